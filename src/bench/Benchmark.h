@@ -0,0 +1,309 @@
+/*
+    Benchmark.h is a tiny microbenchmark harness for the pbrt primitives
+
+    a benchmark is a kernel that performs one operation per call, given an index i
+    (kernels use i to walk over a pool of precomputed inputs, so nothing constant folds)
+    a kernel that processes a whole batch per call passes the batch size as items, and is reported per item
+
+    for every benchmark the Runner:
+        * calibrates an iteration count so that one repetition takes at least minTime
+        * runs a few warmup repetitions that are thrown away
+        * runs the timed repetitions and keeps ns/op for each one
+        * reports median, mean, stddev, min and max of ns/op, and ops/sec (from the median)
+
+    end to end scene renders (see bench_Render.h) are recorded as SceneResults next to the kernels
+
+    results can be printed as a table or written out as JSON
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+    // keeps the compiler from throwing away a result that is never read
+    template<typename T>
+    inline void doNotOptimize(const T& value)
+    {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    struct Options
+    {
+        int warmup = 2;
+        int repetitions = 10;
+        double minTime = 0.02; // seconds per repetition
+        std::string filter; // only run benchmarks whose "group/name" contains this
+    };
+
+    struct Stats
+    {
+        double median = 0, mean = 0, stddev = 0, min = 0, max = 0;
+    };
+
+    // computes the summary statistics of a set of samples
+    inline Stats summarize(std::vector<double> samples)
+    {
+        Stats s;
+        if(samples.empty()) return s;
+
+        std::sort(samples.begin(), samples.end());
+        size_t n = samples.size();
+
+        s.min = samples.front();
+        s.max = samples.back();
+        s.median = (n % 2) ? samples[n / 2] : 0.5 * (samples[n/2 - 1] + samples[n/2]);
+
+        double sum = 0;
+        for(double x : samples) sum += x;
+        s.mean = sum / n;
+
+        double var = 0;
+        for(double x : samples) var += (x - s.mean) * (x - s.mean);
+        s.stddev = (n > 1) ? sqrt(var / (n - 1)) : 0.0;
+
+        return s;
+    }
+
+    struct Result
+    {
+        std::string group, name;
+        uint64_t iterations = 0; // operations per repetition
+        std::vector<double> samples; // ns/op of each repetition
+        Stats ns;
+
+        double opsPerSec() const
+        {
+            return ns.median > 0 ? 1e9 / ns.median : 0.0;
+        }
+    };
+
+    // result of rendering one of the canonical scenes end to end
+    struct SceneResult
+    {
+        std::string name;
+        int width = 0, height = 0, spp = 0, threads = 0;
+        uint64_t rays = 0; // primary rays per render
+        double buildSeconds = 0; // creating the shapes and building the aggregate
+        double resolveSeconds = 0; // converting the film to 8 bit pixels
+        std::vector<double> samples; // seconds of each timed render
+        Stats renderSeconds;
+        double sceneMemoryMB = 0; // the most resident memory the process held for this scene, above what it held before
+        uint32_t checksum = 0; // hash of the resolved image, equal checksums mean identical images
+
+        double raysPerSec() const
+        {
+            return renderSeconds.median > 0 ? rays / renderSeconds.median : 0.0;
+        }
+    };
+
+    // writes s to f as a JSON string literal
+    inline void writeJSONString(FILE* f, const std::string& s)
+    {
+        fputc('"', f);
+        for(char c : s)
+        {
+            if(c == '"' || c == '\\') fputc('\\', f);
+            fputc(c, f);
+        }
+        fputc('"', f);
+    }
+
+    class Runner
+    {
+    public:
+        /* PUBLIC MEMBERS */
+        Options options;
+        std::vector<Result> results;
+        std::vector<SceneResult> sceneResults;
+
+        /* CONSTRUCTORS */
+        Runner(const Options& options) :
+            options(options)
+        {}
+
+        /* PUBLIC METHODS */
+        bool selected(const char* group, const char* name) const
+        {
+            if(options.filter.empty()) return true;
+
+            std::string full = std::string(group) + "/" + name;
+            return full.find(options.filter) != std::string::npos;
+        }
+
+        // times kernel(i) and records the result, in ns per item when every call does items operations
+        template<typename Kernel>
+        void run(const char* group, const char* name, Kernel&& kernel, uint64_t items = 1)
+        {
+            if( !selected(group, name) ) return;
+
+            // calibrate: double the iteration count until one repetition is long enough
+            uint64_t iterations = 1;
+            while(true)
+            {
+                double t = timeIterations(kernel, iterations);
+                if(t >= options.minTime || iterations >= (1ull << 40)) break;
+
+                // jump most of the way there once we have a usable estimate
+                if(t > options.minTime * 0.01)
+                    iterations = std::max<uint64_t>(iterations * 2, (uint64_t)(iterations * options.minTime * 1.2 / t));
+                else
+                    iterations *= 10;
+            }
+
+            for(int w = 0; w < options.warmup; w++)
+                timeIterations(kernel, iterations);
+
+            Result r;
+            r.group = group;
+            r.name = name;
+            r.iterations = iterations;
+            for(int rep = 0; rep < options.repetitions; rep++)
+                r.samples.push_back( timeIterations(kernel, iterations) * 1e9 / (iterations * items) );
+            r.ns = summarize(r.samples);
+
+            printResult(r);
+            results.push_back(r);
+        }
+
+        // folds the results of another run of the same benchmarks into this one (samples are pooled)
+        void merge(const Runner& other)
+        {
+            for(const Result& o : other.results)
+            {
+                auto it = std::find_if(results.begin(), results.end(),
+                    [&](const Result& r) { return r.group == o.group && r.name == o.name; });
+                if(it == results.end()) { results.push_back(o); continue; }
+
+                it->samples.insert(it->samples.end(), o.samples.begin(), o.samples.end());
+                it->ns = summarize(it->samples);
+            }
+            for(const SceneResult& o : other.sceneResults)
+            {
+                auto it = std::find_if(sceneResults.begin(), sceneResults.end(),
+                    [&](const SceneResult& r) { return r.name == o.name; });
+                if(it == sceneResults.end()) { sceneResults.push_back(o); continue; }
+
+                it->samples.insert(it->samples.end(), o.samples.begin(), o.samples.end());
+                it->renderSeconds = summarize(it->samples);
+                it->buildSeconds = std::min(it->buildSeconds, o.buildSeconds);
+                it->resolveSeconds = std::min(it->resolveSeconds, o.resolveSeconds);
+                it->sceneMemoryMB = std::max(it->sceneMemoryMB, o.sceneMemoryMB);
+            }
+        }
+
+        void printHeader() const
+        {
+            printf("%-44s %12s %12s %10s %14s\n", "benchmark", "ns/op", "min", "+/-", "ops/sec");
+        }
+
+        void printResult(const Result& r) const
+        {
+            std::string full = r.group + "/" + r.name;
+            printf("%-44s %12.3f %12.3f %9.1f%% %14.0f\n",
+                full.c_str(), r.ns.median, r.ns.min,
+                r.ns.median > 0 ? 100.0 * r.ns.stddev / r.ns.median : 0.0,
+                r.opsPerSec());
+            fflush(stdout);
+        }
+
+        // writes every result to path as JSON, returns false if the file can't be opened
+        bool writeJSON(const char* path) const
+        {
+            FILE* f = fopen(path, "w");
+            if(!f) return false;
+
+            fprintf(f, "{\n  \"schema\": \"rt-bench-1\",\n");
+            fprintf(f, "  \"options\": { \"warmup\": %d, \"repetitions\": %d, \"min_time\": %g },\n",
+                options.warmup, options.repetitions, options.minTime);
+            fprintf(f, "  \"benchmarks\": [\n");
+            for(size_t i = 0; i < results.size(); i++)
+            {
+                const Result& r = results[i];
+                fprintf(f, "    { \"group\": ");
+                writeJSONString(f, r.group);
+                fprintf(f, ", \"name\": ");
+                writeJSONString(f, r.name);
+                fprintf(f, ", \"iterations\": %llu,\n", (unsigned long long)r.iterations);
+                fprintf(f, "      \"ns_per_op\": { \"median\": %.6g, \"mean\": %.6g, \"stddev\": %.6g, \"min\": %.6g, \"max\": %.6g },\n",
+                    r.ns.median, r.ns.mean, r.ns.stddev, r.ns.min, r.ns.max);
+                fprintf(f, "      \"ops_per_sec\": %.6g,\n", r.opsPerSec());
+                fprintf(f, "      \"samples\": [");
+                for(size_t s = 0; s < r.samples.size(); s++)
+                    fprintf(f, "%s%.6g", s ? ", " : "", r.samples[s]);
+                fprintf(f, "] }%s\n", (i + 1 < results.size()) ? "," : "");
+            }
+            fprintf(f, "  ],\n  \"scenes\": [\n");
+            for(size_t i = 0; i < sceneResults.size(); i++)
+            {
+                const SceneResult& r = sceneResults[i];
+                fprintf(f, "    { \"name\": ");
+                writeJSONString(f, r.name);
+                fprintf(f, ", \"width\": %d, \"height\": %d, \"spp\": %d, \"threads\": %d, \"rays\": %llu,\n",
+                    r.width, r.height, r.spp, r.threads, (unsigned long long)r.rays);
+                fprintf(f, "      \"build_s\": %.6g, \"resolve_s\": %.6g, \"scene_memory_mb\": %.6g, \"checksum\": \"%08x\",\n",
+                    r.buildSeconds, r.resolveSeconds, r.sceneMemoryMB, r.checksum);
+                fprintf(f, "      \"render_s\": { \"median\": %.6g, \"mean\": %.6g, \"stddev\": %.6g, \"min\": %.6g, \"max\": %.6g },\n",
+                    r.renderSeconds.median, r.renderSeconds.mean, r.renderSeconds.stddev, r.renderSeconds.min, r.renderSeconds.max);
+                fprintf(f, "      \"rays_per_sec\": %.6g,\n", r.raysPerSec());
+                fprintf(f, "      \"samples\": [");
+                for(size_t s = 0; s < r.samples.size(); s++)
+                    fprintf(f, "%s%.6g", s ? ", " : "", r.samples[s]);
+                fprintf(f, "] }%s\n", (i + 1 < sceneResults.size()) ? "," : "");
+            }
+            fprintf(f, "  ]\n}\n");
+
+            fclose(f);
+            return true;
+        }
+
+    private:
+        /* PRIVATE METHODS */
+        // returns the number of seconds it took to call kernel(i) for i in [0, iterations)
+        template<typename Kernel>
+        static double timeIterations(Kernel& kernel, uint64_t iterations)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for(uint64_t i = 0; i < iterations; i++)
+                kernel(i);
+            auto end = std::chrono::steady_clock::now();
+
+            return std::chrono::duration<double>(end - start).count();
+        }
+    };
+
+    // size of the input pools the kernels cycle through (a power of two, so i & POOL_MASK is cheap)
+    constexpr size_t POOL_SIZE = 1024;
+    constexpr size_t POOL_MASK = POOL_SIZE - 1;
+
+    // deterministic source of benchmark inputs (seeded, so every run times the same data)
+    class Random
+    {
+    private:
+        std::mt19937 rng;
+
+    public:
+        Random(uint32_t seed) :
+            rng(seed)
+        {}
+
+        float uniform(float lo, float hi)
+        {
+            return std::uniform_real_distribution<float>(lo, hi)(rng);
+        }
+    };
+
+} // bench
+
+#endif // BENCHMARK_H
@@ -0,0 +1,248 @@
+/*
+    Json.h is a minimal JSON reader, just enough to load the files bench writes (baselines)
+
+    json::parseFile() reads a file into a tree of json::Values, or returns false (with an error message) if the text is malformed
+    there is no writer, Benchmark.h prints its JSON directly
+*/
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace json
+{
+    struct Value
+    {
+        enum Type { Null, Bool, Number, String, Array, Object };
+
+        /* PUBLIC MEMBERS */
+        Type type = Null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<Value> array;
+        std::map<std::string, Value> object;
+
+        /* PUBLIC METHODS */
+        bool isNull() const { return type == Null; }
+
+        // returns the member called key, or a null Value if there isn't one
+        const Value& operator[](const std::string& key) const
+        {
+            static const Value null;
+            if(type != Object) return null;
+
+            auto it = object.find(key);
+            return (it == object.end()) ? null : it->second;
+        }
+
+        double asNumber(double fallback = 0.0) const
+        {
+            return (type == Number) ? number : fallback;
+        }
+
+        std::string asString(const std::string& fallback = "") const
+        {
+            return (type == String) ? string : fallback;
+        }
+    };
+
+    class Parser
+    {
+    private:
+        /* PRIVATE MEMBERS */
+        const char* p;
+        const char* end;
+
+    public:
+        /* PUBLIC MEMBERS */
+        std::string error;
+
+        /* CONSTRUCTORS */
+        Parser(const std::string& text) :
+            p(text.data()),
+            end(text.data() + text.size())
+        {}
+
+        /* PUBLIC METHODS */
+        bool parse(Value* out)
+        {
+            if( !parseValue(out) ) return false;
+
+            skipWhitespace();
+            if(p != end) return fail("trailing characters");
+
+            return true;
+        }
+
+    private:
+        /* PRIVATE METHODS */
+        bool fail(const char* message)
+        {
+            if(error.empty()) error = message;
+            return false;
+        }
+
+        void skipWhitespace()
+        {
+            while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+        }
+
+        bool literal(const char* word)
+        {
+            const char* q = p;
+            for(const char* w = word; *w; w++, q++)
+                if(q >= end || *q != *w) return false;
+            p = q;
+
+            return true;
+        }
+
+        bool parseValue(Value* out)
+        {
+            skipWhitespace();
+            if(p >= end) return fail("unexpected end of input");
+
+            if(*p == '{') return parseObject(out);
+            if(*p == '[') return parseArray(out);
+            if(*p == '"')
+            {
+                out->type = Value::String;
+                return parseString(&out->string);
+            }
+            if( literal("true") )  { out->type = Value::Bool; out->boolean = true;  return true; }
+            if( literal("false") ) { out->type = Value::Bool; out->boolean = false; return true; }
+            if( literal("null") )  { out->type = Value::Null; return true; }
+
+            // numbers (strtod accepts a superset of JSON numbers, which is fine for reading our own files)
+            char* numberEnd = nullptr;
+            std::string rest(p, std::min<size_t>(end - p, 64));
+            double number = strtod(rest.c_str(), &numberEnd);
+            if(numberEnd == rest.c_str()) return fail("unexpected character");
+
+            out->type = Value::Number;
+            out->number = number;
+            p += numberEnd - rest.c_str();
+
+            return true;
+        }
+
+        bool parseString(std::string* out)
+        {
+            p++; // opening quote
+            while(p < end && *p != '"')
+            {
+                if(*p == '\\')
+                {
+                    if(++p >= end) break;
+                    switch(*p)
+                    {
+                        case 'n': out->push_back('\n'); break;
+                        case 't': out->push_back('\t'); break;
+                        case 'r': out->push_back('\r'); break;
+                        case 'b': out->push_back('\b'); break;
+                        case 'f': out->push_back('\f'); break;
+                        case 'u': // only ascii escapes are needed for our files
+                            if(end - p < 5) return fail("bad unicode escape");
+                            out->push_back( (char)strtol(std::string(p + 1, 4).c_str(), nullptr, 16) );
+                            p += 4;
+                            break;
+                        default: out->push_back(*p); break;
+                    }
+                    p++;
+                }
+                else
+                    out->push_back(*p++);
+            }
+            if(p >= end) return fail("unterminated string");
+            p++; // closing quote
+
+            return true;
+        }
+
+        bool parseArray(Value* out)
+        {
+            out->type = Value::Array;
+            p++;
+            skipWhitespace();
+            if(p < end && *p == ']') { p++; return true; }
+
+            while(true)
+            {
+                out->array.emplace_back();
+                if( !parseValue(&out->array.back()) ) return false;
+
+                skipWhitespace();
+                if(p < end && *p == ',') { p++; continue; }
+                if(p < end && *p == ']') { p++; return true; }
+
+                return fail("expected , or ] in array");
+            }
+        }
+
+        bool parseObject(Value* out)
+        {
+            out->type = Value::Object;
+            p++;
+            skipWhitespace();
+            if(p < end && *p == '}') { p++; return true; }
+
+            while(true)
+            {
+                skipWhitespace();
+                std::string key;
+                if(p >= end || *p != '"') return fail("expected string key in object");
+                if( !parseString(&key) ) return false;
+
+                skipWhitespace();
+                if(p >= end || *p != ':') return fail("expected : in object");
+                p++;
+
+                if( !parseValue(&out->object[key]) ) return false;
+
+                skipWhitespace();
+                if(p < end && *p == ',') { p++; continue; }
+                if(p < end && *p == '}') { p++; return true; }
+
+                return fail("expected , or } in object");
+            }
+        }
+    };
+
+    // reads and parses the file at path, returns false (and sets error) on failure
+    inline bool parseFile(const char* path, Value* out, std::string* error)
+    {
+        FILE* f = fopen(path, "rb");
+        if(!f)
+        {
+            *error = std::string("can't open ") + path;
+            return false;
+        }
+
+        std::string text;
+        char buffer[1 << 16];
+        size_t n;
+        while( (n = fread(buffer, 1, sizeof(buffer), f)) > 0 )
+            text.append(buffer, n);
+        fclose(f);
+
+        Parser parser(text);
+        if( !parser.parse(out) )
+        {
+            *error = parser.error;
+            return false;
+        }
+
+        return true;
+    }
+} // json
+
+#endif // JSON_H
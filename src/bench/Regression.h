@@ -0,0 +1,180 @@
+/*
+    Regression.h compares a fresh set of benchmark results against a baseline JSON file (one written by bench --json)
+
+    for every kernel (ns/op) and every scene (render seconds) present in both, the change in the median is
+    reported along with a 95% bootstrap confidence interval for the ratio of medians (current / baseline)
+
+    a change is only flagged when the whole interval lies beyond the threshold:
+        * SLOWER  -> the interval is entirely above +threshold (a regression)
+        * faster  -> the interval is entirely below -threshold
+        * ~       -> anything else (no significant change)
+    at least MIN_SAMPLES samples on each side are needed, otherwise the verdict is "n/a"
+*/
+
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Json.h"
+
+namespace regression
+{
+    constexpr int MIN_SAMPLES = 3;
+    constexpr int RESAMPLES = 2000;
+
+    enum Verdict { SAME, FASTER, SLOWER, NOT_ENOUGH_SAMPLES };
+
+    struct Comparison
+    {
+        std::string name;
+        const char* unit;
+        double scale; // multiplies the raw values for printing
+        double baseline, current; // medians
+        double ratio, lo, hi; // current / baseline, and its confidence interval
+        Verdict verdict;
+    };
+
+    inline double median(std::vector<double> v)
+    {
+        return bench::summarize(std::move(v)).median;
+    }
+
+    // 95% percentile bootstrap interval for median(current) / median(baseline)
+    // the generator is seeded, so the same inputs always give the same interval
+    inline void bootstrapRatio(const std::vector<double>& baseline, const std::vector<double>& current, double* lo, double* hi)
+    {
+        std::mt19937 rng(12345);
+        std::vector<double> ratios(RESAMPLES);
+        std::vector<double> b(baseline.size()), c(current.size());
+        std::uniform_int_distribution<size_t> pickB(0, baseline.size() - 1), pickC(0, current.size() - 1);
+
+        for(int i = 0; i < RESAMPLES; i++)
+        {
+            for(double& x : b) x = baseline[pickB(rng)];
+            for(double& x : c) x = current[pickC(rng)];
+
+            double mb = median(b);
+            ratios[i] = (mb > 0) ? median(c) / mb : 1.0;
+        }
+
+        std::sort(ratios.begin(), ratios.end());
+        *lo = ratios[(size_t)(0.025 * (RESAMPLES - 1))];
+        *hi = ratios[(size_t)(0.975 * (RESAMPLES - 1))];
+    }
+
+    inline Comparison compare(const std::string& name, const char* unit, double scale,
+        const std::vector<double>& baseline, const std::vector<double>& current, double threshold)
+    {
+        Comparison c;
+        c.name = name;
+        c.unit = unit;
+        c.scale = scale;
+        c.baseline = median(baseline);
+        c.current = median(current);
+        c.ratio = (c.baseline > 0) ? c.current / c.baseline : 1.0;
+        c.lo = c.hi = c.ratio;
+
+        if((int)baseline.size() < MIN_SAMPLES || (int)current.size() < MIN_SAMPLES)
+        {
+            c.verdict = NOT_ENOUGH_SAMPLES;
+            return c;
+        }
+
+        bootstrapRatio(baseline, current, &c.lo, &c.hi);
+        if(c.lo > 1.0 + threshold)      c.verdict = SLOWER;
+        else if(c.hi < 1.0 - threshold) c.verdict = FASTER;
+        else                            c.verdict = SAME;
+
+        return c;
+    }
+
+    inline std::vector<double> samplesOf(const json::Value& entry)
+    {
+        std::vector<double> samples;
+        for(const json::Value& v : entry["samples"].array)
+            samples.push_back(v.asNumber());
+
+        return samples;
+    }
+
+    inline void printComparison(const Comparison& c)
+    {
+        static const char* verdicts[] = { "~", "faster", "SLOWER", "n/a" };
+
+        char ci[48];
+        snprintf(ci, sizeof(ci), "[%+.1f%%, %+.1f%%]", 100.0 * (c.lo - 1.0), 100.0 * (c.hi - 1.0));
+        printf("%-40s %11.3f %-2s %11.3f %-2s %+8.1f%%  %-20s %s\n", c.name.c_str(),
+            c.baseline * c.scale, c.unit, c.current * c.scale, c.unit,
+            100.0 * (c.ratio - 1.0), ci, verdicts[c.verdict]);
+    }
+
+    // compares runner's results with the baseline file, prints a diff table, and returns the number of regressions
+    // (or -1 if the baseline couldn't be read)
+    inline int compareWithBaseline(const bench::Runner& runner, const char* baselinePath, double threshold)
+    {
+        json::Value baseline;
+        std::string error;
+        if( !json::parseFile(baselinePath, &baseline, &error) )
+        {
+            printf("[bench] failed to read baseline %s: %s\n", baselinePath, error.c_str());
+            return -1;
+        }
+
+        std::vector<Comparison> comparisons;
+        std::vector<std::string> unmatched;
+
+        for(const bench::Result& r : runner.results)
+        {
+            const json::Value* match = nullptr;
+            for(const json::Value& entry : baseline["benchmarks"].array)
+                if(entry["group"].asString() == r.group && entry["name"].asString() == r.name) match = &entry;
+
+            std::string name = r.group + "/" + r.name;
+            if(match) comparisons.push_back( compare(name, "ns", 1.0, samplesOf(*match), r.samples, threshold) );
+            else      unmatched.push_back(name);
+        }
+        for(const bench::SceneResult& r : runner.sceneResults)
+        {
+            const json::Value* match = nullptr;
+            for(const json::Value& entry : baseline["scenes"].array)
+                if(entry["name"].asString() == r.name) match = &entry;
+
+            std::string name = "scene/" + r.name;
+            if(match)
+            {
+                // renders at different settings can't be compared
+                bool sameSettings = (int)(*match)["width"].asNumber() == r.width && (int)(*match)["height"].asNumber() == r.height &&
+                                    (int)(*match)["spp"].asNumber() == r.spp && (int)(*match)["threads"].asNumber() == r.threads;
+                if(sameSettings) comparisons.push_back( compare(name, "ms", 1e3, samplesOf(*match), r.samples, threshold) );
+                else             unmatched.push_back(name + " (different resolution, spp or threads)");
+            }
+            else unmatched.push_back(name);
+        }
+
+        printf("\ncomparing against %s (threshold %.1f%%, %d%% confidence)\n", baselinePath, 100.0 * threshold, 95);
+        printf("%-40s %14s %14s %9s  %-20s %s\n", "benchmark", "baseline", "current", "change", "95% CI", "verdict");
+
+        int regressions = 0, improvements = 0;
+        for(const Comparison& c : comparisons)
+        {
+            printComparison(c);
+            if(c.verdict == SLOWER) regressions++;
+            if(c.verdict == FASTER) improvements++;
+        }
+        for(const std::string& name : unmatched)
+            printf("%-40s not in baseline\n", name.c_str());
+
+        printf("%d regression(s), %d improvement(s), %zu compared\n", regressions, improvements, comparisons.size());
+
+        return regressions;
+    }
+} // regression
+
+#endif // REGRESSION_H
@@ -0,0 +1,189 @@
+/*
+    Scenes.h builds the canonical benchmark scenes
+    every scene is generated from a fixed seed, so every run renders exactly the same thing
+
+    the scenes are framed for canonicalCamera(), which looks down +z like rtiow's camera:
+    everything lives in x in [-aspect, aspect], y in [-1, 1] and z in [5, 13]
+*/
+
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <stdint.h>
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Camera.h"
+#include "Sphere.h"
+#include "SphereSoup.h"
+#include "TriangleMesh.h"
+
+namespace scenes
+{
+    typedef std::vector<std::shared_ptr<Shape>> ShapeList;
+
+    struct SceneDescription
+    {
+        const char* name;
+        std::function<ShapeList()> build; // nullptr -> not available in this build
+        const char* note;
+    };
+
+    // the same orthographic camera rtiow uses, with the screen window matched to the film's aspect ratio
+    inline std::unique_ptr<OrthographicCamera> canonicalCamera(Film* film)
+    {
+        float aspect = (float)film->xResolution / (float)film->yResolution;
+        const float screen[4] = { -aspect, aspect, -1, 1 };
+
+        return std::make_unique<OrthographicCamera>(Transform::translate( Vector(0, 0, 1) ), screen,
+            0.0f, 10.0f, 0.0f, 0.0f, 1.0f, 1.0f, film);
+    }
+
+    inline ShapeList singleSphere()
+    {
+        ShapeList shapes;
+        shapes.push_back( std::make_shared<Sphere>(Transform::translate( Vector(0, 0, 8) ), false, 0.8f) );
+
+        return shapes;
+    }
+
+    // n spheres of random size scattered through the view volume
+    inline ShapeList randomSpheres(int n, uint32_t seed)
+    {
+        bench::Random random(seed);
+
+        ShapeList shapes;
+        shapes.reserve(n);
+        for(int i = 0; i < n; i++)
+        {
+            Vector center( random.uniform(-1.4f, 1.4f), random.uniform(-1.05f, 1.05f), random.uniform(5.0f, 13.0f) );
+            float radius = random.uniform(0.005f, 0.02f);
+            shapes.push_back( std::make_shared<Sphere>(Transform::translate(center), false, radius) );
+        }
+
+        return shapes;
+    }
+
+    // the centers of an n^3 lattice filling the view volume, and the radius of the spheres placed on it
+    inline std::vector<Point> latticeCenters(int n)
+    {
+        std::vector<Point> centers;
+        centers.reserve((size_t)n * n * n);
+        for(int z = 0; z < n; z++)
+            for(int y = 0; y < n; y++)
+                for(int x = 0; x < n; x++)
+                    centers.push_back( Point(
+                        rt::lerp((x + 0.5f) / n, -1.4f, 1.4f),
+                        rt::lerp((y + 0.5f) / n, -1.05f, 1.05f),
+                        rt::lerp((z + 0.5f) / n, 5.0f, 13.0f)
+                    ) );
+
+        return centers;
+    }
+    inline float latticeRadius(int n)
+    {
+        return 0.4f * 2.8f / n;
+    }
+
+    // n^3 separate Spheres on the lattice, each with a translation of its own
+    inline ShapeList latticeSpheres(int n)
+    {
+        const float radius = latticeRadius(n);
+        ShapeList shapes;
+        shapes.reserve((size_t)n * n * n);
+        for(const Point& center : latticeCenters(n))
+            shapes.push_back( std::make_shared<Sphere>(Transform::translate( Vector(center.x, center.y, center.z) ), false, radius) );
+
+        return shapes;
+    }
+
+    // n^3 nests of `shells` concentric spheres on the lattice, every shell cut away (by phi_max) a little more than
+    // the one inside it so each layer shows
+    // all the shells of a nest share its placement, so the scene has n^3 distinct transforms for n^3 * shells shapes
+    inline ShapeList latticeShells(int n, int shells)
+    {
+        const float radius = latticeRadius(n);
+        ShapeList shapes;
+        shapes.reserve((size_t)n * n * n * shells);
+        for(const Point& center : latticeCenters(n))
+        {
+            Transform placement = Transform::translate( Vector(center.x, center.y, center.z) );
+            for(int k = 0; k < shells; k++)
+            {
+                float shell = (float)(k + 1) / shells;
+                shapes.push_back( std::make_shared<Sphere>(placement, false, radius * shell,
+                    -radius, radius, rt::TWOPI * (1.0f - 0.75f * shell)) );
+            }
+        }
+
+        return shapes;
+    }
+
+    // the same lattice of spheres as one SphereSoup
+    inline ShapeList sphereSoupLattice(int n)
+    {
+        std::vector<Point> centers = latticeCenters(n);
+        std::vector<float> radii(centers.size(), latticeRadius(n));
+
+        ShapeList shapes;
+        shapes.push_back( std::make_shared<SphereSoup>(centers, radii) );
+
+        return shapes;
+    }
+
+    // a rippled heightfield of n x n vertices (2 (n - 1)^2 triangles) facing the camera, with normals and uvs
+    inline ShapeList heightfieldMesh(int n)
+    {
+        std::vector<Point> positions;
+        std::vector<Normal> normals;
+        std::vector<float> uvs;
+        positions.reserve((size_t)n * n);
+        normals.reserve((size_t)n * n);
+        uvs.reserve(2 * (size_t)n * n);
+        for(int y = 0; y < n; y++)
+            for(int x = 0; x < n; x++)
+            {
+                float u = (float)x / (n - 1), v = (float)y / (n - 1);
+                float px = rt::lerp(u, -1.4f, 1.4f), py = rt::lerp(v, -1.05f, 1.05f);
+                // z = 9 + 0.5 sin(5x) cos(7y), and its normal (dz/dx, dz/dy, -1) faces the camera
+                positions.push_back( Point(px, py, 9.0f + 0.5f * std::sin(5.0f * px) * std::cos(7.0f * py)) );
+                normals.push_back( normalize( Normal(2.5f * std::cos(5.0f * px) * std::cos(7.0f * py),
+                    -3.5f * std::sin(5.0f * px) * std::sin(7.0f * py), -1.0f) ) );
+                uvs.push_back(u);
+                uvs.push_back(v);
+            }
+
+        std::vector<uint32_t> indices;
+        indices.reserve(6 * (size_t)(n - 1) * (n - 1));
+        for(int y = 0; y + 1 < n; y++)
+            for(int x = 0; x + 1 < n; x++)
+            {
+                uint32_t a = y * n + x, b = a + 1, c = a + n, d = c + 1;
+                for(uint32_t i : { a, b, d, a, d, c })
+                    indices.push_back(i);
+            }
+
+        ShapeList shapes;
+        shapes.push_back( std::make_shared<TriangleMesh>(Transform(), false, indices, positions, normals, uvs) );
+
+        return shapes;
+    }
+
+    inline std::vector<SceneDescription> canonicalScenes()
+    {
+        return {
+            { "sphere",                [] { return singleSphere(); },            "" },
+            { "spheres-10k",           [] { return randomSpheres(10000, 42); },  "" },
+            { "spheres-1m",            [] { return latticeSpheres(100); },       "" },
+            { "spheres-1m-soup",       [] { return sphereSoupLattice(100); },    "" },
+            { "shells-50k",            [] { return latticeShells(10, 50); },     "" },
+            { "mesh",                  [] { return heightfieldMesh(512); },      "" },
+        };
+    }
+} // scenes
+
+#endif // SCENES_H
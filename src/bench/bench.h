@@ -0,0 +1,31 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "bench_Vector.h"
+#include "bench_Packet.h"
+#include "bench_Mat4.h"
+#include "bench_Transform.h"
+#include "bench_TransformBatch.h"
+#include "bench_Bbox.h"
+#include "bench_Sphere.h"
+#include "bench_RayQueue.h"
+#include "bench_MeshLoader.h"
+#include "bench_Render.h"
+
+namespace bench {
+    inline void run_all_benchmarks(Runner& runner) {
+        runner.printHeader();
+
+        bench_vector::run_all_vector_benchmarks(runner);
+        bench_packet::run_all_packet_benchmarks(runner);
+        bench_mat4::run_all_mat4_benchmarks(runner);
+        bench_transform::run_all_transform_benchmarks(runner);
+        bench_transform_batch::run_all_transform_batch_benchmarks(runner);
+        bench_bbox::run_all_bbox_benchmarks(runner);
+        bench_sphere::run_all_sphere_benchmarks(runner);
+        bench_ray_queue::run_all_ray_queue_benchmarks(runner);
+        bench_mesh_loader::run_all_mesh_loader_benchmarks(runner);
+    }
+}
+
+#endif // BENCH_H
@@ -0,0 +1,41 @@
+/*
+    microbenchmarks for ray-Bbox intersection
+*/
+
+#ifndef BENCH_BBOX_H
+#define BENCH_BBOX_H
+
+#include "Benchmark.h"
+#include "Bbox.h"
+#include "Ray.h"
+
+namespace bench_bbox
+{
+    inline void run_all_bbox_benchmarks(bench::Runner& runner)
+    {
+        bench::Random random(4);
+
+        Bbox box( Point(-1, -1, -1), Point(1, 1, 1) );
+
+        // rays that start outside the unit box, half aimed at it and half aimed away
+        std::vector<Ray> hits(bench::POOL_SIZE), misses(bench::POOL_SIZE);
+        for(size_t i = 0; i < bench::POOL_SIZE; i++)
+        {
+            Point o( random.uniform(-5, 5), random.uniform(-5, 5), -10.0f );
+            Point target( random.uniform(-0.9f, 0.9f), random.uniform(-0.9f, 0.9f), random.uniform(-0.9f, 0.9f) );
+            hits[i] = Ray(o, target - o);
+            misses[i] = Ray(o, o - target);
+        }
+
+        runner.run("bbox", "intersectsP/hit", [&](uint64_t i) {
+            float t0, t1;
+            bench::doNotOptimize( box.intersectsP(hits[i & bench::POOL_MASK], &t0, &t1) );
+        });
+        runner.run("bbox", "intersectsP/miss", [&](uint64_t i) {
+            float t0, t1;
+            bench::doNotOptimize( box.intersectsP(misses[i & bench::POOL_MASK], &t0, &t1) );
+        });
+    }
+} // bench_bbox
+
+#endif // BENCH_BBOX_H
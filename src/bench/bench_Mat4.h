@@ -0,0 +1,69 @@
+/*
+    microbenchmarks for the Mat4 kernels
+*/
+
+#ifndef BENCH_MAT4_H
+#define BENCH_MAT4_H
+
+#include "Benchmark.h"
+#include "Mat4.h"
+
+namespace bench_mat4
+{
+    // random, well conditioned matrices (diagonally dominant, so inverse never hits the singular path)
+    inline std::vector<std::shared_ptr<Mat4>> randomMatrices(bench::Random& random)
+    {
+        std::vector<std::shared_ptr<Mat4>> ms(bench::POOL_SIZE);
+        for(auto& m : ms)
+        {
+            float e[16];
+            for(int i = 0; i < 16; i++)
+                e[i] = random.uniform(-1, 1) + ((i % 5 == 0) ? 4.0f : 0.0f);
+            m = std::make_shared<Mat4>(e);
+        }
+
+        return ms;
+    }
+
+    inline void run_all_mat4_benchmarks(bench::Runner& runner)
+    {
+        bench::Random random(2);
+        std::vector<std::shared_ptr<Mat4>> ms = randomMatrices(random);
+
+        runner.run("mat4", "multiply", [&](uint64_t i) {
+            bench::doNotOptimize( Mat4::multiply(ms[i & bench::POOL_MASK], ms[(i + 1) & bench::POOL_MASK]) );
+        });
+        runner.run("mat4", "transpose", [&](uint64_t i) {
+            bench::doNotOptimize( ms[i & bench::POOL_MASK]->transpose() );
+        });
+        runner.run("mat4", "inverse", [&](uint64_t i) {
+            bench::doNotOptimize( ms[i & bench::POOL_MASK]->inverse() );
+        });
+
+        // the allocation free value versions (SSE where available), next to the scalar code they replace
+        std::vector<Mat4> vs(bench::POOL_SIZE);
+        for(size_t i = 0; i < bench::POOL_SIZE; i++)
+            vs[i] = *ms[i];
+
+        runner.run("mat4", "multiply/value", [&](uint64_t i) {
+            bench::doNotOptimize( Mat4::multiply(vs[i & bench::POOL_MASK], vs[(i + 1) & bench::POOL_MASK]) );
+        });
+        runner.run("mat4", "multiply/scalar", [&](uint64_t i) {
+            bench::doNotOptimize( Mat4::multiplyScalar(vs[i & bench::POOL_MASK], vs[(i + 1) & bench::POOL_MASK]) );
+        });
+        runner.run("mat4", "transpose/value", [&](uint64_t i) {
+            bench::doNotOptimize( vs[i & bench::POOL_MASK].getTranspose() );
+        });
+        runner.run("mat4", "transpose/scalar", [&](uint64_t i) {
+            bench::doNotOptimize( vs[i & bench::POOL_MASK].getTransposeScalar() );
+        });
+        runner.run("mat4", "inverse/value", [&](uint64_t i) {
+            bench::doNotOptimize( vs[i & bench::POOL_MASK].getInverse() );
+        });
+        runner.run("mat4", "inverse/scalar", [&](uint64_t i) {
+            bench::doNotOptimize( vs[i & bench::POOL_MASK].getInverseScalar() );
+        });
+    }
+} // bench_mat4
+
+#endif // BENCH_MAT4_H
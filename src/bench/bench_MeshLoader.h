@@ -0,0 +1,121 @@
+/*
+    benchmarks for loadMesh(), on heightfield meshes written out as OBJ, ascii PLY and binary PLY files of a
+    few sizes
+
+    results are in ns per byte of the file, for the whole load (parsing and TriangleMesh::build()), and every
+    file's parsing throughput in MB/s is printed after it, which is the part that grows with the file's size
+    the files are written to the temp directory before the first one is timed and removed afterwards
+*/
+
+#ifndef BENCH_MESH_LOADER_H
+#define BENCH_MESH_LOADER_H
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <string>
+
+#include "Benchmark.h"
+#include "MeshLoader.h"
+
+namespace bench_mesh_loader
+{
+    // an n x n heightfield as format ("obj", "ply-ascii" or "ply-binary"), with normals, uvs and quad faces
+    inline void writeHeightfield(const std::string& path, const std::string& format, int n)
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        if(!f) return;
+
+        auto vertex = [n](int x, int y, float* values)
+        {
+            float u = (float)x / (n - 1), v = (float)y / (n - 1);
+            float px = 2.0f * u - 1.0f, py = 2.0f * v - 1.0f;
+            Normal normal = normalize( Normal(-0.6f * std::cos(3.0f * px), 0.4f * std::sin(2.0f * py), 1.0f) );
+            float p[8] = { px, py, 0.2f * std::sin(3.0f * px) + 0.2f * std::cos(2.0f * py), normal.x, normal.y, normal.z, u, v };
+            std::copy(p, p + 8, values);
+        };
+        int quads = (n - 1) * (n - 1);
+
+        if(format == "obj")
+        {
+            float p[8];
+            for(int i = 0; i < n * n; i++) { vertex(i % n, i / n, p); fprintf(f, "v %.6f %.6f %.6f\n", p[0], p[1], p[2]); }
+            for(int i = 0; i < n * n; i++) { vertex(i % n, i / n, p); fprintf(f, "vt %.6f %.6f\n", p[6], p[7]); }
+            for(int i = 0; i < n * n; i++) { vertex(i % n, i / n, p); fprintf(f, "vn %.6f %.6f %.6f\n", p[3], p[4], p[5]); }
+            for(int q = 0; q < quads; q++)
+            {
+                int a = (q / (n - 1)) * n + q % (n - 1) + 1, b = a + 1, c = a + n + 1, d = a + n;
+                fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+            }
+        }
+        else
+        {
+            bool binary = format == "ply-binary";
+            fprintf(f, "ply\nformat %s 1.0\nelement vertex %d\n", binary ? "binary_little_endian" : "ascii", n * n);
+            for(const char* name : { "x", "y", "z", "nx", "ny", "nz", "u", "v" })
+                fprintf(f, "property float %s\n", name);
+            fprintf(f, "element face %d\nproperty list uchar int vertex_indices\nend_header\n", 2 * quads);
+
+            float p[8];
+            for(int i = 0; i < n * n; i++)
+            {
+                vertex(i % n, i / n, p);
+                if(binary) fwrite(p, sizeof(float), 8, f);
+                else fprintf(f, "%.6f %.6f %.6f %.6f %.6f %.6f %.6f %.6f\n", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]);
+            }
+            for(int q = 0; q < quads; q++)
+            {
+                int a = (q / (n - 1)) * n + q % (n - 1), b = a + 1, c = a + n + 1, d = a + n;
+                int triangles[2][3] = { { a, b, c }, { a, c, d } };
+                for(const int* t : triangles)
+                    if(binary)
+                    {
+                        unsigned char three = 3;
+                        fwrite(&three, 1, 1, f);
+                        fwrite(t, sizeof(int), 3, f);
+                    }
+                    else fprintf(f, "3 %d %d %d\n", t[0], t[1], t[2]);
+            }
+        }
+
+        fclose(f);
+    }
+
+    inline void run_all_mesh_loader_benchmarks(bench::Runner& runner)
+    {
+        const char* formats[] = { "obj", "ply-ascii", "ply-binary" };
+        const int sizes[] = { 180, 500 }; // about 4 and 32 MB of OBJ
+
+        for(int n : sizes)
+            for(const char* format : formats)
+            {
+                std::string name = std::string(format) + "/" + std::to_string(n) + "x" + std::to_string(n);
+                if( !runner.selected("meshload", name.c_str()) ) continue;
+
+                std::string path = ( std::filesystem::temp_directory_path() /
+                    ("rt_bench_mesh" + std::to_string(n) + (format[0] == 'o' ? ".obj" : ".ply")) ).string();
+                writeHeightfield(path, format, n);
+                size_t bytes = std::filesystem::exists(path) ? std::filesystem::file_size(path) : 0;
+                if(bytes == 0)
+                {
+                    printf("[bench] can't write %s, skipping %s\n", path.c_str(), name.c_str());
+                    continue;
+                }
+
+                MeshLoadInfo info, fastest;
+                runner.run("meshload", name.c_str(), [&](uint64_t) {
+                    std::shared_ptr<TriangleMesh> mesh = loadMesh(path.c_str(), Transform(), false, TriangleMesh::Watertight, 0, &info);
+                    if(fastest.parseSeconds == 0 || info.parseSeconds < fastest.parseSeconds) fastest = info;
+                    bench::doNotOptimize( mesh ? mesh->nTriangles : 0 );
+                }, bytes);
+                printf("    %.1f MB parsed at %.0f MB/s on %d threads, then built in %.3f s\n",
+                    bytes * 1e-6, fastest.megabytesPerSecond(), fastest.threads, fastest.buildSeconds);
+
+                std::filesystem::remove(path);
+            }
+    }
+} // bench_mesh_loader
+
+#endif // BENCH_MESH_LOADER_H
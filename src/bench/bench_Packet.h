@@ -0,0 +1,63 @@
+/*
+    benchmarks for the packet types in Packet.h against the scalar Vector functions they mirror
+
+    every kernel normalizes the cross product of two arrays of vectors, read from and written back to SoA3s,
+    results are in ns per vector. width 1 is the scalar Vector code, 4 / 8 / 16 are the packet widths
+    (each one only gets its own registers when the target has them, see RT_ARCH in CMakeLists.txt)
+*/
+
+#ifndef BENCH_PACKET_H
+#define BENCH_PACKET_H
+
+#include <string>
+
+#include "Benchmark.h"
+#include "Packet.h"
+#include "SoA.h"
+
+namespace bench_packet
+{
+    template<int N>
+    inline void crossNormalize(const SoA3& a, const SoA3& b, const SoA3& out, size_t n)
+    {
+        for(size_t i = 0; i + N <= n; i += N)
+            normalize( cross(Vec3x<N>::load(a, i), Vec3x<N>::load(b, i)) ).store(out, i);
+    }
+
+    inline void run_all_packet_benchmarks(bench::Runner& runner)
+    {
+        bench::Random random(40);
+
+        const size_t n = bench::POOL_SIZE;
+        SoA3Buffer aBuffer(n), bBuffer(n), outBuffer(n);
+        SoA3 a = aBuffer.soa(), b = bBuffer.soa(), out = outBuffer.soa();
+        for(size_t i = 0; i < n; i++)
+        {
+            a.set(i, random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(-10, 10));
+            b.set(i, random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(-10, 10));
+        }
+
+        runner.run("packet", "cross+normalize/1", [&](uint64_t) {
+            for(size_t i = 0; i < n; i++)
+            {
+                Vector v = normalize( cross(a.vector(i), b.vector(i)) );
+                out.set(i, v.x, v.y, v.z);
+            }
+            bench::doNotOptimize( out.x[0] );
+        }, n);
+        runner.run("packet", "cross+normalize/4", [&](uint64_t) {
+            crossNormalize<4>(a, b, out, n);
+            bench::doNotOptimize( out.x[0] );
+        }, n);
+        runner.run("packet", "cross+normalize/8", [&](uint64_t) {
+            crossNormalize<8>(a, b, out, n);
+            bench::doNotOptimize( out.x[0] );
+        }, n);
+        runner.run("packet", "cross+normalize/16", [&](uint64_t) {
+            crossNormalize<16>(a, b, out, n);
+            bench::doNotOptimize( out.x[0] );
+        }, n);
+    }
+} // bench_packet
+
+#endif // BENCH_PACKET_H
@@ -0,0 +1,85 @@
+/*
+    benchmarks for the RayQueue stages, on rays like the ones bounces produce: they start anywhere in the
+    scene and head anywhere, so consecutive rays walk unrelated parts of the BVH
+
+    the queue is traced as it was generated (unsorted) and after RayQueue::sort() (whose cost is included),
+    one ray at a time and in packets, results are in ns per ray
+    the scene is big enough (200k spheres, a BVH of tens of megabytes) that traversal is memory bound
+*/
+
+#ifndef BENCH_RAY_QUEUE_H
+#define BENCH_RAY_QUEUE_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "RayQueue.h"
+#include "Scenes.h"
+
+namespace bench_ray_queue
+{
+    inline void run_all_ray_queue_benchmarks(bench::Runner& runner)
+    {
+        const int widths[] = { 1, PACKET_WIDTH };
+        std::vector<std::string> names = { "sort" };
+        for(int width : widths)
+        {
+            names.push_back( "extend/unsorted/" + std::to_string(width) );
+            names.push_back( "extend/sorted/" + std::to_string(width) );
+        }
+        // building the scene takes a while, skip it when nothing here runs
+        if( std::none_of(names.begin(), names.end(), [&](const std::string& name) { return runner.selected("rayqueue", name.c_str()); }) )
+            return;
+
+        bench::Random random(43);
+        Scene scene( scenes::randomSpheres(200000, 43) );
+        Bbox bounds = scene.worldBound();
+
+        RayQueue queue;
+        std::vector<Ray> incoherent(queue.capacity);
+        for(int i = 0; i < queue.capacity; i++)
+        {
+            Point o(
+                random.uniform(bounds.p_min.x, bounds.p_max.x),
+                random.uniform(bounds.p_min.y, bounds.p_max.y),
+                random.uniform(bounds.p_min.z, bounds.p_max.z)
+            );
+            Vector d( random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1) );
+            incoherent[i] = Ray(o, normalize(d));
+        }
+
+        // back to the generated rays, in queue order
+        auto refill = [&]()
+        {
+            queue.clear();
+            for(int i = 0; i < queue.capacity; i++)
+                queue.rays[ queue.push(Sample()) ] = incoherent[i];
+        };
+
+        runner.run("rayqueue", "sort", [&](uint64_t) {
+            refill();
+            queue.sort(bounds);
+            bench::doNotOptimize( queue.order[0] );
+        }, queue.capacity);
+
+        for(int width : widths)
+        {
+            std::string suffix = "/" + std::to_string(width);
+            runner.run("rayqueue", ("extend/unsorted" + suffix).c_str(), [&](uint64_t) {
+                refill();
+                queue.extend(scene, width);
+                bench::doNotOptimize( queue.hits[0] );
+            }, queue.capacity);
+            runner.run("rayqueue", ("extend/sorted" + suffix).c_str(), [&](uint64_t) {
+                refill();
+                queue.sort(bounds);
+                queue.extend(scene, width);
+                bench::doNotOptimize( queue.hits[0] );
+            }, queue.capacity);
+        }
+    }
+} // bench_ray_queue
+
+#endif // BENCH_RAY_QUEUE_H
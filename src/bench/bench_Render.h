@@ -0,0 +1,251 @@
+/*
+    end to end render benchmarks over the canonical scenes (see Scenes.h)
+
+    every scene is built once (shapes + aggregate), rendered a few times at a fixed resolution,
+    sample count and seed, and then resolved to 8 bit pixels
+    primary rays/sec comes from the median render time
+    scene MB is the most resident memory the process held while building and rendering the scene, above what it
+    held before (the peak is restarted for every scene, so a big scene doesn't hide the ones after it)
+    with a scene cache directory (see SceneCache.h), a scene is loaded from its cache there when there's one
+    this binary wrote, and cached there otherwise, so build s is the load time on a hit
+*/
+
+#ifndef BENCH_RENDER_H
+#define BENCH_RENDER_H
+
+#include <stdio.h>
+#include <sys/resource.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <filesystem>
+#include <thread>
+
+#include "Benchmark.h"
+#include "PerfCounters.h"
+#include "Renderer.h"
+#include "SceneCache.h"
+#include "Scenes.h"
+#include "Trace.h"
+#include "TransformCache.h"
+
+namespace bench_render
+{
+    struct RenderOptions
+    {
+        int width = 640, height = 480;
+        int x_samples = 2, y_samples = 2;
+        uint32_t seed = 7;
+        int threads = 0; // 0 -> one per hardware thread
+        int packetSize = PACKET_WIDTH; // see Renderer::packetSize
+        int streamSize = 0; // see Renderer::streamSize
+        bool sortRays = false; // see Renderer::sortRays
+        int repetitions = 3;
+        const char* imageDir = nullptr; // if set, every scene's image is written here as <name>.ppm
+        bool heatmaps = false; // if set, one more (untimed) render records per-pixel costs, see writeHeatmaps()
+        const char* sceneCacheDir = nullptr; // if set, scenes are loaded from and cached to <dir>/<name>.rtscene
+    };
+
+    // resident memory of this process in megabytes: what it holds now, and the most it held since resetPeakMemory()
+    // both come from /proc/self/status on linux; elsewhere there's no current size and the peak is the process's
+    struct ResidentMemory { double currentMB = 0, peakMB = 0; };
+    inline ResidentMemory residentMemory()
+    {
+        ResidentMemory memory;
+#ifdef __linux__
+        FILE* f = fopen("/proc/self/status", "r");
+        char line[256];
+        long kb;
+        while( f && fgets(line, sizeof(line), f) )
+        {
+            if( sscanf(line, "VmRSS: %ld kB", &kb) == 1 ) memory.currentMB = kb / 1024.0;
+            if( sscanf(line, "VmHWM: %ld kB", &kb) == 1 ) memory.peakMB = kb / 1024.0;
+        }
+        if(f) fclose(f);
+#else
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        memory.peakMB = usage.ru_maxrss / 1024.0;
+#endif
+
+        return memory;
+    }
+
+    // hands the memory freed by earlier scenes back to the system and restarts the peak at the current size,
+    // so the next scene's peak is its own
+    inline void resetPeakMemory()
+    {
+#ifdef __GLIBC__
+        malloc_trim(0);
+#endif
+#ifdef __linux__
+        if( FILE* f = fopen("/proc/self/clear_refs", "w") )
+        {
+            fputs("5", f);
+            fclose(f);
+        }
+#endif
+    }
+
+    inline double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // FNV-1a over the resolved pixels
+    inline uint32_t checksum(const std::vector<uint32_t>& pixels)
+    {
+        uint32_t h = 2166136261u;
+        for(uint32_t p : pixels)
+            for(int i = 0; i < 4; i++)
+            {
+                h ^= (p >> (8 * i)) & 0xff;
+                h *= 16777619u;
+            }
+
+        return h;
+    }
+
+    // renders the scene once more with a Heatmap, writes one false color image per metric
+    // (to imageDir, or the working directory) as <name>-heatmap-<metric>.ppm and prints each legend's range
+    inline void writeHeatmaps(const RenderOptions& options, const std::string& name, Renderer& renderer)
+    {
+        Heatmap heatmap(renderer.film.xResolution, renderer.film.yResolution);
+        renderer.heatmap = &heatmap;
+        renderer.film.clear();
+        renderer.render();
+        renderer.heatmap = nullptr;
+
+        static const char* suffixes[Heatmap::N_METRICS] = { "time", "nodes", "tests" };
+        for(int m = 0; m < Heatmap::N_METRICS; m++)
+        {
+            heatmap.metric = (Heatmap::Metric)m;
+            float lo, hi, min, max;
+            heatmap.scaleRange(&lo, &hi);
+            heatmap.range(&min, &max);
+
+            std::string path = std::string(options.imageDir ? options.imageDir : ".") + "/" + name + "-heatmap-" + suffixes[m] + ".ppm";
+            if( heatmap.writePPM(path.c_str()) )
+                printf("    heatmap of %-20s scale %10g - %-10g (max %g) -> %s\n", Heatmap::metricName(heatmap.metric), lo, hi, max, path.c_str());
+            else
+                printf("[bench] failed to write %s\n", path.c_str());
+        }
+    }
+
+    inline void run_scene(bench::Runner& runner, const RenderOptions& options, const scenes::SceneDescription& description)
+    {
+        if( !runner.selected("scene", description.name) ) return;
+        if( !description.build )
+        {
+            printf("%-28s skipped: %s\n", description.name, description.note);
+            return;
+        }
+
+        bench::SceneResult r;
+        r.name = description.name;
+        r.width = options.width;
+        r.height = options.height;
+        r.spp = options.x_samples * options.y_samples;
+
+        resetPeakMemory();
+        double residentBefore = residentMemory().currentMB;
+        const TransformCache& transforms = TransformCache::global();
+        size_t lookupsBefore = transforms.lookups();
+
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<Scene> scene;
+        if(options.sceneCacheDir)
+        {
+            // the scenes are made by code compiled into this binary, so its build time stands in for their source
+            std::string path = std::string(options.sceneCacheDir) + "/" + description.name + ".rtscene";
+            std::string source = std::string(description.name) + " " __DATE__ " " __TIME__;
+            SceneCacheInfo info;
+            scene = loadOrBuildScene(path.c_str(), hashBytes(source.data(), source.size()), description.build, &info);
+            printf("    scene cache %s: %s, %.1f MB\n", info.hit ? "hit" : "miss", path.c_str(), info.bytes * 1e-6);
+        }
+        else
+        {
+            TRACE_SCOPE("build", "scene build");
+            scene = std::make_unique<Scene>( description.build() );
+        }
+        r.buildSeconds = secondsSince(start);
+
+        Film film(options.width, options.height);
+        std::unique_ptr<OrthographicCamera> camera = scenes::canonicalCamera(&film);
+        Renderer renderer(*scene, *camera, film, options.x_samples, options.y_samples, true, options.seed, options.threads);
+        renderer.packetSize = options.packetSize;
+        renderer.streamSize = options.streamSize;
+        renderer.sortRays = options.sortRays;
+        r.threads = renderer.threads > 0 ? renderer.threads : (int)std::thread::hardware_concurrency();
+
+        // one untimed render to warm up caches and the allocator
+        film.clear();
+        r.rays = renderer.render();
+        for(int rep = 0; rep < options.repetitions; rep++)
+        {
+            film.clear();
+            start = std::chrono::steady_clock::now();
+            renderer.render();
+            r.samples.push_back( secondsSince(start) );
+        }
+        r.renderSeconds = bench::summarize(r.samples);
+
+        std::vector<uint32_t> pixels(options.width * options.height);
+        start = std::chrono::steady_clock::now();
+        film.resolve(pixels.data(), options.width * sizeof(uint32_t));
+        r.resolveSeconds = secondsSince(start);
+        r.checksum = checksum(pixels);
+
+        r.sceneMemoryMB = residentMemory().peakMB - residentBefore;
+
+        // without the cache, every shape would keep its own transform and inverse
+        size_t lookups = transforms.lookups() - lookupsBefore;
+        printf("    transform cache: %zu unique of %zu transforms, %.1f MB (%.1f MB as a copy per shape)\n",
+            transforms.size(), lookups, transforms.bytes() / (1024.0 * 1024.0),
+            lookups * 2 * sizeof(AffineTransform) / (1024.0 * 1024.0));
+
+        // statistics and hardware counters add up over the warmup and every timed render
+        if( stats::enabled() )
+        {
+            stats::print(stdout);
+            stats::clear();
+        }
+        if( perf::active() )
+        {
+            perf::print(stdout);
+            perf::clear();
+        }
+
+        printf("%-28s %8.3f %8.3f %8.4f %14.0f %10.1f   %08x\n", r.name.c_str(),
+            r.buildSeconds, r.renderSeconds.median, r.resolveSeconds, r.raysPerSec(), r.sceneMemoryMB, r.checksum);
+        fflush(stdout);
+
+        if(options.imageDir)
+        {
+            std::string path = std::string(options.imageDir) + "/" + r.name + ".ppm";
+            if( !film.writePPM(path.c_str()) )
+                printf("[bench] failed to write %s\n", path.c_str());
+        }
+
+        if(options.heatmaps)
+            writeHeatmaps(options, r.name, renderer);
+
+        runner.sceneResults.push_back(r);
+    }
+
+    inline void run_all_render_benchmarks(bench::Runner& runner, const RenderOptions& options)
+    {
+        printf("rendering %dx%d at %d spp, seed %u\n", options.width, options.height,
+            options.x_samples * options.y_samples, options.seed);
+        printf("%-28s %8s %8s %8s %14s %10s   %s\n", "scene", "build s", "render s", "resolve s", "rays/sec", "scene MB", "checksum");
+        std::error_code ec;
+        if(options.sceneCacheDir) std::filesystem::create_directories(options.sceneCacheDir, ec);
+
+        // every scene's shapes, and so their transforms, are gone once run_scene() returns
+        for(const scenes::SceneDescription& description : scenes::canonicalScenes())
+            run_scene(runner, options, description);
+    }
+} // bench_render
+
+#endif // BENCH_RENDER_H
@@ -0,0 +1,52 @@
+/*
+    microbenchmarks for ray-Sphere intersection
+*/
+
+#ifndef BENCH_SPHERE_H
+#define BENCH_SPHERE_H
+
+#include "Benchmark.h"
+#include "Sphere.h"
+
+namespace bench_sphere
+{
+    inline void run_all_sphere_benchmarks(bench::Runner& runner)
+    {
+        bench::Random random(5);
+
+        Transform placement = Transform::translate( Vector(0.5f, -0.25f, 4.0f) ) * Transform::scale(1.5f, 1.5f, 1.5f);
+        Sphere full(placement, false, 1.0f);
+        Sphere partial(placement, false, 1.0f, -0.5f, 0.8f, rt::TWOPI * 0.75f);
+
+        // rays aimed at the sphere's bounding square (about 3/4 of them hit a full sphere)
+        std::vector<Ray> rays(bench::POOL_SIZE);
+        for(size_t i = 0; i < bench::POOL_SIZE; i++)
+        {
+            Point o( random.uniform(-1, 2), random.uniform(-1.75f, 1.25f), -5.0f );
+            rays[i] = Ray(o, Vector(0, 0, 1));
+        }
+
+        runner.run("sphere", "intersect", [&](uint64_t i) {
+            Hit hit;
+            bench::doNotOptimize( full.intersect(rays[i & bench::POOL_MASK], &hit) );
+        });
+        runner.run("sphere", "intersect/partial", [&](uint64_t i) {
+            Hit hit;
+            bench::doNotOptimize( partial.intersect(rays[i & bench::POOL_MASK], &hit) );
+        });
+        // what a hit costs on top of intersect() once shading asks for its geometry
+        Ray center(Point(0.9f, 0.1f, -5.0f), Vector(0, 0, 1));
+        Hit centerHit;
+        full.intersect(center, &centerHit);
+        runner.run("sphere", "getDifferentialGeometry", [&](uint64_t) {
+            DifferentialGeometry dg;
+            full.getDifferentialGeometry(center, centerHit, &dg);
+            bench::doNotOptimize(dg);
+        });
+        runner.run("sphere", "doesIntersect", [&](uint64_t i) {
+            bench::doNotOptimize( full.doesIntersect(rays[i & bench::POOL_MASK]) );
+        });
+    }
+} // bench_sphere
+
+#endif // BENCH_SPHERE_H
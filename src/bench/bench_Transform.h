@@ -0,0 +1,90 @@
+/*
+    microbenchmarks for applying and composing Transforms
+    the affine group applies the same transform as an AffineTransform (what Shapes hold)
+*/
+
+#ifndef BENCH_TRANSFORM_H
+#define BENCH_TRANSFORM_H
+
+#include "Benchmark.h"
+#include "AffineTransform.h"
+#include "pbrt.h"
+
+namespace bench_transform
+{
+    inline void run_all_transform_benchmarks(bench::Runner& runner)
+    {
+        bench::Random random(3);
+
+        // a handful of typical shape placements (rotation * translation * scale)
+        std::vector<Transform> ts(bench::POOL_SIZE);
+        for(auto& t : ts)
+            t = Transform::translate( Vector(random.uniform(-5, 5), random.uniform(-5, 5), random.uniform(-5, 5)) ) *
+                Transform::rotateY( random.uniform(0, rt::TWOPI) ) *
+                Transform::scale( random.uniform(0.5f, 2), random.uniform(0.5f, 2), random.uniform(0.5f, 2) );
+
+        std::vector<Point> ps(bench::POOL_SIZE);
+        std::vector<Vector> vs(bench::POOL_SIZE);
+        std::vector<Normal> ns(bench::POOL_SIZE);
+        std::vector<Ray> rays(bench::POOL_SIZE);
+        std::vector<Bbox> boxes(bench::POOL_SIZE);
+        for(size_t i = 0; i < bench::POOL_SIZE; i++)
+        {
+            ps[i] = Point(random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(-10, 10));
+            vs[i] = Vector(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1));
+            ns[i] = Normal(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1));
+            rays[i] = Ray(ps[i], vs[i]);
+            boxes[i] = Bbox(ps[i], ps[i] + vs[i] * 4.0f);
+        }
+
+        const Transform& t = ts[0];
+
+        runner.run("transform", "point", [&](uint64_t i) {
+            bench::doNotOptimize( t(ps[i & bench::POOL_MASK]) );
+        });
+        runner.run("transform", "vector", [&](uint64_t i) {
+            bench::doNotOptimize( t(vs[i & bench::POOL_MASK]) );
+        });
+        runner.run("transform", "normal", [&](uint64_t i) {
+            bench::doNotOptimize( t(ns[i & bench::POOL_MASK]) );
+        });
+        runner.run("transform", "ray", [&](uint64_t i) {
+            bench::doNotOptimize( t(rays[i & bench::POOL_MASK]) );
+        });
+        runner.run("transform", "bbox", [&](uint64_t i) {
+            bench::doNotOptimize( t(boxes[i & bench::POOL_MASK]) );
+        });
+        runner.run("transform", "compose", [&](uint64_t i) {
+            bench::doNotOptimize( ts[i & bench::POOL_MASK] * ts[(i + 1) & bench::POOL_MASK] );
+        });
+        runner.run("transform", "getInverse", [&](uint64_t i) {
+            bench::doNotOptimize( ts[i & bench::POOL_MASK].getInverse() );
+        });
+
+        std::vector<AffineTransform> as;
+        for(const auto& t : ts)
+            as.push_back( AffineTransform(t) );
+        const AffineTransform& a = as[0];
+
+        runner.run("affine", "point", [&](uint64_t i) {
+            bench::doNotOptimize( a(ps[i & bench::POOL_MASK]) );
+        });
+        runner.run("affine", "vector", [&](uint64_t i) {
+            bench::doNotOptimize( a(vs[i & bench::POOL_MASK]) );
+        });
+        runner.run("affine", "normal", [&](uint64_t i) {
+            bench::doNotOptimize( a(ns[i & bench::POOL_MASK]) );
+        });
+        runner.run("affine", "ray", [&](uint64_t i) {
+            bench::doNotOptimize( a(rays[i & bench::POOL_MASK]) );
+        });
+        runner.run("affine", "bbox", [&](uint64_t i) {
+            bench::doNotOptimize( a(boxes[i & bench::POOL_MASK]) );
+        });
+        runner.run("affine", "compose", [&](uint64_t i) {
+            bench::doNotOptimize( as[i & bench::POOL_MASK] * as[(i + 1) & bench::POOL_MASK] );
+        });
+    }
+} // bench_transform
+
+#endif // BENCH_TRANSFORM_H
@@ -0,0 +1,78 @@
+/*
+    benchmarks for the batch transforms (Transform::transformPoints() and friends) over growing array lengths
+
+    results are in ns per element, so they show how throughput scales: the fixed cost of a call dominates short
+    arrays, the longest ones no longer fit in cache and become bound by memory bandwidth
+    points/scalar applies the same AffineTransform one Point at a time, from an array of Points, for reference
+*/
+
+#ifndef BENCH_TRANSFORM_BATCH_H
+#define BENCH_TRANSFORM_BATCH_H
+
+#include <string>
+
+#include "Benchmark.h"
+#include "AffineTransform.h"
+#include "SoA.h"
+#include "pbrt.h"
+
+namespace bench_transform_batch
+{
+    inline void run_all_transform_batch_benchmarks(bench::Runner& runner)
+    {
+        bench::Random random(36);
+
+        Transform general = Transform::translate( Vector(1, -2, 3) ) * Transform::rotateY(0.7f) * Transform::scale(2, 1, 0.5f);
+        AffineTransform affine(general);
+        // a pinhole style projection (w = z), which has to take the divide
+        Mat4 p(1, 0, 0, 0,
+               0, 1, 0, 0,
+               0, 0, 1, 0,
+               0, 0, 1, 0);
+        Transform projective = Transform(p, p) * general;
+
+        for(size_t n = 16; n <= (1 << 20); n *= 16)
+        {
+            SoA3Buffer inBuffer(n), outBuffer(n), dirBuffer(n), dirOutBuffer(n);
+            SoA3 in = inBuffer.soa(), out = outBuffer.soa(), dir = dirBuffer.soa(), dirOut = dirOutBuffer.soa();
+            std::vector<Point> points(n), pointsOut(n);
+            for(size_t i = 0; i < n; i++)
+            {
+                in.set(i, random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(1, 10));
+                dir.set(i, random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1));
+                points[i] = in.point(i);
+            }
+
+            std::string size = std::to_string(n);
+            auto name = [&](const char* what) { return std::string(what) + "/" + size; };
+
+            runner.run("batch", name("points/scalar").c_str(), [&](uint64_t) {
+                for(size_t i = 0; i < n; i++)
+                    pointsOut[i] = affine(points[i]);
+                bench::doNotOptimize( pointsOut[0] );
+            }, n);
+            runner.run("batch", name("points/affine").c_str(), [&](uint64_t) {
+                affine.transformPoints(in, out, n);
+                bench::doNotOptimize( out.x[0] );
+            }, n);
+            runner.run("batch", name("points/projective").c_str(), [&](uint64_t) {
+                projective.transformPoints(in, out, n);
+                bench::doNotOptimize( out.x[0] );
+            }, n);
+            runner.run("batch", name("vectors/affine").c_str(), [&](uint64_t) {
+                affine.transformVectors(dir, out, n);
+                bench::doNotOptimize( out.x[0] );
+            }, n);
+            runner.run("batch", name("normals/affine").c_str(), [&](uint64_t) {
+                affine.transformNormals(dir, out, n);
+                bench::doNotOptimize( out.x[0] );
+            }, n);
+            runner.run("batch", name("rays/affine").c_str(), [&](uint64_t) {
+                affine.transformRays(in, dir, out, dirOut, n);
+                bench::doNotOptimize( out.x[0] );
+            }, n);
+        }
+    }
+} // bench_transform_batch
+
+#endif // BENCH_TRANSFORM_BATCH_H
@@ -0,0 +1,50 @@
+/*
+    microbenchmarks for Vector, Normal and Point arithmetic
+*/
+
+#ifndef BENCH_VECTOR_H
+#define BENCH_VECTOR_H
+
+#include "Benchmark.h"
+#include "Point.h"
+#include "Vector.h"
+
+namespace bench_vector
+{
+    inline void run_all_vector_benchmarks(bench::Runner& runner)
+    {
+        bench::Random random(1);
+        std::vector<Vector> a(bench::POOL_SIZE), b(bench::POOL_SIZE);
+        std::vector<Point> p(bench::POOL_SIZE);
+        for(size_t i = 0; i < bench::POOL_SIZE; i++)
+        {
+            a[i] = Vector(random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(-10, 10));
+            b[i] = Vector(random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(-10, 10));
+            p[i] = Point(random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(-10, 10));
+        }
+
+        runner.run("vector", "dot", [&](uint64_t i) {
+            bench::doNotOptimize( dot(a[i & bench::POOL_MASK], b[i & bench::POOL_MASK]) );
+        });
+        runner.run("vector", "cross", [&](uint64_t i) {
+            bench::doNotOptimize( cross(a[i & bench::POOL_MASK], b[i & bench::POOL_MASK]) );
+        });
+        runner.run("vector", "normalize", [&](uint64_t i) {
+            bench::doNotOptimize( normalize(a[i & bench::POOL_MASK]) );
+        });
+        runner.run("vector", "operator[]", [&](uint64_t i) {
+            bench::doNotOptimize( a[i & bench::POOL_MASK][i % 3] );
+        });
+        runner.run("point", "point+vector", [&](uint64_t i) {
+            bench::doNotOptimize( p[i & bench::POOL_MASK] + a[i & bench::POOL_MASK] );
+        });
+        runner.run("point", "point-point", [&](uint64_t i) {
+            bench::doNotOptimize( p[i & bench::POOL_MASK] - p[(i + 1) & bench::POOL_MASK] );
+        });
+        runner.run("point", "operator[]", [&](uint64_t i) {
+            bench::doNotOptimize( p[i & bench::POOL_MASK][i % 3] );
+        });
+    }
+} // bench_vector
+
+#endif // BENCH_VECTOR_H
@@ -0,0 +1,167 @@
+/*
+    bench is a standalone executable (no SDL) that times the pbrt primitives
+
+    usage: bench [options]
+        --mode <m>          micro (kernels, default), render (canonical scenes), all, or test (checks of the
+                            bench's own statistics, exits with 1 on a failure)
+        --filter <text>     only run benchmarks whose "group/name" contains text (scenes are "scene/<name>")
+        --reps <n>          timed repetitions per benchmark (default 10)
+        --warmup <n>        untimed repetitions per benchmark (default 2)
+        --min-time <ms>     minimum duration of one repetition (default 20)
+        --json <path>       also write the results to path as JSON (this is also how baselines are saved)
+        --runs <n>          run everything n times and pool the samples (default 1)
+
+    regression checks:
+        --baseline <path>   compare the results against a JSON file written by --json, exits with 3 on a regression
+        --threshold <pct>   smallest change that counts as a regression or improvement (default 5)
+
+    render mode:
+        --res <w>x<h>       film resolution (default 640x480)
+        --spp <x>x<y>       stratified samples per pixel (default 2x2)
+        --seed <n>          rng seed (default 7)
+        --threads <n>       render threads (default: one per hardware thread)
+        --packet <n>        camera rays traced together: 1 (one at a time), 4, 8 or 16 (default: the SIMD width)
+        --stream <n>        render wavefront style, through queues of n rays (default 0: tile by tile)
+        --sort <on|off>     with --stream, sort every queue by ray direction and origin before tracing it
+        --render-reps <n>   timed renders per scene (default 3)
+        --images <dir>      write every scene's image to dir/<scene>.ppm
+        --heatmap <on|off>  also write per-pixel cost heatmaps (time, BVH nodes, shape tests) of every scene
+        --perf <on|off>     read hardware performance counters (linux perf_event_open) around the BVH build,
+                            tile rendering and film resolve, printed per phase and thread after every scene
+        --trace <path>      record scene/BVH builds, tiles and resolves as a Chrome trace (open in ui.perfetto.dev)
+        --scene-cache <dir> load every scene from a cache in dir instead of building it, when this binary wrote one
+                            there, and write one otherwise
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "Regression.h"
+#include "test_Regression.h"
+#include "PerfCounters.h"
+#include "Trace.h"
+
+static void printUsage()
+{
+    printf("usage: bench [--mode micro|render|all|test] [--filter text] [--reps n] [--warmup n] [--min-time ms] [--json path]\n");
+    printf("             [--runs n] [--baseline path] [--threshold pct]\n");
+    printf("             [--res WxH] [--spp XxY] [--seed n] [--threads n] [--render-reps n] [--images dir] [--heatmap on|off]\n");
+    printf("             [--packet n] [--stream n] [--sort on|off] [--perf on|off] [--trace path] [--scene-cache dir]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Options options;
+    bench_render::RenderOptions renderOptions;
+    const char* mode = "micro";
+    const char* jsonPath = nullptr;
+    const char* baselinePath = nullptr;
+    const char* tracePath = nullptr;
+    bool perfCounters = false;
+    double threshold = 0.05;
+    int runs = 1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if(strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            printUsage();
+            return 0;
+        }
+        else if(!value)
+        {
+            printf("[bench] missing value for %s\n", arg);
+            printUsage();
+            return 1;
+        }
+        else if(strcmp(arg, "--filter") == 0)   options.filter = value;
+        else if(strcmp(arg, "--reps") == 0)     options.repetitions = std::max(1, atoi(value));
+        else if(strcmp(arg, "--warmup") == 0)   options.warmup = std::max(0, atoi(value));
+        else if(strcmp(arg, "--min-time") == 0) options.minTime = atof(value) * 1e-3;
+        else if(strcmp(arg, "--json") == 0)     jsonPath = value;
+        else if(strcmp(arg, "--mode") == 0)     mode = value;
+        else if(strcmp(arg, "--runs") == 0)     runs = std::max(1, atoi(value));
+        else if(strcmp(arg, "--baseline") == 0) baselinePath = value;
+        else if(strcmp(arg, "--threshold") == 0) threshold = atof(value) * 0.01;
+        else if(strcmp(arg, "--res") == 0)      sscanf(value, "%dx%d", &renderOptions.width, &renderOptions.height);
+        else if(strcmp(arg, "--spp") == 0)      sscanf(value, "%dx%d", &renderOptions.x_samples, &renderOptions.y_samples);
+        else if(strcmp(arg, "--seed") == 0)     renderOptions.seed = (uint32_t)strtoul(value, nullptr, 10);
+        else if(strcmp(arg, "--threads") == 0)  renderOptions.threads = std::max(0, atoi(value));
+        else if(strcmp(arg, "--packet") == 0)   renderOptions.packetSize = atoi(value);
+        else if(strcmp(arg, "--stream") == 0)   renderOptions.streamSize = std::max(0, atoi(value));
+        else if(strcmp(arg, "--sort") == 0)     renderOptions.sortRays = strcmp(value, "on") == 0;
+        else if(strcmp(arg, "--render-reps") == 0) renderOptions.repetitions = std::max(1, atoi(value));
+        else if(strcmp(arg, "--images") == 0)   renderOptions.imageDir = value;
+        else if(strcmp(arg, "--heatmap") == 0)  renderOptions.heatmaps = strcmp(value, "on") == 0;
+        else if(strcmp(arg, "--perf") == 0)     perfCounters = strcmp(value, "on") == 0;
+        else if(strcmp(arg, "--trace") == 0)    tracePath = value;
+        else if(strcmp(arg, "--scene-cache") == 0) renderOptions.sceneCacheDir = value;
+        else
+        {
+            printf("[bench] unknown option %s\n", arg);
+            printUsage();
+            return 1;
+        }
+        i++;
+    }
+
+    if(strcmp(mode, "test") == 0) return test_regression::run_all_regression_tests() == 0 ? 0 : 1;
+
+    bool micro = strcmp(mode, "micro") == 0 || strcmp(mode, "all") == 0;
+    bool render = strcmp(mode, "render") == 0 || strcmp(mode, "all") == 0;
+    if(!micro && !render)
+    {
+        printf("[bench] unknown mode %s\n", mode);
+        printUsage();
+        return 1;
+    }
+
+    if(tracePath) trace::start();
+    if(perfCounters) perf::enable(); // prints why and carries on without them if they can't be opened
+
+    bench::Runner runner(options);
+    for(int run = 0; run < runs; run++)
+    {
+        if(runs > 1) printf("\n[bench] run %d of %d\n", run + 1, runs);
+
+        bench::Runner current(options);
+        if(micro) bench::run_all_benchmarks(current);
+        if(render) bench_render::run_all_render_benchmarks(current, renderOptions);
+        runner.merge(current);
+    }
+
+    if(tracePath)
+    {
+        trace::stop();
+        if( !trace::write(tracePath) )
+        {
+            printf("[bench] failed to write %s\n", tracePath);
+            return 1;
+        }
+        printf("[bench] wrote trace to %s\n", tracePath);
+    }
+
+    if(jsonPath)
+    {
+        if( !runner.writeJSON(jsonPath) )
+        {
+            printf("[bench] failed to write %s\n", jsonPath);
+            return 1;
+        }
+        printf("[bench] wrote %zu results to %s\n", runner.results.size() + runner.sceneResults.size(), jsonPath);
+    }
+
+    if(baselinePath)
+    {
+        int regressions = regression::compareWithBaseline(runner, baselinePath, threshold);
+        if(regressions < 0) return 1;
+        if(regressions > 0) return 3;
+    }
+
+    return 0;
+}
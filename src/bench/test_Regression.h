@@ -0,0 +1,71 @@
+/*
+    checks of the verdicts Regression.h gives, on fixed samples whose answer is known
+    run with bench --mode test, which exits with 1 if any of them fails
+
+    these count their failures instead of asserting, since bench is always built optimized (NDEBUG)
+*/
+
+#ifndef TEST_REGRESSION_H
+#define TEST_REGRESSION_H
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "Regression.h"
+
+namespace test_regression
+{
+    inline int check(bool ok, const char* what)
+    {
+        if(!ok) printf("[test_regression] FAILED: %s\n", what);
+        return ok ? 0 : 1;
+    }
+
+    inline std::vector<double> scaled(const std::vector<double>& v, double s)
+    {
+        std::vector<double> out;
+        for(double x : v) out.push_back(x * s);
+
+        return out;
+    }
+
+    // returns the number of failed checks
+    inline int run_all_regression_tests()
+    {
+        // about +-1.5% of noise around 10
+        const std::vector<double> baseline = { 10.0, 10.2, 9.9, 10.1, 10.05, 9.95, 10.15, 9.85, 10.0, 10.1 };
+        const double threshold = 0.05;
+        int failures = 0;
+
+        regression::Comparison same = regression::compare("same", "ns", 1.0, baseline, baseline, threshold);
+        failures += check(same.verdict == regression::SAME, "identical samples are ~");
+        failures += check(same.ratio == 1.0 && same.lo <= 1.0 && same.hi >= 1.0, "identical samples have a ratio of 1 inside the interval");
+
+        regression::Comparison slower = regression::compare("slower", "ns", 1.0, baseline, scaled(baseline, 2.0), threshold);
+        failures += check(slower.verdict == regression::SLOWER, "a 2x slowdown is SLOWER");
+        failures += check(slower.ratio == 2.0 && slower.lo > 1.9 && slower.hi < 2.1, "a 2x slowdown's interval is around 2");
+
+        regression::Comparison faster = regression::compare("faster", "ns", 1.0, baseline, scaled(baseline, 0.5), threshold);
+        failures += check(faster.verdict == regression::FASTER, "a 2x speedup is faster");
+
+        // a change inside the threshold isn't one
+        regression::Comparison small = regression::compare("small", "ns", 1.0, baseline, scaled(baseline, 1.02), threshold);
+        failures += check(small.verdict == regression::SAME, "a 2% change with a 5% threshold is ~");
+
+        std::vector<double> two(baseline.begin(), baseline.begin() + 2);
+        regression::Comparison few = regression::compare("few", "ns", 1.0, two, scaled(two, 2.0), threshold);
+        failures += check(few.verdict == regression::NOT_ENOUGH_SAMPLES, "2 samples are n/a");
+
+        // the bootstrap is seeded
+        double lo1, hi1, lo2, hi2;
+        regression::bootstrapRatio(baseline, scaled(baseline, 1.3), &lo1, &hi1);
+        regression::bootstrapRatio(baseline, scaled(baseline, 1.3), &lo2, &hi2);
+        failures += check(lo1 == lo2 && hi1 == hi2 && lo1 <= 1.3 && hi1 >= 1.3, "the bootstrap interval is deterministic and holds the ratio");
+
+        if(failures == 0) printf("[test_regression] all regression verdict tests passed\n");
+        return failures;
+    }
+} // test_regression
+
+#endif // TEST_REGRESSION_H
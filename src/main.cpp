@@ -8,6 +8,8 @@
 /* this is only for the rt namespace, which includes global defintitions like canvas width, and rng */
 #include "pbrt/pbrt.h"
 #include "rtiow/rtiow.h"
+#include "pbrt/PerfCounters.h"
+#include "pbrt/Trace.h"
 
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
@@ -65,6 +67,15 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 {
     bbxstate = new BBXState();
     printf("[bbx] initializing ...\n");
+
+    // RT_TRACE=<path> records a timeline of the renders, written to path on shutdown (open in ui.perfetto.dev)
+    if( getenv("RT_TRACE") )
+    {
+        trace::start();
+        printf("[bbx] tracing to %s\n", getenv("RT_TRACE"));
+    }
+    // RT_PERF=1 prints hardware performance counters after every render (linux only)
+    if( getenv("RT_PERF") ) perf::enable();
     
     // initialize SDL
     if( !SDL_Init(SDL_INIT_VIDEO) ) {
@@ -120,6 +131,11 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event)
         printf("[bbx-event] window resized!\n");
         event_handleWindowResize(renderer, bbxstate);
     }
+    else if(event->type == SDL_EVENT_KEY_DOWN && event->key.key == SDLK_H)
+    {
+        // h cycles through the per-pixel cost heatmaps
+        rtiow->toggleHeatmap();
+    }
 
     return SDL_APP_CONTINUE;
 }
@@ -157,5 +173,12 @@ void SDL_AppQuit(void* appstate, SDL_AppResult result)
 {
     delete bbxstate;
 
+    if( trace::active() )
+    {
+        trace::stop();
+        if( !trace::write(getenv("RT_TRACE")) )
+            printf("[rt] failed to write trace to %s\n", getenv("RT_TRACE"));
+    }
+
     printf("[rt] shutting down ... (ran for %.1f seconds)\n", timeElapsed);
 }
@@ -0,0 +1,43 @@
+#include "AffineTransform.h"
+
+#ifdef RT_MAT4_SSE
+#include <immintrin.h>
+
+// r = a * b, with the implicit (0, 0, 0, 1) bottom rows
+// row i of the product is the rows of b weighted by row i of a, plus a's translation
+static inline void multiply(const float a[3][4], const float b[3][4], float r[3][4])
+{
+    __m128 b0 = _mm_load_ps(b[0]);
+    __m128 b1 = _mm_load_ps(b[1]);
+    __m128 b2 = _mm_load_ps(b[2]);
+
+    for(int row = 0; row < 3; row++)
+    {
+        __m128 v = _mm_set_ps(a[row][3], 0.0f, 0.0f, 0.0f);
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(a[row][0]), b0));
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(a[row][1]), b1));
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(a[row][2]), b2));
+        _mm_store_ps(r[row], v);
+    }
+}
+#else
+static inline void multiply(const float a[3][4], const float b[3][4], float r[3][4])
+{
+    for(int row = 0; row < 3; row++)
+    {
+        for(int col = 0; col < 4; col++)
+            r[row][col] = a[row][0] * b[0][col] + a[row][1] * b[1][col] + a[row][2] * b[2][col];
+        r[row][3] += a[row][3];
+    }
+}
+#endif // RT_MAT4_SSE
+
+/* OPERATOR OVERLOADS */
+AffineTransform AffineTransform::operator*(const AffineTransform& t2) const
+{
+    AffineTransform ret(Uninitialized{});
+    multiply(m, t2.m, ret.m);
+    multiply(t2.m_inv, m_inv, ret.m_inv);
+
+    return ret;
+}
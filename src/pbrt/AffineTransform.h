@@ -0,0 +1,198 @@
+/*
+    AffineTransform is a Transform whose matrix has a bottom row of (0, 0, 0, 1)
+    translate, scale, rotateX/Y/Z, lookAt and any composition of them are affine, only projections are not
+
+    it only stores the top 3x4 of the matrix and its inverse (96 bytes instead of 128), and applies
+    Points, Vectors, Normals and Rays without computing the w row or dividing by it
+    Bboxes are transformed with Arvo's method (Graphics Gems, 1990), instead of transforming all 8 corners
+
+    it has the same interface as Transform, so Shapes can hold AffineTransforms while cameras keep the
+    general (projective) Transform
+*/
+
+#ifndef AFFINE_TRANSFORM_H
+#define AFFINE_TRANSFORM_H
+
+#include <assert.h>
+
+#include "Transform.h"
+
+class alignas(16) AffineTransform
+{
+public:
+    /* PUBLIC MEMBERS */
+    float m[3][4], m_inv[3][4];
+
+    /* CONSTRUCTORS */
+    AffineTransform() // identity
+    {
+        for(int row = 0; row < 3; row++)
+            for(int col = 0; col < 4; col++)
+                m[row][col] = m_inv[row][col] = (row == col) ? 1.0f : 0.0f;
+    }
+
+    // t must be affine (see Transform::isAffine()), its bottom rows are dropped
+    // a transform that isn't known to be affine goes through fromTransform() instead
+    explicit AffineTransform(const Transform& t)
+    {
+        assert( t.isAffine() );
+        copyTop(t);
+    }
+
+    // sets *out to t and returns true if t is affine, returns false and leaves *out alone if it's a projection
+    static bool fromTransform(const Transform& t, AffineTransform* out)
+    {
+        if( !t.isAffine() || !t.getInverse().isAffine() ) return false;
+
+        out->copyTop(t);
+        return true;
+    }
+
+    /* PUBLIC METHODS */
+    // the equivalent general Transform
+    Transform toTransform() const
+    {
+        return Transform(
+            Mat4(m[0][0], m[0][1], m[0][2], m[0][3],
+                 m[1][0], m[1][1], m[1][2], m[1][3],
+                 m[2][0], m[2][1], m[2][2], m[2][3],
+                 0, 0, 0, 1),
+            Mat4(m_inv[0][0], m_inv[0][1], m_inv[0][2], m_inv[0][3],
+                 m_inv[1][0], m_inv[1][1], m_inv[1][2], m_inv[1][3],
+                 m_inv[2][0], m_inv[2][1], m_inv[2][2], m_inv[2][3],
+                 0, 0, 0, 1)
+        );
+    }
+
+    inline AffineTransform getInverse() const
+    {
+        AffineTransform ret(Uninitialized{});
+        for(int row = 0; row < 3; row++)
+            for(int col = 0; col < 4; col++)
+            {
+                ret.m[row][col] = m_inv[row][col];
+                ret.m_inv[row][col] = m[row][col];
+            }
+
+        return ret;
+    }
+
+    // returns true if the transformation is only a translation and a uniform scale (no rotation, shear or
+    // uneven scale), and sets *scale to the scale factor
+    bool isTranslateScale(float* scale) const
+    {
+        float s = m[0][0];
+        if(s == 0.0f || m[1][1] != s || m[2][2] != s) return false;
+        if(m[0][1] != 0.0f || m[0][2] != 0.0f || m[1][0] != 0.0f || m[1][2] != 0.0f || m[2][0] != 0.0f || m[2][1] != 0.0f)
+            return false;
+
+        *scale = s;
+        return true;
+    }
+
+    // returns true if the transformation causes the resulting matrix to swap handedness
+    bool swapsHandedness() const
+    {
+        float det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                    m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                    m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+
+        return det < 0.0f;
+    }
+
+    /* BATCH METHODS */
+    // same as Transform's (see Transform.h)
+    void transformPoints(const SoA3& in, const SoA3& out, size_t n) const;
+    void transformVectors(const SoA3& in, const SoA3& out, size_t n) const;
+    void transformNormals(const SoA3& in, const SoA3& out, size_t n) const;
+    void transformRays(const SoA3& o, const SoA3& d, const SoA3& o_out, const SoA3& d_out, size_t n) const;
+
+    /* OPERATOR OVERLOADS */
+    AffineTransform operator*(const AffineTransform& t2) const; // transform composition (multiplication)
+
+    /* INLINE OPERATOR OVERLOADS */
+    inline Point operator()(const Point& p) const // transforming a point, w is always 1
+    {
+        return Point(
+            m[0][0]*p.x + m[0][1]*p.y + m[0][2]*p.z + m[0][3],
+            m[1][0]*p.x + m[1][1]*p.y + m[1][2]*p.z + m[1][3],
+            m[2][0]*p.x + m[2][1]*p.y + m[2][2]*p.z + m[2][3]
+        );
+    }
+    inline void operator()(const Point& p, Point* p_transformed) const // transforming a point in place
+    {
+        *p_transformed = (*this)(p);
+    }
+
+    inline Vector operator()(const Vector& v) const // transforming a vector
+    {
+        return Vector(
+            m[0][0]*v.x + m[0][1]*v.y + m[0][2]*v.z,
+            m[1][0]*v.x + m[1][1]*v.y + m[1][2]*v.z,
+            m[2][0]*v.x + m[2][1]*v.y + m[2][2]*v.z
+        );
+    }
+    inline void operator()(const Vector& v, Vector* v_transformed) const // transforming a vector in place
+    {
+        *v_transformed = (*this)(v);
+    }
+
+    // normalized, like Transform's
+    inline Normal operator()(const Normal& n) const // transforming a normal
+    {
+        return normalize( Normal(
+            m_inv[0][0]*n.x + m_inv[1][0]*n.y + m_inv[2][0]*n.z,
+            m_inv[0][1]*n.x + m_inv[1][1]*n.y + m_inv[2][1]*n.z,
+            m_inv[0][2]*n.x + m_inv[1][2]*n.y + m_inv[2][2]*n.z
+        ) );
+    }
+    // not normalized, like Transform's
+    inline void operator()(const Normal& n, Normal* n_transformed) const // transforming a normal in place
+    {
+        n_transformed->x = m_inv[0][0]*n.x + m_inv[1][0]*n.y + m_inv[2][0]*n.z;
+        n_transformed->y = m_inv[0][1]*n.x + m_inv[1][1]*n.y + m_inv[2][1]*n.z;
+        n_transformed->z = m_inv[0][2]*n.x + m_inv[1][2]*n.y + m_inv[2][2]*n.z;
+    }
+
+    inline Ray operator()(const Ray& ray) const // transforming a ray
+    {
+        Ray ret;
+        (*this)(ray, &ret);
+
+        return ret;
+    }
+    inline void operator()(const Ray& ray, Ray* ray_transformed) const
+    {
+        ray_transformed->o = (*this)(ray.o);
+        ray_transformed->d = (*this)(ray.d);
+
+        ray_transformed->t_min = ray.t_min;
+        ray_transformed->t_max = ray.t_max;
+        ray_transformed->t = ray.t;
+    }
+
+    inline Bbox operator()(const Bbox& box) const // transforming a bbox
+    {
+        return Transform::transformAffineBox(m, box);
+    }
+
+private:
+    /* PRIVATE CONSTRUCTORS */
+    // for results that are about to be written over, skips the identity fill
+    struct Uninitialized {};
+    explicit AffineTransform(Uninitialized) {}
+
+    /* PRIVATE METHODS */
+    // the top 3x4 of t's matrices
+    void copyTop(const Transform& t)
+    {
+        for(int row = 0; row < 3; row++)
+            for(int col = 0; col < 4; col++)
+            {
+                m[row][col] = t.m.m[row][col];
+                m_inv[row][col] = t.m_inv.m[row][col];
+            }
+    }
+};
+
+#endif // AFFINE_TRANSFORM_H
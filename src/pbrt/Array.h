@@ -0,0 +1,157 @@
+/*
+    Array<T> is a contiguous array of T's that's either a std::vector of its own, or a view of memory that
+    something else owns, like the mapped file of a scene cache (see SceneCache.h)
+    this is what lets an accelerator's nodes and a mesh's buffers be used straight out of a mapped file,
+    without copying them into vectors first, while the code that builds them still just fills in a vector
+
+    reading one is the same either way, through a pointer and a count
+    a borrowed Array is read-only (the memory may well be mapped that way), so only ever grow or write to one
+    that was built, and never one that was borrow()ed
+
+    usage:
+        Array<int> a(3); // owns 3 zeros
+        a = std::vector<int>{ 1, 2, 3 }; // owns the vector
+        a = Array<int>::borrow(file.data(), n, file); // views n ints owned by file, and keeps it alive
+*/
+
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+template<typename T>
+class Array
+{
+public:
+    /* CONSTRUCTORS */
+    Array() = default;
+    explicit Array(size_t n) :
+        owned(n)
+    {
+        viewOwned();
+    }
+    Array(std::vector<T> v) :
+        owned( std::move(v) )
+    {
+        viewOwned();
+    }
+    Array(const Array& a) :
+        owned(a.owned),
+        owner(a.owner)
+    {
+        if(owner) view(a.begin_, a.count);
+        else viewOwned();
+    }
+    Array(Array&& a) noexcept :
+        owned( std::move(a.owned) ),
+        owner( std::move(a.owner) )
+    {
+        if(owner) view(a.begin_, a.count);
+        else viewOwned();
+        a.view(nullptr, 0);
+    }
+    Array& operator=(Array a) noexcept
+    {
+        owned = std::move(a.owned);
+        owner = std::move(a.owner);
+        if(owner) view(a.begin_, a.count);
+        else viewOwned();
+        a.view(nullptr, 0);
+
+        return *this;
+    }
+
+    // a view of the n T's at data, which keeps owner (whatever data belongs to) alive for as long as it's used
+    static Array borrow(const T* data, size_t n, std::shared_ptr<const void> owner)
+    {
+        Array a;
+        a.owner = std::move(owner);
+        a.view(const_cast<T*>(data), n);
+
+        return a;
+    }
+
+    /* PUBLIC METHODS */
+    // true if the T's belong to something else
+    bool borrowed() const
+    {
+        return owner != nullptr;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    T* data()
+    {
+        return begin_;
+    }
+    const T* data() const
+    {
+        return begin_;
+    }
+    T& operator[](size_t i)
+    {
+        return begin_[i];
+    }
+    const T& operator[](size_t i) const
+    {
+        return begin_[i];
+    }
+    T* begin()
+    {
+        return begin_;
+    }
+    T* end()
+    {
+        return begin_ + count;
+    }
+    const T* begin() const
+    {
+        return begin_;
+    }
+    const T* end() const
+    {
+        return begin_ + count;
+    }
+
+    // element by element, whoever owns them
+    bool operator==(const Array& a) const
+    {
+        return count == a.count && std::equal(begin(), end(), a.begin());
+    }
+    bool operator!=(const Array& a) const
+    {
+        return !(*this == a);
+    }
+
+private:
+    /* PRIVATE MEMBERS */
+    std::vector<T> owned; // empty when borrowed
+    std::shared_ptr<const void> owner; // set when borrowed
+    T* begin_ = nullptr;
+    size_t count = 0;
+
+    /* PRIVATE METHODS */
+    void view(T* data, size_t n)
+    {
+        begin_ = data;
+        count = n;
+    }
+    void viewOwned()
+    {
+        view(owned.data(), owned.size());
+    }
+};
+
+#endif // ARRAY_H
@@ -0,0 +1,553 @@
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "BVH.h"
+#include "PerfCounters.h"
+#include "Stats.h"
+#include "Trace.h"
+
+STAT_COUNTER("BVH/Rays traced", nBVHRays);
+STAT_RATIO("BVH/Node box hits per test", nBVHNodeHits, nBVHNodeTests);
+STAT_COUNTER("BVH/Leaf shape tests", nBVHShapeTests);
+STAT_INT_DISTRIBUTION("BVH/Nodes visited per ray", bvhNodesPerRay);
+STAT_COUNTER("BVH/Nodes", nBVHNodes);
+STAT_COUNTER("BVH/Ray packets traced", nBVHPackets);
+STAT_RATIO("BVH/Packet node interval culls per test", nBVHPacketCulls, nBVHPacketNodeTests);
+STAT_RATIO("BVH/Occlusion rays blocked per ray", nBVHOccluded, nBVHOcclusionRays);
+
+/* CONSTRUCTORS */
+BVH::BVH(std::vector<std::shared_ptr<Shape>> shapes_in, int maxPrimsInNode) :
+    maxPrimsInNode( std::min(maxPrimsInNode, 255) )
+{
+    // a shape that was given a projective transform has no place in the world to bound (see Shape.h)
+    size_t placed = std::remove_if(shapes_in.begin(), shapes_in.end(),
+        [](const std::shared_ptr<Shape>& s) { return !s->validPlacement; }) - shapes_in.begin();
+    if(placed < shapes_in.size())
+    {
+        printf("[BVH] leaving out %zu shape(s) that were given a projective transform\n", shapes_in.size() - placed);
+        shapes_in.resize(placed);
+    }
+    if(shapes_in.empty()) return;
+    TRACE_SCOPE_ARG("build", "BVH build", shapes_in.size());
+    perf::Scope counters("BVH build");
+
+    // compute bounds and centroids of every shape up front, the build only touches these
+    std::vector<PrimitiveInfo> info(shapes_in.size());
+    for(size_t i = 0; i < shapes_in.size(); i++)
+    {
+        Bbox b = shapes_in[i]->worldBound();
+        info[i].index = (int)i;
+        info[i].bounds = b;
+        info[i].centroid = b.p_min + (b.p_max - b.p_min) * 0.5f;
+    }
+
+    std::vector<LinearNode> built;
+    std::vector<int> order = build(info, this->maxPrimsInNode, built);
+    nodes = std::move(built);
+    shapes.reserve(order.size());
+    for(int index : order)
+        shapes.push_back( std::move(shapes_in[index]) );
+}
+
+BVH::BVH(std::vector<std::shared_ptr<Shape>> shapes, Array<LinearNode> nodes, int maxPrimsInNode) :
+    maxPrimsInNode( std::min(maxPrimsInNode, 255) ),
+    shapes( std::move(shapes) ),
+    nodes( std::move(nodes) )
+{}
+
+// builds the subtree over info[start, end), whose root is depth nodes from the tree's root (1 for the root itself),
+// and returns the index of its root node
+// implementation @ (pg. 214) of pbrt 2nd ed.
+static int recursiveBuild(std::vector<BVH::PrimitiveInfo>& info, int start, int end, int depth, int maxPrimsInNode,
+    bool packLeaves, std::vector<BVH::LinearNode>& nodes, std::vector<int>& order)
+{
+    typedef BVH::LinearNode LinearNode;
+    typedef BVH::PrimitiveInfo PrimitiveInfo;
+
+    int nodeIndex = (int)nodes.size();
+    nodes.emplace_back();
+
+    // bounds of all primitives, and of their centroids
+    Bbox bounds, centroidBounds;
+    for(int i = start; i < end; i++)
+    {
+        bounds = Bbox::Union(bounds, info[i].bounds);
+        centroidBounds = Bbox::Union(centroidBounds, info[i].centroid);
+    }
+
+    int n = end - start;
+    auto makeLeaf = [&]()
+    {
+        LinearNode& node = nodes[nodeIndex];
+        node.bounds = bounds;
+        node.primitivesOffset = (int32_t)order.size();
+        node.nPrimitives = (uint16_t)n;
+        node.axis = 0;
+        for(int i = start; i < end; i++)
+            order.push_back(info[i].index);
+
+        return nodeIndex;
+    };
+
+    if(n == 1 || (packLeaves && n <= maxPrimsInNode)) return makeLeaf();
+
+    int axis = centroidBounds.maximumExtent();
+    int mid = (start + end) / 2;
+    float c_min = centroidBounds.p_min[axis];
+    float c_max = centroidBounds.p_max[axis];
+
+    // splits at the median take log2(n) more levels to get down to single primitives, once the SAH's splits have
+    // used up the rest of BVH::MAX_DEPTH (which wildly uneven sizes can make them do), every split below is a median
+    int levels = 0;
+    while( ((int64_t)1 << levels) < n ) levels++;
+    bool capped = depth + levels >= BVH::MAX_DEPTH;
+
+    if(c_max == c_min)
+    {
+        // every centroid is in the same spot, so no split is better than another
+        // still split by count once there are too many for one leaf
+        if(n <= maxPrimsInNode) return makeLeaf();
+    }
+    else if(n <= 4 || capped)
+    {
+        // too few to bother with the SAH (or no depth left for it), split at the median centroid
+        std::nth_element(&info[start], &info[mid], &info[end - 1] + 1,
+            [axis](const PrimitiveInfo& a, const PrimitiveInfo& b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+    else
+    {
+        // bucket the centroids along the axis and evaluate the SAH at every bucket boundary @ (pg. 217)
+        constexpr int N_BUCKETS = 12;
+        struct Bucket { int count = 0; Bbox bounds; };
+        Bucket buckets[N_BUCKETS];
+
+        auto bucketOf = [&](const PrimitiveInfo& p)
+        {
+            // in double, as centroids near the float limit would overflow the scaling
+            int b = (int)( N_BUCKETS * ((double)p.centroid[axis] - c_min) / ((double)c_max - c_min) );
+            return std::min(b, N_BUCKETS - 1);
+        };
+
+        for(int i = start; i < end; i++)
+        {
+            Bucket& b = buckets[bucketOf(info[i])];
+            b.count++;
+            b.bounds = Bbox::Union(b.bounds, info[i].bounds);
+        }
+
+        float cost[N_BUCKETS - 1];
+        for(int i = 0; i < N_BUCKETS - 1; i++)
+        {
+            Bbox b0, b1;
+            int count0 = 0, count1 = 0;
+            for(int j = 0; j <= i; j++)
+            {
+                b0 = Bbox::Union(b0, buckets[j].bounds);
+                count0 += buckets[j].count;
+            }
+            for(int j = i + 1; j < N_BUCKETS; j++)
+            {
+                b1 = Bbox::Union(b1, buckets[j].bounds);
+                count1 += buckets[j].count;
+            }
+
+            // empty sides have an inverted (infinite) box, so leave them out instead of multiplying by 0
+            float area0 = count0 ? count0 * b0.surfaceArea() : 0.0f;
+            float area1 = count1 ? count1 * b1.surfaceArea() : 0.0f;
+            cost[i] = 0.125f + (area0 + area1) / bounds.surfaceArea();
+        }
+
+        int minBucket = 0;
+        for(int i = 1; i < N_BUCKETS - 1; i++)
+            if(cost[i] < cost[minBucket]) minBucket = i;
+
+        // only split if it's cheaper than intersecting everything in a leaf
+        if(n <= maxPrimsInNode && cost[minBucket] >= n) return makeLeaf();
+
+        PrimitiveInfo* pmid = std::partition(&info[start], &info[end - 1] + 1,
+            [&](const PrimitiveInfo& p) { return bucketOf(p) <= minBucket; });
+        mid = (int)(pmid - &info[0]);
+
+        // a degenerate split (everything on one side) can happen with wildly uneven sizes
+        if(mid == start || mid == end) mid = (start + end) / 2;
+    }
+
+    // children are built depth first, so the first child always lands at nodeIndex + 1
+    recursiveBuild(info, start, mid, depth + 1, maxPrimsInNode, packLeaves, nodes, order);
+    int second = recursiveBuild(info, mid, end, depth + 1, maxPrimsInNode, packLeaves, nodes, order);
+
+    LinearNode& node = nodes[nodeIndex];
+    node.bounds = bounds;
+    node.secondChildOffset = second;
+    node.nPrimitives = 0;
+    node.axis = (uint8_t)axis;
+
+    return nodeIndex;
+}
+
+/* PUBLIC METHODS */
+std::vector<int> BVH::build(std::vector<PrimitiveInfo>& info, int maxPrimsInNode, std::vector<LinearNode>& nodes, bool packLeaves)
+{
+    std::vector<int> order;
+    if(info.empty()) return order;
+
+    // a tree has fewer than twice as many nodes as leaves
+    nodes.reserve( nodes.size() + 2 * (packLeaves ? info.size() / maxPrimsInNode + 1 : info.size()) );
+    order.reserve(info.size());
+    recursiveBuild(info, 0, (int)info.size(), 1, maxPrimsInNode, packLeaves, nodes, order);
+    STAT_ADD(nBVHNodes, (int64_t)nodes.size());
+
+    return order;
+}
+
+Bbox BVH::worldBound() const
+{
+    return nodes.empty() ? Bbox() : nodes[0].bounds;
+}
+
+// implementation @ (pg. 225) of pbrt 2nd ed.
+bool BVH::intersect(const Ray& ray, Hit* hit, TraversalCost* cost) const
+{
+    if(nodes.empty()) return false;
+    STAT_INC(nBVHRays);
+
+    Vector invDir(1.0f / ray.d.x, 1.0f / ray.d.y, 1.0f / ray.d.z);
+    int dirIsNeg[3] = { invDir.x < 0, invDir.y < 0, invDir.z < 0 };
+
+    bool found = false;
+    int todo[MAX_DEPTH];
+    int todoOffset = 0;
+    int nodeNum = 0;
+    // counted in locals and reported once per ray, so statistics and costs stay out of the inner loop
+    int nodesVisited = 0, nodesHit = 0, shapesTested = 0;
+    while(true)
+    {
+        const LinearNode& node = nodes[nodeNum];
+        nodesVisited++;
+        if( intersectsP(node.bounds, ray, invDir, dirIsNeg) )
+        {
+            nodesHit++;
+            if(node.nPrimitives > 0)
+            {
+                // intersect ray with the shapes in this leaf
+                shapesTested += node.nPrimitives;
+                for(int i = 0; i < node.nPrimitives; i++)
+                {
+                    if( shapes[node.primitivesOffset + i]->intersect(ray, hit) )
+                    {
+                        found = true;
+                        ray.t_max = hit->t;
+                    }
+                }
+                if(todoOffset == 0) break;
+                nodeNum = todo[--todoOffset];
+            }
+            else
+            {
+                // visit the near child first, and push the far one
+                if(dirIsNeg[node.axis])
+                {
+                    todo[todoOffset++] = nodeNum + 1;
+                    nodeNum = node.secondChildOffset;
+                }
+                else
+                {
+                    todo[todoOffset++] = node.secondChildOffset;
+                    nodeNum = nodeNum + 1;
+                }
+            }
+        }
+        else
+        {
+            if(todoOffset == 0) break;
+            nodeNum = todo[--todoOffset];
+        }
+    }
+
+    STAT_ADD(nBVHNodeTests, nodesVisited);
+    STAT_ADD(nBVHNodeHits, nodesHit);
+    STAT_ADD(nBVHShapeTests, shapesTested);
+    STAT_REPORT_VALUE(bvhNodesPerRay, nodesVisited);
+    (void)nodesHit; // only read when statistics are compiled in
+
+    if(cost)
+    {
+        cost->nodesVisited += nodesVisited;
+        cost->shapeTests += shapesTested;
+    }
+
+    return found;
+}
+
+// implementation @ (pg. 227) of pbrt 2nd ed.
+bool BVH::intersectP(const Ray& ray, TraversalCost* cost) const
+{
+    if(nodes.empty()) return false;
+    STAT_INC(nBVHOcclusionRays);
+
+    Vector invDir(1.0f / ray.d.x, 1.0f / ray.d.y, 1.0f / ray.d.z);
+    int dirIsNeg[3] = { invDir.x < 0, invDir.y < 0, invDir.z < 0 };
+
+    bool hit = false;
+    int todo[MAX_DEPTH];
+    int todoOffset = 0;
+    int nodeNum = 0;
+    int nodesVisited = 0, nodesHit = 0, shapesTested = 0;
+    while(true)
+    {
+        const LinearNode& node = nodes[nodeNum];
+        nodesVisited++;
+        if( intersectsP(node.bounds, ray, invDir, dirIsNeg) )
+        {
+            nodesHit++;
+            if(node.nPrimitives > 0)
+            {
+                for(int i = 0; i < node.nPrimitives && !hit; i++)
+                {
+                    shapesTested++;
+                    hit = shapes[node.primitivesOffset + i]->doesIntersect(ray);
+                }
+                if(hit || todoOffset == 0) break;
+                nodeNum = todo[--todoOffset];
+            }
+            else
+            {
+                todo[todoOffset++] = node.secondChildOffset;
+                nodeNum = nodeNum + 1;
+            }
+        }
+        else
+        {
+            if(todoOffset == 0) break;
+            nodeNum = todo[--todoOffset];
+        }
+    }
+
+    if(hit) STAT_INC(nBVHOccluded);
+    STAT_ADD(nBVHNodeTests, nodesVisited);
+    STAT_ADD(nBVHNodeHits, nodesHit);
+    STAT_ADD(nBVHShapeTests, shapesTested);
+    (void)nodesHit; // only read when statistics are compiled in
+
+    if(cost)
+    {
+        cost->nodesVisited += nodesVisited;
+        cost->shapeTests += shapesTested;
+    }
+
+    return hit;
+}
+
+// interval bounds over the active lanes of a packet: every lane's origin, reciprocal direction and [t_min, t_max]
+// lies inside them, so a box that no ray within the bounds can hit is missed by every lane
+// (Wald et al., "Ray tracing deformable scenes using dynamic bounding volume hierarchies", and Boulos et al.)
+struct PacketInterval
+{
+    float oLo[3], oHi[3];
+    float invLo[3], invHi[3];
+    float tMinLo, tMaxHi;
+
+    template<int N>
+    PacketInterval(const RayPacket<N>& rays, const Vec3x<N>& invDir, const Maskx<N>& active)
+    {
+        const Floatx<N>* o[3] = { &rays.o.x, &rays.o.y, &rays.o.z };
+        const Floatx<N>* inv[3] = { &invDir.x, &invDir.y, &invDir.z };
+        for(int axis = 0; axis < 3; axis++)
+        {
+            oLo[axis]   = hmin( select(active, *o[axis], Floatx<N>(INFINITY)) );
+            oHi[axis]   = hmax( select(active, *o[axis], Floatx<N>(-INFINITY)) );
+            invLo[axis] = hmin( select(active, *inv[axis], Floatx<N>(INFINITY)) );
+            invHi[axis] = hmax( select(active, *inv[axis], Floatx<N>(-INFINITY)) );
+        }
+        tMinLo = hmin( select(active, rays.t_min, Floatx<N>(INFINITY)) );
+        updateTMax(rays, active);
+    }
+
+    // after hits shortened some lanes
+    template<int N>
+    inline void updateTMax(const RayPacket<N>& rays, const Maskx<N>& active)
+    {
+        tMaxHi = hmax( select(active, rays.t_max, Floatx<N>(-INFINITY)) );
+    }
+
+    // false only if no lane can hit bounds
+    // every lane's entry into the box is at least the largest entryLo over the axes, and its exit at most the
+    // smallest exitHi, this mirrors the decisions of the slab test (which ignores NaNs past the x axis,
+    // so a NaN anywhere here means the bounds can't tell)
+    inline bool mayHit(const Bbox& bounds) const
+    {
+        float entry = -INFINITY, exit = INFINITY;
+        for(int axis = 0; axis < 3; axis++)
+        {
+            float lo0, hi0, lo1, hi1;
+            if( !product(bounds.p_min[axis] - oHi[axis], bounds.p_min[axis] - oLo[axis], invLo[axis], invHi[axis], &lo0, &hi0) ||
+                !product(bounds.p_max[axis] - oHi[axis], bounds.p_max[axis] - oLo[axis], invLo[axis], invHi[axis], &lo1, &hi1) )
+                return true;
+
+            // a lane enters through the nearer of the two planes and exits through the farther
+            entry = std::max(entry, std::min(lo0, lo1));
+            exit = std::min(exit, std::max(hi0, hi1));
+        }
+
+        return !(entry > exit || entry >= tMaxHi || exit <= tMinLo);
+    }
+
+    // [lo, hi] = [a0, a1] * [b0, b1], false if it's undefined (0 * infinity)
+    static inline bool product(float a0, float a1, float b0, float b1, float* lo, float* hi)
+    {
+        float p0 = a0 * b0, p1 = a0 * b1, p2 = a1 * b0, p3 = a1 * b1;
+        if(p0 != p0 || p1 != p1 || p2 != p2 || p3 != p3) return false;
+
+        *lo = std::min( std::min(p0, p1), std::min(p2, p3) );
+        *hi = std::max( std::max(p0, p1), std::max(p2, p3) );
+        return true;
+    }
+};
+
+template<int N>
+Maskx<N> BVH::intersect(RayPacket<N>& rays, const Maskx<N>& active, Hit* hits) const
+{
+    Maskx<N> found;
+    if(nodes.empty() || none(active)) return found;
+    STAT_INC(nBVHPackets);
+    STAT_ADD(nBVHRays, laneCount(active.bits()));
+
+    Vec3x<N> invDir( Floatx<N>(1.0f) / rays.d.x, Floatx<N>(1.0f) / rays.d.y, Floatx<N>(1.0f) / rays.d.z );
+    Maskx<N> dirIsNeg[3] = { invDir.x < Floatx<N>(0.0f), invDir.y < Floatx<N>(0.0f), invDir.z < Floatx<N>(0.0f) };
+    PacketInterval interval(rays, invDir, active);
+
+    // children are visited in the order the first active lane would visit them, for a coherent packet that's
+    // every lane's order
+    int first = lowestLane(active.bits());
+    bool firstIsNeg[3] = { dirIsNeg[0][first], dirIsNeg[1][first], dirIsNeg[2][first] };
+
+    int todo[MAX_DEPTH];
+    int todoOffset = 0;
+    int nodeNum = 0;
+    int nodesVisited = 0, nodesCulled = 0;
+    while(true)
+    {
+        const LinearNode& node = nodes[nodeNum];
+        nodesVisited++;
+
+        // the interval test is scalar code, it's only worth doing first when the lanes don't fit in one register
+        // (e.g. 16 lanes on SSE), otherwise testing every lane's ray costs less than it does
+        Maskx<N> lanes;
+        bool visit = N <= PACKET_WIDTH || interval.mayHit(node.bounds);
+        if(visit)
+        {
+            lanes = active & intersectsP(node.bounds, rays, invDir, dirIsNeg);
+            visit = any(lanes);
+        }
+        else nodesCulled++;
+
+        if(visit && node.nPrimitives > 0)
+        {
+            Maskx<N> leafHits;
+            for(int i = 0; i < node.nPrimitives; i++)
+            {
+                Floatx<N> t;
+                // a lane only hits a later shape closer than the earlier ones, so its Hit just gets overwritten
+                Maskx<N> hit = shapes[node.primitivesOffset + i]->intersectPacket(rays, lanes, &t, hits);
+                rays.t_max = select(hit, t, rays.t_max);
+                leafHits = leafHits | hit;
+            }
+            if( any(leafHits) )
+            {
+                found = found | leafHits;
+                interval.updateTMax(rays, active);
+            }
+        }
+        else if(visit)
+        {
+            // visit the near child first, and push the far one
+            if(firstIsNeg[node.axis])
+            {
+                todo[todoOffset++] = nodeNum + 1;
+                nodeNum = node.secondChildOffset;
+            }
+            else
+            {
+                todo[todoOffset++] = node.secondChildOffset;
+                nodeNum = nodeNum + 1;
+            }
+            continue;
+        }
+
+        if(todoOffset == 0) break;
+        nodeNum = todo[--todoOffset];
+    }
+
+    STAT_ADD(nBVHPacketNodeTests, nodesVisited);
+    STAT_ADD(nBVHPacketCulls, nodesCulled);
+    (void)nodesCulled; // only read when statistics are compiled in
+
+    return found;
+}
+
+template<int N>
+Maskx<N> BVH::intersectP(const RayPacket<N>& rays, const Maskx<N>& active) const
+{
+    Maskx<N> occluded;
+    if(nodes.empty() || none(active)) return occluded;
+    STAT_ADD(nBVHOcclusionRays, laneCount(active.bits()));
+
+    Vec3x<N> invDir( Floatx<N>(1.0f) / rays.d.x, Floatx<N>(1.0f) / rays.d.y, Floatx<N>(1.0f) / rays.d.z );
+    Maskx<N> dirIsNeg[3] = { invDir.x < Floatx<N>(0.0f), invDir.y < Floatx<N>(0.0f), invDir.z < Floatx<N>(0.0f) };
+
+    Maskx<N> open = active; // the lanes still looking for a hit
+    int todo[MAX_DEPTH];
+    int todoOffset = 0;
+    int nodeNum = 0;
+    int nodesVisited = 0, nodesHit = 0, shapesTested = 0;
+    while(true)
+    {
+        const LinearNode& node = nodes[nodeNum];
+        nodesVisited++;
+        Maskx<N> lanes = open & intersectsP(node.bounds, rays, invDir, dirIsNeg);
+        if( any(lanes) )
+        {
+            nodesHit++;
+            if(node.nPrimitives > 0)
+            {
+                for(int i = 0; i < node.nPrimitives && any(lanes); i++)
+                {
+                    shapesTested++;
+                    Floatx<N> t;
+                    Maskx<N> hit = shapes[node.primitivesOffset + i]->intersectPacket(rays, lanes, &t);
+                    lanes = lanes & ~hit;
+                    open = open & ~hit;
+                }
+                if( none(open) || todoOffset == 0 ) break;
+                nodeNum = todo[--todoOffset];
+            }
+            else
+            {
+                todo[todoOffset++] = node.secondChildOffset;
+                nodeNum = nodeNum + 1;
+            }
+        }
+        else
+        {
+            if(todoOffset == 0) break;
+            nodeNum = todo[--todoOffset];
+        }
+    }
+
+    occluded = active & ~open;
+    STAT_ADD(nBVHOccluded, laneCount(occluded.bits()));
+    STAT_ADD(nBVHNodeTests, nodesVisited);
+    STAT_ADD(nBVHNodeHits, nodesHit);
+    STAT_ADD(nBVHShapeTests, shapesTested);
+    (void)nodesHit; (void)shapesTested; // only read when statistics are compiled in
+
+    return occluded;
+}
+
+template Maskx<4> BVH::intersect<4>(RayPacket<4>& rays, const Maskx<4>& active, Hit* hits) const;
+template Maskx<8> BVH::intersect<8>(RayPacket<8>& rays, const Maskx<8>& active, Hit* hits) const;
+template Maskx<16> BVH::intersect<16>(RayPacket<16>& rays, const Maskx<16>& active, Hit* hits) const;
+template Maskx<4> BVH::intersectP<4>(const RayPacket<4>& rays, const Maskx<4>& active) const;
+template Maskx<8> BVH::intersectP<8>(const RayPacket<8>& rays, const Maskx<8>& active) const;
+template Maskx<16> BVH::intersectP<16>(const RayPacket<16>& rays, const Maskx<16>& active) const;
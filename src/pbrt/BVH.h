@@ -0,0 +1,147 @@
+/*
+    BVH is a bounding volume hierarchy over a list of Shapes (BVHAccel in pbrt)
+    implementation starts @ (pg. 208) of pbrt 2nd ed.
+
+    the tree is built top down with the surface area heuristic (SAH), and is stored
+    flattened in depth first order:
+        * the first child of an interior node is always the next node in the array
+        * the second child is found at secondChildOffset
+        * leaves point at a contiguous run of shapes, which are reordered during the build
+*/
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "Array.h"
+#include "Shape.h"
+
+// how much work a traversal did, for the cost heatmap (see Heatmap.h)
+struct TraversalCost
+{
+    uint32_t nodesVisited = 0;
+    uint32_t shapeTests = 0;
+};
+
+class BVH
+{
+public:
+    // 32 bytes, so two nodes share a cache line
+    struct LinearNode
+    {
+        Bbox bounds;
+        union
+        {
+            int32_t primitivesOffset; // leaf
+            int32_t secondChildOffset; // interior
+        };
+        uint16_t nPrimitives; // 0 -> interior node
+        uint8_t axis; // interior node: the axis the children were split along
+        uint8_t pad;
+    };
+
+    // what the build needs to know about a primitive, index is its position in the caller's list
+    struct PrimitiveInfo
+    {
+        int index;
+        Bbox bounds;
+        Point centroid;
+    };
+
+    /* PUBLIC MEMBERS */
+    // the most nodes on any path from the root to a leaf, build() keeps every tree within it, so a traversal's
+    // stack of nodes still to visit never needs more than MAX_DEPTH entries
+    static constexpr int MAX_DEPTH = 64;
+    const int maxPrimsInNode;
+    std::vector<std::shared_ptr<Shape>> shapes; // in leaf order
+    Array<LinearNode> nodes; // borrowed when the tree came from a scene cache (see SceneCache.h)
+
+    /* CONSTRUCTORS */
+    BVH(std::vector<std::shared_ptr<Shape>> shapes, int maxPrimsInNode = 4);
+    // a tree that's already built, shapes are in the leaf order of nodes
+    BVH(std::vector<std::shared_ptr<Shape>> shapes, Array<LinearNode> nodes, int maxPrimsInNode = 4);
+
+    /* PUBLIC METHODS */
+    Bbox worldBound() const;
+
+    // builds a tree over info (which gets reordered) into nodes, and returns the primitives' indices in leaf
+    // order, so a leaf's primitives are order[primitivesOffset, primitivesOffset + nPrimitives)
+    // this is how BVH builds itself, and how aggregates that store their primitives their own way (e.g.
+    // SphereSoup) get the same tree
+    // with packLeaves, any node of at most maxPrimsInNode primitives becomes a leaf, for leaves that are tested
+    // all at once with SIMD (where a full leaf costs about what one primitive does)
+    static std::vector<int> build(std::vector<PrimitiveInfo>& info, int maxPrimsInNode, std::vector<LinearNode>& nodes, bool packLeaves = false);
+
+    // slab test against a node's bounds using the precomputed reciprocal direction @ (pg. 224)
+    static inline bool intersectsP(const Bbox& bounds, const Ray& ray, const Vector& invDir, const int dirIsNeg[3])
+    {
+        float t_min  = (bounds[    dirIsNeg[0]].x - ray.o.x) * invDir.x;
+        float t_max  = (bounds[1 - dirIsNeg[0]].x - ray.o.x) * invDir.x;
+        float ty_min = (bounds[    dirIsNeg[1]].y - ray.o.y) * invDir.y;
+        float ty_max = (bounds[1 - dirIsNeg[1]].y - ray.o.y) * invDir.y;
+        if(t_min > ty_max || ty_min > t_max) return false;
+        if(ty_min > t_min) t_min = ty_min;
+        if(ty_max < t_max) t_max = ty_max;
+
+        float tz_min = (bounds[    dirIsNeg[2]].z - ray.o.z) * invDir.z;
+        float tz_max = (bounds[1 - dirIsNeg[2]].z - ray.o.z) * invDir.z;
+        if(t_min > tz_max || tz_min > t_max) return false;
+        if(tz_min > t_min) t_min = tz_min;
+        if(tz_max < t_max) t_max = tz_max;
+
+        return (t_min < ray.t_max) && (t_max > ray.t_min);
+    }
+    // the same on every lane of a packet, with the same arithmetic and comparisons so every lane gets the answer
+    // its ray would on its own (NaNs included, hence select() where min/max would do)
+    template<int N>
+    static inline Maskx<N> intersectsP(const Bbox& bounds, const RayPacket<N>& rays, const Vec3x<N>& invDir, const Maskx<N> dirIsNeg[3])
+    {
+        Floatx<N> t_min  = (select(dirIsNeg[0], Floatx<N>(bounds.p_max.x), Floatx<N>(bounds.p_min.x)) - rays.o.x) * invDir.x;
+        Floatx<N> t_max  = (select(dirIsNeg[0], Floatx<N>(bounds.p_min.x), Floatx<N>(bounds.p_max.x)) - rays.o.x) * invDir.x;
+        Floatx<N> ty_min = (select(dirIsNeg[1], Floatx<N>(bounds.p_max.y), Floatx<N>(bounds.p_min.y)) - rays.o.y) * invDir.y;
+        Floatx<N> ty_max = (select(dirIsNeg[1], Floatx<N>(bounds.p_min.y), Floatx<N>(bounds.p_max.y)) - rays.o.y) * invDir.y;
+        Maskx<N> miss = (t_min > ty_max) | (ty_min > t_max);
+        t_min = select(ty_min > t_min, ty_min, t_min);
+        t_max = select(ty_max < t_max, ty_max, t_max);
+
+        Floatx<N> tz_min = (select(dirIsNeg[2], Floatx<N>(bounds.p_max.z), Floatx<N>(bounds.p_min.z)) - rays.o.z) * invDir.z;
+        Floatx<N> tz_max = (select(dirIsNeg[2], Floatx<N>(bounds.p_min.z), Floatx<N>(bounds.p_max.z)) - rays.o.z) * invDir.z;
+        miss = miss | (t_min > tz_max) | (tz_min > t_max);
+        t_min = select(tz_min > t_min, tz_min, t_min);
+        t_max = select(tz_max < t_max, tz_max, t_max);
+
+        return ~miss & (t_min < rays.t_max) & (t_max > rays.t_min);
+    }
+
+    // finds the closest intersection along ray, like Shape::intersect, and ray.t_max is shortened to it
+    // hit only ever holds a compact record of the closest hit so far, its DifferentialGeometry is left to the caller
+    // (see Hit.h)
+    // if cost is given, the nodes visited and shapes tested are added to it
+    bool intersect(const Ray& ray, Hit* hit, TraversalCost* cost = nullptr) const;
+
+    // traces the lanes of rays set in active through the tree together, for coherent rays like camera rays
+    // every lane's t_max is shortened to its closest hit, like intersect() does, and the lanes that hit are returned
+    // if hits (N of them) is given, each of those lanes gets the Hit intersect() would give it (the other lanes are left alone)
+    // a node is entered if any lane's ray hits its box, and a leaf's shapes are tested only against the lanes
+    // that hit it, packets wider than the SIMD registers first try to rule a node out with interval bounds over
+    // the whole packet
+    // (instantiated for packets of 4, 8 and 16 rays)
+    template<int N>
+    Maskx<N> intersect(RayPacket<N>& rays, const Maskx<N>& active, Hit* hits = nullptr) const;
+
+    // true if anything is hit along ray, like Shape::doesIntersect (IntersectP in pbrt)
+    // it stops at the first hit, and as any hit will do, children are visited in storage order instead of near first
+    // and shapes are asked for doesIntersect(), so no DifferentialGeometry is filled in and ray.t_max is left alone
+    bool intersectP(const Ray& ray, TraversalCost* cost = nullptr) const;
+
+    // the packet version, returns the lanes of active that hit anything, stopping once every one of them has
+    // (instantiated for packets of 4, 8 and 16 rays)
+    template<int N>
+    Maskx<N> intersectP(const RayPacket<N>& rays, const Maskx<N>& active) const;
+};
+
+#endif // BVH_H
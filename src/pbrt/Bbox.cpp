@@ -2,6 +2,9 @@
 
 #include "Bbox.h"
 #include "Ray.h"
+#include "Stats.h"
+
+STAT_RATIO("Intersections/Bbox hits per test", nBboxHits, nBboxTests);
 
 /* CONSTRUCTORS */
 Bbox::Bbox() :
@@ -14,20 +17,10 @@ Bbox::Bbox(const Point& p) :
     p_max(p)
 {}
 
-Bbox::Bbox(const Point& p1, const Point& p2)
-{
-    const float x_min = fmin(p1.x, p2.x);
-    const float x_max = fmax(p1.x, p2.x);
-
-    const float y_min = fmin(p1.y, p2.y);
-    const float y_max = fmax(p1.y, p2.y);
-
-    const float z_min = fmin(p1.z, p2.z);
-    const float z_max = fmax(p1.z, p2.z);
-    
-    p_min = Point(x_min, y_min, z_min);
-    p_max = Point(x_max, y_max, z_max);
-}
+Bbox::Bbox(const Point& p1, const Point& p2) :
+    p_min( min(p1, p2) ),
+    p_max( max(p1, p2) )
+{}
 
 /* PUBLIC METHODS */
 bool Bbox::overlaps(const Bbox& box) const
@@ -50,6 +43,8 @@ bool Bbox::containsPoint(const Point& p) const
 
 bool Bbox::intersectsP(const Ray& ray, float* t_hit0, float* t_hit1) const
 {
+    STAT_INC(nBboxTests);
+
     float t0 = ray.t_min;
     float t1 = ray.t_max;
     
@@ -72,6 +67,7 @@ bool Bbox::intersectsP(const Ray& ray, float* t_hit0, float* t_hit1) const
     if(t_hit0) *t_hit0 = t0;
     if(t_hit1) *t_hit1 = t1;
     
+    STAT_INC(nBboxHits);
     return true;
 }
 
@@ -80,29 +76,24 @@ float Bbox::volume() const
     return (p_max.x - p_min.x) * (p_max.y - p_min.y) * (p_max.z - p_min.z);
 }
 
-int Bbox::maximumExtent() const
+float Bbox::surfaceArea() const
 {
     Vector d = p_max - p_min;
-    
-    if(d.x > d.y && d.x > d.z)
-        return 0;
-    else if(d.y > d.z)
-        return 1;
-    
-    return 2;
+
+    return 2.0f * (d.x * d.y + d.x * d.z + d.y * d.z);
+}
+
+int Bbox::maximumExtent() const
+{
+    return maxDimension(p_max - p_min);
 }
 
 Bbox Bbox::Union(const Bbox& box, const Point& p)
 {
     Bbox newbox = box;
     
-    newbox.p_min.x = fmin(box.p_min.x, p.x);
-    newbox.p_min.y = fmin(box.p_min.y, p.y);
-    newbox.p_min.z = fmin(box.p_min.z, p.z);
-    
-    newbox.p_max.x = fmax(box.p_max.x, p.x);
-    newbox.p_max.y = fmax(box.p_max.y, p.y);
-    newbox.p_max.z = fmax(box.p_max.z, p.z);
+    newbox.p_min = min(box.p_min, p);
+    newbox.p_max = max(box.p_max, p);
     
     return newbox;
 }
@@ -111,13 +102,8 @@ Bbox Bbox::Union(const Bbox& box1, const Bbox& box2)
 {
     Bbox newbox = box1;
 
-    newbox.p_min.x = fmin(box1.p_min.x, box2.p_min.x);
-    newbox.p_min.y = fmin(box1.p_min.y, box2.p_min.y);
-    newbox.p_min.z = fmin(box1.p_min.z, box2.p_min.z);
-    
-    newbox.p_max.x = fmax(box1.p_max.x, box2.p_max.x);
-    newbox.p_max.y = fmax(box1.p_max.y, box2.p_max.y);
-    newbox.p_max.z = fmax(box1.p_max.z, box2.p_max.z);
+    newbox.p_min = min(box1.p_min, box2.p_min);
+    newbox.p_max = max(box1.p_max, box2.p_max);
     
     return newbox;
 }
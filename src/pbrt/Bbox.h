@@ -34,6 +34,8 @@ public:
 
     // returns the volume of the Bbox
     float volume() const;
+    // returns the surface area of the Bbox
+    float surfaceArea() const;
 
     // returns which of the three axes is the longest
     // x=0,  y=1,  z=2
@@ -46,6 +48,13 @@ public:
 
     // expands this Bbox by a constant factor delta 
     void expand(float delta);
+
+    /* INLINE OPERATOR OVERLOADS */
+    // box[0] is p_min and box[1] is p_max
+    inline const Point& operator[](int i) const
+    {
+        return (i == 0) ? p_min : p_max;
+    }
 };
 
 #endif // BBOX_H
\ No newline at end of file
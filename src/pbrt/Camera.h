@@ -5,12 +5,15 @@
 
 #include "Transform.h"
 #include "Sample.h"
+#include "Film.h"
+#include "Stats.h"
 class Ray;
-class Film;
 
 #ifndef CAMERA_H
 #define CAMERA_H
 
+STAT_COUNTER("Camera/Rays generated", nCameraRays);
+
 class Camera
 {
 protected:
@@ -67,8 +70,11 @@ public:
         world_to_screen = camera_to_screen * world_to_camera;
 
         // compute projective camera screen transformations
-        // screen_to_raster should actually be based on the Film's xResolution and yResolution per (pg. 260) in pbrt 2nd ed.
-        screen_to_raster = Transform::scale( (float)rt::CANVAS_WIDTH, (float)rt::CANVAS_HEIGHT, 1.0f ) *
+        // screen_to_raster is based on the Film's xResolution and yResolution per (pg. 260) in pbrt 2nd ed.
+        // (falling back to the canvas size when there is no Film)
+        float xResolution = film ? (float)film->xResolution : (float)rt::CANVAS_WIDTH;
+        float yResolution = film ? (float)film->yResolution : (float)rt::CANVAS_HEIGHT;
+        screen_to_raster = Transform::scale( xResolution, yResolution, 1.0f ) *
                         Transform::scale( 1.0f / (screen[1] - screen[0]), 1.0f / (screen[2] - screen[3]), 1.0f ) *
                         Transform::translate( Vector(-screen[0], -screen[3], 0.0f) );
         raster_to_screen = screen_to_raster.getInverse();
@@ -91,6 +97,8 @@ public:
     // implementation @ (pg. 264) of pbrt 2nd ed.
     float generateRay(Sample& sample, Ray* ray) const override
     {
+        STAT_INC(nCameraRays);
+
         // generate raster and camera samples
         Point p_ras(sample.image_x, sample.image_y, 0);
         Point p_camera;
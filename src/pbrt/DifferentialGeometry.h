@@ -40,16 +40,17 @@ struct DifferentialGeometry
     DifferentialGeometry(const Point& p,
         const Vector& dpdu, const Vector& dpdv,
         const Vector& dndu, const Vector& dndv,
-        float u, float v, Shape* shape
+        float u, float v, const Shape* shape
     ) :
         p(p),
-        dpdu(dpdu),
-        dpdv(dpdv),
-
         nn( Normal(normalize(cross(dpdu, dpdv))) ),
         u(u),
         v(v),
-        shape(shape)
+        shape(shape),
+        dpdu(dpdu),
+        dpdv(dpdv),
+        dndu(dndu),
+        dndv(dndv)
     {}
 };
 
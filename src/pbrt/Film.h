@@ -0,0 +1,117 @@
+/*
+    Film is the image the camera records to (see pg. 370 of pbrt 2nd ed.)
+    
+    each Sample's radiance is accumulated into the pixel it falls in (a box filter)
+    resolving the Film divides by the accumulated weight and converts to 8 bit RGBA
+*/
+
+#ifndef FILM_H
+#define FILM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "PerfCounters.h"
+#include "Sample.h"
+#include "Trace.h"
+#include "Vector.h"
+
+class Film
+{
+private:
+    /* PRIVATE MEMBERS */
+    struct Pixel
+    {
+        float r = 0, g = 0, b = 0;
+        float weight = 0;
+    };
+    std::vector<Pixel> pixels;
+
+public:
+    /* PUBLIC MEMBERS */
+    const int xResolution, yResolution;
+
+    /* CONSTRUCTORS */
+    Film(int xResolution, int yResolution) :
+        pixels(xResolution * yResolution),
+        xResolution(xResolution),
+        yResolution(yResolution)
+    {}
+
+    /* PUBLIC METHODS */
+    void clear()
+    {
+        std::fill(pixels.begin(), pixels.end(), Pixel());
+    }
+
+    // adds a sample of radiance L (stored as an rgb Vector) to the pixel the sample lies in
+    inline void addSample(const Sample& sample, const Vector& L)
+    {
+        int x = (int)sample.image_x;
+        int y = (int)sample.image_y;
+        if(x < 0 || x >= xResolution || y < 0 || y >= yResolution) return;
+
+        Pixel& p = pixels[y * xResolution + x];
+        p.r += L.x;
+        p.g += L.y;
+        p.b += L.z;
+        p.weight += 1.0f;
+    }
+
+    // returns the pixel's 8 bit RGBA8888 value (R in the highest bits)
+    inline uint32_t rgba(int x, int y) const
+    {
+        const Pixel& p = pixels[y * xResolution + x];
+        float inv = (p.weight > 0.0f) ? 1.0f / p.weight : 0.0f;
+
+        uint8_t r = (uint8_t)(255.0f * std::clamp(p.r * inv, 0.0f, 1.0f));
+        uint8_t g = (uint8_t)(255.0f * std::clamp(p.g * inv, 0.0f, 1.0f));
+        uint8_t b = (uint8_t)(255.0f * std::clamp(p.b * inv, 0.0f, 1.0f));
+        uint8_t a = 255;
+
+        return (r << 24) | (g << 16) | (b << 8) | a;
+    }
+
+    // writes the final image as RGBA8888 rows, pitch is in bytes (e.g. a locked SDL texture)
+    void resolve(void* out, int pitch) const
+    {
+        TRACE_SCOPE("film", "resolve");
+        perf::Scope counters("resolve");
+
+        for(int y = 0; y < yResolution; y++)
+        {
+            uint32_t* row = (uint32_t*)((uint8_t*)out + y * pitch);
+            for(int x = 0; x < xResolution; x++)
+                row[x] = rgba(x, y);
+        }
+    }
+
+    // writes the final image to path as a binary PPM, returns false if the file can't be opened
+    bool writePPM(const char* path) const
+    {
+        FILE* f = fopen(path, "wb");
+        if(!f) return false;
+
+        fprintf(f, "P6\n%d %d\n255\n", xResolution, yResolution);
+        std::vector<uint8_t> row(3 * xResolution);
+        for(int y = 0; y < yResolution; y++)
+        {
+            for(int x = 0; x < xResolution; x++)
+            {
+                uint32_t c = rgba(x, y);
+                row[3*x + 0] = (c >> 24) & 0xff;
+                row[3*x + 1] = (c >> 16) & 0xff;
+                row[3*x + 2] = (c >> 8) & 0xff;
+            }
+            fwrite(row.data(), 1, row.size(), f);
+        }
+
+        fclose(f);
+        return true;
+    }
+};
+
+#endif // FILM_H
@@ -0,0 +1,199 @@
+/*
+    Heatmap records what every pixel cost to render, for finding the expensive parts of a frame
+
+    when a Renderer is given a Heatmap, every camera sample is timed and the BVH reports how many nodes it
+    visited and how many shapes it tested; these are summed per pixel like the Film sums radiance
+
+    one metric at a time is mapped to false color (blue -> cyan -> green -> yellow -> red) between the
+    frame's min value of that metric and its 99.9th percentile (see scaleRange()), writePPM() adds a legend
+    bar under the image
+*/
+
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "BVH.h"
+#include "Sample.h"
+
+class Heatmap
+{
+public:
+    enum Metric { Time, Nodes, Tests, N_METRICS };
+
+private:
+    /* PRIVATE MEMBERS */
+    struct Pixel
+    {
+        float ns = 0; // wall time of every sample in the pixel
+        uint32_t nodes = 0, tests = 0;
+    };
+    std::vector<Pixel> pixels;
+
+public:
+    /* PUBLIC MEMBERS */
+    static constexpr int LEGEND_HEIGHT = 16; // rows writePPM() adds under the image
+
+    const int xResolution, yResolution;
+    Metric metric = Time; // what resolve() and writePPM() show
+
+    /* CONSTRUCTORS */
+    Heatmap(int xResolution, int yResolution) :
+        pixels(xResolution * yResolution),
+        xResolution(xResolution),
+        yResolution(yResolution)
+    {}
+
+    /* PUBLIC METHODS */
+    static const char* metricName(Metric m)
+    {
+        switch(m)
+        {
+            case Time:  return "time (ns)";
+            case Nodes: return "BVH nodes visited";
+            case Tests: return "shape tests";
+            default:    return "?";
+        }
+    }
+
+    void clear()
+    {
+        std::fill(pixels.begin(), pixels.end(), Pixel());
+    }
+
+    // adds what one sample cost to the pixel the sample lies in
+    inline void addSample(const Sample& sample, float ns, const TraversalCost& cost)
+    {
+        int x = (int)sample.image_x;
+        int y = (int)sample.image_y;
+        if(x < 0 || x >= xResolution || y < 0 || y >= yResolution) return;
+
+        Pixel& p = pixels[y * xResolution + x];
+        p.ns += ns;
+        p.nodes += cost.nodesVisited;
+        p.tests += cost.shapeTests;
+    }
+
+    // the pixel's value of the current metric
+    inline float value(int x, int y) const
+    {
+        const Pixel& p = pixels[y * xResolution + x];
+        switch(metric)
+        {
+            case Time:  return p.ns;
+            case Nodes: return (float)p.nodes;
+            case Tests: return (float)p.tests;
+            default:    return 0.0f;
+        }
+    }
+
+    // smallest and largest value of the current metric over the frame
+    void range(float* min, float* max) const
+    {
+        *min = *max = pixels.empty() ? 0.0f : value(0, 0);
+        for(int y = 0; y < yResolution; y++)
+            for(int x = 0; x < xResolution; x++)
+            {
+                float v = value(x, y);
+                *min = std::min(*min, v);
+                *max = std::max(*max, v);
+            }
+    }
+
+    // the values mapped to the two ends of the color scale: the min, and the 99.9th percentile rather than the max
+    // (a handful of samples that were preempted or page faulted would otherwise squash the rest of the frame into blue)
+    void scaleRange(float* lo, float* hi) const
+    {
+        std::vector<float> values(pixels.size());
+        for(int y = 0; y < yResolution; y++)
+            for(int x = 0; x < xResolution; x++)
+                values[y * xResolution + x] = value(x, y);
+
+        *lo = *hi = 0.0f;
+        if(values.empty()) return;
+
+        size_t top = std::min(values.size() - 1, (size_t)(0.999 * values.size()));
+        std::nth_element(values.begin(), values.begin() + top, values.end());
+        *hi = values[top];
+        *lo = *std::min_element(values.begin(), values.begin() + top + 1);
+    }
+
+    // maps t in [0, 1] to RGBA8888 (R in the highest bits)
+    static uint32_t falseColor(float t)
+    {
+        static const float stops[5][3] = {
+            { 0.0f, 0.0f, 1.0f }, // blue
+            { 0.0f, 1.0f, 1.0f }, // cyan
+            { 0.0f, 1.0f, 0.0f }, // green
+            { 1.0f, 1.0f, 0.0f }, // yellow
+            { 1.0f, 0.0f, 0.0f }  // red
+        };
+
+        t = std::clamp(t, 0.0f, 1.0f) * 4.0f;
+        int i = std::min((int)t, 3);
+        float f = t - i;
+
+        uint8_t c[3];
+        for(int k = 0; k < 3; k++)
+            c[k] = (uint8_t)(255.0f * (stops[i][k] * (1.0f - f) + stops[i + 1][k] * f));
+
+        return (c[0] << 24) | (c[1] << 16) | (c[2] << 8) | 255;
+    }
+
+    // writes the current metric as false color RGBA8888 rows, pitch is in bytes (e.g. a locked SDL texture)
+    void resolve(void* out, int pitch) const
+    {
+        float lo, hi;
+        scaleRange(&lo, &hi);
+        float scale = (hi > lo) ? 1.0f / (hi - lo) : 0.0f;
+
+        for(int y = 0; y < yResolution; y++)
+        {
+            uint32_t* row = (uint32_t*)((uint8_t*)out + y * pitch);
+            for(int x = 0; x < xResolution; x++)
+                row[x] = falseColor( (value(x, y) - lo) * scale );
+        }
+    }
+
+    // writes the current metric to path as a binary PPM, with the legend (scaleRange() left to right) under it
+    // returns false if the file can't be opened
+    bool writePPM(const char* path) const
+    {
+        FILE* f = fopen(path, "wb");
+        if(!f) return false;
+
+        std::vector<uint32_t> image(xResolution * yResolution);
+        resolve(image.data(), xResolution * sizeof(uint32_t));
+
+        fprintf(f, "P6\n%d %d\n255\n", xResolution, yResolution + LEGEND_HEIGHT);
+        std::vector<uint8_t> row(3 * xResolution);
+        for(int y = 0; y < yResolution + LEGEND_HEIGHT; y++)
+        {
+            for(int x = 0; x < xResolution; x++)
+            {
+                uint32_t c;
+                if(y < yResolution)
+                    c = image[y * xResolution + x];
+                else if(y == yResolution)
+                    c = 0x000000ff; // black line between the image and the legend
+                else
+                    c = falseColor( xResolution > 1 ? (float)x / (xResolution - 1) : 0.0f );
+
+                row[3*x + 0] = (c >> 24) & 0xff;
+                row[3*x + 1] = (c >> 16) & 0xff;
+                row[3*x + 2] = (c >> 8) & 0xff;
+            }
+            fwrite(row.data(), 1, row.size(), f);
+        }
+
+        fclose(f);
+        return true;
+    }
+};
+
+#endif // HEATMAP_H
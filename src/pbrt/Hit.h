@@ -0,0 +1,35 @@
+/*
+    Hit is what intersecting a ray records about the closest hit so far, and no more: the distance, the Shape
+    that was hit, and where on it
+
+    traversal keeps replacing it with closer hits, so it's kept small and cheap to fill in, and the full
+    DifferentialGeometry (dpdu, dndu, ...) is only worked out for the hit that ends up closest, when shading
+    asks the shape for it:
+        Hit hit;
+        if( scene.intersect(ray, &hit) )
+            hit.shape->getDifferentialGeometry(ray, hit, &dg);
+
+    primitive tells apart the pieces of shapes that hold many (the sphere of a SphereSoup), and (u, v) are
+    the surface coordinates of shapes that get them for free while intersecting (a triangle's barycentrics)
+    shapes that don't leave these at 0 and work everything out in getDifferentialGeometry()
+*/
+
+#ifndef HIT_H
+#define HIT_H
+
+#include <stdint.h>
+
+#include <cmath>
+
+class Shape;
+
+struct Hit
+{
+    /* PUBLIC MEMBERS */
+    float t = INFINITY;
+    float u = 0.0f, v = 0.0f;
+    uint32_t primitive = 0;
+    const Shape* shape = nullptr;
+};
+
+#endif // HIT_H
@@ -0,0 +1,93 @@
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+bool MappedFile::open(const char* path, bool sequential)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        message = "can't open the file";
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    length = (size_t)fileSize.QuadPart;
+    if(length == 0) return true; // an empty file can't be mapped, but there's nothing to read either
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    begin = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if(!begin)
+    {
+        message = "can't map the file";
+        close();
+        return false;
+    }
+#else
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        message = strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        message = strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    length = (size_t)st.st_size;
+    if(length == 0)
+    {
+        ::close(fd);
+        return true; // an empty file can't be mapped, but there's nothing to read either
+    }
+
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file open
+    if(mapped == MAP_FAILED)
+    {
+        message = strerror(errno);
+        length = 0;
+        return false;
+    }
+    // a sequential reader walks its part of the file front to back, so read ahead of it, anyone else would
+    // only have pages they never touch read in
+    madvise(mapped, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    begin = (const char*)mapped;
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if(begin) UnmapViewOfFile(begin);
+    if(mapping) CloseHandle(mapping);
+    if(file) CloseHandle(file);
+    mapping = file = nullptr;
+#else
+    if(begin) munmap((void*)begin, length);
+#endif
+    begin = nullptr;
+    length = 0;
+}
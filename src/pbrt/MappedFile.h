@@ -0,0 +1,65 @@
+/*
+    MappedFile maps a whole file read-only into memory (mmap, or MapViewOfFile on windows), so it can be
+    read like one big array without copying it through a stream buffer first
+    pages are only read in from disk as they're first touched, and several threads can read different parts
+    of it at once
+
+    usage:
+        MappedFile file;
+        if( !file.open(path) ) ... // file.error() says why
+        parse(file.data(), file.data() + file.size());
+
+    the mapping lasts until the MappedFile is destroyed (or open()s another file)
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+
+#include <string>
+
+class MappedFile
+{
+public:
+    /* CONSTRUCTORS */
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile()
+    {
+        close();
+    }
+
+    /* PUBLIC METHODS */
+    // maps path, returns false if it can't be opened or mapped
+    // sequential asks the OS to read ahead of a front to back reader, files that are read all over (like a
+    // scene cache, see SceneCache.h) should say false
+    bool open(const char* path, bool sequential = true);
+    void close();
+
+    const char* data() const
+    {
+        return begin;
+    }
+    size_t size() const
+    {
+        return length;
+    }
+    const std::string& error() const
+    {
+        return message;
+    }
+
+private:
+    /* PRIVATE MEMBERS */
+    const char* begin = nullptr;
+    size_t length = 0;
+    std::string message;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_H
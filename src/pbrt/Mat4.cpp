@@ -1,68 +1,187 @@
+#include <cmath>
+#include <utility>
+
 #include "Mat4.h"
 
-/* CONSTRUCTORS */
-Mat4::Mat4()
+#ifdef RT_MAT4_SSE
+#include <immintrin.h>
+#endif
+
+/* SSE KERNELS */
+#ifdef RT_MAT4_SSE
+// every row of a Mat4 is one 16 byte aligned __m128
+#define MAT4_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define MAT4_SWIZZLE(v, x, y, z, w) MAT4_SHUFFLE(v, v, x, y, z, w)
+
+// rounded after the multiply and again after the add, even where fma is available, so a product is the same
+// on every instruction set and matches the scalar one (built with -ffp-contract=off, see CMakeLists.txt)
+static inline __m128 madd(__m128 a, __m128 b, __m128 c)
+{
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+// row i of the product is the rows of m2 weighted by row i of m1
+static inline void multiplySSE(const Mat4& m1, const Mat4& m2, Mat4* r)
+{
+    __m128 b0 = _mm_load_ps(m2.m[0]);
+    __m128 b1 = _mm_load_ps(m2.m[1]);
+    __m128 b2 = _mm_load_ps(m2.m[2]);
+    __m128 b3 = _mm_load_ps(m2.m[3]);
+
+    for(int row = 0; row < 4; row++)
+    {
+        __m128 a = _mm_load_ps(m1.m[row]);
+        __m128 v = _mm_mul_ps(MAT4_SWIZZLE(a, 0, 0, 0, 0), b0);
+        v = madd(MAT4_SWIZZLE(a, 1, 1, 1, 1), b1, v);
+        v = madd(MAT4_SWIZZLE(a, 2, 2, 2, 2), b2, v);
+        v = madd(MAT4_SWIZZLE(a, 3, 3, 3, 3), b3, v);
+        _mm_store_ps(r->m[row], v);
+    }
+}
+
+static inline void transposeSSE(const Mat4& a, Mat4* r)
+{
+    __m128 r0 = _mm_load_ps(a.m[0]);
+    __m128 r1 = _mm_load_ps(a.m[1]);
+    __m128 r2 = _mm_load_ps(a.m[2]);
+    __m128 r3 = _mm_load_ps(a.m[3]);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_store_ps(r->m[0], r0);
+    _mm_store_ps(r->m[1], r1);
+    _mm_store_ps(r->m[2], r2);
+    _mm_store_ps(r->m[3], r3);
+}
+
+// 2x2 matrices packed as (a, b, c, d) = | a b |
+//                                       | c d |
+// A * B
+static inline __m128 mat2Mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, MAT4_SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(MAT4_SWIZZLE(a, 1, 0, 3, 2), MAT4_SWIZZLE(b, 2, 1, 2, 1)));
+}
+// adj(A) * B
+static inline __m128 mat2AdjMul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(MAT4_SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(MAT4_SWIZZLE(a, 1, 1, 2, 2), MAT4_SWIZZLE(b, 2, 3, 0, 1)));
+}
+// A * adj(B)
+static inline __m128 mat2MulAdj(__m128 a, __m128 b)
 {
-    for(int row = 0; row < ROWS; row++)
-        for(int col = 0; col < COLS; col++)
-            m[row][col] = (row == col) ? 1.0f : 0.0f;
+    return _mm_sub_ps(_mm_mul_ps(a, MAT4_SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(MAT4_SWIZZLE(a, 1, 0, 3, 2), MAT4_SWIZZLE(b, 2, 1, 2, 1)));
 }
 
-Mat4::Mat4(const float (&matrix)[ELEMS])
+// closed form inverse through the 2x2 blocks | A B |, using the adjugates of the blocks (the cofactor expansion)
+//                                            | C D |
+// returns false (and leaves r alone) if the determinant is 0 or the inverse doesn't fit in a float
+static inline bool inverseSSE(const Mat4& a, Mat4* r)
 {
-    for(int i = 0; i < ELEMS; i++)
-        m[(int)(i / COLS)][i % COLS] = matrix[i];
+    __m128 r0 = _mm_load_ps(a.m[0]);
+    __m128 r1 = _mm_load_ps(a.m[1]);
+    __m128 r2 = _mm_load_ps(a.m[2]);
+    __m128 r3 = _mm_load_ps(a.m[3]);
+
+    __m128 A = _mm_movelh_ps(r0, r1);
+    __m128 B = _mm_movehl_ps(r1, r0);
+    __m128 C = _mm_movelh_ps(r2, r3);
+    __m128 D = _mm_movehl_ps(r3, r2);
+
+    // determinants of the blocks, (|A|, |B|, |C|, |D|)
+    __m128 detSub = _mm_sub_ps(
+        _mm_mul_ps(MAT4_SHUFFLE(r0, r2, 0, 2, 0, 2), MAT4_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+        _mm_mul_ps(MAT4_SHUFFLE(r0, r2, 1, 3, 1, 3), MAT4_SHUFFLE(r1, r3, 0, 2, 0, 2))
+    );
+    __m128 detA = MAT4_SWIZZLE(detSub, 0, 0, 0, 0);
+    __m128 detB = MAT4_SWIZZLE(detSub, 1, 1, 1, 1);
+    __m128 detC = MAT4_SWIZZLE(detSub, 2, 2, 2, 2);
+    __m128 detD = MAT4_SWIZZLE(detSub, 3, 3, 3, 3);
+
+    __m128 D_C = mat2AdjMul(D, C);
+    __m128 A_B = mat2AdjMul(A, B);
+
+    // the inverse is 1/|M| * | X Y |, these are the adjugates of X, Y, Z and W
+    //                        | Z W |
+    __m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), mat2Mul(B, D_C));
+    __m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), mat2Mul(C, A_B));
+    __m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), mat2MulAdj(D, A_B));
+    __m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), mat2MulAdj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 tr = _mm_mul_ps(A_B, MAT4_SWIZZLE(D_C, 0, 2, 1, 3));
+    tr = _mm_add_ps(tr, MAT4_SWIZZLE(tr, 2, 3, 0, 1));
+    tr = _mm_add_ps(tr, MAT4_SWIZZLE(tr, 1, 0, 3, 2));
+    __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+    float det = _mm_cvtss_f32(detM);
+    if( det == 0.0f || !std::isfinite(1.0f / det) ) return false;
+
+    // the signs of the 2x2 adjugates, combined with 1/|M|
+    __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+    X_ = _mm_mul_ps(X_, rDetM);
+    Y_ = _mm_mul_ps(Y_, rDetM);
+    Z_ = _mm_mul_ps(Z_, rDetM);
+    W_ = _mm_mul_ps(W_, rDetM);
+
+    // undo the adjugate shuffle while storing the rows
+    _mm_store_ps(r->m[0], MAT4_SHUFFLE(X_, Y_, 3, 1, 3, 1));
+    _mm_store_ps(r->m[1], MAT4_SHUFFLE(X_, Y_, 2, 0, 2, 0));
+    _mm_store_ps(r->m[2], MAT4_SHUFFLE(Z_, W_, 3, 1, 3, 1));
+    _mm_store_ps(r->m[3], MAT4_SHUFFLE(Z_, W_, 2, 0, 2, 0));
+
+    return true;
 }
+#endif // RT_MAT4_SSE
 
-Mat4::Mat4(const float (&matrix)[ROWS][COLS])
+/* PRIVATE METHODS */
+#ifdef RT_MAT4_SSE
+Mat4 Mat4::multiplySSE(const Mat4& m1, const Mat4& m2)
 {
-    for(int row = 0; row < ROWS; row++)
-        for(int col = 0; col < COLS; col++)
-            m[row][col] = matrix[row][col];
+    Mat4 r;
+    ::multiplySSE(m1, m2, &r);
+
+    return r;
 }
 
-Mat4::Mat4(
-    float t00, float t01, float t02, float t03,
-    float t10, float t11, float t12, float t13,
-    float t20, float t21, float t22, float t23,
-    float t30, float t31, float t32, float t33
-)
+Mat4 Mat4::getTransposeSSE() const
 {
-    m[0][0]=t00; m[0][1]=t01; m[0][2]=t02; m[0][3]=t03;
-    m[1][0]=t10; m[1][1]=t11; m[1][2]=t12; m[1][3]=t13;
-    m[2][0]=t20; m[2][1]=t21; m[2][2]=t22; m[2][3]=t23;
-    m[3][0]=t30; m[3][1]=t31; m[3][2]=t32; m[3][3]=t33;
+    Mat4 r;
+    transposeSSE(*this, &r);
+
+    return r;
 }
+#endif // RT_MAT4_SSE
 
 /* PUBLIC METHODS */
 std::shared_ptr<Mat4> Mat4::multiply(const std::shared_ptr<Mat4> m1, const std::shared_ptr<Mat4> m2)
 {
-    float r[4][4];
-
-    for(int row = 0; row < ROWS; row++)
-        for(int col = 0; col < COLS; col++)
-            r[row][col] =
-                m1->m[row][0] * m2->m[0][col] + 
-                m1->m[row][1] * m2->m[1][col] + 
-                m1->m[row][2] * m2->m[2][col] + 
-                m1->m[row][3] * m2->m[3][col];
-    
-    return std::make_shared<Mat4>(r);
+    return std::make_shared<Mat4>( multiply(*m1, *m2) );
 }
 
 std::shared_ptr<Mat4> Mat4::transpose() const
 {
-    return std::make_shared<Mat4>(
-        m[0][0], m[1][0], m[2][0], m[3][0],
-        m[0][1], m[1][1], m[2][1], m[3][1],
-        m[0][2], m[1][2], m[2][2], m[3][2],
-        m[0][3], m[1][3], m[2][3], m[3][3]
-    );
+    return std::make_shared<Mat4>( getTranspose() );
+}
+
+Mat4 Mat4::getInverse(bool* singular) const
+{
+#ifdef RT_MAT4_SSE
+    Mat4 r;
+    bool ok = inverseSSE(*this, &r);
+    if(singular) *singular = !ok;
+
+    return ok ? r : Mat4();
+#else
+    return getInverseScalar(singular);
+#endif
+}
+
+std::shared_ptr<Mat4> Mat4::inverse() const
+{
+    return std::make_shared<Mat4>( getInverse() );
 }
 
 // chatgpt code
 // returns new matrix (identity matrix) if matrix is un-invertable 
-std::shared_ptr<Mat4> Mat4::inverse() const
+Mat4 Mat4::getInverseScalar(bool* singular) const
 {
     // Make a copy of this matrix.
     Mat4 t(*this);
@@ -83,7 +202,8 @@ std::shared_ptr<Mat4> Mat4::inverse() const
         }
         // Matrix is singular if the pivot element is zero.
         if (pivotSize == 0.0f) {
-            return std::make_shared<Mat4>();
+            if (singular) *singular = true;
+            return Mat4();
         }
         // Step 2: Swap rows if necessary.
         if (pivot != i) {
@@ -109,8 +229,8 @@ std::shared_ptr<Mat4> Mat4::inverse() const
             }
         }
     }
-    // Return the inverted matrix wrapped in a shared pointer.
-    return std::make_shared<Mat4>(s.m);
+    if (singular) *singular = false;
+    return s;
 }
 
 void Mat4::print() const
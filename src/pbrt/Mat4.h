@@ -1,6 +1,16 @@
 /*
     The Mat4 class is a representation of a 4x4 matrix
     these matrices are members to the Transform class, which holds a mat4 m and it's inverse, m_inv
+
+    multiply(Mat4, Mat4), getTranspose() and getInverse() work on values and never allocate
+    the shared_ptr versions (multiply(shared_ptr, shared_ptr), transpose(), inverse()) are kept for existing callers
+
+    on x86 (SSE2, which every x86-64 cpu has) multiply, transpose and inverse use SSE kernels, see Mat4.cpp
+    (FMA is used for multiply when compiling with -mfma), define RT_NO_SIMD to force the scalar code
+    the scalar versions are always available as multiplyScalar(), getTransposeScalar() and getInverseScalar()
+
+    the constructors, multiply() and getTranspose() are constexpr: in a constant expression they take the
+    scalar path (SSE intrinsics can't be evaluated by the compiler), so fixed matrices fold into static data
 */
 
 #ifndef MAT4_H
@@ -9,7 +19,19 @@
 #include <stdio.h>
 #include <memory>
 
-class Mat4
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(RT_NO_SIMD)
+#define RT_MAT4_SSE 1
+#endif
+
+// true while the compiler evaluates a constant expression (std::is_constant_evaluated() before C++20)
+// compilers without the builtin always take the scalar path
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#define RT_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define RT_CONSTANT_EVALUATED() true
+#endif
+
+class alignas(16) Mat4
 {
 private:
     /* PRIVATE MEMBERS */
@@ -22,22 +44,93 @@ public:
     float m[ROWS][COLS];
     
     /* CONSTRUCTORS */
-    Mat4();
-    Mat4(const float (&matrix)[ELEMS]);
-    Mat4(const float (&matrix)[ROWS][COLS]);
-    Mat4(
+    constexpr Mat4() : // identity
+        m{ { 1, 0, 0, 0 },
+           { 0, 1, 0, 0 },
+           { 0, 0, 1, 0 },
+           { 0, 0, 0, 1 } }
+    {}
+    constexpr Mat4(const float (&matrix)[ELEMS]) :
+        Mat4(matrix[0],  matrix[1],  matrix[2],  matrix[3],
+             matrix[4],  matrix[5],  matrix[6],  matrix[7],
+             matrix[8],  matrix[9],  matrix[10], matrix[11],
+             matrix[12], matrix[13], matrix[14], matrix[15])
+    {}
+    constexpr Mat4(const float (&matrix)[ROWS][COLS]) :
+        Mat4(matrix[0][0], matrix[0][1], matrix[0][2], matrix[0][3],
+             matrix[1][0], matrix[1][1], matrix[1][2], matrix[1][3],
+             matrix[2][0], matrix[2][1], matrix[2][2], matrix[2][3],
+             matrix[3][0], matrix[3][1], matrix[3][2], matrix[3][3])
+    {}
+    constexpr Mat4(
         float t00, float t01, float t02, float t03,
         float t10, float t11, float t12, float t13,
         float t20, float t21, float t22, float t23,
         float t30, float t31, float t32, float t33
-    );
+    ) :
+        m{ { t00, t01, t02, t03 },
+           { t10, t11, t12, t13 },
+           { t20, t21, t22, t23 },
+           { t30, t31, t32, t33 } }
+    {}
     
     /* PUBLIC METHODS */
+    static constexpr Mat4 multiply(const Mat4& m1, const Mat4& m2)
+    {
+#ifdef RT_MAT4_SSE
+        if( !RT_CONSTANT_EVALUATED() ) return multiplySSE(m1, m2);
+#endif
+        return multiplyScalar(m1, m2);
+    }
     static std::shared_ptr<Mat4> multiply(const std::shared_ptr<Mat4> m1, const std::shared_ptr<Mat4> m2);
 
+    constexpr Mat4 getTranspose() const
+    {
+#ifdef RT_MAT4_SSE
+        if( !RT_CONSTANT_EVALUATED() ) return getTransposeSSE();
+#endif
+        return getTransposeScalar();
+    }
+    // returns the identity matrix if the matrix is singular, and sets *singular (if given) to whether it was
+    Mat4 getInverse(bool* singular = nullptr) const;
+
+    // the portable implementations, which the SSE kernels are tested against
+    static constexpr Mat4 multiplyScalar(const Mat4& m1, const Mat4& m2)
+    {
+        Mat4 r;
+
+        for(int row = 0; row < ROWS; row++)
+            for(int col = 0; col < COLS; col++)
+                r.m[row][col] =
+                    m1.m[row][0] * m2.m[0][col] +
+                    m1.m[row][1] * m2.m[1][col] +
+                    m1.m[row][2] * m2.m[2][col] +
+                    m1.m[row][3] * m2.m[3][col];
+
+        return r;
+    }
+    constexpr Mat4 getTransposeScalar() const
+    {
+        return Mat4(
+            m[0][0], m[1][0], m[2][0], m[3][0],
+            m[0][1], m[1][1], m[2][1], m[3][1],
+            m[0][2], m[1][2], m[2][2], m[3][2],
+            m[0][3], m[1][3], m[2][3], m[3][3]
+        );
+    }
+    Mat4 getInverseScalar(bool* singular = nullptr) const; // Gauss-Jordan elimination with partial pivoting
+
     std::shared_ptr<Mat4> transpose() const;
     std::shared_ptr<Mat4> inverse() const;
     void print() const;
+
+private:
+    /* PRIVATE METHODS */
+#ifdef RT_MAT4_SSE
+    // the SSE kernels, see Mat4.cpp
+    static Mat4 multiplySSE(const Mat4& m1, const Mat4& m2);
+    Mat4 getTransposeSSE() const;
+#endif
 };
 
 #endif // MAT4_H
\ No newline at end of file
@@ -0,0 +1,1082 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MeshLoader.h"
+#include "Trace.h"
+
+/* THREADS */
+// calls f(i) for every i in [0, n), spread over threads threads (the calling thread included)
+template<typename F>
+static void parallelFor(int n, int threads, F&& f)
+{
+    threads = std::max(1, std::min(threads, n));
+    std::atomic<int> next { 0 };
+    auto worker = [&]()
+    {
+        for(int i = next++; i < n; i = next++)
+            f(i);
+    };
+
+    std::vector<std::thread> pool;
+    for(int i = 1; i < threads; i++)
+        pool.emplace_back(worker);
+    worker();
+    for(std::thread& t : pool)
+        t.join();
+}
+
+/* TEXT */
+struct Chunk
+{
+    const char* begin;
+    const char* end;
+};
+
+static constexpr size_t MIN_CHUNK_BYTES = 1 << 18;
+
+// cuts [begin, end) into about pieces chunks, each ending at the end of a line
+static std::vector<Chunk> splitLines(const char* begin, const char* end, int pieces)
+{
+    std::vector<Chunk> chunks;
+    size_t size = end - begin;
+    pieces = (int)std::max<size_t>(1, std::min<size_t>(pieces, size / MIN_CHUNK_BYTES));
+
+    const char* p = begin;
+    for(int i = 1; i <= pieces && p < end; i++)
+    {
+        const char* cut = (i == pieces) ? end : std::max(p, begin + size * i / pieces);
+        const char* nl = (const char*)memchr(cut, '\n', end - cut);
+        cut = nl ? nl + 1 : end;
+        chunks.push_back({ p, cut });
+        p = cut;
+    }
+
+    return chunks;
+}
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+static inline bool isDigit(char c)
+{
+    return (unsigned)(c - '0') < 10;
+}
+static inline const char* skipSpaces(const char* p, const char* end)
+{
+    while(p < end && isSpace(*p)) p++;
+    return p;
+}
+// the '\n' that ends the line p is on, or end
+static inline const char* lineEnd(const char* p, const char* end)
+{
+    const char* nl = (const char*)memchr(p, '\n', end - p);
+    return nl ? nl : end;
+}
+
+// every power of ten a double holds exactly
+static const double POWERS_OF_10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// strtof() on the token at start, for whatever parseFloat() doesn't handle itself
+static bool parseFloatSlow(const char* start, const char* end, const char** p, float* out)
+{
+    char token[64];
+    size_t n = 0;
+    while(start + n < end && n + 1 < sizeof(token) && !isSpace(start[n]) && start[n] != '\n')
+    {
+        token[n] = start[n];
+        n++;
+    }
+    token[n] = '\0';
+
+    char* parsed;
+    *out = strtof(token, &parsed);
+    if(parsed == token) return false;
+    *p = start + (parsed - token);
+
+    return true;
+}
+
+// parses the decimal number after any spaces at p, and moves p past it
+// the digits are gathered into an integer and scaled by an exact power of ten in double precision, which is
+// rounded correctly when both fit (Clinger's fast path), before rounding once more to float, which can land
+// 1 ulp from strtof() in rare halfway cases
+// anything else (more than 2^53, exponents past 22, inf, nan, ...) goes to strtof()
+static inline bool parseFloat(const char*& p, const char* end, float* out)
+{
+    p = skipSpaces(p, end);
+    const char* start = p;
+
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for(; p < end && isDigit(*p); p++)
+    {
+        any = true;
+        if(digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa) digits++;
+        }
+        else exponent++;
+    }
+    if(p < end && *p == '.')
+        for(p++; p < end && isDigit(*p); p++)
+        {
+            any = true;
+            if(digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa) digits++;
+                exponent--;
+            }
+        }
+    if(!any) return parseFloatSlow(start, end, &p, out);
+
+    if(p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* e = p + 1;
+        bool negativeExponent = false;
+        if(e < end && (*e == '-' || *e == '+'))
+        {
+            negativeExponent = *e == '-';
+            e++;
+        }
+        if(e < end && isDigit(*e))
+        {
+            int x = 0;
+            for(; e < end && isDigit(*e); e++)
+                if(x < 10000) x = x * 10 + (*e - '0');
+            exponent += negativeExponent ? -x : x;
+            p = e;
+        }
+    }
+
+    if(mantissa > (1ull << 53) || exponent < -22 || exponent > 22)
+        return parseFloatSlow(start, end, &p, out);
+
+    double d = (double)mantissa;
+    d = exponent < 0 ? d / POWERS_OF_10[-exponent] : d * POWERS_OF_10[exponent];
+    *out = (float)(negative ? -d : d);
+
+    return true;
+}
+
+// parses the integer after any spaces at p, and moves p past it
+static inline bool parseInt(const char*& p, const char* end, int64_t* out)
+{
+    p = skipSpaces(p, end);
+
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+    if(p == end || !isDigit(*p)) return false;
+
+    int64_t x = 0;
+    for(; p < end && isDigit(*p); p++)
+        if(x < ((int64_t)1 << 40)) x = x * 10 + (*p - '0');
+    *out = negative ? -x : x;
+
+    return true;
+}
+
+/* OBJ */
+// one face corner, "v", "v/vt", "v//vn" or "v/vt/vn", 0 for the indices it doesn't give
+struct ObjCorner
+{
+    int64_t v, vt, vn;
+};
+
+static inline bool parseCorner(const char*& p, const char* end, ObjCorner* c)
+{
+    c->vt = c->vn = 0;
+    if( !parseInt(p, end, &c->v) ) return false;
+    if(p < end && *p == '/')
+    {
+        p++;
+        if(p < end && *p != '/' && !parseInt(p, end, &c->vt)) return false;
+        if(p < end && *p == '/')
+        {
+            p++;
+            if( !parseInt(p, end, &c->vn) ) return false;
+        }
+    }
+
+    return p == end || isSpace(*p) || *p == '#';
+}
+
+// the corners of the face on [p, eol), false if there's something in it that isn't one
+static bool parseFace(const char* p, const char* eol, std::vector<ObjCorner>* corners)
+{
+    corners->clear();
+    while(true)
+    {
+        p = skipSpaces(p, eol);
+        if(p == eol || *p == '#') return true;
+        ObjCorner c;
+        if( !parseCorner(p, eol, &c) ) return false;
+        corners->push_back(c);
+    }
+}
+
+enum ObjLine { Other, Position, UV, Normal_, Face };
+
+// what the line at p holds, with p moved past its keyword
+static inline ObjLine objLine(const char*& p, const char* eol)
+{
+    p = skipSpaces(p, eol);
+    if(eol - p < 2) return Other;
+    if(p[0] == 'v')
+    {
+        if( isSpace(p[1]) )                                { p += 2; return Position; }
+        if(eol - p >= 3 && p[1] == 't' && isSpace(p[2]))   { p += 3; return UV; }
+        if(eol - p >= 3 && p[1] == 'n' && isSpace(p[2]))   { p += 3; return Normal_; }
+    }
+    else if(p[0] == 'f' && isSpace(p[1]))                  { p += 2; return Face; }
+
+    return Other;
+}
+
+// a chunk of an OBJ file, with what's in it after the first pass, and where its parts go after the prefix sums
+struct ObjChunk
+{
+    Chunk text;
+    int64_t v = 0, vt = 0, vn = 0; // counts of each line, then the indices of the chunk's first ones
+    int64_t corners = 0, triangles = 0; // of the faces with at least 3 corners, then the chunk's first ones
+    int64_t cornersWithUV = 0, cornersWithNormal = 0;
+    bool aligned = true; // every corner's vt and vn, if it has them, are its v, and none are relative
+    std::string error;
+};
+
+// the first pass, counting
+static void countObj(ObjChunk* chunk)
+{
+    std::vector<ObjCorner> corners;
+    for(const char* line = chunk->text.begin; line < chunk->text.end; )
+    {
+        const char* eol = lineEnd(line, chunk->text.end);
+        const char* p = line;
+        line = eol + 1;
+
+        switch( objLine(p, eol) )
+        {
+            case Position: chunk->v++; break;
+            case UV:       chunk->vt++; break;
+            case Normal_:  chunk->vn++; break;
+            case Face:
+                if( !parseFace(p, eol, &corners) )
+                {
+                    chunk->error = "can't read the face \"" + std::string(p, eol) + "\"";
+                    return;
+                }
+                if(corners.size() < 3) break;
+                chunk->corners += corners.size();
+                chunk->triangles += corners.size() - 2;
+                for(const ObjCorner& c : corners)
+                {
+                    chunk->cornersWithUV += c.vt != 0;
+                    chunk->cornersWithNormal += c.vn != 0;
+                    if( c.v < 0 || (c.vt != 0 && c.vt != c.v) || (c.vn != 0 && c.vn != c.v) )
+                        chunk->aligned = false;
+                }
+                break;
+            default: break;
+        }
+    }
+}
+
+// where the second pass puts what it reads
+struct ObjTargets
+{
+    // the attribute lines: into the mesh's buffers if aligned, otherwise into the arrays the corners copy from
+    SoA3 positions, normals;
+    float *us, *vs;
+    int64_t nPositions, nUVs, nNormals; // their sizes, which are never more than the file's v, vt and vn lines
+    bool uvs, hasNormals; // whether uvs and normals are kept at all
+
+    // the faces
+    bool aligned;
+    TriangleMesh* mesh;
+};
+
+static bool objIndex(int64_t i, int64_t seen, int64_t size, int64_t* index)
+{
+    *index = i > 0 ? i - 1 : seen + i; // relative indices count back from the last line read before the face
+    return *index >= 0 && *index < size;
+}
+
+// the second pass, parsing the attribute lines and/or the faces of the chunk
+static void parseObj(ObjChunk* chunk, const ObjTargets& t, bool attributes, bool faces)
+{
+    std::vector<ObjCorner> corners;
+    int64_t v = chunk->v, vt = chunk->vt, vn = chunk->vn; // the next of each line
+    int64_t corner = chunk->corners, triangle = chunk->triangles;
+    uint32_t* indices = t.mesh->indices.data();
+    SoA3 meshPositions = t.mesh->positions.soa(), meshNormals = t.mesh->normals.soa();
+
+    for(const char* line = chunk->text.begin; line < chunk->text.end; )
+    {
+        const char* eol = lineEnd(line, chunk->text.end);
+        const char* p = line;
+        line = eol + 1;
+
+        float x, y, z;
+        switch( objLine(p, eol) )
+        {
+            case Position:
+                if(attributes)
+                {
+                    if( !parseFloat(p, eol, &x) || !parseFloat(p, eol, &y) || !parseFloat(p, eol, &z) )
+                    {
+                        chunk->error = "can't read the vertex \"" + std::string(p, eol) + "\"";
+                        return;
+                    }
+                    if(v < t.nPositions) t.positions.set(v, x, y, z);
+                }
+                v++;
+                break;
+            case UV:
+                if(attributes && t.uvs)
+                {
+                    if( !parseFloat(p, eol, &x) ) x = 0.0f;
+                    if( !parseFloat(p, eol, &y) ) y = 0.0f;
+                    if(vt < t.nUVs)
+                    {
+                        t.us[vt] = x;
+                        t.vs[vt] = y;
+                    }
+                }
+                vt++;
+                break;
+            case Normal_:
+                if(attributes && t.hasNormals)
+                {
+                    if( !parseFloat(p, eol, &x) || !parseFloat(p, eol, &y) || !parseFloat(p, eol, &z) )
+                    {
+                        chunk->error = "can't read the normal \"" + std::string(p, eol) + "\"";
+                        return;
+                    }
+                    if(vn < t.nNormals) t.normals.set(vn, x, y, z);
+                }
+                vn++;
+                break;
+            case Face:
+            {
+                if(!faces) break;
+                parseFace(p, eol, &corners); // already checked by countObj()
+                int k = (int)corners.size();
+                if(k < 3) break;
+
+                // the face's vertices, as the mesh's vertex indices
+                uint32_t first = 0, previous = 0;
+                for(int i = 0; i < k; i++)
+                {
+                    const ObjCorner& c = corners[i];
+                    // aligned or not, a corner's vt and vn have to be lines the file has (when aligned they're
+                    // its v, but there can still be fewer vt or vn lines than v lines)
+                    int64_t iv, ivt = 0, ivn = 0;
+                    bool ok = objIndex(c.v, v, t.nPositions, &iv);
+                    if(t.uvs) ok = ok && objIndex(c.vt, vt, t.nUVs, &ivt);
+                    if(t.hasNormals) ok = ok && objIndex(c.vn, vn, t.nNormals, &ivn);
+                    if(!ok)
+                    {
+                        chunk->error = "the face \"" + std::string(p, eol) + "\" refers to a vertex that isn't in the file";
+                        return;
+                    }
+
+                    uint32_t vertex = (uint32_t)iv;
+                    if(!t.aligned)
+                    {
+                        // a copy of the corner's position, uv and normal of its own
+                        vertex = (uint32_t)corner++;
+                        meshPositions.set(vertex, t.positions.x[iv], t.positions.y[iv], t.positions.z[iv]);
+                        if(t.uvs)
+                        {
+                            t.mesh->us[vertex] = t.us[ivt];
+                            t.mesh->vs[vertex] = t.vs[ivt];
+                        }
+                        if(t.hasNormals)
+                            meshNormals.set(vertex, t.normals.x[ivn], t.normals.y[ivn], t.normals.z[ivn]);
+                    }
+
+                    // a fan around the first corner
+                    if(i == 0) first = vertex;
+                    if(i >= 2)
+                    {
+                        indices[3*triangle]     = first;
+                        indices[3*triangle + 1] = previous;
+                        indices[3*triangle + 2] = vertex;
+                        triangle++;
+                    }
+                    previous = vertex;
+                }
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+static std::shared_ptr<TriangleMesh> loadObj(const char* begin, const char* end, const Transform& object_to_world,
+    bool reverseOrientation, TriangleMesh::Intersector intersector, int threads, std::string* error)
+{
+    std::vector<ObjChunk> chunks;
+    for(const Chunk& c : splitLines(begin, end, 8 * threads))
+    {
+        chunks.emplace_back();
+        chunks.back().text = c;
+    }
+    parallelFor((int)chunks.size(), threads, [&](int i) { countObj(&chunks[i]); });
+
+    // the totals, and every chunk's counts turned into where its first of each goes
+    auto prefix = [](int64_t* count, int64_t* sum)
+    {
+        int64_t n = *count;
+        *count = *sum;
+        *sum += n;
+    };
+    ObjChunk total;
+    for(ObjChunk& c : chunks)
+    {
+        if( !c.error.empty() )
+        {
+            *error = c.error;
+            return nullptr;
+        }
+        prefix(&c.v, &total.v);
+        prefix(&c.vt, &total.vt);
+        prefix(&c.vn, &total.vn);
+        prefix(&c.corners, &total.corners);
+        prefix(&c.triangles, &total.triangles);
+        total.cornersWithUV += c.cornersWithUV;
+        total.cornersWithNormal += c.cornersWithNormal;
+        total.aligned = total.aligned && c.aligned;
+    }
+
+    // uvs and normals are only kept if every corner has one
+    ObjTargets t;
+    t.uvs = total.vt > 0 && total.cornersWithUV == total.corners;
+    t.hasNormals = total.vn > 0 && total.cornersWithNormal == total.corners;
+    t.aligned = total.aligned;
+    int64_t nVertices = t.aligned ? total.v : total.corners;
+    if(nVertices > INT32_MAX || total.triangles > INT32_MAX)
+    {
+        *error = "too many vertices or triangles for 32-bit indices";
+        return nullptr;
+    }
+
+    std::shared_ptr<TriangleMesh> mesh = std::make_shared<TriangleMesh>(object_to_world, reverseOrientation,
+        (int)total.triangles, (int)nVertices, t.hasNormals, t.uvs, intersector);
+    t.mesh = mesh.get();
+    t.nPositions = total.v;
+    t.nUVs = t.uvs ? total.vt : 0;
+    t.nNormals = t.hasNormals ? total.vn : 0;
+
+    if(t.aligned)
+    {
+        // the file's vertices are the mesh's, so everything goes straight in, in one pass
+        t.positions = mesh->positions.soa();
+        t.normals = mesh->normals.soa();
+        t.us = mesh->us.data();
+        t.vs = mesh->vs.data();
+        t.nUVs = std::min(t.nUVs, nVertices);
+        t.nNormals = std::min(t.nNormals, nVertices);
+        parallelFor((int)chunks.size(), threads, [&](int i) { parseObj(&chunks[i], t, true, true); });
+    }
+    else
+    {
+        // the attributes are read first, and then copied to the corners that use them
+        SoA3Buffer positions(t.nPositions), normals(t.nNormals);
+        std::vector<float> us(t.nUVs), vs(t.nUVs);
+        t.positions = positions.soa();
+        t.normals = normals.soa();
+        t.us = us.data();
+        t.vs = vs.data();
+        parallelFor((int)chunks.size(), threads, [&](int i) { parseObj(&chunks[i], t, true, false); });
+        if( std::none_of(chunks.begin(), chunks.end(), [](const ObjChunk& c) { return !c.error.empty(); }) )
+            parallelFor((int)chunks.size(), threads, [&](int i) { parseObj(&chunks[i], t, false, true); });
+    }
+
+    for(const ObjChunk& c : chunks)
+        if( !c.error.empty() )
+        {
+            *error = c.error;
+            return nullptr;
+        }
+
+    return mesh;
+}
+
+/* PLY */
+enum PlyType { Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64, NotAList };
+
+static int plySize(PlyType type)
+{
+    static const int sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+    return sizes[type];
+}
+
+static bool plyType(const std::string& name, PlyType* type)
+{
+    static const char* names[][2] = {
+        { "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+        { "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" }
+    };
+    for(int i = 0; i < 8; i++)
+        if(name == names[i][0] || name == names[i][1])
+        {
+            *type = (PlyType)i;
+            return true;
+        }
+
+    return false;
+}
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type; // of the property, or of a list's items
+    PlyType countType = NotAList; // of a list's count
+    int role = -1; // for the vertex element, see loadPly()
+};
+
+struct PlyElement
+{
+    std::string name;
+    int64_t count = 0;
+    std::vector<PlyProperty> properties;
+
+    // the bytes of a record, or 0 if it has lists and they depend on the record
+    int stride() const
+    {
+        int bytes = 0;
+        for(const PlyProperty& p : properties)
+        {
+            if(p.countType != NotAList) return 0;
+            bytes += plySize(p.type);
+        }
+        return bytes;
+    }
+};
+
+// reads a binary value of type at p as a double, which holds every PLY type exactly
+static inline double readBinary(const char* p, PlyType type, bool swap)
+{
+    unsigned char bytes[8];
+    int size = plySize(type);
+    memcpy(bytes, p, size);
+    if(swap) std::reverse(bytes, bytes + size);
+
+    switch(type)
+    {
+        case Int8:    { int8_t x;   memcpy(&x, bytes, 1); return x; }
+        case Uint8:   { uint8_t x;  memcpy(&x, bytes, 1); return x; }
+        case Int16:   { int16_t x;  memcpy(&x, bytes, 2); return x; }
+        case Uint16:  { uint16_t x; memcpy(&x, bytes, 2); return x; }
+        case Int32:   { int32_t x;  memcpy(&x, bytes, 4); return x; }
+        case Uint32:  { uint32_t x; memcpy(&x, bytes, 4); return x; }
+        case Float32: { float x;    memcpy(&x, bytes, 4); return x; }
+        case Float64: { double x;   memcpy(&x, bytes, 8); return x; }
+        default:      return 0.0;
+    }
+}
+
+// the header, up to and including "end_header", false (and *error) if it isn't one
+static bool readPlyHeader(const char* begin, const char* end, std::vector<PlyElement>* elements, std::string* format,
+    const char** data, std::string* error)
+{
+    const char* next = begin;
+    bool first = true;
+    while(next < end)
+    {
+        const char* line = next;
+        const char* eol = lineEnd(line, end);
+        std::vector<std::string> words;
+        for(const char* p = skipSpaces(line, eol); p < eol; p = skipSpaces(p, eol))
+        {
+            const char* w = p;
+            while(p < eol && !isSpace(*p)) p++;
+            words.push_back( std::string(w, p) );
+        }
+        next = eol + 1;
+
+        if(first)
+        {
+            if(words.size() != 1 || words[0] != "ply")
+            {
+                *error = "not a PLY file";
+                return false;
+            }
+            first = false;
+        }
+        else if(words.empty() || words[0] == "comment" || words[0] == "obj_info") continue;
+        else if(words[0] == "format" && words.size() >= 2) *format = words[1];
+        else if(words[0] == "element" && words.size() == 3)
+        {
+            elements->emplace_back();
+            elements->back().name = words[1];
+            elements->back().count = strtoll(words[2].c_str(), nullptr, 10);
+        }
+        else if(words[0] == "property" && !elements->empty())
+        {
+            PlyProperty p;
+            bool ok;
+            if(words.size() == 5 && words[1] == "list")
+            {
+                ok = plyType(words[2], &p.countType) && plyType(words[3], &p.type) && p.countType != Float32 && p.countType != Float64;
+                p.name = words[4];
+            }
+            else
+            {
+                ok = words.size() == 3 && plyType(words[1], &p.type);
+                p.name = words.back();
+            }
+            if(!ok)
+            {
+                *error = "can't read the property \"" + std::string(line, eol) + "\"";
+                return false;
+            }
+            elements->back().properties.push_back(p);
+        }
+        else if(words[0] == "end_header")
+        {
+            *data = std::min(next, end);
+            return true;
+        }
+        else
+        {
+            *error = "unknown header line \"" + words[0] + "\"";
+            return false;
+        }
+    }
+
+    *error = "the header has no end_header";
+    return false;
+}
+
+// parses the vertex at p (binary: the record, ascii: the line) into vertex i of the mesh
+static inline bool readPlyVertex(const PlyElement& element, const char*& p, const char* end, bool binary, bool swap,
+    TriangleMesh* mesh, const SoA3& positions, const SoA3& normals, int64_t i)
+{
+    float values[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    for(const PlyProperty& property : element.properties)
+    {
+        float x;
+        if(binary)
+        {
+            x = (float)readBinary(p, property.type, swap);
+            p += plySize(property.type);
+        }
+        else if( !parseFloat(p, end, &x) ) return false;
+        if(property.role >= 0) values[property.role] = x;
+    }
+
+    positions.set(i, values[0], values[1], values[2]);
+    if(normals.x) normals.set(i, values[3], values[4], values[5]);
+    if( !mesh->us.empty() )
+    {
+        mesh->us[i] = values[6];
+        mesh->vs[i] = values[7];
+    }
+
+    return true;
+}
+
+// parses the face at p (binary: the record, ascii: the line) into triangles from *triangle on, which moves past them,
+// as a fan like an OBJ face, false if it's unreadable or has a vertex index the mesh doesn't
+// with indices null it only counts them
+static inline bool readPlyFace(const PlyElement& element, int list, const char*& p, const char* end, bool binary, bool swap,
+    uint32_t* indices, int64_t nVertices, int64_t* triangle)
+{
+    for(int j = 0; j < (int)element.properties.size(); j++)
+    {
+        const PlyProperty& property = element.properties[j];
+        int64_t count = 1;
+        if(property.countType != NotAList)
+        {
+            if(binary)
+            {
+                if(end - p < plySize(property.countType)) return false;
+                count = (int64_t)readBinary(p, property.countType, swap);
+                p += plySize(property.countType);
+            }
+            else if( !parseInt(p, end, &count) ) return false;
+        }
+        if(count < 0) return false;
+
+        if(binary && (end - p) / plySize(property.type) < count) return false;
+
+        if(j != list)
+        {
+            // skipped
+            float x;
+            if(binary) p += count * plySize(property.type);
+            else
+                for(int64_t k = 0; k < count; k++)
+                    if( !parseFloat(p, end, &x) ) return false;
+            continue;
+        }
+
+        uint32_t first = 0, previous = 0;
+        for(int64_t k = 0; k < count; k++)
+        {
+            int64_t index;
+            if(binary)
+            {
+                index = (int64_t)readBinary(p, property.type, swap);
+                p += plySize(property.type);
+            }
+            else if( !parseInt(p, end, &index) ) return false;
+            if(!indices) continue;
+            if(index < 0 || index >= nVertices) return false;
+
+            uint32_t vertex = (uint32_t)index;
+            if(k == 0) first = vertex;
+            if(k >= 2)
+            {
+                indices[3 * *triangle]     = first;
+                indices[3 * *triangle + 1] = previous;
+                indices[3 * *triangle + 2] = vertex;
+                ++*triangle;
+            }
+            previous = vertex;
+        }
+        if(!indices) *triangle += std::max<int64_t>(0, count - 2);
+    }
+
+    return true;
+}
+
+static std::shared_ptr<TriangleMesh> loadPly(const char* begin, const char* end, const Transform& object_to_world,
+    bool reverseOrientation, TriangleMesh::Intersector intersector, int threads, std::string* error)
+{
+    std::vector<PlyElement> elements;
+    std::string format;
+    const char* data;
+    if( !readPlyHeader(begin, end, &elements, &format, &data, error) ) return nullptr;
+
+    bool binary = format != "ascii";
+    const uint16_t one = 1;
+    bool littleEndianHost = *(const uint8_t*)&one == 1;
+    bool swap = false;
+    if(format == "binary_little_endian") swap = !littleEndianHost;
+    else if(format == "binary_big_endian") swap = littleEndianHost;
+    else if(binary)
+    {
+        *error = "unknown format \"" + format + "\"";
+        return nullptr;
+    }
+
+    // the vertex element's properties get roles: 0-2 position, 3-5 normal, 6-7 uv, -1 skipped
+    int vertexElement = -1, faceElement = -1, faceList = -1;
+    bool found[8] = {};
+    for(int e = 0; e < (int)elements.size(); e++)
+    {
+        PlyElement& element = elements[e];
+        if(element.name == "vertex")
+        {
+            vertexElement = e;
+            static const char* roles[][4] = {
+                { "x" }, { "y" }, { "z" }, { "nx" }, { "ny" }, { "nz" },
+                { "u", "s", "texture_u", "texture_s" }, { "v", "t", "texture_v", "texture_t" }
+            };
+            for(PlyProperty& p : element.properties)
+                for(int r = 0; r < 8; r++)
+                    for(const char* name : roles[r])
+                        if(name && p.name == name && p.countType == NotAList)
+                        {
+                            p.role = r;
+                            found[r] = true;
+                        }
+        }
+        else if(element.name == "face")
+        {
+            faceElement = e;
+            for(int j = 0; j < (int)element.properties.size(); j++)
+                if( element.properties[j].countType != NotAList &&
+                    (element.properties[j].name == "vertex_indices" || element.properties[j].name == "vertex_index") )
+                    faceList = j;
+        }
+    }
+    if(vertexElement < 0 || !found[0] || !found[1] || !found[2] || faceElement < 0 || faceList < 0)
+    {
+        *error = "needs a vertex element with x, y and z, and a face element with vertex_indices";
+        return nullptr;
+    }
+    const PlyElement& vertices = elements[vertexElement];
+    const PlyElement& faces = elements[faceElement];
+    bool hasNormals = found[3] && found[4] && found[5], hasUVs = found[6] && found[7];
+    for(PlyProperty& p : elements[vertexElement].properties)
+        if( (p.role >= 3 && p.role < 6 && !hasNormals) || (p.role >= 6 && !hasUVs) ) p.role = -1;
+    if(binary && vertices.stride() == 0)
+    {
+        *error = "vertices with list properties aren't supported";
+        return nullptr;
+    }
+
+    // where the vertices and faces start, and how many triangles the faces make
+    // binary: byte offsets, faces that are all triangles are a fixed size, anything else is walked record by record
+    // ascii: line numbers, found by counting the lines of every chunk
+    int64_t vertexStart = 0, faceStart = 0, nTriangles = 0;
+    bool fixedFaces = false;
+    std::vector<Chunk> chunks;
+    std::vector<int64_t> firstLine, firstTriangle;
+    if(binary)
+    {
+        const char* p = data;
+        int last = std::max(vertexElement, faceElement);
+        bool complete = false;
+        for(int e = 0; e <= last; e++)
+        {
+            const PlyElement& element = elements[e];
+            if(e == vertexElement) vertexStart = p - data;
+            if(e == faceElement) faceStart = p - data;
+
+            int stride = element.stride();
+            if(stride > 0)
+            {
+                if( (end - p) / stride < element.count ) break;
+                p += element.count * stride;
+                complete = e == last;
+                continue;
+            }
+
+            if(e == faceElement && element.properties.size() == 1)
+            {
+                // if every count is 3 the records are all the same size, and that's checked in parallel
+                PlyType countType = element.properties[0].countType;
+                int triangleStride = plySize(countType) + 3 * plySize(element.properties[0].type);
+                if( (end - p) / triangleStride >= element.count )
+                {
+                    std::atomic<bool> allTriangles { true };
+                    int tasks = (int)std::min<int64_t>(8 * threads, std::max<int64_t>(1, element.count / 65536));
+                    parallelFor(tasks, threads, [&](int task)
+                    {
+                        for(int64_t i = element.count * task / tasks; i < element.count * (task + 1) / tasks; i++)
+                            if(readBinary(p + i * triangleStride, countType, swap) != 3.0)
+                            {
+                                allTriangles = false;
+                                return;
+                            }
+                    });
+                    if(allTriangles)
+                    {
+                        fixedFaces = true;
+                        nTriangles = element.count;
+                        p += element.count * triangleStride;
+                        complete = e == last;
+                        continue;
+                    }
+                }
+            }
+
+            // records of different sizes, walked one at a time
+            int64_t triangles = 0, i = 0;
+            for(; i < element.count; i++)
+                if( !readPlyFace(element, e == faceElement ? faceList : -1, p, end, true, swap, nullptr, 0, &triangles) ) break;
+            if(i < element.count) break;
+            if(e == faceElement) nTriangles = triangles;
+            complete = e == last;
+        }
+        if(!complete)
+        {
+            *error = "the file is shorter than its header says";
+            return nullptr;
+        }
+    }
+    else
+    {
+        // the line every chunk starts on, then how many triangles the faces before each chunk make
+        chunks = splitLines(data, end, 8 * threads);
+        firstLine.assign(chunks.size() + 1, 0);
+        parallelFor((int)chunks.size(), threads, [&](int i)
+        {
+            int64_t lines = 0;
+            for(const char* p = chunks[i].begin; (p = (const char*)memchr(p, '\n', chunks[i].end - p)) != nullptr; p++)
+                lines++;
+            if(chunks[i].end > chunks[i].begin && chunks[i].end[-1] != '\n') lines++; // the last line, with no '\n'
+            firstLine[i + 1] = lines;
+        });
+        for(size_t i = 0; i < chunks.size(); i++)
+            firstLine[i + 1] += firstLine[i];
+
+        for(int e = 0; e < vertexElement; e++)
+            vertexStart += elements[e].count;
+        for(int e = 0; e < faceElement; e++)
+            faceStart += elements[e].count;
+        if(firstLine.back() < std::max(vertexStart + vertices.count, faceStart + faces.count))
+        {
+            *error = "the file is shorter than its header says";
+            return nullptr;
+        }
+
+        firstTriangle.assign(chunks.size() + 1, 0);
+        std::atomic<bool> ok { true };
+        parallelFor((int)chunks.size(), threads, [&](int i)
+        {
+            int64_t lineNumber = firstLine[i], triangles = 0;
+            for(const char* line = chunks[i].begin; line < chunks[i].end; lineNumber++)
+            {
+                const char* eol = lineEnd(line, chunks[i].end);
+                const char* p = line;
+                line = eol + 1;
+                if(lineNumber >= faceStart && lineNumber < faceStart + faces.count &&
+                    !readPlyFace(faces, faceList, p, eol, false, false, nullptr, 0, &triangles))
+                    ok = false;
+            }
+            firstTriangle[i + 1] = triangles;
+        });
+        if(!ok)
+        {
+            *error = "can't read a face";
+            return nullptr;
+        }
+        for(size_t i = 0; i < chunks.size(); i++)
+            firstTriangle[i + 1] += firstTriangle[i];
+        nTriangles = firstTriangle.back();
+    }
+
+    if(vertices.count > INT32_MAX || nTriangles > INT32_MAX)
+    {
+        *error = "too many vertices or triangles for 32-bit indices";
+        return nullptr;
+    }
+    std::shared_ptr<TriangleMesh> mesh = std::make_shared<TriangleMesh>(object_to_world, reverseOrientation,
+        (int)nTriangles, (int)vertices.count, hasNormals, hasUVs, intersector);
+    SoA3 positions = mesh->positions.soa(), normals = mesh->normals.soa();
+    uint32_t* indices = mesh->indices.data();
+    std::atomic<bool> ok { true };
+
+    if(binary)
+    {
+        // both split by record, except faces of different sizes, which one task walks on its own
+        int stride = vertices.stride();
+        int vertexTasks = (int)std::min<int64_t>(8 * threads, std::max<int64_t>(1, vertices.count / 65536));
+        int faceTasks = fixedFaces ? (int)std::min<int64_t>(8 * threads, std::max<int64_t>(1, faces.count / 65536)) : 1;
+        int faceStride = 0;
+        if(fixedFaces)
+            for(const PlyProperty& property : faces.properties)
+                faceStride += plySize(property.countType) + 3 * plySize(property.type);
+
+        parallelFor(vertexTasks + faceTasks, threads, [&](int task)
+        {
+            if(task < vertexTasks)
+            {
+                int64_t i0 = vertices.count * task / vertexTasks, i1 = vertices.count * (task + 1) / vertexTasks;
+                const char* p = data + vertexStart + i0 * stride;
+                for(int64_t i = i0; i < i1; i++)
+                    readPlyVertex(vertices, p, end, true, swap, mesh.get(), positions, normals, i);
+                return;
+            }
+
+            task -= vertexTasks;
+            int64_t i0 = faces.count * task / faceTasks, i1 = faces.count * (task + 1) / faceTasks;
+            const char* p = data + faceStart + i0 * faceStride;
+            int64_t triangle = fixedFaces ? i0 : 0;
+            for(int64_t i = i0; i < i1; i++)
+                if( !readPlyFace(faces, faceList, p, end, true, swap, indices, vertices.count, &triangle) )
+                {
+                    ok = false;
+                    return;
+                }
+        });
+    }
+    else
+    {
+        parallelFor((int)chunks.size(), threads, [&](int i)
+        {
+            int64_t lineNumber = firstLine[i], triangle = firstTriangle[i];
+            for(const char* line = chunks[i].begin; line < chunks[i].end; lineNumber++)
+            {
+                const char* eol = lineEnd(line, chunks[i].end);
+                const char* p = line;
+                line = eol + 1;
+                bool read = true;
+                if(lineNumber >= vertexStart && lineNumber < vertexStart + vertices.count)
+                    read = readPlyVertex(vertices, p, eol, false, false, mesh.get(), positions, normals, lineNumber - vertexStart);
+                else if(lineNumber >= faceStart && lineNumber < faceStart + faces.count)
+                    read = readPlyFace(faces, faceList, p, eol, false, false, indices, vertices.count, &triangle);
+                if(!read)
+                {
+                    ok = false;
+                    return;
+                }
+            }
+        });
+    }
+
+    if(!ok)
+    {
+        *error = "a face refers to a vertex that isn't in the file, or a vertex or face can't be read";
+        return nullptr;
+    }
+
+    return mesh;
+}
+
+/* LOADING */
+std::shared_ptr<TriangleMesh> loadMesh(const char* path, const Transform& object_to_world, bool reverseOrientation,
+    TriangleMesh::Intersector intersector, int threads, MeshLoadInfo* info)
+{
+    TRACE_SCOPE("load", "loadMesh");
+    auto start = std::chrono::steady_clock::now();
+    if(threads <= 0) threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+    std::string extension = path;
+    extension = extension.substr( std::min(extension.size(), extension.rfind('.')) );
+    for(char& c : extension)
+        c = (char)tolower(c);
+
+    MappedFile file;
+    std::string error;
+    std::shared_ptr<TriangleMesh> mesh;
+    if( !file.open(path) ) error = file.error();
+    else if(extension == ".obj")
+        mesh = loadObj(file.data(), file.data() + file.size(), object_to_world, reverseOrientation, intersector, threads, &error);
+    else if(extension == ".ply")
+        mesh = loadPly(file.data(), file.data() + file.size(), object_to_world, reverseOrientation, intersector, threads, &error);
+    else error = "isn't an .obj or a .ply";
+
+    if(!mesh)
+    {
+        printf("[loadMesh] %s: %s\n", path, error.c_str());
+        return nullptr;
+    }
+
+    auto parsed = std::chrono::steady_clock::now();
+    mesh->build();
+    auto built = std::chrono::steady_clock::now();
+
+    if(info)
+    {
+        info->bytes = file.size();
+        info->threads = threads;
+        info->parseSeconds = std::chrono::duration<double>(parsed - start).count();
+        info->buildSeconds = std::chrono::duration<double>(built - parsed).count();
+    }
+
+    return mesh;
+}
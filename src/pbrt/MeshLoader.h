@@ -0,0 +1,57 @@
+/*
+    loadMesh() reads a triangle mesh from a Wavefront OBJ (.obj) or Stanford PLY (.ply, ascii or binary) file
+    into a TriangleMesh
+
+    the file is mapped into memory (see MappedFile.h) rather than read through a stream, and parsed by
+    several threads at once in two passes over it:
+        1. the file is cut into chunks at line (or record) boundaries, and every chunk counts its vertices,
+           uvs, normals and triangles
+        2. those counts add up to where each chunk's first vertex and triangle go, so the TriangleMesh is
+           allocated at its final size and every chunk parses its numbers straight into the mesh's buffers,
+           with no vectors growing along the way
+    numbers are parsed by hand (see parseFloat() in MeshLoader.cpp), not with strtof() and friends, which are
+    slow and depend on the locale
+    binary PLY files whose faces are all triangles are split by record number, without a counting pass
+
+    OBJ faces with more than 3 vertices, and PLY faces likewise, are split into triangle fans
+    an OBJ vertex is a position and, if every face gives one, a uv and a normal: when every corner's uv and
+    normal have its position's index, the mesh shares vertices like the file does, otherwise every corner
+    of every face becomes its own vertex (relative, negative, indices always take this path)
+
+    usage:
+        MeshLoadInfo info;
+        std::shared_ptr<TriangleMesh> mesh = loadMesh("bunny.ply", Transform(), false, TriangleMesh::Watertight, 0, &info);
+        if(!mesh) ... // why has been printed
+        printf("%.0f MB/s\n", info.megabytesPerSecond());
+*/
+
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <stddef.h>
+
+#include <memory>
+
+#include "TriangleMesh.h"
+
+// what loadMesh() did, for reporting its throughput
+struct MeshLoadInfo
+{
+    size_t bytes = 0; // the size of the file
+    int threads = 0; // threads that parsed it
+    double parseSeconds = 0; // mapping and parsing the file, until the mesh's buffers are filled in
+    double buildSeconds = 0; // TriangleMesh::build(), the world space vertices and the tree
+
+    double megabytesPerSecond() const
+    {
+        return parseSeconds > 0 ? bytes / parseSeconds * 1e-6 : 0.0;
+    }
+};
+
+// reads the mesh at path (an .obj or .ply, by its extension) with threads threads (0 for one per hardware thread),
+// returns nullptr if it can't be read, after printing why
+std::shared_ptr<TriangleMesh> loadMesh(const char* path, const Transform& object_to_world,
+    bool reverseOrientation = false, TriangleMesh::Intersector intersector = TriangleMesh::Watertight,
+    int threads = 0, MeshLoadInfo* info = nullptr);
+
+#endif // MESH_LOADER_H
@@ -0,0 +1,873 @@
+/*
+    packet types: N floats, masks and Vectors/Points side by side, for tracing several rays at once
+
+        Floatx<N>   N float lanes
+        Maskx<N>    N bool lanes, the result of comparing two Floatx<N>s
+        Vec3x<N>    N Vectors or Points in structure of arrays form, a Floatx<N> each for x, y and z
+
+    Vec3x4 / Vec3x8 / Vec3x16 (and Floatx4, Maskx4, ...) name the usual widths, and FloatPacket / MaskPacket /
+    Vec3Packet the widest one the target has registers for (PACKET_WIDTH lanes)
+
+    the instruction set is picked at compile time from the compiler's target flags (see RT_ARCH in CMakeLists.txt):
+        SSE2 (every x86-64 cpu):    Floatx<4> is one __m128
+        AVX2 (-mavx2):              Floatx<8> is one __m256
+        AVX-512 (-mavx512f):        Floatx<16> is one __m512 and its mask a __mmask16
+    every other width (and every width with RT_NO_SIMD) is a plain float array worked on lane by lane, so
+    Floatx<1> behaves exactly like a float, which is how the tests check every width against the scalar types
+
+    all the arithmetic is free functions (operators, min, max, abs, sqrt, fma, select, hmin, hmax, hsum) so
+    the generic templates below apply to any width and the per instruction set overloads replace them where
+    they exist. comparisons are ordered (false when either lane is NaN) except !=, and min/max return their
+    second argument for a NaN lane, like minps/maxps and Vector's min/max
+*/
+
+#ifndef PACKET_H
+#define PACKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+#include <cassert>
+
+#include "Point.h"
+#include "SoA.h"
+
+#if !defined(RT_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64)
+#define RT_PACKET_SSE 1
+#endif
+#if defined(__AVX2__)
+#define RT_PACKET_AVX2 1
+#endif
+#if defined(__AVX512F__)
+#define RT_PACKET_AVX512 1
+#endif
+#endif
+
+#if defined(RT_PACKET_SSE) || defined(RT_PACKET_AVX2) || defined(RT_PACKET_AVX512)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h> // _BitScanForward, __popcnt
+#endif
+
+// lanes in the widest packet the target has registers for
+#if defined(RT_PACKET_AVX512)
+constexpr int PACKET_WIDTH = 16;
+#elif defined(RT_PACKET_AVX2)
+constexpr int PACKET_WIDTH = 8;
+#else
+constexpr int PACKET_WIDTH = 4;
+#endif
+
+/* GENERIC PACKETS */
+template<int N>
+class Maskx
+{
+    static_assert(N >= 1 && N <= 32 && (N & (N - 1)) == 0, "packets have a power of two lanes, at most 32");
+
+public:
+    /* PUBLIC MEMBERS */
+    uint32_t b; // lane i is bit i
+
+    /* CONSTRUCTORS */
+    Maskx() :
+        b(0)
+    {}
+    explicit Maskx(bool all) :
+        b(all ? ALL : 0)
+    {}
+
+    static Maskx fromBits(uint32_t bits)
+    {
+        Maskx m;
+        m.b = bits & ALL;
+        return m;
+    }
+
+    /* PUBLIC METHODS */
+    inline uint32_t bits() const
+    {
+        return b;
+    }
+    inline bool operator[](const int i) const
+    {
+        assert(i >= 0 && i < N);
+        return (b >> i) & 1;
+    }
+
+    static constexpr uint32_t ALL = N == 32 ? 0xffffffffu : (1u << N) - 1;
+};
+
+template<int N>
+class alignas(N * sizeof(float)) Floatx
+{
+    static_assert(N >= 1 && N <= 32 && (N & (N - 1)) == 0, "packets have a power of two lanes, at most 32");
+
+public:
+    /* PUBLIC MEMBERS */
+    float f[N];
+
+    /* CONSTRUCTORS */
+    Floatx() :
+        Floatx(0.0f)
+    {}
+    Floatx(float v)
+    {
+        for(int i = 0; i < N; i++) f[i] = v;
+    }
+
+    // p must be aligned to the packet's size, loadu()/storeu() don't need it to be
+    static Floatx load(const float* p)
+    {
+        Floatx r;
+        for(int i = 0; i < N; i++) r.f[i] = p[i];
+        return r;
+    }
+    static Floatx loadu(const float* p)
+    {
+        return load(p);
+    }
+
+    /* PUBLIC METHODS */
+    inline void store(float* p) const
+    {
+        for(int i = 0; i < N; i++) p[i] = f[i];
+    }
+    inline void storeu(float* p) const
+    {
+        store(p);
+    }
+
+    inline float operator[](const int i) const
+    {
+        assert(i >= 0 && i < N);
+        return f[i];
+    }
+    inline float& operator[](const int i)
+    {
+        assert(i >= 0 && i < N);
+        return f[i];
+    }
+};
+
+/* GENERIC MASK OPERATIONS */
+template<int N> inline Maskx<N> operator&(const Maskx<N>& a, const Maskx<N>& b) { return Maskx<N>::fromBits(a.b & b.b); }
+template<int N> inline Maskx<N> operator|(const Maskx<N>& a, const Maskx<N>& b) { return Maskx<N>::fromBits(a.b | b.b); }
+template<int N> inline Maskx<N> operator^(const Maskx<N>& a, const Maskx<N>& b) { return Maskx<N>::fromBits(a.b ^ b.b); }
+template<int N> inline Maskx<N> operator~(const Maskx<N>& a)                     { return Maskx<N>::fromBits(~a.b); }
+
+/* GENERIC FLOAT OPERATIONS */
+// applies op to every lane
+template<int N, typename Op>
+inline Floatx<N> lanewise(const Floatx<N>& a, const Floatx<N>& b, Op op)
+{
+    Floatx<N> r;
+    for(int i = 0; i < N; i++) r.f[i] = op(a.f[i], b.f[i]);
+    return r;
+}
+
+template<int N, typename Op>
+inline Maskx<N> lanewiseCompare(const Floatx<N>& a, const Floatx<N>& b, Op op)
+{
+    uint32_t bits = 0;
+    for(int i = 0; i < N; i++) bits |= (uint32_t)op(a.f[i], b.f[i]) << i;
+    return Maskx<N>::fromBits(bits);
+}
+
+template<int N> inline Floatx<N> operator+(const Floatx<N>& a, const Floatx<N>& b) { return lanewise(a, b, [](float x, float y) { return x + y; }); }
+template<int N> inline Floatx<N> operator-(const Floatx<N>& a, const Floatx<N>& b) { return lanewise(a, b, [](float x, float y) { return x - y; }); }
+template<int N> inline Floatx<N> operator*(const Floatx<N>& a, const Floatx<N>& b) { return lanewise(a, b, [](float x, float y) { return x * y; }); }
+template<int N> inline Floatx<N> operator/(const Floatx<N>& a, const Floatx<N>& b) { return lanewise(a, b, [](float x, float y) { return x / y; }); }
+template<int N> inline Floatx<N> min(const Floatx<N>& a, const Floatx<N>& b)       { return lanewise(a, b, [](float x, float y) { return x < y ? x : y; }); }
+template<int N> inline Floatx<N> max(const Floatx<N>& a, const Floatx<N>& b)       { return lanewise(a, b, [](float x, float y) { return x > y ? x : y; }); }
+
+template<int N> inline Maskx<N> operator<(const Floatx<N>& a, const Floatx<N>& b)  { return lanewiseCompare(a, b, [](float x, float y) { return x < y; }); }
+template<int N> inline Maskx<N> operator<=(const Floatx<N>& a, const Floatx<N>& b) { return lanewiseCompare(a, b, [](float x, float y) { return x <= y; }); }
+template<int N> inline Maskx<N> operator>(const Floatx<N>& a, const Floatx<N>& b)  { return lanewiseCompare(a, b, [](float x, float y) { return x > y; }); }
+template<int N> inline Maskx<N> operator>=(const Floatx<N>& a, const Floatx<N>& b) { return lanewiseCompare(a, b, [](float x, float y) { return x >= y; }); }
+template<int N> inline Maskx<N> operator==(const Floatx<N>& a, const Floatx<N>& b) { return lanewiseCompare(a, b, [](float x, float y) { return x == y; }); }
+template<int N> inline Maskx<N> operator!=(const Floatx<N>& a, const Floatx<N>& b) { return lanewiseCompare(a, b, [](float x, float y) { return x != y; }); }
+
+template<int N>
+inline Floatx<N> operator-(const Floatx<N>& a)
+{
+    Floatx<N> r;
+    for(int i = 0; i < N; i++) r.f[i] = -a.f[i];
+    return r;
+}
+
+template<int N>
+inline Floatx<N> abs(const Floatx<N>& a)
+{
+    Floatx<N> r;
+    for(int i = 0; i < N; i++) r.f[i] = fabsf(a.f[i]);
+    return r;
+}
+
+template<int N>
+inline Floatx<N> sqrt(const Floatx<N>& a)
+{
+    Floatx<N> r;
+    for(int i = 0; i < N; i++) r.f[i] = sqrtf(a.f[i]);
+    return r;
+}
+
+// a * b + c, a single rounding only where the target has FMA
+template<int N>
+inline Floatx<N> fma(const Floatx<N>& a, const Floatx<N>& b, const Floatx<N>& c)
+{
+    return a * b + c;
+}
+
+// a in the lanes where m is set, b in the rest
+template<int N>
+inline Floatx<N> select(const Maskx<N>& m, const Floatx<N>& a, const Floatx<N>& b)
+{
+    Floatx<N> r;
+    for(int i = 0; i < N; i++) r.f[i] = (m.b >> i) & 1 ? a.f[i] : b.f[i];
+    return r;
+}
+
+// horizontal, the order the lanes are combined in is up to the instruction set
+template<int N>
+inline float hmin(const Floatx<N>& a)
+{
+    float r = a.f[0];
+    for(int i = 1; i < N; i++) r = a.f[i] < r ? a.f[i] : r;
+    return r;
+}
+
+template<int N>
+inline float hmax(const Floatx<N>& a)
+{
+    float r = a.f[0];
+    for(int i = 1; i < N; i++) r = a.f[i] > r ? a.f[i] : r;
+    return r;
+}
+
+template<int N>
+inline float hsum(const Floatx<N>& a)
+{
+    float r = a.f[0];
+    for(int i = 1; i < N; i++) r += a.f[i];
+    return r;
+}
+
+/* SSE: 4 LANES */
+#ifdef RT_PACKET_SSE
+template<>
+class Maskx<4>
+{
+public:
+    /* PUBLIC MEMBERS */
+    __m128 r; // every bit of a set lane is set
+
+    /* CONSTRUCTORS */
+    Maskx() :
+        r( _mm_setzero_ps() )
+    {}
+    explicit Maskx(bool all) :
+        r( _mm_castsi128_ps(_mm_set1_epi32(all ? -1 : 0)) )
+    {}
+    explicit Maskx(__m128 r) :
+        r(r)
+    {}
+
+    static Maskx fromBits(uint32_t bits)
+    {
+        const __m128i lane = _mm_setr_epi32(1, 2, 4, 8);
+        __m128i b = _mm_and_si128(_mm_set1_epi32((int)bits), lane);
+        return Maskx( _mm_castsi128_ps(_mm_cmpeq_epi32(b, lane)) );
+    }
+
+    /* PUBLIC METHODS */
+    inline uint32_t bits() const
+    {
+        return (uint32_t)_mm_movemask_ps(r);
+    }
+    inline bool operator[](const int i) const
+    {
+        assert(i >= 0 && i < 4);
+        return (bits() >> i) & 1;
+    }
+
+    static constexpr uint32_t ALL = 0xf;
+};
+
+template<>
+class alignas(16) Floatx<4>
+{
+public:
+    /* PUBLIC MEMBERS */
+    union
+    {
+        __m128 r;
+        float f[4];
+    };
+
+    /* CONSTRUCTORS */
+    Floatx() :
+        r( _mm_setzero_ps() )
+    {}
+    Floatx(float v) :
+        r( _mm_set1_ps(v) )
+    {}
+    Floatx(__m128 r) :
+        r(r)
+    {}
+
+    static Floatx load(const float* p)  { return Floatx( _mm_load_ps(p) ); }
+    static Floatx loadu(const float* p) { return Floatx( _mm_loadu_ps(p) ); }
+
+    /* PUBLIC METHODS */
+    inline void store(float* p) const  { _mm_store_ps(p, r); }
+    inline void storeu(float* p) const { _mm_storeu_ps(p, r); }
+
+    inline float operator[](const int i) const
+    {
+        assert(i >= 0 && i < 4);
+        return f[i];
+    }
+    inline float& operator[](const int i)
+    {
+        assert(i >= 0 && i < 4);
+        return f[i];
+    }
+};
+
+inline Maskx<4> operator&(const Maskx<4>& a, const Maskx<4>& b) { return Maskx<4>( _mm_and_ps(a.r, b.r) ); }
+inline Maskx<4> operator|(const Maskx<4>& a, const Maskx<4>& b) { return Maskx<4>( _mm_or_ps(a.r, b.r) ); }
+inline Maskx<4> operator^(const Maskx<4>& a, const Maskx<4>& b) { return Maskx<4>( _mm_xor_ps(a.r, b.r) ); }
+inline Maskx<4> operator~(const Maskx<4>& a)                    { return a ^ Maskx<4>(true); }
+
+inline Floatx<4> operator+(const Floatx<4>& a, const Floatx<4>& b) { return _mm_add_ps(a.r, b.r); }
+inline Floatx<4> operator-(const Floatx<4>& a, const Floatx<4>& b) { return _mm_sub_ps(a.r, b.r); }
+inline Floatx<4> operator*(const Floatx<4>& a, const Floatx<4>& b) { return _mm_mul_ps(a.r, b.r); }
+inline Floatx<4> operator/(const Floatx<4>& a, const Floatx<4>& b) { return _mm_div_ps(a.r, b.r); }
+inline Floatx<4> min(const Floatx<4>& a, const Floatx<4>& b)       { return _mm_min_ps(a.r, b.r); }
+inline Floatx<4> max(const Floatx<4>& a, const Floatx<4>& b)       { return _mm_max_ps(a.r, b.r); }
+
+inline Maskx<4> operator<(const Floatx<4>& a, const Floatx<4>& b)  { return Maskx<4>( _mm_cmplt_ps(a.r, b.r) ); }
+inline Maskx<4> operator<=(const Floatx<4>& a, const Floatx<4>& b) { return Maskx<4>( _mm_cmple_ps(a.r, b.r) ); }
+inline Maskx<4> operator>(const Floatx<4>& a, const Floatx<4>& b)  { return Maskx<4>( _mm_cmpgt_ps(a.r, b.r) ); }
+inline Maskx<4> operator>=(const Floatx<4>& a, const Floatx<4>& b) { return Maskx<4>( _mm_cmpge_ps(a.r, b.r) ); }
+inline Maskx<4> operator==(const Floatx<4>& a, const Floatx<4>& b) { return Maskx<4>( _mm_cmpeq_ps(a.r, b.r) ); }
+inline Maskx<4> operator!=(const Floatx<4>& a, const Floatx<4>& b) { return Maskx<4>( _mm_cmpneq_ps(a.r, b.r) ); }
+
+inline Floatx<4> operator-(const Floatx<4>& a) { return _mm_xor_ps(a.r, _mm_set1_ps(-0.0f)); }
+inline Floatx<4> abs(const Floatx<4>& a)       { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.r); }
+inline Floatx<4> sqrt(const Floatx<4>& a)      { return _mm_sqrt_ps(a.r); }
+
+inline Floatx<4> fma(const Floatx<4>& a, const Floatx<4>& b, const Floatx<4>& c)
+{
+#ifdef __FMA__
+    return _mm_fmadd_ps(a.r, b.r, c.r);
+#else
+    return _mm_add_ps(_mm_mul_ps(a.r, b.r), c.r);
+#endif
+}
+
+inline Floatx<4> select(const Maskx<4>& m, const Floatx<4>& a, const Floatx<4>& b)
+{
+#ifdef __SSE4_1__
+    return _mm_blendv_ps(b.r, a.r, m.r);
+#else
+    return _mm_or_ps(_mm_and_ps(m.r, a.r), _mm_andnot_ps(m.r, b.r));
+#endif
+}
+
+inline float hmin(const Floatx<4>& a)
+{
+    __m128 r = _mm_min_ps(a.r, _mm_shuffle_ps(a.r, a.r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_min_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+}
+
+inline float hmax(const Floatx<4>& a)
+{
+    __m128 r = _mm_max_ps(a.r, _mm_shuffle_ps(a.r, a.r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_max_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+}
+
+inline float hsum(const Floatx<4>& a)
+{
+    __m128 r = _mm_add_ps(a.r, _mm_shuffle_ps(a.r, a.r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_add_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+}
+#endif // RT_PACKET_SSE
+
+/* AVX2: 8 LANES */
+#ifdef RT_PACKET_AVX2
+template<>
+class Maskx<8>
+{
+public:
+    /* PUBLIC MEMBERS */
+    __m256 r; // every bit of a set lane is set
+
+    /* CONSTRUCTORS */
+    Maskx() :
+        r( _mm256_setzero_ps() )
+    {}
+    explicit Maskx(bool all) :
+        r( _mm256_castsi256_ps(_mm256_set1_epi32(all ? -1 : 0)) )
+    {}
+    explicit Maskx(__m256 r) :
+        r(r)
+    {}
+
+    static Maskx fromBits(uint32_t bits)
+    {
+        const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        __m256i b = _mm256_and_si256(_mm256_set1_epi32((int)bits), lane);
+        return Maskx( _mm256_castsi256_ps(_mm256_cmpeq_epi32(b, lane)) );
+    }
+
+    /* PUBLIC METHODS */
+    inline uint32_t bits() const
+    {
+        return (uint32_t)_mm256_movemask_ps(r);
+    }
+    inline bool operator[](const int i) const
+    {
+        assert(i >= 0 && i < 8);
+        return (bits() >> i) & 1;
+    }
+
+    static constexpr uint32_t ALL = 0xff;
+};
+
+template<>
+class alignas(32) Floatx<8>
+{
+public:
+    /* PUBLIC MEMBERS */
+    union
+    {
+        __m256 r;
+        float f[8];
+    };
+
+    /* CONSTRUCTORS */
+    Floatx() :
+        r( _mm256_setzero_ps() )
+    {}
+    Floatx(float v) :
+        r( _mm256_set1_ps(v) )
+    {}
+    Floatx(__m256 r) :
+        r(r)
+    {}
+
+    static Floatx load(const float* p)  { return Floatx( _mm256_load_ps(p) ); }
+    static Floatx loadu(const float* p) { return Floatx( _mm256_loadu_ps(p) ); }
+
+    /* PUBLIC METHODS */
+    inline void store(float* p) const  { _mm256_store_ps(p, r); }
+    inline void storeu(float* p) const { _mm256_storeu_ps(p, r); }
+
+    inline float operator[](const int i) const
+    {
+        assert(i >= 0 && i < 8);
+        return f[i];
+    }
+    inline float& operator[](const int i)
+    {
+        assert(i >= 0 && i < 8);
+        return f[i];
+    }
+};
+
+inline Maskx<8> operator&(const Maskx<8>& a, const Maskx<8>& b) { return Maskx<8>( _mm256_and_ps(a.r, b.r) ); }
+inline Maskx<8> operator|(const Maskx<8>& a, const Maskx<8>& b) { return Maskx<8>( _mm256_or_ps(a.r, b.r) ); }
+inline Maskx<8> operator^(const Maskx<8>& a, const Maskx<8>& b) { return Maskx<8>( _mm256_xor_ps(a.r, b.r) ); }
+inline Maskx<8> operator~(const Maskx<8>& a)                    { return a ^ Maskx<8>(true); }
+
+inline Floatx<8> operator+(const Floatx<8>& a, const Floatx<8>& b) { return _mm256_add_ps(a.r, b.r); }
+inline Floatx<8> operator-(const Floatx<8>& a, const Floatx<8>& b) { return _mm256_sub_ps(a.r, b.r); }
+inline Floatx<8> operator*(const Floatx<8>& a, const Floatx<8>& b) { return _mm256_mul_ps(a.r, b.r); }
+inline Floatx<8> operator/(const Floatx<8>& a, const Floatx<8>& b) { return _mm256_div_ps(a.r, b.r); }
+inline Floatx<8> min(const Floatx<8>& a, const Floatx<8>& b)       { return _mm256_min_ps(a.r, b.r); }
+inline Floatx<8> max(const Floatx<8>& a, const Floatx<8>& b)       { return _mm256_max_ps(a.r, b.r); }
+
+inline Maskx<8> operator<(const Floatx<8>& a, const Floatx<8>& b)  { return Maskx<8>( _mm256_cmp_ps(a.r, b.r, _CMP_LT_OQ) ); }
+inline Maskx<8> operator<=(const Floatx<8>& a, const Floatx<8>& b) { return Maskx<8>( _mm256_cmp_ps(a.r, b.r, _CMP_LE_OQ) ); }
+inline Maskx<8> operator>(const Floatx<8>& a, const Floatx<8>& b)  { return Maskx<8>( _mm256_cmp_ps(a.r, b.r, _CMP_GT_OQ) ); }
+inline Maskx<8> operator>=(const Floatx<8>& a, const Floatx<8>& b) { return Maskx<8>( _mm256_cmp_ps(a.r, b.r, _CMP_GE_OQ) ); }
+inline Maskx<8> operator==(const Floatx<8>& a, const Floatx<8>& b) { return Maskx<8>( _mm256_cmp_ps(a.r, b.r, _CMP_EQ_OQ) ); }
+inline Maskx<8> operator!=(const Floatx<8>& a, const Floatx<8>& b) { return Maskx<8>( _mm256_cmp_ps(a.r, b.r, _CMP_NEQ_UQ) ); }
+
+inline Floatx<8> operator-(const Floatx<8>& a) { return _mm256_xor_ps(a.r, _mm256_set1_ps(-0.0f)); }
+inline Floatx<8> abs(const Floatx<8>& a)       { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.r); }
+inline Floatx<8> sqrt(const Floatx<8>& a)      { return _mm256_sqrt_ps(a.r); }
+
+inline Floatx<8> fma(const Floatx<8>& a, const Floatx<8>& b, const Floatx<8>& c)
+{
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a.r, b.r, c.r);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a.r, b.r), c.r);
+#endif
+}
+
+inline Floatx<8> select(const Maskx<8>& m, const Floatx<8>& a, const Floatx<8>& b)
+{
+    return _mm256_blendv_ps(b.r, a.r, m.r);
+}
+
+// the two halves are combined first, then it's the SSE reduction
+inline float hmin(const Floatx<8>& a)
+{
+    __m128 r = _mm_min_ps(_mm256_castps256_ps128(a.r), _mm256_extractf128_ps(a.r, 1));
+    r = _mm_min_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_min_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+}
+
+inline float hmax(const Floatx<8>& a)
+{
+    __m128 r = _mm_max_ps(_mm256_castps256_ps128(a.r), _mm256_extractf128_ps(a.r, 1));
+    r = _mm_max_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_max_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+}
+
+inline float hsum(const Floatx<8>& a)
+{
+    __m128 r = _mm_add_ps(_mm256_castps256_ps128(a.r), _mm256_extractf128_ps(a.r, 1));
+    r = _mm_add_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_add_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+}
+#endif // RT_PACKET_AVX2
+
+/* AVX-512: 16 LANES */
+// the mask stays the generic bitmask, which is what AVX-512's mask registers hold anyway
+#ifdef RT_PACKET_AVX512
+template<>
+class alignas(64) Floatx<16>
+{
+public:
+    /* PUBLIC MEMBERS */
+    union
+    {
+        __m512 r;
+        float f[16];
+    };
+
+    /* CONSTRUCTORS */
+    Floatx() :
+        r( _mm512_setzero_ps() )
+    {}
+    Floatx(float v) :
+        r( _mm512_set1_ps(v) )
+    {}
+    Floatx(__m512 r) :
+        r(r)
+    {}
+
+    static Floatx load(const float* p)  { return Floatx( _mm512_load_ps(p) ); }
+    static Floatx loadu(const float* p) { return Floatx( _mm512_loadu_ps(p) ); }
+
+    /* PUBLIC METHODS */
+    inline void store(float* p) const  { _mm512_store_ps(p, r); }
+    inline void storeu(float* p) const { _mm512_storeu_ps(p, r); }
+
+    inline float operator[](const int i) const
+    {
+        assert(i >= 0 && i < 16);
+        return f[i];
+    }
+    inline float& operator[](const int i)
+    {
+        assert(i >= 0 && i < 16);
+        return f[i];
+    }
+};
+
+inline Floatx<16> operator+(const Floatx<16>& a, const Floatx<16>& b) { return _mm512_add_ps(a.r, b.r); }
+inline Floatx<16> operator-(const Floatx<16>& a, const Floatx<16>& b) { return _mm512_sub_ps(a.r, b.r); }
+inline Floatx<16> operator*(const Floatx<16>& a, const Floatx<16>& b) { return _mm512_mul_ps(a.r, b.r); }
+inline Floatx<16> operator/(const Floatx<16>& a, const Floatx<16>& b) { return _mm512_div_ps(a.r, b.r); }
+inline Floatx<16> min(const Floatx<16>& a, const Floatx<16>& b)       { return _mm512_min_ps(a.r, b.r); }
+inline Floatx<16> max(const Floatx<16>& a, const Floatx<16>& b)       { return _mm512_max_ps(a.r, b.r); }
+
+inline Maskx<16> operator<(const Floatx<16>& a, const Floatx<16>& b)  { return Maskx<16>::fromBits( _mm512_cmp_ps_mask(a.r, b.r, _CMP_LT_OQ) ); }
+inline Maskx<16> operator<=(const Floatx<16>& a, const Floatx<16>& b) { return Maskx<16>::fromBits( _mm512_cmp_ps_mask(a.r, b.r, _CMP_LE_OQ) ); }
+inline Maskx<16> operator>(const Floatx<16>& a, const Floatx<16>& b)  { return Maskx<16>::fromBits( _mm512_cmp_ps_mask(a.r, b.r, _CMP_GT_OQ) ); }
+inline Maskx<16> operator>=(const Floatx<16>& a, const Floatx<16>& b) { return Maskx<16>::fromBits( _mm512_cmp_ps_mask(a.r, b.r, _CMP_GE_OQ) ); }
+inline Maskx<16> operator==(const Floatx<16>& a, const Floatx<16>& b) { return Maskx<16>::fromBits( _mm512_cmp_ps_mask(a.r, b.r, _CMP_EQ_OQ) ); }
+inline Maskx<16> operator!=(const Floatx<16>& a, const Floatx<16>& b) { return Maskx<16>::fromBits( _mm512_cmp_ps_mask(a.r, b.r, _CMP_NEQ_UQ) ); }
+
+inline Floatx<16> operator-(const Floatx<16>& a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a.r), _mm512_set1_epi32(INT32_MIN))); }
+inline Floatx<16> abs(const Floatx<16>& a)       { return _mm512_abs_ps(a.r); }
+inline Floatx<16> sqrt(const Floatx<16>& a)      { return _mm512_sqrt_ps(a.r); }
+
+inline Floatx<16> fma(const Floatx<16>& a, const Floatx<16>& b, const Floatx<16>& c)
+{
+    return _mm512_fmadd_ps(a.r, b.r, c.r);
+}
+
+inline Floatx<16> select(const Maskx<16>& m, const Floatx<16>& a, const Floatx<16>& b)
+{
+    return _mm512_mask_blend_ps((__mmask16)m.b, b.r, a.r);
+}
+
+inline float hmin(const Floatx<16>& a) { return _mm512_reduce_min_ps(a.r); }
+inline float hmax(const Floatx<16>& a) { return _mm512_reduce_max_ps(a.r); }
+inline float hsum(const Floatx<16>& a) { return _mm512_reduce_add_ps(a.r); }
+#endif // RT_PACKET_AVX512
+
+/* FLOAT CONVENIENCE */
+// a float operand is broadcast to every lane
+template<int N> inline Floatx<N> operator+(const Floatx<N>& a, float b) { return a + Floatx<N>(b); }
+template<int N> inline Floatx<N> operator-(const Floatx<N>& a, float b) { return a - Floatx<N>(b); }
+template<int N> inline Floatx<N> operator*(const Floatx<N>& a, float b) { return a * Floatx<N>(b); }
+template<int N> inline Floatx<N> operator/(const Floatx<N>& a, float b) { return a / Floatx<N>(b); }
+template<int N> inline Floatx<N> operator*(float a, const Floatx<N>& b) { return Floatx<N>(a) * b; }
+
+template<int N> inline Floatx<N>& operator+=(Floatx<N>& a, const Floatx<N>& b) { return a = a + b; }
+template<int N> inline Floatx<N>& operator-=(Floatx<N>& a, const Floatx<N>& b) { return a = a - b; }
+template<int N> inline Floatx<N>& operator*=(Floatx<N>& a, const Floatx<N>& b) { return a = a * b; }
+template<int N> inline Floatx<N>& operator/=(Floatx<N>& a, const Floatx<N>& b) { return a = a / b; }
+
+template<int N> inline Maskx<N>& operator&=(Maskx<N>& a, const Maskx<N>& b) { return a = a & b; }
+template<int N> inline Maskx<N>& operator|=(Maskx<N>& a, const Maskx<N>& b) { return a = a | b; }
+
+template<int N> inline bool any(const Maskx<N>& m)  { return m.bits() != 0; }
+template<int N> inline bool all(const Maskx<N>& m)  { return m.bits() == Maskx<N>::ALL; }
+template<int N> inline bool none(const Maskx<N>& m) { return m.bits() == 0; }
+
+// index of the lowest set lane of a non-zero bits(), for walking the active lanes:
+//     for(uint32_t lanes = m.bits(); lanes; lanes &= lanes - 1) { int i = lowestLane(lanes); ... }
+inline int lowestLane(uint32_t bits)
+{
+    assert(bits != 0);
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward(&i, bits);
+    return (int)i;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+// number of set lanes in bits()
+inline int laneCount(uint32_t bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (int)__popcnt(bits);
+#else
+    return __builtin_popcount(bits);
+#endif
+}
+
+/* VEC3 PACKETS */
+template<int N>
+class Vec3x
+{
+public:
+    /* PUBLIC MEMBERS */
+    Floatx<N> x, y, z;
+
+    /* CONSTRUCTORS */
+    Vec3x() {}
+    Vec3x(const Floatx<N>& x, const Floatx<N>& y, const Floatx<N>& z) :
+        x(x),
+        y(y),
+        z(z)
+    {}
+    // v or p in every lane
+    explicit Vec3x(const Vector& v) :
+        x(v.x),
+        y(v.y),
+        z(v.z)
+    {}
+    explicit Vec3x(const Point& p) :
+        x(p.x),
+        y(p.y),
+        z(p.z)
+    {}
+
+    // N consecutive Vectors (array of structures to structure of arrays)
+    static Vec3x load(const Vector* v)
+    {
+        Vec3x r;
+        for(int i = 0; i < N; i++) r.set(i, v[i]);
+        return r;
+    }
+    static Vec3x load(const Point* p)
+    {
+        Vec3x r;
+        for(int i = 0; i < N; i++) r.set(i, p[i]);
+        return r;
+    }
+    // elements i to i + N - 1 of soa, which is already in this layout so it's three plain loads
+    static Vec3x load(const SoA3& soa, size_t i)
+    {
+        return Vec3x( Floatx<N>::loadu(soa.x + i), Floatx<N>::loadu(soa.y + i), Floatx<N>::loadu(soa.z + i) );
+    }
+
+    /* PUBLIC METHODS */
+    inline void store(Vector* v) const
+    {
+        for(int i = 0; i < N; i++) v[i] = vector(i);
+    }
+    inline void store(Point* p) const
+    {
+        for(int i = 0; i < N; i++) p[i] = point(i);
+    }
+    inline void store(const SoA3& soa, size_t i) const
+    {
+        x.storeu(soa.x + i);
+        y.storeu(soa.y + i);
+        z.storeu(soa.z + i);
+    }
+
+    // a single lane
+    inline Vector vector(const int i) const
+    {
+        return Vector(x[i], y[i], z[i]);
+    }
+    inline Point point(const int i) const
+    {
+        return Point(x[i], y[i], z[i]);
+    }
+    inline void set(const int i, const Vector& v)
+    {
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+    inline void set(const int i, const Point& p)
+    {
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+    }
+
+    /* INLINE OPERATOR OVERLOADS */
+    inline Vec3x operator+(const Vec3x& v) const
+    {
+        return Vec3x(x + v.x, y + v.y, z + v.z);
+    }
+    inline Vec3x& operator+=(const Vec3x& v)
+    {
+        return *this = *this + v;
+    }
+
+    inline Vec3x operator-(const Vec3x& v) const
+    {
+        return Vec3x(x - v.x, y - v.y, z - v.z);
+    }
+    inline Vec3x& operator-=(const Vec3x& v)
+    {
+        return *this = *this - v;
+    }
+
+    // a different scale in every lane
+    inline Vec3x operator*(const Floatx<N>& f) const
+    {
+        return Vec3x(x * f, y * f, z * f);
+    }
+    inline Vec3x& operator*=(const Floatx<N>& f)
+    {
+        return *this = *this * f;
+    }
+
+    inline Vec3x operator/(const Floatx<N>& f) const
+    {
+        return Vec3x(x / f, y / f, z / f);
+    }
+    inline Vec3x& operator/=(const Floatx<N>& f)
+    {
+        return *this = *this / f;
+    }
+
+    inline Vec3x operator-() const
+    {
+        return Vec3x(-x, -y, -z);
+    }
+};
+
+/* GLOBAL INLINE FUNCTIONS (that use Vec3x) */
+// these match the scalar functions in Vector.h lane for lane, up to rounding
+template<int N>
+inline Floatx<N> dot(const Vec3x<N>& a, const Vec3x<N>& b)
+{
+    return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+template<int N>
+inline Vec3x<N> cross(const Vec3x<N>& a, const Vec3x<N>& b)
+{
+    return Vec3x<N>(
+        a.y*b.z - a.z*b.y,
+        a.z*b.x - a.x*b.z,
+        a.x*b.y - a.y*b.x
+    );
+}
+
+template<int N>
+inline Floatx<N> lengthSquared(const Vec3x<N>& v)
+{
+    return dot(v, v);
+}
+
+template<int N>
+inline Floatx<N> length(const Vec3x<N>& v)
+{
+    return sqrt( lengthSquared(v) );
+}
+
+template<int N>
+inline Vec3x<N> normalize(const Vec3x<N>& v)
+{
+    return v / length(v);
+}
+
+// a in the lanes where m is set, b in the rest
+template<int N>
+inline Vec3x<N> select(const Maskx<N>& m, const Vec3x<N>& a, const Vec3x<N>& b)
+{
+    return Vec3x<N>( select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z) );
+}
+
+template<int N>
+inline Vec3x<N> min(const Vec3x<N>& a, const Vec3x<N>& b)
+{
+    return Vec3x<N>( min(a.x, b.x), min(a.y, b.y), min(a.z, b.z) );
+}
+
+template<int N>
+inline Vec3x<N> max(const Vec3x<N>& a, const Vec3x<N>& b)
+{
+    return Vec3x<N>( max(a.x, b.x), max(a.y, b.y), max(a.z, b.z) );
+}
+
+template<int N>
+inline Vec3x<N> abs(const Vec3x<N>& v)
+{
+    return Vec3x<N>( abs(v.x), abs(v.y), abs(v.z) );
+}
+
+/* NAMED WIDTHS */
+using Floatx4 = Floatx<4>;
+using Floatx8 = Floatx<8>;
+using Floatx16 = Floatx<16>;
+using Maskx4 = Maskx<4>;
+using Maskx8 = Maskx<8>;
+using Maskx16 = Maskx<16>;
+using Vec3x4 = Vec3x<4>;
+using Vec3x8 = Vec3x<8>;
+using Vec3x16 = Vec3x<16>;
+
+using FloatPacket = Floatx<PACKET_WIDTH>;
+using MaskPacket = Maskx<PACKET_WIDTH>;
+using Vec3Packet = Vec3x<PACKET_WIDTH>;
+
+#endif // PACKET_H
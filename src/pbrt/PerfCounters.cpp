@@ -0,0 +1,224 @@
+#include <string.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "PerfCounters.h"
+
+namespace perf
+{
+    const char* counterName(Counter c)
+    {
+        switch(c)
+        {
+            case Cycles:       return "cycles";
+            case Instructions: return "instructions";
+            case L1DMisses:    return "L1D misses";
+            case LLCMisses:    return "LLC misses";
+            case BranchMisses: return "branch misses";
+            default:           return "?";
+        }
+    }
+
+    // function local statics, so they exist before any thread can report
+    static std::mutex& mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+    static std::map<std::string, std::map<int, Values>>& totals() // phase -> thread -> counts
+    {
+        static std::map<std::string, std::map<int, Values>> t;
+        return t;
+    }
+
+    // the calling thread's counter file descriptors, -1 for counters that couldn't be opened
+    // the counters that did open are one group, led by the first of them (cycles, unless it's missing), so
+    // the kernel schedules them onto the PMU together and a single read of the leader returns all of them
+    // over the same stretch of the thread's time
+    struct ThreadCounters
+    {
+        bool opened = false;
+        int fds[N_COUNTERS];
+        int leader = -1;
+        int error = 0; // errno of the first counter that failed
+
+        ~ThreadCounters()
+        {
+#ifdef __linux__
+            if(!opened) return;
+            for(int fd : fds)
+                if(fd >= 0) close(fd);
+#endif
+        }
+    };
+    static thread_local ThreadCounters current;
+
+#ifdef __linux__
+    static int openCounter(uint32_t type, uint64_t config, int group)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1; // allowed with perf_event_paranoid <= 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // pid 0, cpu -1: the calling thread, on whatever cpu it runs on
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+    }
+
+    static void open(ThreadCounters& c)
+    {
+        const uint64_t cacheReadMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const uint32_t types[N_COUNTERS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+        const uint64_t configs[N_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | cacheReadMiss,
+            PERF_COUNT_HW_CACHE_LL | cacheReadMiss,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for(int i = 0; i < N_COUNTERS; i++)
+        {
+            c.fds[i] = openCounter(types[i], configs[i], c.leader);
+            if(c.fds[i] < 0 && !c.error) c.error = errno;
+            if(c.fds[i] >= 0 && c.leader < 0) c.leader = c.fds[i];
+        }
+        c.opened = true;
+    }
+#endif
+
+    bool read(Values* out)
+    {
+        *out = Values();
+#ifdef __linux__
+        if(!current.opened) open(current);
+        if(current.leader < 0) return false;
+
+        // the number of counters, time enabled, time running, then a value per counter in the order they
+        // joined the group; all scaled up alike if the kernel had to multiplex the group
+        uint64_t data[3 + N_COUNTERS];
+        ssize_t bytes = ::read(current.leader, data, sizeof(data));
+        if(bytes < (ssize_t)(3 * sizeof(uint64_t)) || bytes != (ssize_t)((3 + data[0]) * sizeof(uint64_t))) return false;
+
+        const uint64_t enabled = data[1], running = data[2];
+        uint64_t n = 0;
+        for(int i = 0; i < N_COUNTERS && n < data[0]; i++)
+        {
+            if(current.fds[i] < 0) continue;
+
+            uint64_t value = data[3 + n++];
+            out->counts[i] = (running > 0 && running < enabled) ? (uint64_t)((double)value * enabled / running) : value;
+            out->valid[i] = true;
+        }
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool enable()
+    {
+        static bool warned = false;
+
+        Values probe;
+        if( !read(&probe) )
+        {
+            if(!warned)
+            {
+#ifdef __linux__
+                printf("[perf] hardware counters unavailable (%s), check /proc/sys/kernel/perf_event_paranoid\n",
+                    strerror(current.error ? current.error : ENOENT));
+#else
+                printf("[perf] hardware counters are only supported on linux\n");
+#endif
+                warned = true;
+            }
+            return false;
+        }
+
+        for(int i = 0; i < N_COUNTERS; i++)
+            if( !probe.valid[i] ) printf("[perf] %s counter unavailable, leaving it out\n", counterName((Counter)i));
+
+        counting.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    void disable()
+    {
+        counting.store(false, std::memory_order_relaxed);
+    }
+
+    void report(const char* phase, int thread, const Values& v)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        totals()[phase][thread] += v;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        totals().clear();
+    }
+
+    static void printRow(FILE* f, const char* label, const Values& v)
+    {
+        fprintf(f, "    %-8s", label);
+        for(int i = 0; i < N_COUNTERS; i++)
+        {
+            if(v.valid[i]) fprintf(f, " %15llu", (unsigned long long)v.counts[i]);
+            else           fprintf(f, " %15s", "-");
+
+            // IPC goes right after instructions
+            if(i == Instructions)
+            {
+                if(v.valid[Cycles] && v.valid[Instructions] && v.counts[Cycles] > 0)
+                    fprintf(f, " %6.2f", (double)v.counts[Instructions] / v.counts[Cycles]);
+                else
+                    fprintf(f, " %6s", "-");
+            }
+        }
+        fprintf(f, "\n");
+    }
+
+    void print(FILE* f)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        if(totals().empty()) return;
+
+        fprintf(f, "Hardware counters:\n");
+        for(const auto& phase : totals())
+        {
+            fprintf(f, "  %s\n    %-8s", phase.first.c_str(), "thread");
+            for(int i = 0; i < N_COUNTERS; i++)
+            {
+                fprintf(f, " %15s", counterName((Counter)i));
+                if(i == Instructions) fprintf(f, " %6s", "IPC");
+            }
+            fprintf(f, "\n");
+
+            Values total;
+            char label[16];
+            for(const auto& thread : phase.second)
+            {
+                snprintf(label, sizeof(label), "%d", thread.first);
+                printRow(f, label, thread.second);
+                total += thread.second;
+            }
+            if(phase.second.size() > 1) printRow(f, "total", total);
+        }
+    }
+} // perf
@@ -0,0 +1,109 @@
+/*
+    PerfCounters.h reads hardware performance counters (linux perf_event_open) around render phases
+
+    wall time says how long a phase took, the counters say why: cycles and instructions (IPC), L1 data
+    and last level cache read misses, and branch mispredictions
+
+    usage:
+        perf::enable();
+        {
+            perf::Scope scope("tiles", worker); // counts the calling thread between construction and destruction
+            ...
+        }
+        perf::print(stdout); // one table per phase, a row per thread plus the total
+        perf::clear();
+
+    every thread opens its own counters the first time it enters a Scope, and they only count that thread
+    a thread's counters are one perf group read all at once, so ratios like IPC are of the same instructions and cycles
+    if the counters can't be opened (not linux, a VM without a PMU, or /proc/sys/kernel/perf_event_paranoid
+    too strict) the reason is printed once and every Scope does nothing; counters that are missing
+    individually are left out of the report
+    when perf is not enabled a Scope costs a single relaxed atomic load
+*/
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+
+namespace perf
+{
+    enum Counter { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, N_COUNTERS };
+
+    const char* counterName(Counter c);
+
+    struct Values
+    {
+        uint64_t counts[N_COUNTERS] = {};
+        bool valid[N_COUNTERS] = {}; // false if the counter couldn't be opened
+
+        Values& operator+=(const Values& v)
+        {
+            for(int i = 0; i < N_COUNTERS; i++)
+            {
+                counts[i] += v.counts[i];
+                valid[i] = valid[i] || v.valid[i];
+            }
+            return *this;
+        }
+    };
+
+    inline std::atomic<bool> counting { false };
+
+    inline bool active()
+    {
+        return counting.load(std::memory_order_relaxed);
+    }
+
+    // turns counting on/off, returns false (and prints why, once) if no counter can be opened
+    bool enable();
+    void disable();
+
+    // reads the calling thread's counters (opening them on first use), false if there are none
+    bool read(Values* out);
+    // adds the counts of a finished phase on one thread to the totals
+    void report(const char* phase, int thread, const Values& v);
+
+    // prints the totals, one table per phase
+    void print(FILE* f);
+    void clear();
+
+    // counts the calling thread for the lifetime of the scope, and reports it under (phase, thread)
+    class Scope
+    {
+    private:
+        const char* phase;
+        int thread;
+        bool running;
+        Values begin;
+
+    public:
+        Scope(const char* phase, int thread = 0) :
+            phase(phase),
+            thread(thread),
+            running(false)
+        {
+            if( active() ) running = read(&begin);
+        }
+
+        ~Scope()
+        {
+            if(!running) return;
+
+            Values end;
+            if( !read(&end) ) return;
+            for(int i = 0; i < N_COUNTERS; i++)
+                end.counts[i] -= begin.counts[i];
+
+            report(phase, thread, end);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+} // perf
+
+#endif // PERF_COUNTERS_H
@@ -1,5 +1,7 @@
 /*
     Point is a class that represents a single point in 3D space (x, y, z)
+
+    like Vector, x, y, z are contiguous and indexed as an array from &x, so operator[] doesn't branch on the index
 */
 
 #ifndef POINT_H
@@ -14,23 +16,23 @@ public:
     float x, y, z;
     
     /* CONSTRUCTORS */
-    Point() :
+    constexpr Point() :
         x(0.0f),
         y(0.0f),
         z(0.0f)
     {}
-    Point(float x, float y, float z) :
+    constexpr Point(float x, float y, float z) :
         x(x),
         y(y),
         z(z)
     {}
     
     /* INLINE OPERATOR OVERLOADS */
-    inline Point operator+(const Vector& v) const
+    constexpr Point operator+(const Vector& v) const
     {
         return Point(x + v.x, y + v.y, z + v.z);
     }
-    inline Point& operator+=(const Vector& v)
+    constexpr Point& operator+=(const Vector& v)
     {
         x += v.x;
         y += v.y;
@@ -39,11 +41,11 @@ public:
         return *this;
     }
 
-    inline Point operator-(const Vector& v) const
+    constexpr Point operator-(const Vector& v) const
     {
         return Point(x - v.x, y - v.y, z - v.z);
     }
-    inline Point& operator-=(const Vector& v)
+    constexpr Point& operator-=(const Vector& v)
     {
         x -= v.x;
         y -= v.y;
@@ -51,23 +53,45 @@ public:
         
         return *this;
     }
-    inline Vector operator-(const Point& p) const
+    constexpr Vector operator-(const Point& p) const
     {
         return Vector(x - p.x, y - p.y, z - p.z);
     }
     
-    float operator[](const int i) const
+    inline float operator[](const int i) const
+    {
+        assert(i >= 0 && i < 3);
+        return (&x)[i];
+    }
+    inline float& operator[](const int i)
     {
-        if(i == 0) return x;
-        else if(i == 1) return y;
-        else if(i == 2) return z;
-        else
-        {
-            printf("Point has no member of index %i!\n", i);
-            
-            return NAN;
-        }
+        assert(i >= 0 && i < 3);
+        return (&x)[i];
     }
 };
 
+// operator[] indexes x, y, z as an array
+static_assert(offsetof(Point, y) == offsetof(Point, x) + sizeof(float) && offsetof(Point, z) == offsetof(Point, y) + sizeof(float) &&
+    sizeof(Point) == 3 * sizeof(float), "Point's components aren't contiguous");
+
+/* GLOBAL INLINE FUNCTIONS */
+// component-wise, see min()/max() for Vectors
+constexpr Point min(const Point& p1, const Point& p2)
+{
+    return Point(
+        p1.x < p2.x ? p1.x : p2.x,
+        p1.y < p2.y ? p1.y : p2.y,
+        p1.z < p2.z ? p1.z : p2.z
+    );
+}
+
+constexpr Point max(const Point& p1, const Point& p2)
+{
+    return Point(
+        p1.x > p2.x ? p1.x : p2.x,
+        p1.y > p2.y ? p1.y : p2.y,
+        p1.z > p2.z ? p1.z : p2.z
+    );
+}
+
 #endif // POINT_H
\ No newline at end of file
@@ -0,0 +1,47 @@
+/*
+    RayPacket holds N Rays side by side (structure of arrays), so N coherent rays (e.g. camera rays from
+    neighbouring pixels) can be traced together, see BVH::intersect(RayPacket&, ...)
+
+    the lanes of a packet that are actually in use are given by a Maskx<N> next to it, the rest can hold anything
+    t_max is mutable for the same reason as Ray's: intersecting a lane shortens it to the closest hit so far
+
+    packets come in the widths Packet.h has, 4, 8 and 16
+*/
+
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include "Packet.h"
+#include "Ray.h"
+
+template<int N>
+class RayPacket
+{
+public:
+    /* PUBLIC MEMBERS */
+    Vec3x<N> o, d;
+    mutable Floatx<N> t_min, t_max;
+
+    /* CONSTRUCTORS */
+    RayPacket() :
+        t_min(rt::RAY_EPSILON),
+        t_max(INFINITY)
+    {}
+
+    /* PUBLIC METHODS */
+    inline void set(const int i, const Ray& ray)
+    {
+        o.set(i, ray.o);
+        d.set(i, ray.d);
+        t_min[i] = ray.t_min;
+        t_max[i] = ray.t_max;
+    }
+
+    // lane i as a Ray
+    inline Ray ray(const int i) const
+    {
+        return Ray(o.point(i), d.vector(i), t_min[i], t_max[i]);
+    }
+};
+
+#endif // RAY_PACKET_H
@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "RayQueue.h"
+#include "Stats.h"
+
+STAT_COUNTER("Renderer/Ray queues sorted", nRayQueueSorts);
+
+/* PUBLIC METHODS */
+void RayQueue::sort(const Bbox& bounds)
+{
+    STAT_INC(nRayQueueSorts);
+
+    // grid cells per unit along each axis, 0 along an axis the bounds are flat (or empty) in
+    Vector extent = bounds.p_max - bounds.p_min;
+    Vector scale(
+        extent.x > 0.0f ? 1024.0f / extent.x : 0.0f,
+        extent.y > 0.0f ? 1024.0f / extent.y : 0.0f,
+        extent.z > 0.0f ? 1024.0f / extent.z : 0.0f
+    );
+    auto cell = [](float offset, float scale)
+    {
+        return scale > 0.0f ? (uint32_t)rt::clamp(offset * scale, 0.0f, 1023.0f) : 0u;
+    };
+
+    // octant (the top 3 bits), Morton code (the next 30) and slot (the low 31) in one key, so ties keep queue order
+    for(int i = 0; i < size; i++)
+    {
+        const Ray& ray = rays[i];
+        uint32_t octant = (ray.d.x < 0.0f) | (ray.d.y < 0.0f) << 1 | (ray.d.z < 0.0f) << 2;
+        uint32_t morton = rt::encodeMorton3(
+            cell(ray.o.x - bounds.p_min.x, scale.x),
+            cell(ray.o.y - bounds.p_min.y, scale.y),
+            cell(ray.o.z - bounds.p_min.z, scale.z)
+        );
+        keys[i] = (uint64_t)octant << 61 | (uint64_t)morton << 31 | (uint32_t)i;
+    }
+    std::sort(keys.begin(), keys.begin() + size);
+
+    for(int i = 0; i < size; i++)
+        order[i] = (int)(keys[i] & 0x7fffffff);
+}
+
+void RayQueue::extend(const Scene& scene, int packetSize)
+{
+    switch(packetSize)
+    {
+        case 4:  extendPackets<4>(scene); return;
+        case 8:  extendPackets<8>(scene); return;
+        case 16: extendPackets<16>(scene); return;
+        default: break;
+    }
+
+    for(int i = 0; i < size; i++)
+    {
+        int slot = order[i];
+        hits[slot] = Hit();
+        scene.intersect(rays[slot], &hits[slot]);
+    }
+}
+
+/* PRIVATE METHODS */
+template<int N>
+void RayQueue::extendPackets(const Scene& scene)
+{
+    for(int i = 0; i < size; i += N)
+    {
+        int n = std::min(N, size - i);
+        RayPacket<N> packet;
+        for(int lane = 0; lane < n; lane++)
+            packet.set(lane, rays[order[i + lane]]);
+
+        Hit laneHits[N];
+        Maskx<N> hit = scene.intersect( packet, Maskx<N>::fromBits((1u << n) - 1), laneHits );
+        for(int lane = 0; lane < n; lane++)
+        {
+            int slot = order[i + lane];
+            hits[slot] = hit[lane] ? laneHits[lane] : Hit();
+            rays[slot].t_max = packet.t_max[lane];
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/*
+    RayQueue is a batch of rays that flows through the wavefront renderer (Renderer::streamSize) one stage
+    at a time: generate fills it with camera rays, sort (optional) reorders them so rays that will walk the
+    same part of the BVH are traced together, extend finds what every ray hits, the hit and miss rays are
+    compacted into their own lists of indices so each shading kernel loops over just its rays, and accumulate
+    adds every ray's radiance to the film
+
+    every stage is a loop over the whole queue, so one stage's code and data stay in cache while it runs,
+    which is why capacity should keep a queue (about 90 bytes a ray) within the L2 cache
+
+    the per ray data is kept in parallel arrays, indexed by the ray's slot in the queue
+    sorting only changes the order extend visits the slots in, so every other stage still sees queue order
+*/
+
+#ifndef RAY_QUEUE_H
+#define RAY_QUEUE_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "Ray.h"
+#include "Sample.h"
+#include "Scene.h"
+
+class RayQueue
+{
+public:
+    /* PUBLIC MEMBERS */
+    static constexpr int DEFAULT_CAPACITY = 4096;
+
+    const int capacity; // an int, so any slot fits the low 31 bits sort() keeps it in
+    int size = 0;
+
+    // filled in by generate
+    std::vector<Ray> rays;
+    std::vector<float> image_x, image_y; // where on the film each ray's sample lies
+    std::vector<float> weights;
+
+    // the slots in the order extend traces them, queue order unless sort() changed it
+    std::vector<int> order;
+
+    // filled in by extend, the closest hit of every ray (hits[slot].shape is nullptr for a miss), for the shading
+    // kernels to get the DifferentialGeometry of
+    std::vector<Hit> hits;
+    // compacted from hits, the slots of the rays that hit the scene and that missed it, in queue order
+    std::vector<int> hitSlots, missSlots;
+
+    // filled in by the shading kernels
+    std::vector<Vector> L;
+
+    /* CONSTRUCTORS */
+    explicit RayQueue(int capacity = DEFAULT_CAPACITY) :
+        capacity(capacity),
+        rays(capacity),
+        image_x(capacity),
+        image_y(capacity),
+        weights(capacity),
+        order(capacity),
+        hits(capacity),
+        L(capacity),
+        keys(capacity)
+    {
+        hitSlots.reserve(capacity);
+        missSlots.reserve(capacity);
+    }
+
+    /* PUBLIC METHODS */
+    inline bool full() const
+    {
+        return size == capacity;
+    }
+
+    inline void clear()
+    {
+        size = 0;
+        hitSlots.clear();
+        missSlots.clear();
+    }
+
+    // the slot to generate the next ray into
+    inline int push(const Sample& sample)
+    {
+        int slot = size++;
+        image_x[slot] = sample.image_x;
+        image_y[slot] = sample.image_y;
+        order[slot] = slot;
+
+        return slot;
+    }
+
+    // reorders order by the rays' direction octant, then by the Morton code of their origin on a 1024^3 grid
+    // over bounds (origins outside it are clamped onto it), so rays starting close together and heading the
+    // same way are traced one after another and find the nodes they need still in cache
+    // rays with equal keys keep their queue order
+    void sort(const Bbox& bounds);
+
+    // finds the closest hit of every ray, in order, packetSize (4, 8 or 16) rays at a time or one at a time (1)
+    // each ray's t_max is shortened to its hit, and its Hit is the one Scene::intersect() finds for it
+    void extend(const Scene& scene, int packetSize);
+
+    // splits the queue into hitSlots and missSlots
+    inline void compact()
+    {
+        hitSlots.clear();
+        missSlots.clear();
+        for(int i = 0; i < size; i++)
+            (hits[i].shape ? hitSlots : missSlots).push_back(i);
+    }
+
+private:
+    /* PRIVATE MEMBERS */
+    std::vector<uint64_t> keys; // sort()'s scratch space
+
+    /* PRIVATE METHODS */
+    template<int N>
+    void extendPackets(const Scene& scene);
+};
+
+#endif // RAY_QUEUE_H
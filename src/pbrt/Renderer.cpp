@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "PerfCounters.h"
+#include "Renderer.h"
+#include "Trace.h"
+
+/* PUBLIC METHODS */
+int Renderer::tileCount() const
+{
+    int x_tiles = (film.xResolution + TILE_SIZE - 1) / TILE_SIZE;
+    int y_tiles = (film.yResolution + TILE_SIZE - 1) / TILE_SIZE;
+
+    return x_tiles * y_tiles;
+}
+
+uint64_t Renderer::render()
+{
+    TRACE_SCOPE("render", "render");
+
+    int n_tiles = tileCount();
+    int n_threads = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+    n_threads = std::max(1, std::min(n_threads, n_tiles));
+
+    std::atomic<int> nextTile { 0 };
+    std::atomic<uint64_t> rays { 0 };
+    auto worker = [&](int index)
+    {
+        uint64_t local = 0;
+        {
+            perf::Scope counters("tiles", index);
+            if(streamSize > 0 && !heatmap)
+                local = renderStream(nextTile, n_tiles);
+            else
+                for(int tile = nextTile++; tile < n_tiles; tile = nextTile++)
+                    local += renderTile(tile);
+        }
+        rays += local;
+
+        // merge this thread's statistics before it goes away
+        stats::reportThread();
+    };
+
+    std::vector<std::thread> pool;
+    for(int i = 1; i < n_threads; i++)
+        pool.emplace_back(worker, i);
+    worker(0); // the calling thread works too
+    for(std::thread& t : pool)
+        t.join();
+
+    return rays;
+}
+
+// this is the same shading rtiow has always done: purple if anything is hit, otherwise a sky gradient
+Vector Renderer::Li(const Ray& ray, TraversalCost* cost) const
+{
+    // shade() only needs to know whether anything is hit, so the traversal can stop at the first hit
+    return shade( ray, scene.intersectP(ray, cost) );
+}
+
+/* PRIVATE METHODS */
+Vector Renderer::shade(const Ray& ray, bool hit) const
+{
+    if(hit)
+        return Vector(0.9f, 0.2f, 0.9f); // purple
+
+    Vector dir = normalize(ray.d);
+    float tt = 0.5f * (dir.y + 1.0f);
+    Vector white(1.0f, 1.0f, 1.0f);
+    Vector blue(0.5f, 0.7f, 1.0f);
+
+    return white * (1.0f - tt) + blue * tt;
+}
+
+void Renderer::tileBounds(int tile, int* x0, int* x1, int* y0, int* y1) const
+{
+    int x_tiles = (film.xResolution + TILE_SIZE - 1) / TILE_SIZE;
+    *x0 = (tile % x_tiles) * TILE_SIZE;
+    *y0 = (tile / x_tiles) * TILE_SIZE;
+    *x1 = std::min(*x0 + TILE_SIZE, film.xResolution);
+    *y1 = std::min(*y0 + TILE_SIZE, film.yResolution);
+}
+
+uint64_t Renderer::renderTile(int tile)
+{
+    TRACE_SCOPE_ARG("render", "tile", tile);
+
+    int x0, x1, y0, y1;
+    tileBounds(tile, &x0, &x1, &y0, &y1);
+
+    rt::seedRNG( seed ^ (uint32_t)(tile * 2654435761u) );
+    StratifiedSampler sampler(x0, x1, y0, y1, x_pixelSamples, y_pixelSamples, jitter);
+
+    uint64_t rays = 0;
+    Sample sample;
+    Ray ray;
+    if(heatmap)
+    {
+        // same loop, but every sample is timed and its traversal work is counted
+        while( sampler.getNextSample(&sample) )
+        {
+            TraversalCost cost;
+            auto start = std::chrono::steady_clock::now();
+            float weight = camera.generateRay(sample, &ray);
+            Vector L = Li(ray, &cost) * weight;
+            auto end = std::chrono::steady_clock::now();
+            rays++;
+
+            film.addSample(sample, L);
+            heatmap->addSample(sample, std::chrono::duration<float, std::nano>(end - start).count(), cost);
+        }
+
+        return rays;
+    }
+
+    switch(packetSize)
+    {
+        case 4:  return renderTilePackets<4>(sampler);
+        case 8:  return renderTilePackets<8>(sampler);
+        case 16: return renderTilePackets<16>(sampler);
+        default: break;
+    }
+
+    while( sampler.getNextSample(&sample) )
+    {
+        float weight = camera.generateRay(sample, &ray);
+        rays++;
+
+        film.addSample(sample, Li(ray) * weight);
+    }
+
+    return rays;
+}
+
+template<int N>
+uint64_t Renderer::renderTilePackets(StratifiedSampler& sampler)
+{
+    uint64_t rays = 0;
+    Sample samples[N];
+    Ray cameraRays[N];
+    float weights[N];
+    while(true)
+    {
+        // the next (up to) N samples, the last packet of a tile may be partly empty
+        int n = 0;
+        while( n < N && sampler.getNextSample(&samples[n]) )
+        {
+            weights[n] = camera.generateRay(samples[n], &cameraRays[n]);
+            n++;
+        }
+        if(n == 0) break;
+        rays += n;
+
+        RayPacket<N> packet;
+        for(int i = 0; i < n; i++)
+            packet.set(i, cameraRays[i]);
+        Maskx<N> active = Maskx<N>::fromBits( (1u << n) - 1 );
+        Maskx<N> hits = scene.intersectP(packet, active);
+
+        // in sample order, so the film sums up the same way it does one ray at a time
+        for(int i = 0; i < n; i++)
+            film.addSample(samples[i], shade(cameraRays[i], hits[i]) * weights[i]);
+    }
+
+    return rays;
+}
+
+uint64_t Renderer::renderStream(std::atomic<int>& nextTile, int n_tiles)
+{
+    RayQueue queue(streamSize);
+    uint64_t rays = 0;
+    Sample sample;
+    for(int tile = nextTile++; tile < n_tiles; tile = nextTile++)
+    {
+        int x0, x1, y0, y1;
+        tileBounds(tile, &x0, &x1, &y0, &y1);
+
+        // seeded per tile as in renderTile(), so the samples don't depend on how the tiles share a queue
+        rt::seedRNG( seed ^ (uint32_t)(tile * 2654435761u) );
+        StratifiedSampler sampler(x0, x1, y0, y1, x_pixelSamples, y_pixelSamples, jitter);
+
+        // generate
+        while( sampler.getNextSample(&sample) )
+        {
+            int slot = queue.push(sample);
+            queue.weights[slot] = camera.generateRay(sample, &queue.rays[slot]);
+            if( queue.full() )
+                rays += traceQueue(queue);
+        }
+    }
+    rays += traceQueue(queue);
+
+    return rays;
+}
+
+int Renderer::traceQueue(RayQueue& queue)
+{
+    TRACE_SCOPE_ARG("render", "ray queue", queue.size);
+
+    if(sortRays)
+        queue.sort( scene.worldBound() );
+    queue.extend(scene, packetSize);
+
+    // shade the hits and the misses each in their own loop
+    queue.compact();
+    for(int i : queue.hitSlots)
+        queue.L[i] = shade(queue.rays[i], true);
+    for(int i : queue.missSlots)
+        queue.L[i] = shade(queue.rays[i], false);
+
+    // accumulate, in queue order (the order the samples were generated in) so the film sums up like renderTile()
+    for(int i = 0; i < queue.size; i++)
+        film.addSample( Sample(queue.image_x[i], queue.image_y[i], 0.0f, 0.0f, 0.0f), queue.L[i] * queue.weights[i] );
+
+    int n = queue.size;
+    queue.clear();
+
+    return n;
+}
@@ -0,0 +1,98 @@
+/*
+    Renderer drives the main rendering loop (SamplerRenderer @ pg. 24 of pbrt 2nd ed.)
+
+    the image is split into TILE_SIZE x TILE_SIZE tiles, which worker threads pull off a shared counter
+    every tile gets its own StratifiedSampler, and reseeds the thread's rng from (seed, tile index),
+    so a given seed always produces the same image no matter how the tiles land on threads
+
+    a tile's camera rays are traced as RayPackets of packetSize consecutive samples (the samples of one pixel,
+    then the next), by default as many as fit in a SIMD register, and shade exactly like Li() does one at a time
+
+    with a streamSize, every thread instead renders wavefront style: its tiles' camera rays are queued into a
+    RayQueue, and once streamSize of them are waiting the whole queue goes through one stage after another
+    (sort if sortRays is set, extend, compact into hits and misses, shade each, accumulate into the film,
+    see RayQueue.h)
+    the image comes out the same either way
+*/
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "Camera.h"
+#include "Film.h"
+#include "Heatmap.h"
+#include "RayQueue.h"
+#include "Scene.h"
+#include "Stats.h"
+
+class Renderer
+{
+public:
+    /* PUBLIC MEMBERS */
+    static constexpr int TILE_SIZE = 16;
+
+    const Scene& scene;
+    const Camera& camera;
+    Film& film;
+
+    int x_pixelSamples, y_pixelSamples;
+    bool jitter;
+    uint32_t seed;
+    int threads; // 0 -> one per hardware thread
+    Heatmap* heatmap = nullptr; // if set, render() also records what every pixel cost into it
+    int packetSize = PACKET_WIDTH; // camera rays traced together: 4, 8 or 16, or 1 for one at a time (always with a heatmap)
+    int streamSize = 0; // 0 -> tile by tile, otherwise rays are traced in RayQueues of this many (not with a heatmap)
+    bool sortRays = false; // with a streamSize, sort every RayQueue before tracing it (see RayQueue::sort())
+
+    /* CONSTRUCTORS */
+    Renderer(const Scene& scene, const Camera& camera, Film& film,
+        int x_pixelSamples = 1, int y_pixelSamples = 1, bool jitter = false,
+        uint32_t seed = rt::RNG_SEED, int threads = 0
+    ) :
+        scene(scene),
+        camera(camera),
+        film(film),
+        x_pixelSamples(x_pixelSamples),
+        y_pixelSamples(y_pixelSamples),
+        jitter(jitter),
+        seed(seed),
+        threads(threads)
+    {}
+
+    /* PUBLIC METHODS */
+    // renders the whole image into film, returns the number of camera rays traced
+    // every render thread's statistics (see Stats.h) are merged into the global totals when it finishes,
+    // and its hardware counters (see PerfCounters.h) are reported as phase "tiles", thread <worker index>
+    uint64_t render();
+
+    // returns the radiance (as an rgb Vector) arriving along ray, adding the traversal work to cost if given
+    Vector Li(const Ray& ray, TraversalCost* cost = nullptr) const;
+
+    int tileCount() const;
+
+private:
+    /* PRIVATE METHODS */
+    // the pixels [x0, x1) x [y0, y1) of tile number tile
+    void tileBounds(int tile, int* x0, int* x1, int* y0, int* y1) const;
+
+    // renders tile number tile, returns the number of camera rays traced
+    uint64_t renderTile(int tile);
+    // renderTile() with camera rays traced N at a time
+    template<int N>
+    uint64_t renderTilePackets(StratifiedSampler& sampler);
+
+    // renders tiles off nextTile until there are none left, through a RayQueue of streamSize rays
+    // returns the number of camera rays traced
+    uint64_t renderStream(std::atomic<int>& nextTile, int n_tiles);
+    // runs the rays in queue through every stage after generate, and empties it, returns how many it held
+    int traceQueue(RayQueue& queue);
+
+    // the radiance along ray, given whether it hit the scene
+    Vector shade(const Ray& ray, bool hit) const;
+};
+
+#endif // RENDERER_H
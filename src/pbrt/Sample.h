@@ -9,6 +9,10 @@
 #include <vector>
 
 #include "pbrt.h"
+#include "Stats.h"
+
+STAT_COUNTER("Sampler/Samples generated", nSamplesGenerated);
+STAT_COUNTER("Sampler/Pixels sampled", nPixelsSampled);
 
 class Scene;
 class SurfaceIntegrator;
@@ -92,6 +96,8 @@ private:
     /* PRIVATE METHODS */
     void generateStratifiedCameraSamples()
     {
+        STAT_INC(nPixelsSampled);
+
         int n = x_pixelSamples * y_pixelSamples;
         
         // image samples
@@ -135,6 +141,14 @@ public:
 
         sample_pos = 0;
     }
+    StratifiedSampler(const StratifiedSampler&) = delete;
+    StratifiedSampler& operator=(const StratifiedSampler&) = delete;
+    
+    /* DECONSTRUCTORS */
+    ~StratifiedSampler()
+    {
+        free(imageSamples); // lensSamples and timeSamples live in the same allocation
+    }
     
     /* PUBLIC METHODS */
     int roundSize(int size) const override
@@ -173,6 +187,7 @@ public:
         // not implemented yet, starts @ (pg. 311)
 
         sample_pos++;
+        STAT_INC(nSamplesGenerated);
 
         return true;
     }
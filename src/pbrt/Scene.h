@@ -0,0 +1,82 @@
+/*
+    Scene holds every Shape in the world, along with the aggregate (BVH) used to intersect rays against them
+    see (pg. 22) of pbrt 2nd ed.
+*/
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "BVH.h"
+
+class Scene
+{
+public:
+    /* PUBLIC MEMBERS */
+    BVH aggregate;
+
+    /* CONSTRUCTORS */
+    // builds the aggregate over shapes
+    Scene(std::vector<std::shared_ptr<Shape>> shapes) :
+        aggregate( std::move(shapes) )
+    {}
+    // around an aggregate that's already built (see BVH's constructors), e.g. one loaded from a scene cache
+    Scene(std::vector<std::shared_ptr<Shape>> shapes, Array<BVH::LinearNode> nodes, int maxPrimsInNode = 4) :
+        aggregate( std::move(shapes), std::move(nodes), maxPrimsInNode )
+    {}
+
+    /* PUBLIC METHODS */
+    // finds the closest intersection along ray, ray.t_max is updated to the hit
+    // hit->shape->getDifferentialGeometry(ray, *hit, &dg) gives the full geometry there, when it's needed
+    inline bool intersect(const Ray& ray, Hit* hit, TraversalCost* cost = nullptr) const
+    {
+        return aggregate.intersect(ray, hit, cost);
+    }
+    // the packet version, returns the lanes of active that hit, and each one's Hit if hits is given
+    // (see BVH::intersect)
+    template<int N>
+    inline Maskx<N> intersect(RayPacket<N>& rays, const Maskx<N>& active, Hit* hits = nullptr) const
+    {
+        return aggregate.intersect(rays, active, hits);
+    }
+
+    // true if anything is hit along ray, stopping at the first hit (see BVH::intersectP)
+    // for shadow and visibility rays, and anything else that only needs to know whether there's a hit
+    inline bool intersectP(const Ray& ray, TraversalCost* cost = nullptr) const
+    {
+        return aggregate.intersectP(ray, cost);
+    }
+    template<int N>
+    inline Maskx<N> intersectP(const RayPacket<N>& rays, const Maskx<N>& active) const
+    {
+        return aggregate.intersectP(rays, active);
+    }
+    // occluded[i] = intersectP(rays[i]) for n rays, traced PACKET_WIDTH at a time
+    // for batches of shadow rays, which are coherent when they're headed for the same light
+    inline void intersectP(const Ray* rays, int n, uint8_t* occluded) const
+    {
+        for(int start = 0; start < n; start += PACKET_WIDTH)
+        {
+            int count = std::min(PACKET_WIDTH, n - start);
+            RayPacket<PACKET_WIDTH> packet;
+            for(int i = 0; i < count; i++)
+                packet.set(i, rays[start + i]);
+
+            Maskx<PACKET_WIDTH> hit = aggregate.intersectP( packet, Maskx<PACKET_WIDTH>::fromBits((1u << count) - 1) );
+            for(int i = 0; i < count; i++)
+                occluded[start + i] = hit[i];
+        }
+    }
+
+    inline Bbox worldBound() const
+    {
+        return aggregate.worldBound();
+    }
+};
+
+#endif // SCENE_H
@@ -0,0 +1,538 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#include "MappedFile.h"
+#include "SceneCache.h"
+#include "Sphere.h"
+#include "SphereSoup.h"
+#include "Trace.h"
+#include "TriangleMesh.h"
+
+// the arrays are used in place, so they have to be plain data
+static_assert(std::is_trivially_copyable<BVH::LinearNode>::value, "BVH::LinearNode can't be cached");
+static_assert(std::is_trivially_copyable<SphereSoup::Block>::value, "SphereSoup::Block can't be cached");
+static_assert(std::is_trivially_copyable<TriangleMesh::EdgeTriangle>::value, "TriangleMesh::EdgeTriangle can't be cached");
+
+static const char MAGIC[8] = "rtscene";
+static constexpr uint32_t VERSION = 1;
+static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+static constexpr size_t ALIGNMENT = 64; // every array starts on a cache line
+
+// count elements, starting offset bytes into the file
+struct FileRange
+{
+    uint64_t offset;
+    uint64_t count;
+};
+
+enum ShapeType : uint32_t
+{
+    SPHERE = 1,
+    SPHERE_SOUP,
+    TRIANGLE_MESH
+};
+
+// a SphereSoup's and a TriangleMesh's slots in ShapeRecord::arrays
+enum SoupArray
+{
+    SOUP_NODES,
+    SOUP_BLOCKS
+};
+enum MeshArray
+{
+    MESH_INDICES,
+    MESH_X, MESH_Y, MESH_Z,
+    MESH_NX, MESH_NY, MESH_NZ,
+    MESH_US, MESH_VS,
+    MESH_NODES,
+    MESH_EDGES,
+    N_MESH_ARRAYS
+};
+
+struct ShapeRecord
+{
+    uint32_t type;
+    uint32_t reverseOrientation;
+    float m[3][4], m_inv[3][4]; // object_to_world, as AffineTransform keeps it
+    float sphere[4]; // a Sphere's radius, z_min, z_max and phi_max
+    uint32_t intersector; // a TriangleMesh's
+    uint32_t pad;
+    uint64_t count; // a SphereSoup's spheres
+    FileRange arrays[N_MESH_ARRAYS];
+};
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    // the layout of this build's arrays, SphereSoup's blocks follow the SIMD width
+    uint32_t nodeBytes, blockBytes, leafWidth, edgeBytes;
+    uint64_t sourceHash;
+    uint64_t fileBytes;
+    uint32_t maxPrimsInNode;
+    uint32_t pad;
+    FileRange nodes; // the aggregate's
+    FileRange shapes; // a ShapeRecord for each of the aggregate's shapes, in leaf order
+};
+
+// the header of a cache this build writes, with everything that doesn't depend on the scene filled in
+static Header layoutHeader()
+{
+    Header h = {};
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    h.nodeBytes = sizeof(BVH::LinearNode);
+    h.blockBytes = sizeof(SphereSoup::Block);
+    h.leafWidth = SphereSoup::LEAF_WIDTH;
+    h.edgeBytes = sizeof(TriangleMesh::EdgeTriangle);
+
+    return h;
+}
+
+static inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// implementation as in the xxHash reference (github.com/Cyan4973/xxHash), for little endian machines
+uint64_t hashBytes(const void* data, size_t n, uint64_t seed)
+{
+    const uint64_t P1 = 11400714785074694791ull, P2 = 14029467366897019727ull, P3 = 1609587929392839161ull;
+    const uint64_t P4 = 9650029242287828579ull, P5 = 2870177450012600261ull;
+    auto round = [=](uint64_t acc, uint64_t input)
+    {
+        return rotl(acc + input * P2, 31) * P1;
+    };
+
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + n;
+    uint64_t h;
+
+    // four independent lanes over 32 bytes at a time, so the multiplies overlap
+    if(n >= 32)
+    {
+        uint64_t v[4] = { seed + P1 + P2, seed + P2, seed, seed - P1 };
+        for(; p + 32 <= end; p += 32)
+            for(int i = 0; i < 4; i++)
+                v[i] = round(v[i], read64(p + 8*i));
+
+        h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+        for(int i = 0; i < 4; i++)
+            h = (h ^ round(0, v[i])) * P1 + P4;
+    }
+    else h = seed + P5;
+    h += n;
+
+    for(; p + 8 <= end; p += 8)
+        h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+    if(p + 4 <= end)
+    {
+        h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for(; p < end; p++)
+        h = rotl(h ^ (*p * P5), 11) * P1;
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+bool hashFile(const char* path, uint64_t* hash)
+{
+    MappedFile file;
+    if( !file.open(path) )
+    {
+        printf("[hashFile] %s: %s\n", path, file.error().c_str());
+        return false;
+    }
+    *hash = hashBytes(file.data(), file.size());
+
+    return true;
+}
+
+/* WRITING */
+
+// writes a cache front to back, every array padded out to ALIGNMENT
+class CacheWriter
+{
+public:
+    FILE* f;
+    uint64_t offset = 0;
+    bool ok = true;
+
+    CacheWriter(FILE* f) :
+        f(f)
+    {}
+
+    // writes count elements of elementBytes each and returns where they went
+    FileRange write(const void* data, size_t elementBytes, size_t count)
+    {
+        static const char zeros[ALIGNMENT] = {};
+
+        FileRange range = { offset, count };
+        size_t bytes = elementBytes * count;
+        if(bytes > 0) ok &= fwrite(data, 1, bytes, f) == bytes;
+        size_t pad = (ALIGNMENT - bytes % ALIGNMENT) % ALIGNMENT;
+        if(pad > 0) ok &= fwrite(zeros, 1, pad, f) == pad;
+        offset += bytes + pad;
+
+        return range;
+    }
+    template<typename T>
+    FileRange write(const Array<T>& array)
+    {
+        return write(array.data(), sizeof(T), array.size());
+    }
+};
+
+// fills in record for shape and writes its arrays, returns false if it's not a shape the cache knows
+static bool writeShape(CacheWriter& writer, Shape& shape, ShapeRecord* record)
+{
+    *record = {};
+    record->reverseOrientation = shape.reverseOrientation;
+    memcpy(record->m, shape.object_to_world->m, sizeof(record->m));
+    memcpy(record->m_inv, shape.object_to_world->m_inv, sizeof(record->m_inv));
+
+    // exact types, a subclass could have anything else in it
+    if( typeid(shape) == typeid(Sphere) )
+    {
+        const Sphere& sphere = static_cast<const Sphere&>(shape);
+        record->type = SPHERE;
+        record->sphere[0] = sphere.getRadius();
+        record->sphere[1] = sphere.getZMin();
+        record->sphere[2] = sphere.getZMax();
+        record->sphere[3] = sphere.getPhiMax();
+    }
+    else if( typeid(shape) == typeid(SphereSoup) )
+    {
+        const SphereSoup& soup = static_cast<const SphereSoup&>(shape);
+        record->type = SPHERE_SOUP;
+        record->count = soup.size();
+        record->arrays[SOUP_NODES] = writer.write(soup.nodes);
+        record->arrays[SOUP_BLOCKS] = writer.write(soup.blocks);
+    }
+    else if( typeid(shape) == typeid(TriangleMesh) )
+    {
+        TriangleMesh& mesh = static_cast<TriangleMesh&>(shape);
+        SoA3 p = mesh.positions.soa(), n = mesh.normals.soa();
+        record->type = TRIANGLE_MESH;
+        record->intersector = mesh.intersector;
+        record->arrays[MESH_INDICES] = writer.write(mesh.indices);
+        record->arrays[MESH_X] = writer.write(p.x, sizeof(float), mesh.positions.size());
+        record->arrays[MESH_Y] = writer.write(p.y, sizeof(float), mesh.positions.size());
+        record->arrays[MESH_Z] = writer.write(p.z, sizeof(float), mesh.positions.size());
+        record->arrays[MESH_NX] = writer.write(n.x, sizeof(float), mesh.normals.size());
+        record->arrays[MESH_NY] = writer.write(n.y, sizeof(float), mesh.normals.size());
+        record->arrays[MESH_NZ] = writer.write(n.z, sizeof(float), mesh.normals.size());
+        record->arrays[MESH_US] = writer.write(mesh.us);
+        record->arrays[MESH_VS] = writer.write(mesh.vs);
+        record->arrays[MESH_NODES] = writer.write(mesh.nodes);
+        record->arrays[MESH_EDGES] = writer.write(mesh.edgeTriangles);
+    }
+    else return false;
+
+    return true;
+}
+
+bool writeSceneCache(const char* path, const Scene& scene, uint64_t sourceHash)
+{
+    TRACE_SCOPE("build", "scene cache write");
+    const BVH& aggregate = scene.aggregate;
+
+    // written next to path and moved over it once it's complete, so a reader never maps half a cache
+    std::string temporary = std::string(path) + ".tmp";
+    FILE* f = fopen(temporary.c_str(), "wb");
+    if(!f)
+    {
+        printf("[writeSceneCache] %s: can't write %s\n", path, temporary.c_str());
+        return false;
+    }
+
+    CacheWriter writer(f);
+    Header header = layoutHeader();
+    writer.write(&header, sizeof(header), 1); // a placeholder, it's written again once the offsets are known
+
+    std::vector<ShapeRecord> records( aggregate.shapes.size() );
+    bool known = true;
+    for(size_t i = 0; i < records.size() && known; i++)
+        known = writeShape(writer, *aggregate.shapes[i], &records[i]);
+    if(known)
+    {
+        header.sourceHash = sourceHash;
+        header.maxPrimsInNode = aggregate.maxPrimsInNode;
+        header.nodes = writer.write(aggregate.nodes);
+        header.shapes = writer.write(records.data(), sizeof(ShapeRecord), records.size());
+        header.fileBytes = writer.offset;
+
+        writer.ok &= fseek(f, 0, SEEK_SET) == 0;
+        writer.ok &= fwrite(&header, sizeof(header), 1, f) == 1;
+    }
+    writer.ok &= fclose(f) == 0;
+
+    std::error_code ec;
+    if(known && writer.ok) std::filesystem::rename(temporary, path, ec);
+    if(!known || !writer.ok || ec)
+    {
+        if(!known) printf("[writeSceneCache] %s: the scene has a shape that can't be cached (only Spheres, SphereSoups and TriangleMeshes can)\n", path);
+        else printf("[writeSceneCache] %s: can't write the file\n", path);
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+
+    return true;
+}
+
+/* LOADING */
+
+// borrows the array at range in file, returns false if it isn't inside the file
+template<typename T>
+static bool borrow(const std::shared_ptr<MappedFile>& file, const FileRange& range, Array<T>* array)
+{
+    if(range.offset % alignof(T) != 0 || range.offset > file->size() ||
+        range.count > (file->size() - range.offset) / sizeof(T)) return false;
+
+    *array = Array<T>::borrow( (const T*)(file->data() + range.offset), range.count, file );
+    return true;
+}
+
+// true if nothing in nodes can lead a traversal outside of it or of the primitives its leaves refer to: every
+// interior node splits along x, y or z and both its children come after it, and the tree is no deeper than the
+// BVH::MAX_DEPTH nodes traversal keeps on its stack
+// a leaf's primitives are the nPrimitives from its primitivesOffset, or with blockLeaves (a SphereSoup's) the one
+// block at primitivesOffset, holding at most LEAF_WIDTH spheres
+// *leafPrimitives is set to the sum of every leaf's nPrimitives
+static bool validTree(const Array<BVH::LinearNode>& nodes, size_t nPrimitives, bool blockLeaves, uint64_t* leafPrimitives)
+{
+    *leafPrimitives = 0;
+    std::vector<uint8_t> depth(nodes.size(), 0); // 0 for the nodes nothing leads to
+    if( !nodes.empty() ) depth[0] = 1;
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        const BVH::LinearNode& node = nodes[i];
+        if(node.nPrimitives > 0)
+        {
+            uint64_t span = blockLeaves ? 1 : node.nPrimitives;
+            if( node.primitivesOffset < 0 || (uint64_t)node.primitivesOffset + span > nPrimitives ) return false;
+            if( blockLeaves && node.nPrimitives > SphereSoup::LEAF_WIDTH ) return false;
+            *leafPrimitives += node.nPrimitives;
+            continue;
+        }
+
+        if( node.axis > 2 || i + 1 >= nodes.size() || node.secondChildOffset <= (int64_t)i + 1 ||
+            (size_t)node.secondChildOffset >= nodes.size() ) return false;
+        if(depth[i] == 0) continue;
+        if(depth[i] >= BVH::MAX_DEPTH) return false;
+        depth[i + 1] = std::max<uint8_t>(depth[i + 1], depth[i] + 1);
+        depth[node.secondChildOffset] = std::max<uint8_t>(depth[node.secondChildOffset], depth[i] + 1);
+    }
+
+    return true;
+}
+
+// the shape record describes, with its arrays borrowed from file, or nullptr if the record doesn't make sense
+// everything traversal and getDifferentialGeometry() index with is checked here, once, so they never have to
+static std::shared_ptr<Shape> readShape(const std::shared_ptr<MappedFile>& file, const ShapeRecord& record)
+{
+    AffineTransform affine;
+    memcpy(affine.m, record.m, sizeof(affine.m));
+    memcpy(affine.m_inv, record.m_inv, sizeof(affine.m_inv));
+    Transform object_to_world = affine.toTransform();
+    bool reverseOrientation = record.reverseOrientation != 0;
+
+    if(record.type == SPHERE)
+        return std::make_shared<Sphere>(object_to_world, reverseOrientation,
+            record.sphere[0], record.sphere[1], record.sphere[2], record.sphere[3]);
+
+    if(record.type == SPHERE_SOUP)
+    {
+        Array<BVH::LinearNode> nodes;
+        Array<SphereSoup::Block> blocks;
+        if( !borrow(file, record.arrays[SOUP_NODES], &nodes) || !borrow(file, record.arrays[SOUP_BLOCKS], &blocks) ) return nullptr;
+
+        // the leaves hold every one of the soup's spheres
+        uint64_t spheres;
+        if( !validTree(nodes, blocks.size(), true, &spheres) || spheres != record.count ) return nullptr;
+
+        return std::make_shared<SphereSoup>( record.count, std::move(nodes), std::move(blocks) );
+    }
+
+    if(record.type == TRIANGLE_MESH)
+    {
+        Array<uint32_t> indices;
+        Array<float> floats[MESH_VS + 1]; // MESH_X through MESH_VS
+        Array<BVH::LinearNode> nodes;
+        Array<TriangleMesh::EdgeTriangle> edges;
+        bool ok = borrow(file, record.arrays[MESH_INDICES], &indices) &&
+            borrow(file, record.arrays[MESH_NODES], &nodes) &&
+            borrow(file, record.arrays[MESH_EDGES], &edges);
+        for(int i = MESH_X; i <= MESH_VS; i++)
+            ok = ok && borrow(file, record.arrays[i], &floats[i]);
+        if(!ok) return nullptr;
+
+        // the normals and uvs are there for every vertex, or not at all
+        size_t nVertices = floats[MESH_X].size(), nNormals = floats[MESH_NX].size(), nUVs = floats[MESH_US].size();
+        bool buffers = floats[MESH_Y].size() == nVertices && floats[MESH_Z].size() == nVertices &&
+            (nNormals == 0 || nNormals == nVertices) && floats[MESH_NY].size() == nNormals && floats[MESH_NZ].size() == nNormals &&
+            (nUVs == 0 || nUVs == nVertices) && floats[MESH_VS].size() == nUVs;
+        TriangleMesh::Intersector intersector = (TriangleMesh::Intersector)record.intersector;
+        bool triangles = indices.size() % 3 == 0 &&
+            (intersector == TriangleMesh::Watertight || intersector == TriangleMesh::PrecomputedEdges) &&
+            edges.size() == (intersector == TriangleMesh::PrecomputedEdges ? indices.size() / 3 : 0);
+        if(!buffers || !triangles) return nullptr;
+
+        uint64_t leafTriangles;
+        if( !validTree(nodes, indices.size() / 3, false, &leafTriangles) || leafTriangles != indices.size() / 3 ) return nullptr;
+        for(uint32_t index : indices)
+            if(index >= nVertices) return nullptr;
+
+        std::shared_ptr<const void> owner = file;
+        SoA3Buffer positions = SoA3Buffer::borrow(floats[MESH_X].data(), floats[MESH_Y].data(), floats[MESH_Z].data(), nVertices, owner);
+        SoA3Buffer normals = SoA3Buffer::borrow(floats[MESH_NX].data(), floats[MESH_NY].data(), floats[MESH_NZ].data(), nNormals, owner);
+
+        return std::make_shared<TriangleMesh>(object_to_world, reverseOrientation, intersector, std::move(indices),
+            std::move(positions), std::move(normals), std::move(floats[MESH_US]), std::move(floats[MESH_VS]),
+            std::move(nodes), std::move(edges));
+    }
+
+    return nullptr;
+}
+
+// the scene in file, or nullptr and *error says why it can't be used
+static std::unique_ptr<Scene> readScene(const std::shared_ptr<MappedFile>& file, uint64_t sourceHash, std::string* error)
+{
+    Header header = {}, expected = layoutHeader();
+    if( file->size() >= sizeof(Header) ) memcpy(&header, file->data(), sizeof(Header));
+    if( memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 )
+    {
+        *error = "not a scene cache";
+        return nullptr;
+    }
+    if(header.version != expected.version || header.byteOrder != expected.byteOrder ||
+        header.nodeBytes != expected.nodeBytes || header.blockBytes != expected.blockBytes ||
+        header.leafWidth != expected.leafWidth || header.edgeBytes != expected.edgeBytes)
+    {
+        *error = "written by an incompatible build (another version or SIMD width)";
+        return nullptr;
+    }
+    if(header.fileBytes != file->size())
+    {
+        *error = "the file is " + std::to_string(file->size()) + " bytes, not the " + std::to_string(header.fileBytes) + " it was written with";
+        return nullptr;
+    }
+    if(header.sourceHash != sourceHash)
+    {
+        *error = "stale, it was written for another source";
+        return nullptr;
+    }
+
+    Array<BVH::LinearNode> nodes;
+    Array<ShapeRecord> records;
+    if( !borrow(file, header.nodes, &nodes) || !borrow(file, header.shapes, &records) )
+    {
+        *error = "an array runs past the end of the file";
+        return nullptr;
+    }
+    uint64_t leafShapes;
+    if( !validTree(nodes, records.size(), false, &leafShapes) || leafShapes != records.size() )
+    {
+        *error = "the tree refers to nodes or shapes that aren't in the file";
+        return nullptr;
+    }
+
+    std::vector<std::shared_ptr<Shape>> shapes;
+    shapes.reserve( records.size() );
+    for(const ShapeRecord& record : records)
+    {
+        shapes.push_back( readShape(file, record) );
+        if( !shapes.back() )
+        {
+            *error = "shape " + std::to_string(shapes.size() - 1) + " is corrupt";
+            return nullptr;
+        }
+    }
+
+    return std::make_unique<Scene>( std::move(shapes), std::move(nodes), (int)header.maxPrimsInNode );
+}
+
+std::unique_ptr<Scene> loadSceneCache(const char* path, uint64_t sourceHash, SceneCacheInfo* info)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::error_code ec;
+    if( !std::filesystem::exists(path, ec) ) return nullptr;
+    TRACE_SCOPE("build", "scene cache load");
+
+    // the nodes and buffers are read wherever rays go, not front to back
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if( !file->open(path, false) )
+    {
+        printf("[loadSceneCache] %s: %s\n", path, file->error().c_str());
+        return nullptr;
+    }
+
+    std::string error;
+    std::unique_ptr<Scene> scene = readScene(file, sourceHash, &error);
+    if(!scene)
+    {
+        printf("[loadSceneCache] %s: %s\n", path, error.c_str());
+        return nullptr;
+    }
+
+    if(info)
+    {
+        info->hit = true;
+        info->bytes = file->size();
+        info->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return scene;
+}
+
+std::unique_ptr<Scene> loadOrBuildScene(const char* path, uint64_t sourceHash,
+    const std::function<std::vector<std::shared_ptr<Shape>>()>& build, SceneCacheInfo* info)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Scene> scene = loadSceneCache(path, sourceHash, info);
+    if(scene) return scene;
+
+    scene = std::make_unique<Scene>( build() );
+    bool written = writeSceneCache(path, *scene, sourceHash); // the scene is just as good without it
+
+    if(info)
+    {
+        std::error_code ec;
+        info->hit = false;
+        info->bytes = written ? (size_t)std::filesystem::file_size(path, ec) : 0;
+        info->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return scene;
+}
@@ -0,0 +1,69 @@
+/*
+    a scene cache is a Scene written to a binary file once it's built, so the next run can map the file and
+    render from it without parsing or building anything again
+
+    the file is one block of plain data, found by offsets from its start (so it can be mapped anywhere):
+        * a header: the format's version, the layout of this build's nodes and blocks, and the hash of the
+          source the scene was built from
+        * a fixed size record for every shape, in the aggregate's leaf order: its type, object_to_world (both
+          matrices), reverseOrientation, a Sphere's parameters, and where a SphereSoup's or TriangleMesh's
+          arrays are
+        * the arrays themselves, each aligned to 64 bytes: the aggregate's flattened BVH nodes, and every soup's
+          nodes and blocks and every mesh's indices, world space vertex buffers, uvs, nodes and edge triangles
+    loading maps the file (see MappedFile.h) and the arrays are borrowed in place (see Array.h), nothing is
+    copied or built, and pages are only read in as rays reach them
+    only the shape objects themselves (and their transforms) are made again from the records, since a vtable
+    can't be stored in a file
+
+    a cache is only used for the source it was written for: the caller hashes whatever the scene is built
+    from (hashFile() of a mesh file, or hashBytes() of a scene's description) and a cache written for any
+    other hash is stale and rebuilt
+    a cache written by a build with other node or block layouts (e.g. another SIMD width) is rebuilt too
+    Spheres, SphereSoups and TriangleMeshes can be cached, a scene with any other shape can't
+
+    usage:
+        uint64_t hash;
+        if( !hashFile("bunny.ply", &hash) ) ...
+        std::unique_ptr<Scene> scene = loadOrBuildScene("bunny.rtscene", hash, [] {
+            return std::vector<std::shared_ptr<Shape>>{ loadMesh("bunny.ply", Transform()) };
+        });
+*/
+
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Scene.h"
+
+// what loadSceneCache() or loadOrBuildScene() did
+struct SceneCacheInfo
+{
+    bool hit = false; // the scene came from the cache
+    size_t bytes = 0; // the size of the cache file
+    double seconds = 0; // loading the scene, or building it and writing the cache on a miss
+};
+
+// xxHash64 of the n bytes at data
+uint64_t hashBytes(const void* data, size_t n, uint64_t seed = 0);
+// hashBytes() of the file at path, returns false if it can't be read, after printing why
+bool hashFile(const char* path, uint64_t* hash);
+
+// writes scene to path as the cache of a source with hash sourceHash, returns false if it can't (after printing
+// why), which leaves no file behind
+bool writeSceneCache(const char* path, const Scene& scene, uint64_t sourceHash);
+
+// the scene cached at path, without building anything, or nullptr if there isn't one
+// a cache that's there but is stale or can't be read prints why
+std::unique_ptr<Scene> loadSceneCache(const char* path, uint64_t sourceHash, SceneCacheInfo* info = nullptr);
+
+// loadSceneCache(), or on a miss a Scene of build()'s shapes, which is then cached at path for next time
+std::unique_ptr<Scene> loadOrBuildScene(const char* path, uint64_t sourceHash,
+    const std::function<std::vector<std::shared_ptr<Shape>>()>& build, SceneCacheInfo* info = nullptr);
+
+#endif // SCENE_CACHE_H
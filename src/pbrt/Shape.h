@@ -3,42 +3,136 @@
     
     Shapes operate within their own object coordiante space
     they hold Transforms that go from object_to_world and back
+    placing a shape never involves a projection, so these are AffineTransforms
+    they're references into a TransformCache, so shapes with the same placement share one copy of it, which
+    is freed with the last of them
+    a shape given a projective Transform says why, is left at the identity with validPlacement false, and
+    BVH leaves it out
+
+    intersect() only fills in a compact Hit, the full DifferentialGeometry of a hit is worked out afterwards by
+    getDifferentialGeometry(), once it's known to be the closest (see Hit.h)
+
+    intersectPacket() (4, 8 or 16 rays at once, see RayPacket.h) falls back to calling intersect() for every
+    lane, shapes that have a SIMD kernel override it
 */
 
 #ifndef SHAPE_H
 #define SHAPE_H
 
-#include "Transform.h"
+#include <stdio.h>
+
+#include <memory>
+#include <utility>
+
+#include "TransformCache.h"
 #include "DifferentialGeometry.h"
+#include "Hit.h"
+#include "RayPacket.h"
 
 class Shape
 {
 public:
     /* PUBLIC MEMBERS */
-    const Transform object_to_world, world_to_object;
+    std::shared_ptr<const AffineTransform> object_to_world, world_to_object;
     const bool reverseOrientation, transformSwapsHandedness;
+    const bool validPlacement; // false if the shape was given a projective transform
     
     /* CONSTRUCTORS */
-    Shape(const Transform& object_to_world, bool reverseOrientation = false) :
-        object_to_world(object_to_world),
-        world_to_object(object_to_world.getInverse()),
+    // nullptr is a transform that couldn't be made affine, the shape is then left at the identity
+    Shape(std::shared_ptr<const AffineTransform> object_to_world, std::shared_ptr<const AffineTransform> world_to_object,
+        bool reverseOrientation = false) :
+        object_to_world( object_to_world ? object_to_world : identity() ),
+        world_to_object( world_to_object ? world_to_object : identity() ),
         reverseOrientation(reverseOrientation),
-        transformSwapsHandedness( object_to_world.swapsHandedness() )
+        transformSwapsHandedness( this->object_to_world->swapsHandedness() ),
+        validPlacement( object_to_world && world_to_object )
+    {
+        if(!validPlacement) printf("[Shape] object_to_world is a projection, which can't place a shape\n");
+    }
+    // interns object_to_world and its inverse in TransformCache::global()
+    Shape(const Transform& object_to_world, bool reverseOrientation = false) :
+        Shape( intern(object_to_world), reverseOrientation )
     {}
     
     /* VIRTUAL METHODS */
     virtual Bbox objectBound() const = 0;
-    virtual bool intersect(const Ray& ray, float* t_hit, DifferentialGeometry* dg) const = 0;
+    // finds the closest hit along ray in [ray.t_min, ray.t_max], and fills in hit (hit->shape = this) if there's one
+    virtual bool intersect(const Ray& ray, Hit* hit) const = 0;
     virtual bool doesIntersect(const Ray& ray) const = 0; // aka IntersectP() in pbrt
+    // the geometry at a hit intersect() found along ray, in world space
+    virtual void getDifferentialGeometry(const Ray& ray, const Hit& hit, DifferentialGeometry* dg) const = 0;
+
+    // intersects the lanes of rays that are set in active, returns the lanes that hit
+    // the distance to each hit is written to that lane of t_hit, the other lanes of t_hit are left alone
+    // if hits (N of them) is given, each lane that hit also gets the Hit intersect() would fill in
+    virtual Maskx<4> intersectPacket(const RayPacket<4>& rays, const Maskx<4>& active, Floatx<4>* t_hit, Hit* hits = nullptr) const
+    {
+        return intersectLanes(rays, active, t_hit, hits);
+    }
+    virtual Maskx<8> intersectPacket(const RayPacket<8>& rays, const Maskx<8>& active, Floatx<8>* t_hit, Hit* hits = nullptr) const
+    {
+        return intersectLanes(rays, active, t_hit, hits);
+    }
+    virtual Maskx<16> intersectPacket(const RayPacket<16>& rays, const Maskx<16>& active, Floatx<16>* t_hit, Hit* hits = nullptr) const
+    {
+        return intersectLanes(rays, active, t_hit, hits);
+    }
 
     virtual Bbox worldBound() const
     {
-        return object_to_world( objectBound() );
+        return (*object_to_world)( objectBound() );
     }
     virtual bool isIntersectable() const
     {
         return true; // if you want this to be false, impliment refine() at (pg. 92) of pbrt 2nd ed.
     }
+
+protected:
+    /* PROTECTED METHODS */
+    static std::shared_ptr<const AffineTransform> identity()
+    {
+        return TransformCache::global().lookup( AffineTransform() );
+    }
+
+private:
+    /* PRIVATE CONSTRUCTORS */
+    // object_to_world and world_to_object, as one TransformCache lookup gives them
+    typedef std::pair<std::shared_ptr<const AffineTransform>, std::shared_ptr<const AffineTransform>> Placement;
+
+    Shape(Placement placement, bool reverseOrientation) :
+        Shape( std::move(placement.first), std::move(placement.second), reverseOrientation )
+    {}
+
+    /* PRIVATE METHODS */
+    // TransformCache::global()'s copies of t and its inverse, or nullptrs if t is a projection
+    static Placement intern(const Transform& t)
+    {
+        Placement placement;
+        AffineTransform affine;
+        if( AffineTransform::fromTransform(t, &affine) ) placement.first = TransformCache::global().lookup(affine, &placement.second);
+
+        return placement;
+    }
+
+    // intersectPacket() one lane at a time
+    template<int N>
+    Maskx<N> intersectLanes(const RayPacket<N>& rays, const Maskx<N>& active, Floatx<N>* t_hit, Hit* hits) const
+    {
+        uint32_t hitBits = 0;
+        for(uint32_t lanes = active.bits(); lanes; lanes &= lanes - 1)
+        {
+            int i = lowestLane(lanes);
+            Hit hit;
+            if( intersect(rays.ray(i), &hit) )
+            {
+                (*t_hit)[i] = hit.t;
+                if(hits) hits[i] = hit;
+                hitBits |= 1u << i;
+            }
+        }
+
+        return Maskx<N>::fromBits(hitBits);
+    }
 };
 
 #endif // Shape
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+    SoA3 points at n Points, Vectors or Normals stored as three separate arrays (structure of arrays)
+    x[i], y[i], z[i] is element i
+
+    this is the layout the batch transforms (Transform::transformPoints() and friends) work on: four
+    consecutive x's fill one SSE register, so every lane does the same work with no shuffling
+    SoA3 doesn't own the floats, SoA3Buffer does (or borrows them, see Array.h)
+*/
+
+#ifndef SOA_H
+#define SOA_H
+
+#include <stddef.h>
+
+#include <memory>
+
+#include "Array.h"
+#include "Point.h"
+
+struct SoA3
+{
+    float* x;
+    float* y;
+    float* z;
+
+    inline Vector vector(size_t i) const
+    {
+        return Vector(x[i], y[i], z[i]);
+    }
+    inline Point point(size_t i) const
+    {
+        return Point(x[i], y[i], z[i]);
+    }
+    inline Normal normal(size_t i) const
+    {
+        return Normal(x[i], y[i], z[i]);
+    }
+    inline void set(size_t i, float xi, float yi, float zi) const
+    {
+        x[i] = xi;
+        y[i] = yi;
+        z[i] = zi;
+    }
+};
+
+// n elements worth of SoA3 storage
+class SoA3Buffer
+{
+private:
+    /* PRIVATE MEMBERS */
+    Array<float> xs, ys, zs;
+
+public:
+    /* CONSTRUCTORS */
+    SoA3Buffer(size_t n = 0) :
+        xs(n),
+        ys(n),
+        zs(n)
+    {}
+
+    // a view of n elements at x, y and z, which belong to owner (see Array::borrow())
+    static SoA3Buffer borrow(const float* x, const float* y, const float* z, size_t n, const std::shared_ptr<const void>& owner)
+    {
+        SoA3Buffer buffer;
+        buffer.xs = Array<float>::borrow(x, n, owner);
+        buffer.ys = Array<float>::borrow(y, n, owner);
+        buffer.zs = Array<float>::borrow(z, n, owner);
+
+        return buffer;
+    }
+
+    /* PUBLIC METHODS */
+    size_t size() const
+    {
+        return xs.size();
+    }
+
+    SoA3 soa()
+    {
+        return SoA3{ xs.data(), ys.data(), zs.data() };
+    }
+};
+
+#endif // SOA_H
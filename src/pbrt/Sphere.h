@@ -3,12 +3,19 @@
     TODO: impliment more quadrics
     
     Spheres are centered at the object space origin and have a radius = radius
+
+    a full sphere (no z or phi clipping) that's placed by just a translation and a uniform scale is still a
+    sphere in world space, so it's intersected right there, without transforming the ray or any trigonometry
 */
 
 #ifndef SPHERE_H
 #define SPHERE_H
 
 #include "Shape.h"
+#include "Stats.h"
+
+STAT_RATIO("Intersections/Sphere hits per test", nSphereHits, nSphereTests);
+STAT_RATIO("Intersections/Sphere occlusion hits per test", nSphereOcclusionHits, nSphereOcclusionTests);
 
 class Sphere : public Shape
 {
@@ -19,6 +26,11 @@ private:
     float z_min, z_max; // the range in which the sphere exists, in z values in object space
     float theta_min, theta_max; // the range in which the sphere exists, sweeping around the z axis, in radians
 
+    // for the world space fast path
+    bool worldSpace; // full, and placed by a translation and uniform scale
+    Point center;
+    float worldRadius;
+
 public:
     /* CONSTRUCTORS */
     Sphere(const Transform& object_to_world, bool reverseOrientation, float radius, float z_min = -rt::TWOPI, float z_max = rt::TWOPI, float phi_max_radians = rt::TWOPI) :
@@ -29,7 +41,16 @@ public:
         theta_min( acosf((*this).z_min / radius) ),
         theta_max( acosf((*this).z_max / radius) ),
         phi_max(phi_max_radians)
-    {}
+    {
+        float scale;
+        worldSpace = (*this).z_min <= -radius && (*this).z_max >= radius && phi_max >= rt::TWOPI &&
+            this->object_to_world->isTranslateScale(&scale);
+        if(worldSpace)
+        {
+            center = (*this->object_to_world)( Point(0, 0, 0) );
+            worldRadius = radius * fabsf(scale);
+        }
+    }
     
     // this can be greatly improved if theta_min is considered
     // theta_min in this implimentation is ignored, so the naive solution for a bounding box is used
@@ -40,18 +61,130 @@ public:
             Point(radius, radius, z_max)
         );
     }
-    
+
+    // the constructor's parameters, after it clamped them, so the same sphere can be made again
+    inline float getRadius() const { return radius; }
+    inline float getZMin() const { return z_min; }
+    inline float getZMax() const { return z_max; }
+    inline float getPhiMax() const { return phi_max; }
+
     // performs ray-sphere intersection test and saves results
     // returns true if there's an intersection
+    bool intersect(const Ray& ray, Hit* hit) const override
+    {
+        STAT_INC(nSphereTests);
+        float t_hit;
+        if( !hitDistance(ray, &t_hit) ) return false;
+
+        hit->t = t_hit;
+        hit->u = hit->v = 0.0f;
+        hit->primitive = 0;
+        hit->shape = this;
+        STAT_INC(nSphereHits);
+
+        return true;
+    }
+    
+    // the same test as intersect(), so shadow rays and camera rays agree on what's hit, including the clipped
+    // parts of partial spheres
+    bool doesIntersect(const Ray& ray) const override
+    {
+        STAT_INC(nSphereOcclusionTests);
+        float t_hit;
+        if( !hitDistance(ray, &t_hit) ) return false;
+
+        STAT_INC(nSphereOcclusionHits);
+        return true;
+    }
+
+    // the hit point is found again in object space, where the parametric representation is worked out
+    // implimentation at (pg. 102) of pbrt 2nd ed.
+    void getDifferentialGeometry(const Ray& ray, const Hit& hit, DifferentialGeometry* dg) const override
+    {
+        const AffineTransform& o2w = *object_to_world;
+        DifferentialGeometry obj = objectGeometry( (*world_to_object)(ray(hit.t)), radius, phi_max, theta_min, theta_max );
+
+        // pbrt transforms dndu and dndv as normals, which is only right without scaling: the world space normal
+        // is the transformed one normalized, so its derivatives are scaled by the same 1 / length, and lose
+        // whatever part of them points along the normal (the in place normal transform doesn't normalize)
+        Normal n, dndu_n, dndv_n;
+        o2w(obj.nn, &n);
+        o2w(Normal(obj.dndu), &dndu_n);
+        o2w(Normal(obj.dndv), &dndv_n);
+        float invLength = 1.0f / n.length();
+        Vector nw = Vector(n) * invLength;
+        Vector dndu = Vector(dndu_n) * invLength;
+        Vector dndv = Vector(dndv_n) * invLength;
+
+        *dg = DifferentialGeometry(
+            o2w(obj.p), o2w(obj.dpdu), o2w(obj.dpdv),
+            dndu - nw * dot(nw, dndu), dndv - nw * dot(nw, dndv),
+            obj.u, obj.v, this
+        );
+        if(reverseOrientation ^ transformSwapsHandedness) dg->nn = -dg->nn;
+    }
+
+    // the geometry at p_hit on a sphere of radius centered at the origin, in object space, with shape left unset
+    // (u, v) = (phi / phi_max, (theta - theta_min) / (theta_max - theta_min))
+    static DifferentialGeometry objectGeometry(Point p_hit, float radius, float phi_max, float theta_min, float theta_max)
+    {
+        // the poles have no phi, nudge them off the z axis
+        if(p_hit.x == 0.0f && p_hit.y == 0.0f) p_hit.x = 1e-5f * radius;
+
+        float phi = atan2f(p_hit.y, p_hit.x);
+        if(phi < 0.0f) phi += rt::TWOPI;
+        float u = phi / phi_max;
+        float theta = acosf( rt::clamp(p_hit.z / radius, -1.0f, 1.0f) );
+        float v = (theta - theta_min) / (theta_max - theta_min);
+
+        // the partial derivatives of the point
+        float invzradius = 1.0f / sqrtf(p_hit.x*p_hit.x + p_hit.y*p_hit.y);
+        float cosphi = p_hit.x * invzradius, sinphi = p_hit.y * invzradius;
+        float dtheta = theta_max - theta_min;
+        Vector dpdu(-phi_max * p_hit.y, phi_max * p_hit.x, 0.0f);
+        Vector dpdv = Vector(p_hit.z * cosphi, p_hit.z * sinphi, -radius * sinf(theta)) * dtheta;
+
+        // and of the normal, by the Weingarten equations @ (pg. 103)
+        Vector d2Pduu = Vector(p_hit.x, p_hit.y, 0.0f) * (-phi_max * phi_max);
+        Vector d2Pduv = Vector(-sinphi, cosphi, 0.0f) * (dtheta * p_hit.z * phi_max);
+        Vector d2Pdvv = Vector(p_hit.x, p_hit.y, p_hit.z) * (-dtheta * dtheta);
+        float E = dot(dpdu, dpdu), F = dot(dpdu, dpdv), G = dot(dpdv, dpdv);
+        Vector N = normalize( cross(dpdu, dpdv) );
+        float e = dot(N, d2Pduu), f = dot(N, d2Pduv), g = dot(N, d2Pdvv);
+        float invEGF2 = 1.0f / (E*G - F*F);
+        Vector dndu = dpdu * ((f*F - e*G) * invEGF2) + dpdv * ((e*F - f*E) * invEGF2);
+        Vector dndv = dpdu * ((g*F - f*G) * invEGF2) + dpdv * ((f*F - g*E) * invEGF2);
+
+        return DifferentialGeometry(p_hit, dpdu, dpdv, dndu, dndv, u, v, nullptr);
+    }
+
+    Maskx<4> intersectPacket(const RayPacket<4>& rays, const Maskx<4>& active, Floatx<4>* t_hit, Hit* hits = nullptr) const override
+    {
+        return recordHits( intersectPacketSIMD(rays, active, t_hit), *t_hit, hits );
+    }
+    Maskx<8> intersectPacket(const RayPacket<8>& rays, const Maskx<8>& active, Floatx<8>* t_hit, Hit* hits = nullptr) const override
+    {
+        return recordHits( intersectPacketSIMD(rays, active, t_hit), *t_hit, hits );
+    }
+    Maskx<16> intersectPacket(const RayPacket<16>& rays, const Maskx<16>& active, Floatx<16>* t_hit, Hit* hits = nullptr) const override
+    {
+        return recordHits( intersectPacketSIMD(rays, active, t_hit), *t_hit, hits );
+    }
+
+private:
+    /* PRIVATE METHODS */
+    // the distance to the closest hit in [ray.t_min, ray.t_max], if there's one
     // implimentation at (pg. 99) of pbrt 2nd ed.
-    bool intersect(const Ray& ray, float* t_hit, DifferentialGeometry* dg) const override
+    bool hitDistance(const Ray& ray, float* t_hit) const
     {
+        if(worldSpace) return hitDistanceWorld(ray, t_hit);
+
         // transform ray into object space
         Ray r_objspc;
-        world_to_object(ray, &r_objspc);
+        (*world_to_object)(ray, &r_objspc);
 
         // compute quadratic sphere coefficients 
-        float A = r_objspc.d.length();
+        float A = dot(r_objspc.d, r_objspc.d);
         float B = 2 * (r_objspc.d.x*r_objspc.o.x + r_objspc.d.y*r_objspc.o.y + r_objspc.d.z*r_objspc.o.z);
         float C = (r_objspc.o.x*r_objspc.o.x + r_objspc.o.y*r_objspc.o.y + r_objspc.o.z*r_objspc.o.z) - radius*radius;
 
@@ -89,40 +222,158 @@ public:
             if(p_hit.z < z_min || p_hit.z > z_max || phi > phi_max) return false;
         }
 
-        // TODO: get parametric representation and update differentialgeometry
-        // these implimentations start at (pg. 102) in pbrt 2nd ed.
-
-        // update t_hit for quadratic intersection
         *t_hit = thit;
-
         return true;
     }
-    
-    // this does not follow the pbrt implementation, but should still work 
-    bool doesIntersect(const Ray& ray) const override
+
+    // hitDistance() for a worldSpace sphere
+    // the quadratic is solved from the point on the ray closest to the center (Haines et al., "Precision
+    // Improvements for Ray/Sphere Intersection"), which stays accurate for small spheres far from the ray's
+    // origin, where B^2 - 4AC cancels away
+    bool hitDistanceWorld(const Ray& ray, float* t_hit) const
     {
-        Ray r = world_to_object(ray);
+        Vector oc = ray.o - center;
+        float invA = 1.0f / dot(ray.d, ray.d);
+        float tc = -dot(oc, ray.d) * invA;
+        Vector l = oc + ray.d * tc;
+        float h2 = worldRadius*worldRadius - dot(l, l);
+        if(h2 < 0.0f) return false;
 
-        float A = dot(r.d, r.d);
-        float B = 2.0f * (r.d.x*r.o.x + r.d.y*r.o.y + r.d.y*r.o.y);
-        float C = (r.o.x*r.o.x + r.o.y*r.o.y + r.o.z*r.o.z) - radius * radius;
-        
-        float t0, t1;
-        if( !rt::solveQuadratic(A, B, C, &t0, &t1) ) return false;
-        
+        float s = sqrtf(h2 * invA);
+        float t0 = tc - s, t1 = tc + s;
+
+        // compute intersection distance along ray
         if(t0 > ray.t_max || t1 < ray.t_min) return false;
-        
+
         float thit = t0;
-        if(thit < ray.t_min)
+        if(t0 < ray.t_min)
         {
             thit = t1;
             if(thit > ray.t_max) return false;
         }
-        
-        // TODO: either follow pbrt implementation or handle partial spheres correctly here
-        
+
+        *t_hit = thit;
         return true;
     }
+
+    // fills in hits (if given) for the lanes of hit, as intersect() does
+    template<int N>
+    Maskx<N> recordHits(const Maskx<N>& hit, const Floatx<N>& t_hit, Hit* hits) const
+    {
+        if(hits)
+            for(uint32_t lanes = hit.bits(); lanes; lanes &= lanes - 1)
+            {
+                int i = lowestLane(lanes);
+                hits[i] = Hit();
+                hits[i].t = t_hit[i];
+                hits[i].shape = this;
+            }
+
+        return hit;
+    }
+
+    // hitDistanceWorld() on every lane, with the same arithmetic in the same order
+    template<int N>
+    Maskx<N> intersectPacketWorld(const RayPacket<N>& rays, const Maskx<N>& active, Floatx<N>* t_hit) const
+    {
+        STAT_ADD(nSphereTests, laneCount(active.bits()));
+        const Vec3x<N>& d = rays.d;
+        Vec3x<N> oc = rays.o - Vec3x<N>(center);
+        Floatx<N> invA = Floatx<N>(1.0f) / (d.x*d.x + d.y*d.y + d.z*d.z);
+        Floatx<N> tc = -(oc.x*d.x + oc.y*d.y + oc.z*d.z) * invA;
+        Vec3x<N> l( oc.x + d.x*tc, oc.y + d.y*tc, oc.z + d.z*tc );
+        Floatx<N> h2 = Floatx<N>(worldRadius*worldRadius) - (l.x*l.x + l.y*l.y + l.z*l.z);
+        Maskx<N> hit = active & ~(h2 < Floatx<N>(0.0f));
+        if( none(hit) ) return hit;
+
+        Floatx<N> s = sqrt(h2 * invA);
+        Floatx<N> t0 = tc - s, t1 = tc + s;
+
+        // the closest t in [t_min, t_max]
+        hit = hit & ~( (t0 > rays.t_max) | (t1 < rays.t_min) );
+        Maskx<N> far = t0 < rays.t_min;
+        hit = hit & ~( far & (t1 > rays.t_max) );
+
+        *t_hit = select(hit, select(far, t1, t0), *t_hit);
+        STAT_ADD(nSphereHits, laneCount(hit.bits()));
+
+        return hit;
+    }
+
+    // intersect() on every lane at once, with the same arithmetic in the same order, so every lane gets
+    // exactly the answer intersect() would give
+    // the clipping test needs atan2, so the rare lanes whose hit lies outside [z_min, z_max] (and every lane,
+    // for a sphere cut by phi_max) are finished by intersect() instead
+    template<int N>
+    Maskx<N> intersectPacketSIMD(const RayPacket<N>& rays, const Maskx<N>& active, Floatx<N>* t_hit) const
+    {
+        if(worldSpace) return intersectPacketWorld(rays, active, t_hit);
+
+        // transform the rays into object space
+        const float (*m)[4] = world_to_object->m;
+        const Vec3x<N>& o = rays.o;
+        const Vec3x<N>& d = rays.d;
+        Vec3x<N> oo(
+            Floatx<N>(m[0][0])*o.x + Floatx<N>(m[0][1])*o.y + Floatx<N>(m[0][2])*o.z + Floatx<N>(m[0][3]),
+            Floatx<N>(m[1][0])*o.x + Floatx<N>(m[1][1])*o.y + Floatx<N>(m[1][2])*o.z + Floatx<N>(m[1][3]),
+            Floatx<N>(m[2][0])*o.x + Floatx<N>(m[2][1])*o.y + Floatx<N>(m[2][2])*o.z + Floatx<N>(m[2][3])
+        );
+        Vec3x<N> od(
+            Floatx<N>(m[0][0])*d.x + Floatx<N>(m[0][1])*d.y + Floatx<N>(m[0][2])*d.z,
+            Floatx<N>(m[1][0])*d.x + Floatx<N>(m[1][1])*d.y + Floatx<N>(m[1][2])*d.z,
+            Floatx<N>(m[2][0])*d.x + Floatx<N>(m[2][1])*d.y + Floatx<N>(m[2][2])*d.z
+        );
+
+        // quadratic coefficients, as in intersect()
+        Floatx<N> A = od.x*od.x + od.y*od.y + od.z*od.z;
+        Floatx<N> B = Floatx<N>(2.0f) * (od.x*oo.x + od.y*oo.y + od.z*oo.z);
+        Floatx<N> C = (oo.x*oo.x + oo.y*oo.y + oo.z*oo.z) - Floatx<N>(radius*radius);
+
+        // rt::solveQuadratic()
+        Floatx<N> discriminant = B*B - Floatx<N>(4.0f) * A * C;
+        Maskx<N> hit = active & ~(discriminant < Floatx<N>(0.0f));
+        if( none(hit) )
+        {
+            STAT_ADD(nSphereTests, laneCount(active.bits()));
+            return hit;
+        }
+        Floatx<N> discriminant_sqrt = sqrt(discriminant);
+        Floatx<N> q = Floatx<N>(-0.5f) * select(B < Floatx<N>(0.0f), B - discriminant_sqrt, B + discriminant_sqrt);
+        Floatx<N> q0 = q / A, q1 = C / q;
+        Maskx<N> swap = q0 > q1;
+        Floatx<N> t0 = select(swap, q1, q0), t1 = select(swap, q0, q1);
+
+        // the closest t in [t_min, t_max]
+        hit = hit & ~( (t0 > rays.t_max) | (t1 < rays.t_min) );
+        Maskx<N> far = t0 < rays.t_min;
+        hit = hit & ~( far & (t1 > rays.t_max) );
+        Floatx<N> thit = select(far, t1, t0);
+
+        // lanes that may be clipped go through intersect()
+        Floatx<N> z = oo.z + od.z * thit;
+        Maskx<N> clipped = (z < Floatx<N>(z_min)) | (z > Floatx<N>(z_max));
+        if(phi_max < rt::TWOPI) clipped = Maskx<N>(true);
+        clipped = clipped & hit;
+        hit = hit & ~clipped;
+
+        *t_hit = select(hit, thit, *t_hit);
+        // intersect() counts the clipped lanes itself
+        STAT_ADD(nSphereTests, laneCount(active.bits() & ~clipped.bits()));
+        STAT_ADD(nSphereHits, laneCount(hit.bits()));
+
+        for(uint32_t lanes = clipped.bits(); lanes; lanes &= lanes - 1)
+        {
+            int i = lowestLane(lanes);
+            Hit h;
+            if( intersect(rays.ray(i), &h) )
+            {
+                (*t_hit)[i] = h.t;
+                hit = hit | Maskx<N>::fromBits(1u << i);
+            }
+        }
+
+        return hit;
+    }
 };
 
 #endif // SPHERE_H
\ No newline at end of file
@@ -0,0 +1,311 @@
+#include <stdio.h>
+
+#include "Sphere.h"
+#include "SphereSoup.h"
+#include "Stats.h"
+#include "Trace.h"
+
+STAT_RATIO("Intersections/Sphere soup leaf hits per test", nSoupLeafHits, nSoupLeafTests);
+
+typedef Floatx<SphereSoup::LEAF_WIDTH> BlockFloats;
+typedef Maskx<SphereSoup::LEAF_WIDTH> BlockMask;
+
+// a ray in every lane of a block
+struct BlockRay
+{
+    BlockFloats ox, oy, oz;
+    BlockFloats dx, dy, dz;
+    BlockFloats invA; // 1 / dot(d, d)
+
+    BlockRay(const Point& o, const Vector& d) :
+        ox(o.x), oy(o.y), oz(o.z),
+        dx(d.x), dy(d.y), dz(d.z),
+        invA( 1.0f / dot(d, d) )
+    {}
+};
+
+// tests ray against the first count spheres of block, for hits in (t_min, t_max)
+// returns the lane of the closest one and its distance in *t_hit, or -1 if there's none
+static inline int intersectBlock(const SphereSoup::Block& block, int count, const BlockRay& ray, float t_min, float t_max, float* t_hit)
+{
+    // closest point on the line to each center, and how far the ray is inside the sphere there
+    // (Haines et al., "Precision Improvements for Ray/Sphere Intersection"), which stays accurate for small
+    // spheres far from the ray's origin, where b^2 - ac would cancel away
+    BlockFloats ocx = ray.ox - BlockFloats::load(block.x);
+    BlockFloats ocy = ray.oy - BlockFloats::load(block.y);
+    BlockFloats ocz = ray.oz - BlockFloats::load(block.z);
+    BlockFloats r = BlockFloats::load(block.r);
+    BlockFloats tc = -(ocx*ray.dx + ocy*ray.dy + ocz*ray.dz) * ray.invA;
+    BlockFloats lx = ocx + tc*ray.dx, ly = ocy + tc*ray.dy, lz = ocz + tc*ray.dz;
+    BlockFloats h2 = r*r - (lx*lx + ly*ly + lz*lz);
+
+    BlockMask lanes = BlockMask::fromBits( (1u << count) - 1 ) & (h2 >= BlockFloats(0.0f));
+    if( none(lanes) ) return -1;
+
+    BlockFloats s = sqrt( max(h2, BlockFloats(0.0f)) * ray.invA );
+    BlockFloats t0 = tc - s, t1 = tc + s;
+
+    // the near root unless the ray starts inside the sphere
+    BlockFloats t = select(t0 > BlockFloats(t_min), t0, t1);
+    lanes &= (t > BlockFloats(t_min)) & (t < BlockFloats(t_max));
+    if( none(lanes) ) return -1;
+
+    *t_hit = hmin( select(lanes, t, BlockFloats(INFINITY)) );
+
+    return lowestLane( (lanes & (t == BlockFloats(*t_hit))).bits() );
+}
+
+/* CONSTRUCTORS */
+SphereSoup::SphereSoup(const std::vector<Point>& centers, const std::vector<float>& radii) :
+    Shape( Transform() ),
+    count( centers.size() )
+{
+    if(radii.size() != centers.size())
+    {
+        printf("[SphereSoup] given %zu centers but %zu radii, leaving the soup empty\n", centers.size(), radii.size());
+        count = 0;
+        return;
+    }
+    if(centers.empty()) return;
+    TRACE_SCOPE_ARG("build", "SphereSoup build", centers.size());
+
+    std::vector<BVH::PrimitiveInfo> info(centers.size());
+    for(size_t i = 0; i < centers.size(); i++)
+    {
+        Vector r(radii[i], radii[i], radii[i]);
+        info[i].index = (int)i;
+        info[i].bounds = Bbox(centers[i] - r, centers[i] + r);
+        info[i].centroid = centers[i];
+    }
+
+    // the leaves are tested a block at a time, so they're filled up to LEAF_WIDTH whenever possible
+    std::vector<BVH::LinearNode> tree;
+    std::vector<int> order = BVH::build(info, LEAF_WIDTH, tree, true);
+    tree.shrink_to_fit();
+
+    // copy the spheres into one block per leaf, in leaf order
+    size_t leaves = 0;
+    for(const BVH::LinearNode& node : tree)
+        leaves += node.nPrimitives > 0;
+    std::vector<Block> leafBlocks;
+    leafBlocks.reserve(leaves);
+    for(BVH::LinearNode& node : tree)
+    {
+        if(node.nPrimitives == 0) continue;
+
+        Block block = {};
+        for(int lane = 0; lane < node.nPrimitives; lane++)
+        {
+            int i = order[node.primitivesOffset + lane];
+            block.x[lane] = centers[i].x;
+            block.y[lane] = centers[i].y;
+            block.z[lane] = centers[i].z;
+            block.r[lane] = radii[i];
+        }
+        node.primitivesOffset = (int32_t)leafBlocks.size();
+        leafBlocks.push_back(block);
+    }
+    nodes = std::move(tree);
+    blocks = std::move(leafBlocks);
+}
+
+SphereSoup::SphereSoup(size_t count, Array<BVH::LinearNode> nodes, Array<Block> blocks) :
+    Shape( Transform() ),
+    nodes( std::move(nodes) ),
+    blocks( std::move(blocks) ),
+    count(count)
+{}
+
+/* PUBLIC METHODS */
+bool SphereSoup::intersect(const Ray& ray, Hit* hit) const
+{
+    float t_hit;
+    int block, lane;
+    if( !traverse(ray, false, &t_hit, &block, &lane) ) return false;
+
+    ray.t_max = t_hit;
+    hit->t = t_hit;
+    hit->u = hit->v = 0.0f;
+    hit->primitive = (uint32_t)(block * LEAF_WIDTH + lane);
+    hit->shape = this;
+
+    return true;
+}
+
+// the spheres are full spheres parametrized like Sphere's, around their own centers
+void SphereSoup::getDifferentialGeometry(const Ray& ray, const Hit& hit, DifferentialGeometry* dg) const
+{
+    const Block& b = blocks[hit.primitive / LEAF_WIDTH];
+    int lane = hit.primitive % LEAF_WIDTH;
+    Vector center(b.x[lane], b.y[lane], b.z[lane]);
+
+    Point p = ray(hit.t) - center;
+    *dg = Sphere::objectGeometry(p, b.r[lane], rt::TWOPI, rt::PI, 0.0f);
+    dg->p = dg->p + center;
+    dg->shape = this;
+    if(reverseOrientation) dg->nn = -dg->nn;
+}
+
+bool SphereSoup::doesIntersect(const Ray& ray) const
+{
+    float t_hit;
+    int block, lane;
+
+    return traverse(ray, true, &t_hit, &block, &lane);
+}
+
+/* PRIVATE METHODS */
+// the same traversal as BVH::intersect(), with every leaf's spheres tested in one go
+bool SphereSoup::traverse(const Ray& ray_in, bool anyHit, float* t_hit, int* hitBlock, int* hitLane) const
+{
+    if(nodes.empty()) return false;
+
+    // t_max shrinks as hits are found, without touching the caller's ray
+    Ray ray = ray_in;
+
+    Vector invDir(1.0f / ray.d.x, 1.0f / ray.d.y, 1.0f / ray.d.z);
+    int dirIsNeg[3] = { invDir.x < 0, invDir.y < 0, invDir.z < 0 };
+    BlockRay lanes(ray.o, ray.d);
+
+    bool hit = false;
+    int todo[BVH::MAX_DEPTH];
+    int todoOffset = 0;
+    int nodeNum = 0;
+    int leavesTested = 0, leavesHit = 0;
+    while(true)
+    {
+        const BVH::LinearNode& node = nodes[nodeNum];
+        if( BVH::intersectsP(node.bounds, ray, invDir, dirIsNeg) )
+        {
+            if(node.nPrimitives > 0)
+            {
+                leavesTested++;
+                float t;
+                int lane = intersectBlock(blocks[node.primitivesOffset], node.nPrimitives, lanes, ray.t_min, ray.t_max, &t);
+                if(lane >= 0)
+                {
+                    leavesHit++;
+                    hit = true;
+                    *t_hit = t;
+                    *hitBlock = node.primitivesOffset;
+                    *hitLane = lane;
+                    if(anyHit) break;
+                    ray.t_max = t;
+                }
+
+                if(todoOffset == 0) break;
+                nodeNum = todo[--todoOffset];
+            }
+            else
+            {
+                // visit the near child first, and push the far one
+                if(dirIsNeg[node.axis])
+                {
+                    todo[todoOffset++] = nodeNum + 1;
+                    nodeNum = node.secondChildOffset;
+                }
+                else
+                {
+                    todo[todoOffset++] = node.secondChildOffset;
+                    nodeNum = nodeNum + 1;
+                }
+            }
+        }
+        else
+        {
+            if(todoOffset == 0) break;
+            nodeNum = todo[--todoOffset];
+        }
+    }
+
+    STAT_ADD(nSoupLeafTests, leavesTested);
+    STAT_ADD(nSoupLeafHits, leavesHit);
+    (void)leavesTested; (void)leavesHit; // only read when statistics are compiled in
+
+    return hit;
+}
+
+// BVH::intersect(RayPacket&) over the soup's tree, leaves test one lane's ray against the whole block at a time
+template<int N>
+Maskx<N> SphereSoup::traversePacket(const RayPacket<N>& rays_in, const Maskx<N>& active, Floatx<N>* t_hit, Hit* hits) const
+{
+    Maskx<N> found;
+    if(nodes.empty() || none(active)) return found;
+
+    // the lanes' t_max shrink as hits are found, without touching the caller's packet
+    RayPacket<N> rays = rays_in;
+    Vec3x<N> invDir( Floatx<N>(1.0f) / rays.d.x, Floatx<N>(1.0f) / rays.d.y, Floatx<N>(1.0f) / rays.d.z );
+    Maskx<N> dirIsNeg[3] = { invDir.x < Floatx<N>(0.0f), invDir.y < Floatx<N>(0.0f), invDir.z < Floatx<N>(0.0f) };
+    int first = lowestLane(active.bits());
+    bool firstIsNeg[3] = { dirIsNeg[0][first], dirIsNeg[1][first], dirIsNeg[2][first] };
+
+    int todo[BVH::MAX_DEPTH];
+    int todoOffset = 0;
+    int nodeNum = 0;
+    int leavesTested = 0, leavesHit = 0;
+    while(true)
+    {
+        const BVH::LinearNode& node = nodes[nodeNum];
+        Maskx<N> lanes = active & BVH::intersectsP(node.bounds, rays, invDir, dirIsNeg);
+        if( any(lanes) )
+        {
+            if(node.nPrimitives > 0)
+            {
+                const Block& block = blocks[node.primitivesOffset];
+                for(uint32_t remaining = lanes.bits(); remaining; remaining &= remaining - 1)
+                {
+                    int i = lowestLane(remaining);
+                    leavesTested++;
+                    float t;
+                    int lane = intersectBlock(block, node.nPrimitives, BlockRay(rays.o.point(i), rays.d.vector(i)), rays.t_min[i], rays.t_max[i], &t);
+                    if(lane >= 0)
+                    {
+                        leavesHit++;
+                        (*t_hit)[i] = t;
+                        rays.t_max[i] = t;
+                        if(hits)
+                        {
+                            hits[i].t = t;
+                            hits[i].u = hits[i].v = 0.0f;
+                            hits[i].primitive = (uint32_t)(node.primitivesOffset * LEAF_WIDTH + lane);
+                            hits[i].shape = this;
+                        }
+                        found = found | Maskx<N>::fromBits(1u << i);
+                    }
+                }
+
+                if(todoOffset == 0) break;
+                nodeNum = todo[--todoOffset];
+            }
+            else
+            {
+                // visit the near child first, and push the far one
+                if(firstIsNeg[node.axis])
+                {
+                    todo[todoOffset++] = nodeNum + 1;
+                    nodeNum = node.secondChildOffset;
+                }
+                else
+                {
+                    todo[todoOffset++] = node.secondChildOffset;
+                    nodeNum = nodeNum + 1;
+                }
+            }
+        }
+        else
+        {
+            if(todoOffset == 0) break;
+            nodeNum = todo[--todoOffset];
+        }
+    }
+
+    STAT_ADD(nSoupLeafTests, leavesTested);
+    STAT_ADD(nSoupLeafHits, leavesHit);
+    (void)leavesTested; (void)leavesHit; // only read when statistics are compiled in
+
+    return found;
+}
+
+template Maskx<4> SphereSoup::traversePacket<4>(const RayPacket<4>& rays, const Maskx<4>& active, Floatx<4>* t_hit, Hit* hits) const;
+template Maskx<8> SphereSoup::traversePacket<8>(const RayPacket<8>& rays, const Maskx<8>& active, Floatx<8>* t_hit, Hit* hits) const;
+template Maskx<16> SphereSoup::traversePacket<16>(const RayPacket<16>& rays, const Maskx<16>& active, Floatx<16>* t_hit, Hit* hits) const;
@@ -0,0 +1,96 @@
+/*
+    SphereSoup is a Shape made of many plain spheres (a center and a radius each, in world space), for
+    particle-like scenes with millions of them
+
+    a Sphere is a heap object with a vtable, two transform pointers and clipping parameters, plus a
+    shared_ptr and a BVH leaf slot to reach it, a few hundred bytes a sphere once its transforms are counted
+    SphereSoup keeps just the centers and radii, in blocks of LEAF_WIDTH: every leaf of its own BVH owns one
+    block, stored as x[], y[], z[], r[] arrays, so a leaf is tested against a ray in a single SIMD pass
+    over all of its spheres
+    that comes to about 40 bytes a sphere, nodes included (vs. over 400 for a million separate Spheres)
+
+    the spheres are full spheres, with no clipping and no transforms of their own
+    a Hit's primitive is the sphere's slot in blocks (block * LEAF_WIDTH + lane)
+*/
+
+#ifndef SPHERE_SOUP_H
+#define SPHERE_SOUP_H
+
+#include <vector>
+
+#include "Array.h"
+#include "BVH.h"
+#include "Shape.h"
+
+class SphereSoup : public Shape
+{
+public:
+    /* PUBLIC MEMBERS */
+    // spheres per leaf: a whole leaf fits one packet register, 8 lanes with AVX and up, 4 with SSE
+    static constexpr int LEAF_WIDTH = PACKET_WIDTH >= 8 ? 8 : 4;
+
+    // one leaf's spheres, unused lanes past the leaf's count are zero
+    struct alignas(LEAF_WIDTH * sizeof(float)) Block
+    {
+        float x[LEAF_WIDTH], y[LEAF_WIDTH], z[LEAF_WIDTH];
+        float r[LEAF_WIDTH];
+    };
+
+    // both are borrowed when the soup came from a scene cache (see SceneCache.h)
+    Array<BVH::LinearNode> nodes; // a leaf's primitivesOffset is the index of its Block
+    Array<Block> blocks;
+
+    /* CONSTRUCTORS */
+    // sphere i is at centers[i] with radius radii[i], the soup is left empty if there aren't as many radii as centers
+    SphereSoup(const std::vector<Point>& centers, const std::vector<float>& radii);
+    // a soup of count spheres that's already built, from the nodes and blocks of another one
+    SphereSoup(size_t count, Array<BVH::LinearNode> nodes, Array<Block> blocks);
+
+    /* PUBLIC METHODS */
+    Bbox objectBound() const override
+    {
+        return nodes.empty() ? Bbox() : nodes[0].bounds;
+    }
+
+    bool intersect(const Ray& ray, Hit* hit) const override;
+    bool doesIntersect(const Ray& ray) const override;
+    void getDifferentialGeometry(const Ray& ray, const Hit& hit, DifferentialGeometry* dg) const override;
+
+    // the packet walks the tree together, and every lane that reaches a leaf tests its whole block
+    Maskx<4> intersectPacket(const RayPacket<4>& rays, const Maskx<4>& active, Floatx<4>* t_hit, Hit* hits = nullptr) const override
+    {
+        return traversePacket(rays, active, t_hit, hits);
+    }
+    Maskx<8> intersectPacket(const RayPacket<8>& rays, const Maskx<8>& active, Floatx<8>* t_hit, Hit* hits = nullptr) const override
+    {
+        return traversePacket(rays, active, t_hit, hits);
+    }
+    Maskx<16> intersectPacket(const RayPacket<16>& rays, const Maskx<16>& active, Floatx<16>* t_hit, Hit* hits = nullptr) const override
+    {
+        return traversePacket(rays, active, t_hit, hits);
+    }
+
+    // how many spheres there are, and the bytes they take up (blocks and nodes)
+    inline size_t size() const
+    {
+        return count;
+    }
+    inline size_t bytes() const
+    {
+        return blocks.size() * sizeof(Block) + nodes.size() * sizeof(BVH::LinearNode);
+    }
+
+private:
+    /* PRIVATE MEMBERS */
+    size_t count = 0;
+
+    /* PRIVATE METHODS */
+    // walks the tree with ray, returns true on the first hit if anyHit, otherwise on the closest
+    // (*t_hit, *block and *lane say where it is, ray itself is left alone)
+    bool traverse(const Ray& ray, bool anyHit, float* t_hit, int* block, int* lane) const;
+    // the closest hit of every active lane, which gets the same answer it would from traverse()
+    template<int N>
+    Maskx<N> traversePacket(const RayPacket<N>& rays, const Maskx<N>& active, Floatx<N>* t_hit, Hit* hits) const;
+};
+
+#endif // SPHERE_SOUP_H
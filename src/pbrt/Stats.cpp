@@ -0,0 +1,111 @@
+#include <mutex>
+#include <vector>
+
+#include "Stats.h"
+
+namespace stats
+{
+    // function local statics, so registration from other translation units' static initializers is safe
+    static std::vector<ReportFunction>& registry()
+    {
+        static std::vector<ReportFunction> functions;
+        return functions;
+    }
+    static std::mutex& mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+    static Accumulator& globalTotals()
+    {
+        static Accumulator accumulator;
+        return accumulator;
+    }
+
+    Registerer::Registerer(ReportFunction report)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        registry().push_back(report);
+    }
+
+    void reportThread()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        for(ReportFunction report : registry())
+            report(globalTotals());
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        globalTotals() = Accumulator();
+    }
+
+    Accumulator totals()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        return globalTotals();
+    }
+
+    // splits "Category/Description" into its two halves
+    static void splitTitle(const std::string& title, std::string* category, std::string* description)
+    {
+        size_t slash = title.find('/');
+        *category = (slash == std::string::npos) ? "" : title.substr(0, slash);
+        *description = (slash == std::string::npos) ? title : title.substr(slash + 1);
+    }
+
+    void print(FILE* f)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        const Accumulator& a = globalTotals();
+
+        // gather every line under its category, so each category prints together
+        std::map<std::string, std::vector<std::string>> lines;
+        char line[256];
+        std::string category, description;
+
+        for(const auto& c : a.counters)
+        {
+            if(c.second == 0) continue;
+            splitTitle(c.first, &category, &description);
+            snprintf(line, sizeof(line), "    %-42s %14lld", description.c_str(), (long long)c.second);
+            lines[category].push_back(line);
+        }
+        for(const auto& r : a.ratios)
+        {
+            if(r.second.second == 0) continue;
+            splitTitle(r.first, &category, &description);
+            snprintf(line, sizeof(line), "    %-42s %14lld / %lld (%.2f%%)", description.c_str(),
+                (long long)r.second.first, (long long)r.second.second, 100.0 * r.second.first / r.second.second);
+            lines[category].push_back(line);
+        }
+        for(const auto& d : a.distributions)
+        {
+            const Accumulator::Distribution& dist = d.second;
+            if(dist.count == 0) continue;
+            splitTitle(d.first, &category, &description);
+            snprintf(line, sizeof(line), "    %-42s %14.3f avg [%lld - %lld]", description.c_str(),
+                (double)dist.sum / dist.count, (long long)dist.min, (long long)dist.max);
+            lines[category].push_back(line);
+
+            // histogram, one row per non empty power of two bucket
+            for(int i = 0; i < Accumulator::N_BUCKETS; i++)
+            {
+                if(dist.buckets[i] == 0) continue;
+                long long lo = (i == 0) ? 0 : (1ll << (i - 1));
+                long long hi = (i == 0) ? 0 : (1ll << i) - 1;
+                snprintf(line, sizeof(line), "        [%6lld, %6lld] %10.2f%%", lo, hi, 100.0 * dist.buckets[i] / dist.count);
+                lines[category].push_back(line);
+            }
+        }
+
+        fprintf(f, "Statistics:\n");
+        for(const auto& group : lines)
+        {
+            fprintf(f, "  %s\n", group.first.c_str());
+            for(const std::string& l : group.second)
+                fprintf(f, "%s\n", l.c_str());
+        }
+    }
+} // stats
@@ -0,0 +1,158 @@
+/*
+    Stats.h defines per-thread statistics counters, modeled after pbrt-v3's STAT_COUNTER and friends
+
+    statistics are only compiled in when RT_STATS is defined (cmake -DRT_ENABLE_STATS=ON)
+    otherwise every macro below expands to nothing, so instrumented code costs nothing
+
+    declaring statistics (at namespace scope, titles are "Category/Description"):
+        STAT_COUNTER("Camera/Rays generated", nCameraRays);
+        STAT_RATIO("Intersections/Sphere hits per test", nSphereHits, nSphereTests); // declares both counters
+        STAT_INT_DISTRIBUTION("BVH/Nodes visited per ray", nodesPerRay);
+
+    updating them:
+        STAT_INC(nCameraRays);
+        STAT_ADD(nSphereTests, n);
+        STAT_REPORT_VALUE(nodesPerRay, visited);
+
+    every thread updates its own thread_local copy with no synchronization
+    when a thread is done (e.g. at the end of a render), it calls stats::reportThread() to fold its
+    values into the global totals, which stats::print() then writes out
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+
+namespace stats
+{
+    // accumulated values of every statistic, merged over threads
+    class Accumulator
+    {
+    public:
+        /* PUBLIC MEMBERS */
+        static constexpr int N_BUCKETS = 32; // distribution buckets are powers of two: [0], [1], [2, 3], [4, 7], ...
+
+        struct Distribution
+        {
+            int64_t count = 0, sum = 0;
+            int64_t min = INT64_MAX, max = INT64_MIN;
+            int64_t buckets[N_BUCKETS] = {};
+        };
+
+        std::map<std::string, int64_t> counters;
+        std::map<std::string, std::pair<int64_t, int64_t>> ratios; // numerator, denominator
+        std::map<std::string, Distribution> distributions;
+
+        /* PUBLIC METHODS */
+        void reportCounter(const char* title, int64_t value)
+        {
+            counters[title] += value;
+        }
+        void reportRatio(const char* title, int64_t numerator, int64_t denominator)
+        {
+            ratios[title].first += numerator;
+            ratios[title].second += denominator;
+        }
+        void reportDistribution(const char* title, const Distribution& d)
+        {
+            Distribution& total = distributions[title];
+            total.count += d.count;
+            total.sum += d.sum;
+            if(d.min < total.min) total.min = d.min;
+            if(d.max > total.max) total.max = d.max;
+            for(int i = 0; i < N_BUCKETS; i++)
+                total.buckets[i] += d.buckets[i];
+        }
+    };
+
+    // bucket index of a value: 0 for v <= 0, otherwise 1 + floor(log2(v)), clamped to the last bucket
+    inline int distributionBucket(int64_t v)
+    {
+        if(v <= 0) return 0;
+
+        int bucket = 1;
+        while(v > 1 && bucket < Accumulator::N_BUCKETS - 1)
+        {
+            v >>= 1;
+            bucket++;
+        }
+
+        return bucket;
+    }
+
+    inline void record(Accumulator::Distribution& d, int64_t v)
+    {
+        d.count++;
+        d.sum += v;
+        if(v < d.min) d.min = v;
+        if(v > d.max) d.max = v;
+        d.buckets[distributionBucket(v)]++;
+    }
+
+    typedef void (*ReportFunction)(Accumulator&);
+
+    // registers a statistic's report function, declaring a Registerer is all the macros need to do
+    struct Registerer
+    {
+        Registerer(ReportFunction report);
+    };
+
+    // folds the calling thread's statistics into the global totals and resets them
+    void reportThread();
+    // prints the global totals (grouped by category) to f
+    void print(FILE* f);
+    // clears the global totals
+    void clear();
+    // a copy of the global totals, as print() would write them
+    Accumulator totals();
+    // true if statistics were compiled in
+    constexpr bool enabled()
+    {
+#ifdef RT_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+} // stats
+
+#ifdef RT_STATS
+
+#define STAT_COUNTER(title, var) \
+    inline thread_local int64_t var = 0; \
+    inline void var##_report(stats::Accumulator& accum) { accum.reportCounter(title, var); var = 0; } \
+    inline stats::Registerer var##_registerer(var##_report)
+
+#define STAT_RATIO(title, numVar, denomVar) \
+    inline thread_local int64_t numVar = 0; \
+    inline thread_local int64_t denomVar = 0; \
+    inline void numVar##_report(stats::Accumulator& accum) { accum.reportRatio(title, numVar, denomVar); numVar = denomVar = 0; } \
+    inline stats::Registerer numVar##_registerer(numVar##_report)
+
+#define STAT_INT_DISTRIBUTION(title, var) \
+    inline thread_local stats::Accumulator::Distribution var; \
+    inline void var##_report(stats::Accumulator& accum) { accum.reportDistribution(title, var); var = stats::Accumulator::Distribution(); } \
+    inline stats::Registerer var##_registerer(var##_report)
+
+#define STAT_INC(var) (++(var))
+#define STAT_ADD(var, n) ((var) += (n))
+#define STAT_REPORT_VALUE(var, value) stats::record(var, value)
+
+#else
+
+// these expand to a no-op declaration/statement, so the trailing semicolons are still valid
+#define STAT_COUNTER(title, var) static_assert(true, "")
+#define STAT_RATIO(title, numVar, denomVar) static_assert(true, "")
+#define STAT_INT_DISTRIBUTION(title, var) static_assert(true, "")
+#define STAT_INC(var) ((void)0)
+#define STAT_ADD(var, n) ((void)0)
+#define STAT_REPORT_VALUE(var, value) ((void)0)
+
+#endif // RT_STATS
+
+#endif // STATS_H
@@ -0,0 +1,159 @@
+#include <stdio.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Trace.h"
+
+namespace trace
+{
+    static constexpr uint64_t CAPACITY = 1 << 14; // events per ring buffer, a power of two
+
+    // one thread's events, only that thread writes to it while recording
+    struct Buffer
+    {
+        int id; // the "thread" row it shows up as in the viewer
+        std::vector<Event> events;
+        std::atomic<uint64_t> head { 0 }; // total events ever recorded, the next one goes at head % CAPACITY
+
+        Buffer(int id) :
+            id(id),
+            events(CAPACITY)
+        {}
+    };
+
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    // function local statics, so they exist before any thread can record
+    static std::mutex& mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+    static std::vector<std::unique_ptr<Buffer>>& buffers()
+    {
+        static std::vector<std::unique_ptr<Buffer>> all;
+        return all;
+    }
+    static std::vector<Buffer*>& freeBuffers()
+    {
+        static std::vector<Buffer*> unused;
+        return unused;
+    }
+
+    // render threads are short lived (one set per render), so when a thread exits its buffer is handed to
+    // the next thread that records, instead of every render adding a new buffer (and row in the viewer)
+    struct ThreadBuffer
+    {
+        Buffer* buffer = nullptr;
+
+        ~ThreadBuffer()
+        {
+            if(!buffer) return;
+
+            std::lock_guard<std::mutex> lock(mutex());
+            freeBuffers().push_back(buffer);
+        }
+    };
+    static thread_local ThreadBuffer current;
+
+    static Buffer* acquireBuffer()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        if( !freeBuffers().empty() )
+        {
+            Buffer* b = freeBuffers().back();
+            freeBuffers().pop_back();
+            return b;
+        }
+
+        buffers().push_back( std::make_unique<Buffer>((int)buffers().size()) );
+        return buffers().back().get();
+    }
+
+    void start()
+    {
+        recording.store(true, std::memory_order_relaxed);
+    }
+
+    void stop()
+    {
+        recording.store(false, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        for(const std::unique_ptr<Buffer>& b : buffers())
+            b->head.store(0, std::memory_order_relaxed);
+    }
+
+    int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void record(const Event& event)
+    {
+        Buffer* b = current.buffer;
+        if(!b) b = current.buffer = acquireBuffer();
+
+        uint64_t h = b->head.load(std::memory_order_relaxed);
+        b->events[h & (CAPACITY - 1)] = event;
+        b->head.store(h + 1, std::memory_order_release);
+    }
+
+    // writes s to f as a JSON string literal
+    static void writeString(FILE* f, const char* s)
+    {
+        fputc('"', f);
+        for(; *s; s++)
+        {
+            if(*s == '"' || *s == '\\') fputc('\\', f);
+            fputc(*s, f);
+        }
+        fputc('"', f);
+    }
+
+    bool write(const char* path)
+    {
+        FILE* f = fopen(path, "w");
+        if(!f) return false;
+
+        std::lock_guard<std::mutex> lock(mutex());
+
+        // complete ("X") events with timestamps in microseconds, see the Trace Event Format spec
+        fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for(const std::unique_ptr<Buffer>& b : buffers())
+        {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", b->id, b->id);
+            first = false;
+
+            uint64_t head = b->head.load(std::memory_order_acquire);
+            uint64_t begin = (head > CAPACITY) ? head - CAPACITY : 0;
+            if(begin > 0)
+                printf("[trace] thread %d overflowed its buffer, its oldest %llu events were dropped\n", b->id, (unsigned long long)begin);
+
+            for(uint64_t i = begin; i < head; i++)
+            {
+                const Event& e = b->events[i & (CAPACITY - 1)];
+                fprintf(f, ",\n{\"name\":");
+                writeString(f, e.name);
+                fprintf(f, ",\"cat\":");
+                writeString(f, e.category);
+                fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    b->id, e.begin * 1e-3, (e.end - e.begin) * 1e-3);
+                if(e.hasArg) fprintf(f, ",\"args\":{\"arg\":%lld}", (long long)e.arg);
+                fputc('}', f);
+            }
+        }
+        fprintf(f, "\n]}\n");
+
+        fclose(f);
+        return true;
+    }
+} // trace
@@ -3,8 +3,15 @@
     it holds both the matrix of the given transformation as well as its inverse (to transform back)
     
     Transform can transform Points, Vectors, Normals, Rays, and Bboxes
+    for transformations without a projection, AffineTransform does the same with less work
     
     it supports translation, scaling, rotation, and lookAt matrix generation
+
+    both matrices are stored inline (2 x 64 bytes, 16 byte aligned), so composing, inverting and
+    copying Transforms never allocate, and applying one doesn't chase a pointer
+
+    translate, scale, orthographic, composition and applying to Points and Vectors are constexpr, so a fixed
+    setup like rtiow's camera folds into static data (the rotations and lookAt need sin/cos/sqrt, which aren't)
 */
 
 #ifndef TRANSFORM_H
@@ -16,64 +23,121 @@
 #include "Ray.h"
 #include "Bbox.h"
 
+struct SoA3;
+
 class Transform
 {
 public:
     /* PUBLIC MEMBERS */
-    std::shared_ptr<Mat4> m, m_inv;
+    Mat4 m, m_inv;
     
     /* CONSTRUCTORS */
-    Transform();
-    Transform(const std::shared_ptr<Mat4> matrix);
+    constexpr Transform() {} // identity
+    Transform(const Mat4& matrix);
+    constexpr Transform(const Mat4& matrix, const Mat4& matrix_inverse) :
+        m(matrix),
+        m_inv(matrix_inverse)
+    {}
+    Transform(const std::shared_ptr<Mat4> matrix); // the matrices are copied in
     Transform(const std::shared_ptr<Mat4> matrix, const std::shared_ptr<Mat4> matrix_inverse);
     Transform(float matrix[4][4]);
     
     /* PUBLIC METHODS */
     // returns true if the transformation causes the resulting matrix to swap handedness
     bool swapsHandedness() const;
+    // returns true if the bottom row of the matrix is (0, 0, 0, 1), i.e. there is no projection
+    constexpr bool isAffine() const
+    {
+        return m.m[3][0] == 0.0f && m.m[3][1] == 0.0f && m.m[3][2] == 0.0f && m.m[3][3] == 1.0f;
+    }
     
-    inline Transform getInverse() const
+    constexpr Transform getInverse() const
     {
         return Transform(m_inv, m);
     }
     
-    static Transform translate(const Vector& delta);
-    static Transform scale(float x, float y, float z);
+    static constexpr Transform translate(const Vector& delta)
+    {
+        return Transform(
+            Mat4(1, 0, 0, delta.x,
+                 0, 1, 0, delta.y,
+                 0, 0, 1, delta.z,
+                 0, 0, 0, 1),
+            Mat4(1, 0, 0, -delta.x,
+                 0, 1, 0, -delta.y,
+                 0, 0, 1, -delta.z,
+                 0, 0, 0, 1)
+        );
+    }
+    static constexpr Transform scale(float x, float y, float z)
+    {
+        return Transform(
+            Mat4(x, 0, 0, 0,
+                 0, y, 0, 0,
+                 0, 0, z, 0,
+                 0, 0, 0, 1),
+            Mat4(1.0f / x, 0, 0, 0,
+                 0, 1.0f / y, 0, 0,
+                 0, 0, 1.0f / z, 0,
+                 0, 0, 0, 1)
+        );
+    }
     static Transform rotateX(float angle);
     static Transform rotateY(float angle);
     static Transform rotateZ(float angle);
     //Transform rotate(const Vector& axis, float angle); // implementation @ (pg. 74) of pbrt 2nd ed.
     static Transform lookAt(const Point& pos, const Point& lookingAt, const Vector& up);
-    static Transform orthographic(float clip_near, float clip_far);
+    // implementation @ (pg. 263) of pbrt 2nd ed.
+    static constexpr Transform orthographic(float clip_near, float clip_far)
+    {
+        // this was the supposed implementation
+        // TODO: check correct implementation
+        /*
+        return Transform::scale( 1.0f, 1.0f, 1.0f / (clip_far - clip_near) ) *
+            Transform::translate( Vector(0.0f, 0.0f, -clip_near) );
+        */
+        // chatgpt code
+
+        float mid = 0.5f*(clip_near + clip_far);
+        float scaleZ = 2.0f/(clip_far - clip_near);
+        return Transform::scale(1,1, scaleZ)
+             * Transform::translate(Vector(0,0, -mid));
+    }
+
+    /* BATCH METHODS */
+    // these transform n elements at once, stored as SoA3 arrays (see SoA.h), 4 at a time with SSE
+    // out may be the same arrays as in; affine matrices take AffineTransform's path, without the divide
+    void transformPoints(const SoA3& in, const SoA3& out, size_t n) const;
+    void transformVectors(const SoA3& in, const SoA3& out, size_t n) const;
+    void transformNormals(const SoA3& in, const SoA3& out, size_t n) const; // normalized, like operator()(const Normal&)
+    // origins as points and directions as vectors, t_min/t_max/t don't change so they aren't passed
+    void transformRays(const SoA3& o, const SoA3& d, const SoA3& o_out, const SoA3& d_out, size_t n) const;
     
     /* INLINE OPERATOR OVERLOADS */
-    inline Transform operator*(const Transform& t2) const // transform composition (multiplication)
+    constexpr Transform operator*(const Transform& t2) const // transform composition (multiplication)
     {
-        std::shared_ptr<Mat4> m1 = Mat4::multiply(m, t2.m);
-        std::shared_ptr<Mat4> m2 = Mat4::multiply(t2.m_inv, m_inv);
-        
-        return Transform(m1, m2);
+        return Transform( Mat4::multiply(m, t2.m), Mat4::multiply(t2.m_inv, m_inv) );
     }
 
-    inline Point operator()(const Point& p) const // transforming a point
+    constexpr Point operator()(const Point& p) const // transforming a point
     {
         float x = p.x, y = p.y, z = p.z;
-        float xp = m->m[0][0]*x + m->m[0][1]*y + m->m[0][2]*z + m->m[0][3];
-        float yp = m->m[1][0]*x + m->m[1][1]*y + m->m[1][2]*z + m->m[1][3];
-        float zp = m->m[2][0]*x + m->m[2][1]*y + m->m[2][2]*z + m->m[2][3];
-        float wp = m->m[3][0]*x + m->m[3][1]*y + m->m[3][2]*z + m->m[3][3];
+        float xp = m.m[0][0]*x + m.m[0][1]*y + m.m[0][2]*z + m.m[0][3];
+        float yp = m.m[1][0]*x + m.m[1][1]*y + m.m[1][2]*z + m.m[1][3];
+        float zp = m.m[2][0]*x + m.m[2][1]*y + m.m[2][2]*z + m.m[2][3];
+        float wp = m.m[3][0]*x + m.m[3][1]*y + m.m[3][2]*z + m.m[3][3];
         
         assert(wp != 0);
         if(wp == 1.0) return Point(xp, yp, zp);
         else          return Point(xp/wp, yp/wp, zp/wp);
     }
     // recheck that this matches pbrt, bc it doesnt
-    inline void operator()(const Point& p, Point* p_transformed) const // transforming a point in place
+    constexpr void operator()(const Point& p, Point* p_transformed) const // transforming a point in place
     {
-        p_transformed->x = m->m[0][0]*p.x + m->m[0][1]*p.y + m->m[0][2]*p.z + m->m[0][3];
-        p_transformed->y = m->m[1][0]*p.x + m->m[1][1]*p.y + m->m[1][2]*p.z + m->m[1][3];
-        p_transformed->z = m->m[2][0]*p.x + m->m[2][1]*p.y + m->m[2][2]*p.z + m->m[2][3];
-        float w = m->m[3][0]*p.x + m->m[3][1]*p.y + m->m[3][2]*p.z + m->m[3][3];
+        p_transformed->x = m.m[0][0]*p.x + m.m[0][1]*p.y + m.m[0][2]*p.z + m.m[0][3];
+        p_transformed->y = m.m[1][0]*p.x + m.m[1][1]*p.y + m.m[1][2]*p.z + m.m[1][3];
+        p_transformed->z = m.m[2][0]*p.x + m.m[2][1]*p.y + m.m[2][2]*p.z + m.m[2][3];
+        float w = m.m[3][0]*p.x + m.m[3][1]*p.y + m.m[3][2]*p.z + m.m[3][3];
         
         if(w != 1.0f)
         {
@@ -84,37 +148,37 @@ public:
     }
     
     // w = 0
-    inline Vector operator()(const Vector& v) const // transforming a vector 
+    constexpr Vector operator()(const Vector& v) const // transforming a vector 
     {
         return Vector(
-            m->m[0][0]*v.x + m->m[0][1]*v.y + m->m[0][2]*v.z,
-            m->m[1][0]*v.x + m->m[1][1]*v.y + m->m[1][2]*v.z,
-            m->m[2][0]*v.x + m->m[2][1]*v.y + m->m[2][2]*v.z
+            m.m[0][0]*v.x + m.m[0][1]*v.y + m.m[0][2]*v.z,
+            m.m[1][0]*v.x + m.m[1][1]*v.y + m.m[1][2]*v.z,
+            m.m[2][0]*v.x + m.m[2][1]*v.y + m.m[2][2]*v.z
         );
     }
-    inline void operator()(const Vector& v, Vector* v_transformed) const // transforming a vector in place 
+    constexpr void operator()(const Vector& v, Vector* v_transformed) const // transforming a vector in place 
     {
-        v_transformed->x = m->m[0][0]*v.x + m->m[0][1]*v.y + m->m[0][2]*v.z;
-        v_transformed->y = m->m[1][0]*v.x + m->m[1][1]*v.y + m->m[1][2]*v.z;
-        v_transformed->z = m->m[2][0]*v.x + m->m[2][1]*v.y + m->m[2][2]*v.z;
+        v_transformed->x = m.m[0][0]*v.x + m.m[0][1]*v.y + m.m[0][2]*v.z;
+        v_transformed->y = m.m[1][0]*v.x + m.m[1][1]*v.y + m.m[1][2]*v.z;
+        v_transformed->z = m.m[2][0]*v.x + m.m[2][1]*v.y + m.m[2][2]*v.z;
     }
     
     // this might not need to be normalized
     inline Normal operator()(const Normal& n) const // transforming a normal
     {
         return normalize( Normal(
-            m_inv->m[0][0]*n.x + m_inv->m[1][0]*n.y + m_inv->m[2][0]*n.z,
-            m_inv->m[0][1]*n.x + m_inv->m[1][1]*n.y + m_inv->m[2][1]*n.z,
-            m_inv->m[0][2]*n.x + m_inv->m[1][2]*n.y + m_inv->m[2][2]*n.z
+            m_inv.m[0][0]*n.x + m_inv.m[1][0]*n.y + m_inv.m[2][0]*n.z,
+            m_inv.m[0][1]*n.x + m_inv.m[1][1]*n.y + m_inv.m[2][1]*n.z,
+            m_inv.m[0][2]*n.x + m_inv.m[1][2]*n.y + m_inv.m[2][2]*n.z
         ) );
     }
     // this isnt being normalized
     // TODO: make these behave the same
     inline void operator()(const Normal &n, Normal* n_transformed) const // transforming a normal in place
     {
-        n_transformed->x = m_inv->m[0][0]*n.x + m_inv->m[1][0]*n.y + m_inv->m[2][0]*n.z;
-        n_transformed->y = m_inv->m[0][1]*n.x + m_inv->m[1][1]*n.y + m_inv->m[2][1]*n.z;
-        n_transformed->z = m_inv->m[0][2]*n.x + m_inv->m[1][2]*n.y + m_inv->m[2][2]*n.z;
+        n_transformed->x = m_inv.m[0][0]*n.x + m_inv.m[1][0]*n.y + m_inv.m[2][0]*n.z;
+        n_transformed->y = m_inv.m[0][1]*n.x + m_inv.m[1][1]*n.y + m_inv.m[2][1]*n.z;
+        n_transformed->z = m_inv.m[0][2]*n.x + m_inv.m[1][2]*n.y + m_inv.m[2][2]*n.z;
     }
     
     inline Ray operator()(const Ray& ray) const // transforming a ray
@@ -141,6 +205,9 @@ public:
     
     inline Bbox operator()(const Bbox& box) const // transforming a bbox
     {
+        if( isAffine() ) return transformAffineBox(m.m, box);
+
+        // a projection can bend the box's extent anywhere, so every corner has to be transformed
         const Transform& M = *this;
         
         Bbox ret(            M(Point(box.p_min.x, box.p_min.y, box.p_min.z)));
@@ -154,6 +221,36 @@ public:
         
         return ret;
     }
+
+    // transforms box by the top 3 rows of an affine matrix, with Arvo's method (Graphics Gems, 1990):
+    // every output axis starts at the translation, and each input axis adds the smaller/larger of its
+    // two scaled extents, 9 multiplies per end instead of 8 full point transforms
+    static inline Bbox transformAffineBox(const float m[][4], const Bbox& box)
+    {
+        // an empty box stays empty (its infinities would turn into NaNs below)
+        if(box.p_min.x > box.p_max.x || box.p_min.y > box.p_max.y || box.p_min.z > box.p_max.z) return Bbox();
+
+        const float b_min[3] = { box.p_min.x, box.p_min.y, box.p_min.z };
+        const float b_max[3] = { box.p_max.x, box.p_max.y, box.p_max.z };
+        float r_min[3], r_max[3];
+        for(int i = 0; i < 3; i++)
+        {
+            r_min[i] = r_max[i] = m[i][3];
+            for(int j = 0; j < 3; j++)
+            {
+                float a = m[i][j] * b_min[j];
+                float b = m[i][j] * b_max[j];
+                // not fminf/fmaxf, which are library calls unless NaNs are ruled out
+                r_min[i] += (a < b) ? a : b;
+                r_max[i] += (a < b) ? b : a;
+            }
+        }
+
+        Bbox ret;
+        ret.p_min = Point(r_min[0], r_min[1], r_min[2]);
+        ret.p_max = Point(r_max[0], r_max[1], r_max[2]);
+        return ret;
+    }
 };
 
 #endif // TRANSFORM_H
\ No newline at end of file
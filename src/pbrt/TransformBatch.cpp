@@ -0,0 +1,192 @@
+#include <cmath>
+
+#include "AffineTransform.h"
+#include "SoA.h"
+
+#ifdef RT_MAT4_SSE
+#include <immintrin.h>
+#endif
+
+/*
+    every kernel applies the top 3 rows of a matrix c:
+        out = c * in (+ the translation c[i][3] when TRANSLATE)
+    SSE does 4 elements per iteration with each coefficient broadcast across a register, the
+    remaining n % 4 elements (or all of them without SSE) go through the scalar loop
+
+    the array pointers are copied out of the SoA3s first, otherwise every store could alias them
+    and they'd be reloaded on every iteration
+*/
+
+template<bool TRANSLATE, bool NORMALIZE>
+static void affineKernel(const float c[3][4], const SoA3& in, const SoA3& out, size_t n)
+{
+    const float *ix = in.x, *iy = in.y, *iz = in.z;
+    float *ox = out.x, *oy = out.y, *oz = out.z;
+
+    size_t i = 0;
+#ifdef RT_MAT4_SSE
+    const __m128 c00 = _mm_set1_ps(c[0][0]), c01 = _mm_set1_ps(c[0][1]), c02 = _mm_set1_ps(c[0][2]), c03 = _mm_set1_ps(c[0][3]);
+    const __m128 c10 = _mm_set1_ps(c[1][0]), c11 = _mm_set1_ps(c[1][1]), c12 = _mm_set1_ps(c[1][2]), c13 = _mm_set1_ps(c[1][3]);
+    const __m128 c20 = _mm_set1_ps(c[2][0]), c21 = _mm_set1_ps(c[2][1]), c22 = _mm_set1_ps(c[2][2]), c23 = _mm_set1_ps(c[2][3]);
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(ix + i);
+        __m128 y = _mm_loadu_ps(iy + i);
+        __m128 z = _mm_loadu_ps(iz + i);
+
+        __m128 xp = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c00, x), _mm_mul_ps(c01, y)), _mm_mul_ps(c02, z));
+        __m128 yp = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c10, x), _mm_mul_ps(c11, y)), _mm_mul_ps(c12, z));
+        __m128 zp = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c20, x), _mm_mul_ps(c21, y)), _mm_mul_ps(c22, z));
+        if(TRANSLATE)
+        {
+            xp = _mm_add_ps(xp, c03);
+            yp = _mm_add_ps(yp, c13);
+            zp = _mm_add_ps(zp, c23);
+        }
+        if(NORMALIZE)
+        {
+            __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(xp, xp), _mm_mul_ps(yp, yp)), _mm_mul_ps(zp, zp)));
+            __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), len);
+            xp = _mm_mul_ps(xp, inv);
+            yp = _mm_mul_ps(yp, inv);
+            zp = _mm_mul_ps(zp, inv);
+        }
+
+        _mm_storeu_ps(ox + i, xp);
+        _mm_storeu_ps(oy + i, yp);
+        _mm_storeu_ps(oz + i, zp);
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        float x = ix[i], y = iy[i], z = iz[i];
+        float xp = c[0][0]*x + c[0][1]*y + c[0][2]*z;
+        float yp = c[1][0]*x + c[1][1]*y + c[1][2]*z;
+        float zp = c[2][0]*x + c[2][1]*y + c[2][2]*z;
+        if(TRANSLATE)
+        {
+            xp += c[0][3];
+            yp += c[1][3];
+            zp += c[2][3];
+        }
+        if(NORMALIZE)
+        {
+            float inv = 1.0f / sqrtf(xp*xp + yp*yp + zp*zp);
+            xp *= inv;
+            yp *= inv;
+            zp *= inv;
+        }
+
+        ox[i] = xp;
+        oy[i] = yp;
+        oz[i] = zp;
+    }
+}
+
+// points through a full 4x4 matrix, divided by w
+static void projectiveKernel(const float m[4][4], const SoA3& in, const SoA3& out, size_t n)
+{
+    const float *ix = in.x, *iy = in.y, *iz = in.z;
+    float *ox = out.x, *oy = out.y, *oz = out.z;
+
+    size_t i = 0;
+#ifdef RT_MAT4_SSE
+    __m128 c[4][4];
+    for(int row = 0; row < 4; row++)
+        for(int col = 0; col < 4; col++)
+            c[row][col] = _mm_set1_ps(m[row][col]);
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(ix + i);
+        __m128 y = _mm_loadu_ps(iy + i);
+        __m128 z = _mm_loadu_ps(iz + i);
+
+        __m128 r[4];
+        for(int row = 0; row < 4; row++)
+            r[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[row][0], x), _mm_mul_ps(c[row][1], y)),
+                                _mm_add_ps(_mm_mul_ps(c[row][2], z), c[row][3]));
+
+        __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), r[3]);
+        _mm_storeu_ps(ox + i, _mm_mul_ps(r[0], inv));
+        _mm_storeu_ps(oy + i, _mm_mul_ps(r[1], inv));
+        _mm_storeu_ps(oz + i, _mm_mul_ps(r[2], inv));
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        float x = ix[i], y = iy[i], z = iz[i];
+        float xp = m[0][0]*x + m[0][1]*y + m[0][2]*z + m[0][3];
+        float yp = m[1][0]*x + m[1][1]*y + m[1][2]*z + m[1][3];
+        float zp = m[2][0]*x + m[2][1]*y + m[2][2]*z + m[2][3];
+        float wp = m[3][0]*x + m[3][1]*y + m[3][2]*z + m[3][3];
+
+        float inv = 1.0f / wp;
+        ox[i] = xp * inv;
+        oy[i] = yp * inv;
+        oz[i] = zp * inv;
+    }
+}
+
+// normals go through the transpose of the inverse, this lays out its top 3x3 as kernel coefficients
+static void normalCoefficients(const float inv[][4], float c[3][4])
+{
+    for(int row = 0; row < 3; row++)
+    {
+        for(int col = 0; col < 3; col++)
+            c[row][col] = inv[col][row];
+        c[row][3] = 0.0f;
+    }
+}
+
+/* AFFINE TRANSFORM */
+void AffineTransform::transformPoints(const SoA3& in, const SoA3& out, size_t n) const
+{
+    affineKernel<true, false>(m, in, out, n);
+}
+
+void AffineTransform::transformVectors(const SoA3& in, const SoA3& out, size_t n) const
+{
+    affineKernel<false, false>(m, in, out, n);
+}
+
+void AffineTransform::transformNormals(const SoA3& in, const SoA3& out, size_t n) const
+{
+    float c[3][4];
+    normalCoefficients(m_inv, c);
+    affineKernel<false, true>(c, in, out, n);
+}
+
+void AffineTransform::transformRays(const SoA3& o, const SoA3& d, const SoA3& o_out, const SoA3& d_out, size_t n) const
+{
+    transformPoints(o, o_out, n);
+    transformVectors(d, d_out, n);
+}
+
+/* TRANSFORM */
+void Transform::transformPoints(const SoA3& in, const SoA3& out, size_t n) const
+{
+    if( isAffine() ) affineKernel<true, false>(m.m, in, out, n);
+    else             projectiveKernel(m.m, in, out, n);
+}
+
+void Transform::transformVectors(const SoA3& in, const SoA3& out, size_t n) const
+{
+    affineKernel<false, false>(m.m, in, out, n);
+}
+
+void Transform::transformNormals(const SoA3& in, const SoA3& out, size_t n) const
+{
+    float c[3][4];
+    normalCoefficients(m_inv.m, c);
+    affineKernel<false, true>(c, in, out, n);
+}
+
+void Transform::transformRays(const SoA3& o, const SoA3& d, const SoA3& o_out, const SoA3& d_out, size_t n) const
+{
+    transformPoints(o, o_out, n);
+    transformVectors(d, d_out, n);
+}
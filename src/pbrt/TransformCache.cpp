@@ -0,0 +1,282 @@
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "TransformCache.h"
+
+/*
+    every copy is an Entry, made by std::allocate_shared so the copy and its reference counts are one block of
+    the table's pool: blocks are carved out of chunks of BLOCKS_PER_CHUNK, a freed one goes on a free list for the
+    next entry, and the chunks are given back once none of their blocks are in use (so a scene's copies take a
+    few big allocations, and go with the scene)
+    the allocator each entry's control block keeps holds a reference to the table, so the table (and its pool)
+    outlives every entry, up to the return of the last block
+    the table only points at entries, it doesn't own them: when the last reference to one is dropped, its
+    destructor takes it out of the table
+    between the count reaching zero and the destructor taking the lock, the entry is still in the table but
+    can't be handed out again, so lookup() skips it (weak_from_this() comes back empty) and adds a new copy
+*/
+
+struct TransformCache::Table
+{
+    struct Entry : std::enable_shared_from_this<Entry>
+    {
+        AffineTransform t, inverse;
+        Table* table; // kept alive by the allocator in the entry's control block
+
+        Entry(const AffineTransform& t, Table* table) :
+            t(t),
+            inverse( t.getInverse() ),
+            table(table)
+        {}
+        ~Entry()
+        {
+            table->erase(this);
+        }
+    };
+
+    // fixed size blocks, for the one type allocate_shared() asks for (an Entry with its reference counts)
+    struct Pool
+    {
+        static constexpr size_t BLOCKS_PER_CHUNK = 256;
+
+        std::vector<void*> chunks;
+        void* freeList = nullptr; // each free block starts with a pointer to the next
+        size_t blockSize = 0;
+        size_t carved = 0; // blocks handed out of the last chunk so far
+        size_t live = 0;
+        std::mutex mutex; // its own, as blocks are given back with the table's lock held or not
+
+        ~Pool() { release(); }
+        void* allocate(size_t bytes);
+        void deallocate(void* block);
+        void release();
+    };
+
+    // an allocator for allocate_shared(), handing out blocks of the table's pool
+    template<class T>
+    struct Allocator
+    {
+        typedef T value_type;
+        std::shared_ptr<Table> table;
+
+        Allocator(std::shared_ptr<Table> table) : table( std::move(table) ) {}
+        template<class U>
+        Allocator(const Allocator<U>& other) : table(other.table) {}
+
+        T* allocate(size_t n)
+        {
+            static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "pool blocks are only aligned like operator new");
+            return n == 1 ? (T*)table->pool.allocate(sizeof(T)) : std::allocator<T>().allocate(n);
+        }
+        void deallocate(T* p, size_t n)
+        {
+            if(n == 1) table->pool.deallocate(p);
+            else std::allocator<T>().deallocate(p, n);
+        }
+
+        template<class U>
+        bool operator==(const Allocator<U>& other) const { return table == other.table; }
+        template<class U>
+        bool operator!=(const Allocator<U>& other) const { return table != other.table; }
+    };
+
+    std::vector<Entry*> slots; // open addressing with linear probing, nullptr is empty
+    size_t count = 0, nLookups = 0;
+    std::mutex mutex;
+    Pool pool;
+
+    void erase(const Entry* entry);
+    void resize(size_t n);
+};
+
+/* HELPERS */
+// FNV-1a over the words of the matrix (the inverse follows from it), then a final mix so the low bits,
+// which pick the slot, depend on every word
+static uint64_t hash(const AffineTransform& t)
+{
+    uint32_t words[12];
+    memcpy(words, t.m, sizeof(words));
+
+    uint64_t h = 14695981039346656037ull;
+    for(uint32_t w : words)
+    {
+        h ^= w;
+        h *= 1099511628211ull;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+static bool equal(const AffineTransform& a, const AffineTransform& b)
+{
+    return memcmp(a.m, b.m, sizeof(a.m)) == 0 && memcmp(a.m_inv, b.m_inv, sizeof(a.m_inv)) == 0;
+}
+
+/* CONSTRUCTORS */
+TransformCache::TransformCache() :
+    table( std::make_shared<Table>() )
+{}
+
+/* PUBLIC METHODS */
+std::shared_ptr<const AffineTransform> TransformCache::lookup(const AffineTransform& t, std::shared_ptr<const AffineTransform>* inverse)
+{
+    typedef Table::Entry Entry;
+
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(table->mutex);
+        table->nLookups++;
+
+        // keep the table at most half full, so probe sequences stay short
+        std::vector<Entry*>& slots = table->slots;
+        if( 2 * (table->count + 1) > slots.size() ) table->resize(slots.empty() ? 1024 : 2 * slots.size());
+
+        size_t mask = slots.size() - 1;
+        size_t i = hash(t) & mask;
+        for( ; slots[i]; i = (i + 1) & mask)
+            if( equal(slots[i]->t, t) && (entry = slots[i]->weak_from_this().lock()) ) break;
+
+        if(!entry)
+        {
+            entry = std::allocate_shared<Entry>(Table::Allocator<Entry>(table), t, table.get());
+            slots[i] = entry.get();
+            table->count++;
+        }
+    }
+
+    // *inverse is only assigned once the lock is released: if it held the last reference to another entry,
+    // that entry's destructor takes the lock to leave the table
+    if(inverse) *inverse = std::shared_ptr<const AffineTransform>(entry, &entry->inverse);
+
+    return std::shared_ptr<const AffineTransform>(entry, &entry->t);
+}
+
+size_t TransformCache::size() const
+{
+    std::lock_guard<std::mutex> lock(table->mutex);
+    return table->count;
+}
+
+size_t TransformCache::lookups() const
+{
+    std::lock_guard<std::mutex> lock(table->mutex);
+    return table->nLookups;
+}
+
+size_t TransformCache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(table->mutex);
+    std::lock_guard<std::mutex> poolLock(table->pool.mutex);
+    return table->pool.chunks.size() * Table::Pool::BLOCKS_PER_CHUNK * table->pool.blockSize +
+        table->slots.capacity() * sizeof(Table::Entry*);
+}
+
+TransformCache& TransformCache::global()
+{
+    static TransformCache cache;
+    return cache;
+}
+
+/* TABLE METHODS */
+// takes entry out, then moves the entries after it in its probe run back into the gap (backward shift
+// deletion), so no probe sequence that went past it stops short
+// the table shrinks as entries leave, and is freed with the last one
+void TransformCache::Table::erase(const Entry* entry)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t mask = slots.size() - 1;
+    size_t hole = hash(entry->t) & mask;
+    while(slots[hole] != entry)
+        hole = (hole + 1) & mask;
+
+    for(size_t i = (hole + 1) & mask; slots[i]; i = (i + 1) & mask)
+    {
+        // slots[i] can only move back to the hole if the hole isn't before its home slot
+        size_t home = hash(slots[i]->t) & mask;
+        if( ((i - home) & mask) >= ((i - hole) & mask) )
+        {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole] = nullptr;
+    count--;
+
+    if(count == 0) std::vector<Entry*>().swap(slots);
+    else if(slots.size() > 1024 && 8 * count < slots.size()) resize(slots.size() / 4);
+}
+
+// reinserts every entry into a table of n slots (a power of two)
+void TransformCache::Table::resize(size_t n)
+{
+    std::vector<Entry*> old(n, nullptr);
+    old.swap(slots);
+
+    size_t mask = slots.size() - 1;
+    for(Entry* entry : old)
+    {
+        if(!entry) continue;
+
+        size_t i = hash(entry->t) & mask;
+        while(slots[i])
+            i = (i + 1) & mask;
+        slots[i] = entry;
+    }
+}
+
+/* POOL METHODS */
+void* TransformCache::Table::Pool::allocate(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    live++;
+
+    if(freeList)
+    {
+        void* block = freeList;
+        freeList = *(void**)block;
+        return block;
+    }
+
+    // every block is the size of the first one asked for, rounded up so they stay aligned
+    if(blockSize == 0)
+    {
+        const size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+        blockSize = (std::max(bytes, sizeof(void*)) + align - 1) / align * align;
+    }
+    if(chunks.empty() || carved == BLOCKS_PER_CHUNK)
+    {
+        chunks.push_back( ::operator new(BLOCKS_PER_CHUNK * blockSize) );
+        carved = 0;
+    }
+
+    return (char*)chunks.back() + blockSize * carved++;
+}
+
+void TransformCache::Table::Pool::deallocate(void* block)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    *(void**)block = freeList;
+    freeList = block;
+    if(--live == 0) release();
+}
+
+// frees every chunk, only once none of their blocks are in use
+void TransformCache::Table::Pool::release()
+{
+    for(void* chunk : chunks)
+        ::operator delete(chunk);
+    chunks.clear();
+    freeList = nullptr;
+    carved = 0;
+}
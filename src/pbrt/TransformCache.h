@@ -0,0 +1,54 @@
+/*
+    TransformCache interns AffineTransforms by value, like pbrt's TransformCache
+
+    lookup() returns the cache's copy of a transform, every equal transform (both matrices bitwise equal)
+    gets the same copy, so shapes sharing a placement share one 96 byte copy of it
+    the copy's inverse is kept alongside it, so a shape's two transforms take one lookup and one allocation
+    the copies are reference counted: each one is freed, and leaves the cache, as soon as the last shape
+    holding it is gone, so a scene's transforms go with the scene and nothing can be left pointing at a
+    freed one
+    the copies can outlive the cache itself too (e.g. the global one at exit), they just aren't shared anymore
+
+    Shapes built from a Transform intern theirs in TransformCache::global()
+*/
+
+#ifndef TRANSFORM_CACHE_H
+#define TRANSFORM_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "AffineTransform.h"
+
+class TransformCache
+{
+private:
+    /* PRIVATE MEMBERS */
+    // the hash table of the live copies, shared with every copy so each one can remove itself (see TransformCache.cpp)
+    struct Table;
+    std::shared_ptr<Table> table;
+
+public:
+    /* CONSTRUCTORS */
+    TransformCache();
+    TransformCache(const TransformCache&) = delete;
+    TransformCache& operator=(const TransformCache&) = delete;
+
+    /* PUBLIC METHODS */
+    // the cache's copy of t, added if it isn't there yet
+    // *inverse (if it's given) is set to the copy of t's inverse that's kept with it
+    std::shared_ptr<const AffineTransform> lookup(const AffineTransform& t, std::shared_ptr<const AffineTransform>* inverse = nullptr);
+
+    // number of transforms (with their inverses) that are still held, and of lookup() calls ever made
+    size_t size() const;
+    size_t lookups() const;
+    // bytes held by the live copies and the hash table
+    size_t bytes() const;
+
+    // the cache every Shape built from a Transform uses
+    static TransformCache& global();
+};
+
+#endif // TRANSFORM_CACHE_H
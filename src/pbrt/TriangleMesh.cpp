@@ -0,0 +1,506 @@
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "Stats.h"
+#include "Trace.h"
+#include "TriangleMesh.h"
+
+STAT_RATIO("Intersections/Triangle hits per test", nTriangleHits, nTriangleTests);
+
+// a ray set up for the Watertight test, once for however many triangles it's tested against
+// the axes are permuted so the ray's largest direction component is z (swapping x and y when that's negative,
+// to keep the triangles' winding), and the shear takes its direction to (0, 0, 1)
+struct WatertightRay
+{
+    Point o;
+    int kx, ky, kz;
+    float Sx, Sy, Sz;
+
+    WatertightRay(const Point& o, const Vector& d) :
+        o(o)
+    {
+        kz = maxDimension( abs(d) );
+        kx = kz + 1 == 3 ? 0 : kz + 1;
+        ky = kx + 1 == 3 ? 0 : kx + 1;
+        if(d[kz] < 0.0f) std::swap(kx, ky);
+
+        Sx = -d[kx] / d[kz];
+        Sy = -d[ky] / d[kz];
+        Sz = 1.0f / d[kz];
+    }
+};
+
+// Woop et al., "Watertight Ray/Triangle Intersection" (JCGT 2013)
+static inline bool intersectWatertight(const WatertightRay& r, const Point& p0, const Point& p1, const Point& p2,
+    float t_min, float t_max, float* t_hit, float* b1, float* b2)
+{
+    // the vertices relative to the ray's origin, permuted and sheared so the ray runs down +z from (0, 0)
+    float p0z = p0[r.kz] - r.o[r.kz], p1z = p1[r.kz] - r.o[r.kz], p2z = p2[r.kz] - r.o[r.kz];
+    float p0x = (p0[r.kx] - r.o[r.kx]) + r.Sx * p0z, p0y = (p0[r.ky] - r.o[r.ky]) + r.Sy * p0z;
+    float p1x = (p1[r.kx] - r.o[r.kx]) + r.Sx * p1z, p1y = (p1[r.ky] - r.o[r.ky]) + r.Sy * p1z;
+    float p2x = (p2[r.kx] - r.o[r.kx]) + r.Sx * p2z, p2y = (p2[r.ky] - r.o[r.ky]) + r.Sy * p2z;
+
+    // the edge functions, which the triangles on either side of an edge compute from the same two vertices
+    float e0 = p1x*p2y - p1y*p2x;
+    float e1 = p2x*p0y - p2y*p0x;
+    float e2 = p0x*p1y - p0y*p1x;
+
+    // right on an edge, the float products may have rounded the wrong way, double precision settles it
+    if(e0 == 0.0f || e1 == 0.0f || e2 == 0.0f)
+    {
+        e0 = (float)( (double)p1x*p2y - (double)p1y*p2x );
+        e1 = (float)( (double)p2x*p0y - (double)p2y*p0x );
+        e2 = (float)( (double)p0x*p1y - (double)p0y*p1x );
+    }
+
+    // the ray passes inside if the edge functions agree in sign (zeros count as either)
+    if( (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) && (e0 > 0.0f || e1 > 0.0f || e2 > 0.0f) ) return false;
+    float det = e0 + e1 + e2;
+    if(det == 0.0f) return false;
+
+    // the distance, scaled by det so the range can be checked before dividing
+    p0z *= r.Sz;
+    p1z *= r.Sz;
+    p2z *= r.Sz;
+    float tScaled = e0*p0z + e1*p1z + e2*p2z;
+    if(det > 0.0f && (tScaled <= t_min * det || tScaled >= t_max * det)) return false;
+    if(det < 0.0f && (tScaled >= t_min * det || tScaled <= t_max * det)) return false;
+
+    float invDet = 1.0f / det;
+    float t = tScaled * invDet;
+    if( !(t > t_min && t < t_max) ) return false;
+
+    *t_hit = t;
+    *b1 = e1 * invDet;
+    *b2 = e2 * invDet;
+
+    return true;
+}
+
+// Moller and Trumbore, "Fast, Minimum Storage Ray/Triangle Intersection", with the edges stored up front
+static inline bool intersectEdges(const TriangleMesh::EdgeTriangle& tri, const Ray& ray, float t_min, float t_max,
+    float* t_hit, float* b1, float* b2)
+{
+    Vector pvec = cross(ray.d, tri.e2);
+    float det = dot(tri.e1, pvec);
+    if(det == 0.0f) return false; // parallel to the triangle
+    float invDet = 1.0f / det;
+
+    Vector tvec = ray.o - tri.v0;
+    float u = dot(tvec, pvec) * invDet;
+    if(u < 0.0f || u > 1.0f) return false;
+
+    Vector qvec = cross(tvec, tri.e1);
+    float v = dot(ray.d, qvec) * invDet;
+    if(v < 0.0f || u + v > 1.0f) return false;
+
+    float t = dot(tri.e2, qvec) * invDet;
+    if( !(t > t_min && t < t_max) ) return false;
+
+    *t_hit = t;
+    *b1 = u;
+    *b2 = v;
+
+    return true;
+}
+
+/* CONSTRUCTORS */
+TriangleMesh::TriangleMesh(const Transform& object_to_world, bool reverseOrientation,
+    const std::vector<uint32_t>& vertexIndices, const std::vector<Point>& P,
+    const std::vector<Normal>& N, const std::vector<float>& uv,
+    Intersector intersector) :
+    TriangleMesh(object_to_world, reverseOrientation, vertexIndices, P, N, uv, intersector, validArrays(vertexIndices, P, N, uv))
+{}
+
+TriangleMesh::TriangleMesh(const Transform& object_to_world, bool reverseOrientation,
+    const std::vector<uint32_t>& vertexIndices, const std::vector<Point>& P,
+    const std::vector<Normal>& N, const std::vector<float>& uv,
+    Intersector intersector, bool valid) :
+    TriangleMesh(object_to_world, reverseOrientation, valid ? (int)(vertexIndices.size() / 3) : 0, valid ? (int)P.size() : 0,
+        valid && !N.empty(), valid && !uv.empty(), intersector)
+{
+    if(!valid) return;
+
+    std::copy(vertexIndices.begin(), vertexIndices.begin() + indices.size(), indices.begin());
+    for(size_t i = 0; i < P.size(); i++)
+        p.set(i, P[i].x, P[i].y, P[i].z);
+    for(size_t i = 0; i < N.size(); i++)
+        n.set(i, N[i].x, N[i].y, N[i].z);
+    for(size_t i = 0; i < us.size(); i++)
+    {
+        us[i] = uv[2*i];
+        vs[i] = uv[2*i + 1];
+    }
+
+    build();
+}
+
+TriangleMesh::TriangleMesh(const Transform& object_to_world, bool reverseOrientation, int nTriangles, int nVertices,
+    bool hasNormals, bool hasUVs, Intersector intersector) :
+    Shape(object_to_world, reverseOrientation),
+    intersector(intersector),
+    nTriangles(nTriangles),
+    nVertices(nVertices),
+    indices( 3 * (size_t)nTriangles ),
+    positions(nVertices),
+    normals(hasNormals ? nVertices : 0),
+    us(hasUVs ? nVertices : 0),
+    vs(hasUVs ? nVertices : 0)
+{
+    p = positions.soa();
+    n = normals.soa();
+}
+
+TriangleMesh::TriangleMesh(const Transform& object_to_world, bool reverseOrientation, Intersector intersector,
+    Array<uint32_t> indices, SoA3Buffer positions, SoA3Buffer normals, Array<float> us, Array<float> vs,
+    Array<BVH::LinearNode> nodes, Array<EdgeTriangle> edgeTriangles) :
+    Shape(object_to_world, reverseOrientation),
+    intersector(intersector),
+    nTriangles( (int)(indices.size() / 3) ),
+    nVertices( (int)positions.size() ),
+    indices( std::move(indices) ),
+    positions( std::move(positions) ),
+    normals( std::move(normals) ),
+    us( std::move(us) ),
+    vs( std::move(vs) ),
+    nodes( std::move(nodes) ),
+    edgeTriangles( std::move(edgeTriangles) )
+{
+    p = this->positions.soa();
+    n = this->normals.soa();
+}
+
+/* PUBLIC METHODS */
+void TriangleMesh::build()
+{
+    // the vertices go into world space in one batch, in place
+    object_to_world->transformPoints(p, p, positions.size());
+    object_to_world->transformNormals(n, n, normals.size());
+
+    if(nTriangles == 0) return;
+    TRACE_SCOPE_ARG("build", "TriangleMesh build", nTriangles);
+
+    // the slab test rounds, and a ray through an edge or vertex right on a box's face could miss the leaf
+    // that holds it, so every box is padded by a few ulps of the mesh's largest coordinate
+    float largest = 0.0f;
+    for(int i = 0; i < nVertices; i++)
+        for(int axis = 0; axis < 3; axis++)
+            largest = std::max( largest, std::fabs(position((uint32_t)i)[axis]) );
+    float pad = 1e-6f * largest;
+
+    std::vector<BVH::PrimitiveInfo> info(nTriangles);
+    for(int i = 0; i < nTriangles; i++)
+    {
+        Bbox b = Bbox::Union( Bbox(position(indices[3*i]), position(indices[3*i + 1])), position(indices[3*i + 2]) );
+        b.expand(pad);
+        info[i].index = i;
+        info[i].bounds = b;
+        info[i].centroid = b.p_min + (b.p_max - b.p_min) * 0.5f;
+    }
+    std::vector<BVH::LinearNode> tree;
+    std::vector<int> order = BVH::build(info, 4, tree);
+    tree.shrink_to_fit();
+    nodes = std::move(tree);
+
+    // the triangles in leaf order, so a leaf's triangles are the next nPrimitives from its primitivesOffset
+    std::vector<uint32_t> ordered( 3 * (size_t)nTriangles );
+    for(int i = 0; i < nTriangles; i++)
+        for(int j = 0; j < 3; j++)
+            ordered[3*i + j] = indices[3*order[i] + j];
+    indices = std::move(ordered);
+
+    if(intersector == PrecomputedEdges)
+    {
+        std::vector<EdgeTriangle> edges(nTriangles);
+        for(int i = 0; i < nTriangles; i++)
+        {
+            Point p0 = position(indices[3*i]), p1 = position(indices[3*i + 1]), p2 = position(indices[3*i + 2]);
+            edges[i] = { p0, p1 - p0, p2 - p0 };
+        }
+        edgeTriangles = std::move(edges);
+    }
+}
+
+bool TriangleMesh::intersect(const Ray& ray, Hit* hit) const
+{
+    if( !traverse(ray, false, hit) ) return false;
+
+    ray.t_max = hit->t;
+    return true;
+}
+
+bool TriangleMesh::doesIntersect(const Ray& ray) const
+{
+    Hit hit;
+
+    return traverse(ray, true, &hit);
+}
+
+// implementation @ (pg. 143) of pbrt 2nd ed., with the normals' derivatives as pbrt 3rd ed. does them
+void TriangleMesh::getDifferentialGeometry(const Ray&, const Hit& hit, DifferentialGeometry* dg) const
+{
+    const uint32_t* v = &indices[3 * (size_t)hit.primitive];
+    Point p0 = position(v[0]), p1 = position(v[1]), p2 = position(v[2]);
+    float b1 = hit.u, b2 = hit.v, b0 = 1.0f - b1 - b2;
+
+    // the uvs at the vertices, pbrt's (0, 0), (1, 0), (1, 1) if the mesh has none
+    float u[3] = { 0.0f, 1.0f, 1.0f }, vv[3] = { 0.0f, 0.0f, 1.0f };
+    if( !us.empty() )
+        for(int i = 0; i < 3; i++)
+        {
+            u[i] = us[v[i]];
+            vv[i] = vs[v[i]];
+        }
+
+    // the partial derivatives of the point, from how it and uv change along two edges
+    float du02 = u[0] - u[2], du12 = u[1] - u[2];
+    float dv02 = vv[0] - vv[2], dv12 = vv[1] - vv[2];
+    Vector dp02 = p0 - p2, dp12 = p1 - p2;
+    float determinant = du02*dv12 - dv02*du12;
+    bool degenerate = determinant == 0.0f;
+    float invdet = degenerate ? 0.0f : 1.0f / determinant;
+    Vector dpdu, dpdv;
+    if(!degenerate)
+    {
+        dpdu = ( dp02 * dv12 - dp12 * dv02 ) * invdet;
+        dpdv = ( dp12 * du02 - dp02 * du12 ) * invdet;
+    }
+    if( degenerate || cross(dpdu, dpdv).lengthSquared() == 0.0f )
+        coordinateSystem( normalize(cross(p2 - p0, p1 - p0)), &dpdu, &dpdv );
+
+    // and of the normal, if there are normals to interpolate
+    Vector dndu, dndv;
+    if(normals.size() > 0 && !degenerate)
+    {
+        Vector dn02 = Vector( n.normal(v[0]) ) - Vector( n.normal(v[2]) );
+        Vector dn12 = Vector( n.normal(v[1]) ) - Vector( n.normal(v[2]) );
+        dndu = ( dn02 * dv12 - dn12 * dv02 ) * invdet;
+        dndv = ( dn12 * du02 - dn02 * du12 ) * invdet;
+    }
+
+    Point p_hit = p2 + dp02 * b0 + dp12 * b1; // b0 p0 + b1 p1 + b2 p2
+    *dg = DifferentialGeometry(p_hit, dpdu, dpdv, dndu, dndv,
+        b0*u[0] + b1*u[1] + b2*u[2], b0*vv[0] + b1*vv[1] + b2*vv[2], this);
+
+    // with normals the surface faces the way they do, otherwise the way the winding and the transform say
+    if(normals.size() > 0)
+    {
+        Vector ns = Vector( n.normal(v[0]) ) * b0 + Vector( n.normal(v[1]) ) * b1 + Vector( n.normal(v[2]) ) * b2;
+        if(dot(Vector(dg->nn), ns) < 0.0f) dg->nn = -dg->nn;
+    }
+    else if(reverseOrientation ^ transformSwapsHandedness)
+        dg->nn = -dg->nn;
+}
+
+size_t TriangleMesh::bytes() const
+{
+    return indices.size() * sizeof(uint32_t) + (positions.size() + normals.size()) * 3 * sizeof(float) +
+        (us.size() + vs.size()) * sizeof(float) + nodes.size() * sizeof(BVH::LinearNode) +
+        edgeTriangles.size() * sizeof(EdgeTriangle);
+}
+
+/* PRIVATE METHODS */
+bool TriangleMesh::validArrays(const std::vector<uint32_t>& indices, const std::vector<Point>& positions,
+    const std::vector<Normal>& normals, const std::vector<float>& uvs)
+{
+    if(indices.size() % 3 != 0)
+    {
+        printf("[TriangleMesh] given %zu vertex indices, not 3 per triangle, leaving the mesh empty\n", indices.size());
+        return false;
+    }
+    for(size_t i = 0; i < indices.size(); i++)
+        if(indices[i] >= positions.size())
+        {
+            printf("[TriangleMesh] triangle %zu uses vertex %u of %zu, leaving the mesh empty\n", i / 3, indices[i], positions.size());
+            return false;
+        }
+    if( !normals.empty() && normals.size() != positions.size() )
+    {
+        printf("[TriangleMesh] given %zu normals for %zu vertices, leaving the mesh empty\n", normals.size(), positions.size());
+        return false;
+    }
+    if( !uvs.empty() && uvs.size() != 2 * positions.size() )
+    {
+        printf("[TriangleMesh] given %zu uv floats for %zu vertices (2 per vertex), leaving the mesh empty\n", uvs.size(), positions.size());
+        return false;
+    }
+
+    return true;
+}
+
+bool TriangleMesh::intersectTriangle(int tri, const Ray& ray, const WatertightRay& wr, float t_min, float t_max, float* t_hit, float* b1, float* b2) const
+{
+    if(intersector == PrecomputedEdges)
+        return intersectEdges(edgeTriangles[tri], ray, t_min, t_max, t_hit, b1, b2);
+
+    const uint32_t* v = &indices[3 * (size_t)tri];
+    return intersectWatertight(wr, position(v[0]), position(v[1]), position(v[2]), t_min, t_max, t_hit, b1, b2);
+}
+
+// the same traversal as BVH::intersect()
+bool TriangleMesh::traverse(const Ray& ray_in, bool anyHit, Hit* hit) const
+{
+    if(nodes.empty()) return false;
+
+    // t_max shrinks as hits are found, without touching the caller's ray
+    Ray ray = ray_in;
+
+    Vector invDir(1.0f / ray.d.x, 1.0f / ray.d.y, 1.0f / ray.d.z);
+    int dirIsNeg[3] = { invDir.x < 0, invDir.y < 0, invDir.z < 0 };
+    WatertightRay wr(ray.o, ray.d);
+
+    bool found = false;
+    int todo[BVH::MAX_DEPTH];
+    int todoOffset = 0;
+    int nodeNum = 0;
+    int trianglesTested = 0, trianglesHit = 0;
+    while(true)
+    {
+        const BVH::LinearNode& node = nodes[nodeNum];
+        if( BVH::intersectsP(node.bounds, ray, invDir, dirIsNeg) )
+        {
+            if(node.nPrimitives > 0)
+            {
+                trianglesTested += node.nPrimitives;
+                for(int i = 0; i < node.nPrimitives; i++)
+                {
+                    int tri = node.primitivesOffset + i;
+                    float t, b1, b2;
+                    if( intersectTriangle(tri, ray, wr, ray.t_min, ray.t_max, &t, &b1, &b2) )
+                    {
+                        trianglesHit++;
+                        found = true;
+                        hit->t = t;
+                        hit->u = b1;
+                        hit->v = b2;
+                        hit->primitive = (uint32_t)tri;
+                        hit->shape = this;
+                        if(anyHit) break;
+                        ray.t_max = t;
+                    }
+                }
+
+                if( (found && anyHit) || todoOffset == 0 ) break;
+                nodeNum = todo[--todoOffset];
+            }
+            else
+            {
+                // visit the near child first, and push the far one
+                if(dirIsNeg[node.axis])
+                {
+                    todo[todoOffset++] = nodeNum + 1;
+                    nodeNum = node.secondChildOffset;
+                }
+                else
+                {
+                    todo[todoOffset++] = node.secondChildOffset;
+                    nodeNum = nodeNum + 1;
+                }
+            }
+        }
+        else
+        {
+            if(todoOffset == 0) break;
+            nodeNum = todo[--todoOffset];
+        }
+    }
+
+    STAT_ADD(nTriangleTests, trianglesTested);
+    STAT_ADD(nTriangleHits, trianglesHit);
+    (void)trianglesTested; (void)trianglesHit; // only read when statistics are compiled in
+
+    return found;
+}
+
+// BVH::intersect(RayPacket&) over the mesh's tree, leaves test every lane that reaches them on its own
+template<int N>
+Maskx<N> TriangleMesh::traversePacket(const RayPacket<N>& rays_in, const Maskx<N>& active, Floatx<N>* t_hit, Hit* hits) const
+{
+    Maskx<N> found;
+    if(nodes.empty() || none(active)) return found;
+
+    // the lanes' t_max shrink as hits are found, without touching the caller's packet
+    RayPacket<N> rays = rays_in;
+    Vec3x<N> invDir( Floatx<N>(1.0f) / rays.d.x, Floatx<N>(1.0f) / rays.d.y, Floatx<N>(1.0f) / rays.d.z );
+    Maskx<N> dirIsNeg[3] = { invDir.x < Floatx<N>(0.0f), invDir.y < Floatx<N>(0.0f), invDir.z < Floatx<N>(0.0f) };
+    int first = lowestLane(active.bits());
+    bool firstIsNeg[3] = { dirIsNeg[0][first], dirIsNeg[1][first], dirIsNeg[2][first] };
+
+    int todo[BVH::MAX_DEPTH];
+    int todoOffset = 0;
+    int nodeNum = 0;
+    int trianglesTested = 0, trianglesHit = 0;
+    while(true)
+    {
+        const BVH::LinearNode& node = nodes[nodeNum];
+        Maskx<N> lanes = active & BVH::intersectsP(node.bounds, rays, invDir, dirIsNeg);
+        if( any(lanes) )
+        {
+            if(node.nPrimitives > 0)
+            {
+                for(uint32_t remaining = lanes.bits(); remaining; remaining &= remaining - 1)
+                {
+                    int i = lowestLane(remaining);
+                    Ray ray = rays.ray(i);
+                    WatertightRay wr(ray.o, ray.d);
+                    trianglesTested += node.nPrimitives;
+                    for(int j = 0; j < node.nPrimitives; j++)
+                    {
+                        float t, b1, b2;
+                        if( intersectTriangle(node.primitivesOffset + j, ray, wr, ray.t_min, ray.t_max, &t, &b1, &b2) )
+                        {
+                            trianglesHit++;
+                            (*t_hit)[i] = t;
+                            ray.t_max = t;
+                            rays.t_max[i] = t;
+                            if(hits)
+                            {
+                                hits[i].t = t;
+                                hits[i].u = b1;
+                                hits[i].v = b2;
+                                hits[i].primitive = (uint32_t)(node.primitivesOffset + j);
+                                hits[i].shape = this;
+                            }
+                            found = found | Maskx<N>::fromBits(1u << i);
+                        }
+                    }
+                }
+
+                if(todoOffset == 0) break;
+                nodeNum = todo[--todoOffset];
+            }
+            else
+            {
+                // visit the near child first, and push the far one
+                if(firstIsNeg[node.axis])
+                {
+                    todo[todoOffset++] = nodeNum + 1;
+                    nodeNum = node.secondChildOffset;
+                }
+                else
+                {
+                    todo[todoOffset++] = node.secondChildOffset;
+                    nodeNum = nodeNum + 1;
+                }
+            }
+        }
+        else
+        {
+            if(todoOffset == 0) break;
+            nodeNum = todo[--todoOffset];
+        }
+    }
+
+    STAT_ADD(nTriangleTests, trianglesTested);
+    STAT_ADD(nTriangleHits, trianglesHit);
+    (void)trianglesTested; (void)trianglesHit; // only read when statistics are compiled in
+
+    return found;
+}
+
+template Maskx<4> TriangleMesh::traversePacket<4>(const RayPacket<4>& rays, const Maskx<4>& active, Floatx<4>* t_hit, Hit* hits) const;
+template Maskx<8> TriangleMesh::traversePacket<8>(const RayPacket<8>& rays, const Maskx<8>& active, Floatx<8>* t_hit, Hit* hits) const;
+template Maskx<16> TriangleMesh::traversePacket<16>(const RayPacket<16>& rays, const Maskx<16>& active, Floatx<16>* t_hit, Hit* hits) const;
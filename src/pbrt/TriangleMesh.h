@@ -0,0 +1,148 @@
+/*
+    TriangleMesh is a Shape made of many triangles that share their vertices (pbrt's TriangleMesh, pg. 135 of
+    pbrt 2nd ed.)
+
+    a triangle is just three 32-bit indices into the mesh's vertex buffers, not a Shape of its own with a
+    vtable and transforms, and the mesh has its own BVH over them (built with BVH::build, as SphereSoup does)
+    so a whole mesh is a single primitive to whichever aggregate it's put in
+    the positions (and normals, if there are any) are transformed into world space once, when the mesh is
+    built, and kept as SoA3 buffers, the uvs as two plain arrays
+
+    triangles are intersected one of two ways:
+        * Watertight, the default: Woop et al.'s "Watertight Ray/Triangle Intersection", the ray is sheared so
+          it points down +z and the triangle's edge functions are evaluated in 2D, every ray that hits the
+          mesh hits at least one triangle, even exactly on an edge or vertex they share
+        * PrecomputedEdges: Moller-Trumbore against a copy of every triangle as a vertex and two edges,
+          which skips the indices and the shear for another 36 bytes a triangle, but can slip through the
+          crack between two triangles
+    a Hit's primitive is the triangle's index and (u, v) are its barycentrics b1, b2
+*/
+
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "Array.h"
+#include "BVH.h"
+#include "Shape.h"
+#include "SoA.h"
+
+struct WatertightRay; // see TriangleMesh.cpp
+
+class TriangleMesh : public Shape
+{
+public:
+    /* PUBLIC MEMBERS */
+    enum Intersector
+    {
+        Watertight,
+        PrecomputedEdges
+    };
+
+    // a triangle's first vertex and its two edges from it
+    struct EdgeTriangle
+    {
+        Point v0;
+        Vector e1, e2;
+    };
+
+    const Intersector intersector;
+    const int nTriangles, nVertices;
+
+    // all of these are borrowed when the mesh came from a scene cache (see SceneCache.h)
+    Array<uint32_t> indices; // 3 per triangle, the triangles are in leaf order once built
+    SoA3Buffer positions;
+    SoA3Buffer normals; // empty if the mesh has no normals
+    Array<float> us, vs; // empty if the mesh has no uvs
+    Array<BVH::LinearNode> nodes; // a leaf's primitivesOffset is the index of its first triangle
+    Array<EdgeTriangle> edgeTriangles; // PrecomputedEdges only, in the same order as the triangles
+
+    /* CONSTRUCTORS */
+    // indices holds 3 per triangle, normals and uvs (2 floats per vertex) are optional
+    // if the arrays don't fit together (an index past the last position, a triangle short of indices, or normals
+    // or uvs for a different number of vertices), it says so and leaves the mesh empty
+    TriangleMesh(const Transform& object_to_world, bool reverseOrientation,
+        const std::vector<uint32_t>& indices, const std::vector<Point>& positions,
+        const std::vector<Normal>& normals = {}, const std::vector<float>& uvs = {},
+        Intersector intersector = Watertight);
+    // an unbuilt mesh with room for nTriangles and nVertices (and normals and uvs if asked for), for loaders
+    // to write straight into: the object space vertices go into positions, normals, us and vs, 3 vertex
+    // indices per triangle into indices, and then build() has to be called once before it's used
+    TriangleMesh(const Transform& object_to_world, bool reverseOrientation, int nTriangles, int nVertices,
+        bool hasNormals, bool hasUVs, Intersector intersector = Watertight);
+    // a mesh that's already built, around what build() left in another one's buffers (world space vertices,
+    // triangles in leaf order, the tree and the edge triangles)
+    TriangleMesh(const Transform& object_to_world, bool reverseOrientation, Intersector intersector,
+        Array<uint32_t> indices, SoA3Buffer positions, SoA3Buffer normals, Array<float> us, Array<float> vs,
+        Array<BVH::LinearNode> nodes, Array<EdgeTriangle> edgeTriangles);
+    TriangleMesh(const TriangleMesh&) = delete;
+    TriangleMesh& operator=(const TriangleMesh&) = delete;
+
+    /* PUBLIC METHODS */
+    // the vertices are in world space already, so this is looser than the world bound
+    Bbox objectBound() const override
+    {
+        return (*world_to_object)( worldBound() );
+    }
+    Bbox worldBound() const override
+    {
+        return nodes.empty() ? Bbox() : nodes[0].bounds;
+    }
+
+    bool intersect(const Ray& ray, Hit* hit) const override;
+    bool doesIntersect(const Ray& ray) const override;
+    void getDifferentialGeometry(const Ray& ray, const Hit& hit, DifferentialGeometry* dg) const override;
+
+    // the packet walks the tree together, and every lane that reaches a leaf tests its triangles
+    Maskx<4> intersectPacket(const RayPacket<4>& rays, const Maskx<4>& active, Floatx<4>* t_hit, Hit* hits = nullptr) const override
+    {
+        return traversePacket(rays, active, t_hit, hits);
+    }
+    Maskx<8> intersectPacket(const RayPacket<8>& rays, const Maskx<8>& active, Floatx<8>* t_hit, Hit* hits = nullptr) const override
+    {
+        return traversePacket(rays, active, t_hit, hits);
+    }
+    Maskx<16> intersectPacket(const RayPacket<16>& rays, const Maskx<16>& active, Floatx<16>* t_hit, Hit* hits = nullptr) const override
+    {
+        return traversePacket(rays, active, t_hit, hits);
+    }
+
+    // moves the vertices into world space and builds the tree over the triangles
+    void build();
+
+    inline Point position(uint32_t vertex) const
+    {
+        return p.point(vertex);
+    }
+    // the bytes the triangles take up (indices, vertex buffers, nodes and edge triangles)
+    size_t bytes() const;
+
+private:
+    /* PRIVATE MEMBERS */
+    SoA3 p, n; // views of positions and normals
+
+    /* PRIVATE CONSTRUCTORS */
+    // the public one from arrays, once validArrays() has said whether to take them or stay empty
+    TriangleMesh(const Transform& object_to_world, bool reverseOrientation,
+        const std::vector<uint32_t>& indices, const std::vector<Point>& positions,
+        const std::vector<Normal>& normals, const std::vector<float>& uvs, Intersector intersector, bool valid);
+
+    /* PRIVATE METHODS */
+    // true if the arrays make a mesh, otherwise prints what's wrong with them
+    static bool validArrays(const std::vector<uint32_t>& indices, const std::vector<Point>& positions,
+        const std::vector<Normal>& normals, const std::vector<float>& uvs);
+    // tests ray against triangle tri with the mesh's intersector, for hits in (t_min, t_max)
+    // wr is the ray set up for Watertight, *b1 and *b2 are the hit's barycentrics
+    bool intersectTriangle(int tri, const Ray& ray, const WatertightRay& wr, float t_min, float t_max, float* t_hit, float* b1, float* b2) const;
+    // walks the tree with ray, returns true on the first hit if anyHit, otherwise on the closest
+    // (*hit says where it is, ray itself is left alone)
+    bool traverse(const Ray& ray, bool anyHit, Hit* hit) const;
+    // the closest hit of every active lane, which gets the same answer it would from traverse()
+    template<int N>
+    Maskx<N> traversePacket(const RayPacket<N>& rays, const Maskx<N>& active, Floatx<N>* t_hit, Hit* hits) const;
+};
+
+#endif // TRIANGLE_MESH_H
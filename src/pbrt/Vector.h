@@ -11,11 +11,18 @@
                   Vector v = Vector(n)
                   
     Vector.h also defines Normal
+
+    everything but length() and normalize() (which need a sqrt) is constexpr
+
+    x, y, z are plain members that are laid out contiguously (checked by static_asserts), so operator[]
+    indexes them as an array from &x, a single load with no branch on the index
+    indexing out of range is caught by an assert, not at runtime
 */
 
 #ifndef VECTOR_H
 #define VECTOR_H
 
+#include <stddef.h>
 #include <stdio.h>
 #include <cmath>
 #include <cassert>
@@ -31,20 +38,20 @@ public:
     float x, y, z;
     
     /* CONSTRUCTORS */
-    Vector() :
+    constexpr Vector() :
         x(0.0f),
         y(0.0f),
         z(0.0f)
     {}
-    Vector(float x, float y, float z) :
+    constexpr Vector(float x, float y, float z) :
         x(x),
         y(y),
         z(z)
     {}
-    explicit Vector(const Normal& n);
+    explicit constexpr Vector(const Normal& n);
 
     /* PUBLIC METHODS */
-    float lengthSquared() const
+    constexpr float lengthSquared() const
     {
         return x*x + y*y + z*z;
     }
@@ -55,11 +62,11 @@ public:
     }
     
     /* INLINE OPERATOR OVERLOADS */
-    inline Vector operator+(const Vector& v) const
+    constexpr Vector operator+(const Vector& v) const
     {
         return Vector(x + v.x, y + v.y, z + v.z);
     }
-    inline Vector& operator+=(const Vector& v)
+    constexpr Vector& operator+=(const Vector& v)
     {
         x += v.x;
         y += v.y;
@@ -68,11 +75,11 @@ public:
         return *this;
     }
 
-    inline Vector operator-(const Vector& v) const
+    constexpr Vector operator-(const Vector& v) const
     {
         return Vector(x - v.x, y - v.y, z - v.z);
     }
-    inline Vector& operator-=(const Vector& v)
+    constexpr Vector& operator-=(const Vector& v)
     {
         x -= v.x;
         y -= v.y;
@@ -81,11 +88,11 @@ public:
         return *this;
     }
     
-    inline Vector operator*(float f) const
+    constexpr Vector operator*(float f) const
     {
         return Vector(x * f, y * f, z * f);
     }
-    inline Vector& operator*=(float f)
+    constexpr Vector& operator*=(float f)
     {
         x *= f;
         y *= f;
@@ -94,11 +101,11 @@ public:
         return *this;
     }
 
-    inline Vector operator/(float f) const
+    constexpr Vector operator/(float f) const
     {
         return Vector(x / f, y / f, z / f);
     }
-    inline Vector& operator/=(float f)
+    constexpr Vector& operator/=(float f)
     {
         x /= f;
         y /= f;
@@ -107,27 +114,29 @@ public:
         return *this;
     }
     
-    inline Vector operator-() const
+    constexpr Vector operator-() const
     {
         return Vector(-x, -y, -z);
     }
     
     inline float operator[](const int i) const
     {
-        if(i == 0) return x;
-        else if(i == 1) return y;
-        else if(i == 2) return z;
-        else
-        {
-            printf("Vector has no member of index %i!\n", i);
-            
-            return NAN;
-        }
+        assert(i >= 0 && i < 3);
+        return (&x)[i];
+    }
+    inline float& operator[](const int i)
+    {
+        assert(i >= 0 && i < 3);
+        return (&x)[i];
     }
 }; // Vector 
 
+// operator[] indexes x, y, z as an array
+static_assert(offsetof(Vector, y) == offsetof(Vector, x) + sizeof(float) && offsetof(Vector, z) == offsetof(Vector, y) + sizeof(float) &&
+    sizeof(Vector) == 3 * sizeof(float), "Vector's components aren't contiguous");
+
 /* GLOBAL INLINE FUNCTIONS (that only use Vectors) */
-inline float dot(const Vector& v1, const Vector& v2)
+constexpr float dot(const Vector& v1, const Vector& v2)
 {
     return v1.x*v2.x + v1.y*v2.y + v1.z*v2.z;
 }
@@ -137,7 +146,7 @@ inline float dotAbs(const Vector& v1, const Vector& v2)
     return fabsf( dot(v1, v2) );
 }
 
-inline Vector cross(const Vector& v1, const Vector& v2)
+constexpr Vector cross(const Vector& v1, const Vector& v2)
 {
     return Vector(
         v1.y*v2.z - v1.z*v2.y,
@@ -151,6 +160,75 @@ inline Vector normalize(const Vector& v)
     return v / v.length();
 }
 
+// component-wise, written as selects so they compile to minps/maxps/andps rather than libm calls
+constexpr Vector min(const Vector& v1, const Vector& v2)
+{
+    return Vector(
+        v1.x < v2.x ? v1.x : v2.x,
+        v1.y < v2.y ? v1.y : v2.y,
+        v1.z < v2.z ? v1.z : v2.z
+    );
+}
+
+constexpr Vector max(const Vector& v1, const Vector& v2)
+{
+    return Vector(
+        v1.x > v2.x ? v1.x : v2.x,
+        v1.y > v2.y ? v1.y : v2.y,
+        v1.z > v2.z ? v1.z : v2.z
+    );
+}
+
+constexpr Vector abs(const Vector& v)
+{
+    return Vector(
+        v.x < 0.0f ? -v.x : v.x,
+        v.y < 0.0f ? -v.y : v.y,
+        v.z < 0.0f ? -v.z : v.z
+    );
+}
+
+// component-wise a * b + c
+constexpr Vector fma(const Vector& a, const Vector& b, const Vector& c)
+{
+    return Vector(a.x*b.x + c.x, a.y*b.y + c.y, a.z*b.z + c.z);
+}
+
+// horizontal
+constexpr float minComponent(const Vector& v)
+{
+    float m = v.x < v.y ? v.x : v.y;
+    return m < v.z ? m : v.z;
+}
+
+constexpr float maxComponent(const Vector& v)
+{
+    float m = v.x > v.y ? v.x : v.y;
+    return m > v.z ? m : v.z;
+}
+
+// index of the largest component, ties go to the later axis
+constexpr int maxDimension(const Vector& v)
+{
+    return (v.x > v.y && v.x > v.z) ? 0 : (v.y > v.z ? 1 : 2);
+}
+
+// two vectors that make an orthonormal basis with v1, which must be normalized @ (pg. 63) of pbrt 2nd ed.
+inline void coordinateSystem(const Vector& v1, Vector* v2, Vector* v3)
+{
+    if(fabsf(v1.x) > fabsf(v1.y))
+    {
+        float invLen = 1.0f / sqrtf(v1.x*v1.x + v1.z*v1.z);
+        *v2 = Vector(-v1.z * invLen, 0.0f, v1.x * invLen);
+    }
+    else
+    {
+        float invLen = 1.0f / sqrtf(v1.y*v1.y + v1.z*v1.z);
+        *v2 = Vector(0.0f, v1.z * invLen, -v1.y * invLen);
+    }
+    *v3 = cross(v1, *v2);
+}
+
 
 
 class Normal
@@ -160,20 +238,20 @@ public:
     float x, y, z;
     
     /* CONSTRUCTORS */
-    Normal() :
+    constexpr Normal() :
         x(0.0f),
         y(0.0f),
         z(0.0f)
     {}
-    Normal(float x, float y, float z) :
+    constexpr Normal(float x, float y, float z) :
         x(x),
         y(y),
         z(z)
     {}
-    explicit Normal(const Vector& v);
+    explicit constexpr Normal(const Vector& v);
     
     /* PUBLIC METHODS */
-    inline float lengthSquared() const
+    constexpr float lengthSquared() const
     {
         return x*x + y*y + z*z;
     }
@@ -183,11 +261,11 @@ public:
     }
     
     /* OPERATOR OVERLOADS */
-    inline Normal operator+(const Normal& n) const
+    constexpr Normal operator+(const Normal& n) const
     {
         return Normal(x + n.x, y + n.y, z + n.z);
     }
-    inline Normal& operator+=(const Normal& n)
+    constexpr Normal& operator+=(const Normal& n)
     {
         x += n.x;
         y += n.y;
@@ -196,11 +274,11 @@ public:
         return *this;
     }
 
-    inline Normal operator-(const Normal& n) const
+    constexpr Normal operator-(const Normal& n) const
     {
         return Normal(x - n.x, y - n.y, z - n.z);
     }
-    inline Normal& operator-=(const Normal& n)
+    constexpr Normal& operator-=(const Normal& n)
     {
         x -= n.x;
         y -= n.y;
@@ -209,11 +287,11 @@ public:
         return *this;
     }
 
-    inline Normal operator*(float f) const
+    constexpr Normal operator*(float f) const
     {
         return Normal(x*f, y*f, z*f);
     }
-    inline Normal& operator*=(float f)
+    constexpr Normal& operator*=(float f)
     {
         x *= f;
         y *= f;
@@ -222,14 +300,14 @@ public:
         return *this;
     }
 
-    inline Normal operator/(float f) const
+    constexpr Normal operator/(float f) const
     {
         assert(f != 0);
         float inv = 1.0f / f;
 
         return Normal(x*inv, y*inv, z*inv);
     }
-    inline Normal& operator/=(float f)
+    constexpr Normal& operator/=(float f)
     {
         assert(f != 0);
         float inv = 1.0f / f;
@@ -241,15 +319,29 @@ public:
         return *this;
     }
     
-    inline Normal operator-() const
+    constexpr Normal operator-() const
     {
         return Normal(-x, -y, -z);
     }
+
+    inline float operator[](const int i) const
+    {
+        assert(i >= 0 && i < 3);
+        return (&x)[i];
+    }
+    inline float& operator[](const int i)
+    {
+        assert(i >= 0 && i < 3);
+        return (&x)[i];
+    }
 }; // Normal 
 
+static_assert(offsetof(Normal, y) == offsetof(Normal, x) + sizeof(float) && offsetof(Normal, z) == offsetof(Normal, y) + sizeof(float) &&
+    sizeof(Normal) == 3 * sizeof(float), "Normal's components aren't contiguous");
+
 /* GLOBAL INLINE FUNCTIONS (that only use Normals) */
 // note that Normal does not have a cross() function--the cross product of two normals does not behave as expected
-inline float dot(const Normal& n1, const Normal& n2)
+constexpr float dot(const Normal& n1, const Normal& n2)
 {
     return n1.x*n2.x + n1.y*n2.y + n1.z*n2.z;
 }
@@ -264,15 +356,24 @@ inline Normal normalize(const Normal& n)
     return n / n.length();
 }
 
+constexpr Normal abs(const Normal& n)
+{
+    return Normal(
+        n.x < 0.0f ? -n.x : n.x,
+        n.y < 0.0f ? -n.y : n.y,
+        n.z < 0.0f ? -n.z : n.z
+    );
+}
+
 /* EXPLICIT CONSTRUCTOR BODIES */
 // defining the bodies here (or in a .cpp file, but i wanna keep everything here) breaks the circular definition cycle 
-inline Vector::Vector(const Normal& n) :
+constexpr Vector::Vector(const Normal& n) :
     x(n.x),
     y(n.y),
     z(n.z)
 {}
 
-inline Normal::Normal(const Vector& v) :
+constexpr Normal::Normal(const Vector& v) :
     x(v.x),
     y(v.y),
     z(v.z)
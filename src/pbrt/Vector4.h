@@ -0,0 +1,271 @@
+/*
+    Vector4 is four floats (x, y, z, w) aligned to 16 bytes, so it loads into a single SSE register
+
+    it's the register sized counterpart to Vector and Point for kernels that work on whole rows or
+    several components at once, e.g. a bbox slab test can do its three axes in one Vector4
+    a Vector converts with w = 0 and a Point with w = 1, like the homogeneous coordinates Mat4 works on
+
+    every operation is component-wise, except the horizontal ones (hmin, hmax, hsum, dot) which reduce
+    the four lanes to one float
+    with SSE (the same RT_VECTOR4_SSE switch as Mat4's RT_MAT4_SSE) each one is a few instructions,
+    otherwise it's plain scalar code over the four components
+*/
+
+#ifndef VECTOR4_H
+#define VECTOR4_H
+
+#include <stddef.h>
+
+#include <cassert>
+#include <cmath>
+
+#include "Point.h"
+
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(RT_NO_SIMD)
+#define RT_VECTOR4_SSE 1
+#include <immintrin.h>
+#endif
+
+class alignas(16) Vector4
+{
+public:
+    /* PUBLIC MEMBERS */
+    float x, y, z, w;
+
+    /* CONSTRUCTORS */
+    constexpr Vector4() :
+        x(0.0f),
+        y(0.0f),
+        z(0.0f),
+        w(0.0f)
+    {}
+    constexpr Vector4(float x, float y, float z, float w) :
+        x(x),
+        y(y),
+        z(z),
+        w(w)
+    {}
+    // f in every lane
+    explicit constexpr Vector4(float f) :
+        x(f),
+        y(f),
+        z(f),
+        w(f)
+    {}
+    explicit constexpr Vector4(const Vector& v, float w = 0.0f) :
+        x(v.x),
+        y(v.y),
+        z(v.z),
+        w(w)
+    {}
+    explicit constexpr Vector4(const Point& p, float w = 1.0f) :
+        x(p.x),
+        y(p.y),
+        z(p.z),
+        w(w)
+    {}
+#ifdef RT_VECTOR4_SSE
+    explicit Vector4(__m128 v)
+    {
+        _mm_store_ps(&x, v);
+    }
+
+    /* PUBLIC METHODS */
+    inline __m128 simd() const
+    {
+        return _mm_load_ps(&x);
+    }
+#endif
+
+    /* PUBLIC METHODS */
+    constexpr Vector xyz() const
+    {
+        return Vector(x, y, z);
+    }
+    constexpr Point point() const
+    {
+        return Point(x, y, z);
+    }
+
+    /* INLINE OPERATOR OVERLOADS */
+    inline Vector4 operator+(const Vector4& v) const
+    {
+#ifdef RT_VECTOR4_SSE
+        return Vector4( _mm_add_ps(simd(), v.simd()) );
+#else
+        return Vector4(x + v.x, y + v.y, z + v.z, w + v.w);
+#endif
+    }
+    inline Vector4& operator+=(const Vector4& v)
+    {
+        return *this = *this + v;
+    }
+
+    inline Vector4 operator-(const Vector4& v) const
+    {
+#ifdef RT_VECTOR4_SSE
+        return Vector4( _mm_sub_ps(simd(), v.simd()) );
+#else
+        return Vector4(x - v.x, y - v.y, z - v.z, w - v.w);
+#endif
+    }
+    inline Vector4& operator-=(const Vector4& v)
+    {
+        return *this = *this - v;
+    }
+
+    // component-wise
+    inline Vector4 operator*(const Vector4& v) const
+    {
+#ifdef RT_VECTOR4_SSE
+        return Vector4( _mm_mul_ps(simd(), v.simd()) );
+#else
+        return Vector4(x * v.x, y * v.y, z * v.z, w * v.w);
+#endif
+    }
+    inline Vector4& operator*=(const Vector4& v)
+    {
+        return *this = *this * v;
+    }
+    inline Vector4 operator*(float f) const
+    {
+        return *this * Vector4(f);
+    }
+
+    // component-wise
+    inline Vector4 operator/(const Vector4& v) const
+    {
+#ifdef RT_VECTOR4_SSE
+        return Vector4( _mm_div_ps(simd(), v.simd()) );
+#else
+        return Vector4(x / v.x, y / v.y, z / v.z, w / v.w);
+#endif
+    }
+    inline Vector4& operator/=(const Vector4& v)
+    {
+        return *this = *this / v;
+    }
+    inline Vector4 operator/(float f) const
+    {
+        return *this * (1.0f / f);
+    }
+
+    inline Vector4 operator-() const
+    {
+        return Vector4(0.0f) - *this;
+    }
+
+    inline float operator[](const int i) const
+    {
+        assert(i >= 0 && i < 4);
+        return (&x)[i];
+    }
+    inline float& operator[](const int i)
+    {
+        assert(i >= 0 && i < 4);
+        return (&x)[i];
+    }
+}; // Vector4
+
+// operator[] and the SSE loads and stores treat x, y, z, w as an array
+static_assert(offsetof(Vector4, y) == offsetof(Vector4, x) + sizeof(float) && offsetof(Vector4, z) == offsetof(Vector4, y) + sizeof(float) &&
+    offsetof(Vector4, w) == offsetof(Vector4, z) + sizeof(float) && sizeof(Vector4) == 4 * sizeof(float), "Vector4's components aren't contiguous");
+
+/* GLOBAL INLINE FUNCTIONS */
+// component-wise, these pick the second argument when either is NaN, like minps/maxps
+inline Vector4 min(const Vector4& a, const Vector4& b)
+{
+#ifdef RT_VECTOR4_SSE
+    return Vector4( _mm_min_ps(a.simd(), b.simd()) );
+#else
+    return Vector4(
+        a.x < b.x ? a.x : b.x,
+        a.y < b.y ? a.y : b.y,
+        a.z < b.z ? a.z : b.z,
+        a.w < b.w ? a.w : b.w
+    );
+#endif
+}
+
+inline Vector4 max(const Vector4& a, const Vector4& b)
+{
+#ifdef RT_VECTOR4_SSE
+    return Vector4( _mm_max_ps(a.simd(), b.simd()) );
+#else
+    return Vector4(
+        a.x > b.x ? a.x : b.x,
+        a.y > b.y ? a.y : b.y,
+        a.z > b.z ? a.z : b.z,
+        a.w > b.w ? a.w : b.w
+    );
+#endif
+}
+
+inline Vector4 abs(const Vector4& v)
+{
+#ifdef RT_VECTOR4_SSE
+    // clears the sign bits
+    return Vector4( _mm_andnot_ps(_mm_set1_ps(-0.0f), v.simd()) );
+#else
+    return Vector4( fabsf(v.x), fabsf(v.y), fabsf(v.z), fabsf(v.w) );
+#endif
+}
+
+// a * b + c, a single rounding only when built with FMA (-mfma / -march=native)
+inline Vector4 fma(const Vector4& a, const Vector4& b, const Vector4& c)
+{
+#if defined(RT_VECTOR4_SSE) && defined(__FMA__)
+    return Vector4( _mm_fmadd_ps(a.simd(), b.simd(), c.simd()) );
+#else
+    return a * b + c;
+#endif
+}
+
+// horizontal
+inline float hmin(const Vector4& v)
+{
+#ifdef RT_VECTOR4_SSE
+    __m128 r = v.simd();
+    r = _mm_min_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_min_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+#else
+    float a = v.x < v.y ? v.x : v.y;
+    float b = v.z < v.w ? v.z : v.w;
+    return a < b ? a : b;
+#endif
+}
+
+inline float hmax(const Vector4& v)
+{
+#ifdef RT_VECTOR4_SSE
+    __m128 r = v.simd();
+    r = _mm_max_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_max_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+#else
+    float a = v.x > v.y ? v.x : v.y;
+    float b = v.z > v.w ? v.z : v.w;
+    return a > b ? a : b;
+#endif
+}
+
+inline float hsum(const Vector4& v)
+{
+#ifdef RT_VECTOR4_SSE
+    __m128 r = v.simd();
+    r = _mm_add_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)));
+    r = _mm_add_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(r);
+#else
+    return (v.x + v.y) + (v.z + v.w);
+#endif
+}
+
+// all four lanes
+inline float dot(const Vector4& a, const Vector4& b)
+{
+    return hsum(a * b);
+}
+
+#endif // VECTOR4_H
@@ -81,11 +81,19 @@ namespace rt
         return (180.0f / PI) * radians;
     }
     
-    static uint32_t RNG_SEED = std::random_device{}(); // could be set to anything, like 0, 50, 234234234234, etc.
-    //static uint32_t RNG_SEED = 8008135;
-    static std::mt19937 rng(RNG_SEED);
+    inline uint32_t RNG_SEED = std::random_device{}(); // could be set to anything, like 0, 50, 234234234234, etc.
+    //inline uint32_t RNG_SEED = 8008135;
+    // every thread gets its own generator, so render threads never share (or race on) rng state
+    inline thread_local std::mt19937 rng(RNG_SEED);
 
-    static std::uniform_real_distribution<float> float_dist(0.0f, 1.0f);
+    // reseeds the calling thread's rng
+    // the renderer reseeds per tile, which keeps images reproducible no matter which thread renders which tile
+    inline void seedRNG(uint32_t seed)
+    {
+        rng.seed(seed);
+    }
+
+    inline thread_local std::uniform_real_distribution<float> float_dist(0.0f, 1.0f);
     // definitions of both functions @ (pg. 857) of pbrt 
     // these are not the definitions they refer to, but this should work for now
     inline float randomFloat()
@@ -93,7 +101,7 @@ namespace rt
         return float_dist(rng);
     }
     
-    static std::uniform_int_distribution<uint32_t> int_dist( 0, std::numeric_limits<uint32_t>::max() );
+    inline thread_local std::uniform_int_distribution<uint32_t> int_dist( 0, std::numeric_limits<uint32_t>::max() );
     inline uint32_t randomUInt()
     {
         return int_dist(rng);
@@ -155,6 +163,24 @@ namespace rt
         return ptr;
     }
     
+    // spreads the low 10 bits of x out to every third bit (pg. 268 of pbrt 3rd ed.)
+    constexpr uint32_t leftShift3(uint32_t x)
+    {
+        x &= 0x3ff;
+        x = (x | (x << 16)) & 0x030000ff;
+        x = (x | (x <<  8)) & 0x0300f00f;
+        x = (x | (x <<  4)) & 0x030c30c3;
+        x = (x | (x <<  2)) & 0x09249249;
+
+        return x;
+    }
+
+    // 30 bit Morton code of a point on a 1024^3 grid, the bits of x, y and z interleaved (x lowest)
+    constexpr uint32_t encodeMorton3(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return (leftShift3(z) << 2) | (leftShift3(y) << 1) | leftShift3(x);
+    }
+    
     /* SAMPLING GLOBAL FUNCTIONS */
     // implementations @ (pg. 308) of pbrt 2nd ed.
     constexpr void stratifiedSample1D(float* sample, int n_samples, bool jitter)
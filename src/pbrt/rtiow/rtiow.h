@@ -3,6 +3,8 @@
 
 #include <SDL3/SDL.h>
 
+#include <string.h>
+
 #include <vector>
 
 #include "pbrt.h"
@@ -10,6 +12,12 @@
 #include "Sphere.h"
 #include "Camera.h"
 #include "Sample.h"
+#include "Film.h"
+#include "Heatmap.h"
+#include "PerfCounters.h"
+#include "Scene.h"
+#include "Renderer.h"
+#include "Trace.h"
 
 struct RayTracingInOneWeekend
 {
@@ -20,6 +28,13 @@ public:
     static constexpr float aspectRatio = float(width) / float(height);
 
     std::vector<std::shared_ptr<Shape>> shapes;
+    std::unique_ptr<Scene> scene;
+    Film film { (int)width, (int)height };
+
+    // diagnostic view, cycled with toggleHeatmap()
+    Heatmap heatmap { (int)width, (int)height };
+    bool showHeatmap { false };
+    float heatmap_lo { 0.0f }, heatmap_hi { 0.0f }, heatmap_max { 0.0f }; // color scale, and the real max
 
     SDL_Renderer* renderer { nullptr };
     SDL_Texture* texture { nullptr };
@@ -41,7 +56,7 @@ public:
     float shutter_close { 0.0f };
     float lensRadius { 1.0f };
     float focalDistance { 1.0f };
-    Transform camera_to_world = Transform::translate( Vector(0, 0, 1) );
+    static constexpr Transform camera_to_world = Transform::translate( Vector(0, 0, 1) ); // folded at compile time
     OrthographicCamera camera {
         camera_to_world,
         screen,
@@ -50,16 +65,13 @@ public:
         shutter_open,
         shutter_close,
         lensRadius,
-        focalDistance
+        focalDistance,
+        &film
     };
 
     // sampler stuff
-    const int x_start = 0, x_end = width;
-    const int y_start = 0, y_end = height;
     const int x_samples = 1, y_samples = 1;
     const bool jitter = false;
-    StratifiedSampler sampler{  x_start, x_end, y_start, y_end, x_samples, y_samples, jitter };
-    Sample sample { 0, 0, 0, 0, 0 };
     
     /* CONSTRUCTORS */
     RayTracingInOneWeekend(SDL_Renderer* renderer) :
@@ -69,6 +81,7 @@ public:
         texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, width, height);
         
         // shape stuff
+        TRACE_SCOPE("build", "scene build");
         printf("[RTIOW] creating shapes ...\n");
         
         float zmin = -1;
@@ -79,6 +92,9 @@ public:
         std::shared_ptr<Sphere> sphere = std::make_shared<Sphere>(world_to_sphere.getInverse(), false, 1.0f, zmin, zmax, phi);
         
         shapes.push_back(sphere);
+
+        printf("[RTIOW] building scene ...\n");
+        scene = std::make_unique<Scene>(shapes);
     }
     
     /* DECONSTRUCTORS */
@@ -128,72 +144,91 @@ public:
     void samplePixels()
     {
         printf("[RTIOW] sampling pixels ...\n");
+
+        Renderer renderer(*scene, camera, film, x_samples, y_samples, jitter);
+        film.clear();
+        if(showHeatmap)
+        {
+            heatmap.clear();
+            renderer.heatmap = &heatmap;
+        }
+        uint64_t rays = renderer.render();
+        
+        printf("\tsampler generated %llu samples\n", (unsigned long long)rays);
+        if( stats::enabled() )
+        {
+            stats::print(stdout);
+            stats::clear();
+        }
+        if( perf::active() )
+        {
+            perf::print(stdout);
+            perf::clear();
+        }
         
+        // put pixel colors in SDL texture
+        TRACE_SCOPE("sdl", "texture upload");
         void* pixels = nullptr;
         int pitch = 0;
-        if( SDL_LockTexture(texture, nullptr, &pixels, &pitch) != 0)
+        if( !SDL_LockTexture(texture, nullptr, &pixels, &pitch) )
         {
             printf("[RTIOW] failed to lock texture: %s\n", SDL_GetError());
+            return;
         }
-        
-        int samplerSampleCount = 0;
-        // for each pixel 
-        Ray ray; 
-        while( sampler.getNextSample(&sample) )
+
+        if(showHeatmap)
         {
-            //printf("sample %i : image_x=%f | image_y=%f\n", samplerSampleCount, sample.image_x, sample.image_y);
-            samplerSampleCount++; 
+            heatmap.resolve(pixels, pitch);
+            float min;
+            heatmap.scaleRange(&heatmap_lo, &heatmap_hi);
+            heatmap.range(&min, &heatmap_max);
+            printf("\theatmap of %s: scale %g - %g, max %g\n", Heatmap::metricName(heatmap.metric), heatmap_lo, heatmap_hi, heatmap_max);
+        }
+        else
+            film.resolve(pixels, pitch);
 
-            camera.generateRay(sample, &ray);
-            //printf("\tray o = (%.2f %.2f %.2f)\n", ray.o.x, ray.o.y, ray.o.z);
-            //printf("\tray d = (%.2f %.2f %.2f)\n\n", ray.d.x, ray.d.y, ray.d.z);
+        SDL_UnlockTexture(texture);
+    }
 
-            // test ray intersection on all shapes
-            bool hit = false;
-            for(auto& shape : shapes)
-            {
-                float thit = 0; // this it not actually used btw, it's just here so the intersection function can be called (for now)
-                if( shape->intersect(ray, &thit, nullptr) )
-                {
-                    hit = true;
+    // cycles the view through image -> time heatmap -> BVH nodes heatmap -> shape tests heatmap -> image, and re-renders
+    void toggleHeatmap()
+    {
+        if(!showHeatmap)
+        {
+            showHeatmap = true;
+            heatmap.metric = Heatmap::Time;
+        }
+        else if(heatmap.metric + 1 < Heatmap::N_METRICS)
+            heatmap.metric = (Heatmap::Metric)(heatmap.metric + 1);
+        else
+            showHeatmap = false;
 
-                    break;
-                }
-            }
-            
-            // color purple if hits, otherwise do a sky gradient
-            Vector color;
-            if(hit)
-            {
-                color = Vector(0.9f, 0.2f, 0.9f); // purple 
-            }
-            else
-            {
-                Vector dir = normalize(ray.d);
-                float tt = 0.5f * (dir.y + 1.0f);
-                Vector white(1.0f, 1.0f, 1.0f);
-                Vector blue(0.5f, 0.7f, 1.0f);
-                color = white * (1.0f - tt) + blue * tt;
-            }
-            
-            // put pixel color in SDL texture 
-            int ix = static_cast<int>(sample.image_x);
-            int iy = static_cast<int>(sample.image_y);
-            if(ix >= 0 && ix < static_cast<int>(width) && iy >= 0 && iy <= static_cast<int>(height))
-            {
-                uint8_t r = (u_int8_t)(255.0f * std::clamp(color.x, 0.0f, 1.0f));
-                uint8_t g = (u_int8_t)(255.0f * std::clamp(color.y, 0.0f, 1.0f));
-                uint8_t b = (u_int8_t)(255.0f * std::clamp(color.z, 0.0f, 1.0f));
-                uint8_t a = 255.0f;
-                
-                uint32_t* row = (uint32_t*)((uint8_t*)pixels + iy * pitch);
-                row[ix] = (r << 24) | (g << 16) | (b << 8) | a;
-            }
+        samplePixels();
+    }
+
+    // draws the heatmap's color bar along the bottom of the window, labeled with the values at either end
+    void drawHeatmapLegend()
+    {
+        int w = 0, h = 0;
+        SDL_GetCurrentRenderOutputSize(renderer, &w, &h);
+        if(w <= 1) return;
+
+        const float barHeight = 12.0f;
+        float y0 = h - barHeight;
+        for(int x = 0; x < w; x++)
+        {
+            uint32_t c = Heatmap::falseColor( (float)x / (w - 1) );
+            SDL_SetRenderDrawColor(renderer, (c >> 24) & 0xff, (c >> 16) & 0xff, (c >> 8) & 0xff, 255);
+            SDL_RenderLine(renderer, (float)x, y0, (float)x, (float)h);
         }
-        
-        printf("\tsampler generated %i samples\n", samplerSampleCount);
 
-        SDL_UnlockTexture(texture);
+        char label[96];
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+        snprintf(label, sizeof(label), "%s: %g", Heatmap::metricName(heatmap.metric), heatmap_lo);
+        SDL_RenderDebugText(renderer, 2.0f, y0 - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE - 2.0f, label);
+        snprintf(label, sizeof(label), "%g (max %g)", heatmap_hi, heatmap_max);
+        SDL_RenderDebugText(renderer, w - 2.0f - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE * strlen(label),
+            y0 - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE - 2.0f, label);
     }
 
     // draws canvas to SDL texture
@@ -205,6 +240,7 @@ public:
         //SDL_UpdateTexture(texture, nullptr, canvas.data(), width * sizeof(uint32_t));
 
         SDL_RenderTexture(renderer, texture, nullptr, nullptr);
+        if(showHeatmap) drawHeatmapLegend();
     }
 };
 
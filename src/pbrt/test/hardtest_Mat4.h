@@ -173,6 +173,61 @@ namespace hardtest_mat4 {
             }
     }
 
+    // the SSE kernels (multiply, getTranspose, getInverse) against the scalar code, over the same kind of random matrices
+    // multiply rounds like the scalar code does on every instruction set (it never fuses), so it matches exactly
+    inline void test_simd_matches_scalar(int trials = 1000) {
+        std::mt19937_64 rng(24680);
+        std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+        for (int t = 0; t < trials; ++t) {
+            float a[16], b[16];
+            for (int i = 0; i < 16; ++i) {
+                a[i] = dist(rng);
+                b[i] = dist(rng);
+            }
+            // diagonal dominance, like test_random_inverse, so the inverse is well conditioned
+            for (int i = 0; i < 4; ++i) {
+                float rowsum = 0.0f;
+                for (int j = 0; j < 4; ++j)
+                    rowsum += std::fabs(a[i*4 + j]);
+                a[i*4 + i] += rowsum + 1.0f;
+            }
+            Mat4 A(a), B(b);
+
+            Mat4 C1 = Mat4::multiply(A, B), C2 = Mat4::multiplyScalar(A, B);
+            Mat4 T1 = A.getTranspose(), T2 = A.getTransposeScalar();
+            bool s1 = true, s2 = true;
+            Mat4 I1 = A.getInverse(&s1), I2 = A.getInverseScalar(&s2);
+            assert(!s1 && !s2);
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j) {
+                    assert(C1.m[i][j] == C2.m[i][j]);
+                    assert(T1.m[i][j] == T2.m[i][j]);
+                    assert(feq(I1.m[i][j], I2.m[i][j]));
+                }
+
+            // and on general random matrices, the inverse still inverts
+            Mat4 Binv = B.getInverse(&s1);
+            if (!s1) {
+                Mat4 P = Mat4::multiply(B, Binv);
+                for (int i = 0; i < 4; ++i)
+                    for (int j = 0; j < 4; ++j)
+                        assert(std::fabs(P.m[i][j] - ((i == j) ? 1.0f : 0.0f)) < 1e-2f);
+            }
+        }
+
+        // singular matrices are flagged and give the identity, like the scalar code
+        float rank3[16] = { 1,2,3,4, 2,4,6,8, 0,1,0,1, 1,0,0,1 }; // row 1 = 2 * row 0
+        float zero[16] = {0};
+        for (const float* m : { rank3, zero }) {
+            bool s = false;
+            Mat4 I = Mat4(*reinterpret_cast<const float(*)[16]>(m)).getInverse(&s);
+            assert(s);
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    assert(I.m[i][j] == ((i == j) ? 1.0f : 0.0f));
+        }
+    }
+
     // run ’em all
     inline void run_all_hard_Mat4_tests() {
         test_random_multiplication();
@@ -182,6 +237,7 @@ namespace hardtest_mat4 {
         test_random_inverse();
         test_zero_multiplication();
         test_inverse_of_identity();
+        test_simd_matches_scalar();
         std::cout << "[hardtest_mat4] all rigorous tests passed\n";
     }
 }
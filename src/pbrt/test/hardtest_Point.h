@@ -101,11 +101,15 @@ namespace hardtest_point {
         }
     }
 
-    // out‐of‐range returns NAN
-    inline void test_index_oob() {
-        Point p(1.0f, 2.0f, 3.0f);
-        float val = p[42];
-        assert(std::isnan(val));
+    // every index writes through to the matching member
+    inline void test_index_write() {
+        for (int i = 0; i < 3; ++i) {
+            Point p(1.0f, 2.0f, 3.0f);
+            p[i] = -7.0f;
+            assert(p.x == (i == 0 ? -7.0f : 1.0f));
+            assert(p.y == (i == 1 ? -7.0f : 2.0f));
+            assert(p.z == (i == 2 ? -7.0f : 3.0f));
+        }
     }
 
     inline void run_all_hard_Point_tests() {
@@ -114,7 +118,7 @@ namespace hardtest_point {
         test_compound_vs_simple();
         test_point_vector_roundtrip();
         test_index_inbounds();
-        test_index_oob();
+        test_index_write();
         std::cout << "[hardtest_point] all rigorous Point tests passed\n";
     }
 }
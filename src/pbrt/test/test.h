@@ -9,15 +9,31 @@
 
 #include "test_Transform.h"
 #include "hardtest_Transform.h"
+#include "test_AffineTransform.h"
+#include "test_TransformCache.h"
 
 #include "test_Ray.h"
 
 #include "test_Vector.h"
+#include "test_Vector4.h"
+#include "test_Packet.h"
 
 #include "test_Bbox.h"
 
 #include "test_Camera.h"
 
+#include "test_Sphere.h"
+
+#include "test_BVH.h"
+#include "test_SphereSoup.h"
+#include "test_TriangleMesh.h"
+#include "test_MeshLoader.h"
+#include "test_SceneCache.h"
+#include "test_Renderer.h"
+#include "test_RayQueue.h"
+
+#include "test_Stats.h"
+
 namespace test {
     inline void run_all_tests() {
         test_mat4::run_all_mat4_tests();
@@ -28,14 +44,30 @@ namespace test {
 
         test_transform::run_all_transform_tests();
         //hardtest_transform::run_all_hard_Transform_tests(); // doesnt pass
+        test_affine_transform::run_all_affine_transform_tests();
+        test_transform_cache::run_all_transform_cache_tests();
 
         test_ray::run_all_ray_tests();
         
         test_vector::run_all_vector_tests();
+        test_vector4::run_all_vector4_tests();
+        test_packet::run_all_packet_tests();
         
         test_bbox::run_all_bbox_tests();
         
         test_camera::run_all_camera_tests();
+        
+        test_sphere::run_all_sphere_tests();
+        
+        test_bvh::run_all_bvh_tests();
+        test_sphere_soup::run_all_sphere_soup_tests();
+        test_triangle_mesh::run_all_triangle_mesh_tests();
+        test_mesh_loader::run_all_mesh_loader_tests();
+        test_scene_cache::run_all_scene_cache_tests();
+        test_renderer::run_all_renderer_tests();
+        test_ray_queue::run_all_ray_queue_tests();
+
+        test_stats::run_all_stats_tests();
     }
 }
 
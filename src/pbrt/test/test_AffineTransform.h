@@ -0,0 +1,214 @@
+#ifndef TEST_AFFINE_TRANSFORM_H
+#define TEST_AFFINE_TRANSFORM_H
+
+#include "AffineTransform.h"
+#include "SoA.h"
+#include "pbrt.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace test_affine_transform {
+    static constexpr float EPS = 1e-4f;
+
+    // relative for large values, a transformed point can be ~100 away from the origin
+    inline bool feq(float a, float b) {
+        return std::fabs(a - b) <= EPS * std::fmax(1.0f, std::fmax(std::fabs(a), std::fabs(b)));
+    }
+    inline bool peq(const Point& a, const Point& b) {
+        return feq(a.x, b.x) && feq(a.y, b.y) && feq(a.z, b.z);
+    }
+    inline bool veq(const Vector& a, const Vector& b) {
+        return feq(a.x, b.x) && feq(a.y, b.y) && feq(a.z, b.z);
+    }
+    inline bool neq(const Normal& a, const Normal& b) {
+        return feq(a.x, b.x) && feq(a.y, b.y) && feq(a.z, b.z);
+    }
+
+    // translate * rotateX * rotateY * rotateZ * scale, with a negative scale now and then
+    inline Transform randomAffine(std::mt19937& rng) {
+        std::uniform_real_distribution<float> pos(-10.0f, 10.0f);
+        std::uniform_real_distribution<float> angle(0.0f, rt::TWOPI);
+        std::uniform_real_distribution<float> s(0.25f, 4.0f);
+        std::uniform_int_distribution<int> flip(0, 3);
+        return Transform::translate(Vector(pos(rng), pos(rng), pos(rng))) *
+               Transform::rotateX(angle(rng)) * Transform::rotateY(angle(rng)) * Transform::rotateZ(angle(rng)) *
+               Transform::scale(flip(rng) == 0 ? -s(rng) : s(rng), s(rng), s(rng));
+    }
+
+    inline void test_identity() {
+        AffineTransform A;
+        Point p(1, 2, 3);
+        assert(peq(A(p), p));
+        assert(veq(A(Vector(4, 5, 6)), Vector(4, 5, 6)));
+        assert(peq(A.getInverse()(p), p));
+        assert(!A.swapsHandedness());
+        assert(A.toTransform().isAffine());
+    }
+
+    inline void test_isAffine() {
+        assert(Transform().isAffine());
+        assert(Transform::translate(Vector(1, 2, 3)).isAffine());
+        assert(Transform::lookAt(Point(1, 2, 3), Point(0, 0, 0), Vector(0, 1, 0)).isAffine());
+        assert(Transform::orthographic(0.1f, 100.0f).isAffine());
+        Mat4 projective(1, 0, 0, 0,
+                        0, 1, 0, 0,
+                        0, 0, 1, 0,
+                        0, 0, 1, 0);
+        assert(!Transform(projective, projective).isAffine());
+
+        // the checked conversion turns a projection down in any build, and leaves its output alone
+        AffineTransform A;
+        assert(!AffineTransform::fromTransform(Transform(projective, projective), &A));
+        assert(peq(A(Point(1, 2, 3)), Point(1, 2, 3)));
+        assert(AffineTransform::fromTransform(Transform::translate(Vector(1, 2, 3)), &A));
+        assert(peq(A(Point(0, 0, 0)), Point(1, 2, 3)) && peq(A.getInverse()(Point(1, 2, 3)), Point(0, 0, 0)));
+    }
+
+    inline void test_isTranslateScale() {
+        float s = 0.0f;
+        assert(AffineTransform().isTranslateScale(&s) && s == 1.0f);
+        assert(AffineTransform(Transform::translate(Vector(1, 2, 3)) * Transform::scale(-2, -2, -2)).isTranslateScale(&s));
+        assert(s == -2.0f);
+        assert(!AffineTransform(Transform::scale(1, 2, 1)).isTranslateScale(&s));
+        assert(!AffineTransform(Transform::scale(0, 0, 0)).isTranslateScale(&s));
+        assert(!AffineTransform(Transform::rotateZ(0.5f)).isTranslateScale(&s));
+    }
+
+    // every operator gives what the general Transform gives
+    inline void test_matches_transform() {
+        std::mt19937 rng(35);
+        std::uniform_real_distribution<float> u(-5.0f, 5.0f);
+        for (int i = 0; i < 500; ++i) {
+            Transform T = randomAffine(rng);
+            AffineTransform A(T);
+            assert(A.swapsHandedness() == T.swapsHandedness());
+
+            Point p(u(rng), u(rng), u(rng));
+            Vector v(u(rng), u(rng), u(rng));
+            Normal n(u(rng), u(rng), u(rng));
+            assert(peq(A(p), T(p)));
+            assert(veq(A(v), T(v)));
+            assert(neq(A(n), T(n)));
+
+            Point pp; A(p, &pp);
+            assert(peq(pp, T(p)));
+            Normal nn, tn; A(n, &nn); T(n, &tn);
+            assert(neq(nn, tn));
+
+            Ray r(p, v, 0.5f, 20.0f);
+            Ray ra = A(r), rt = T(r);
+            assert(peq(ra.o, rt.o) && veq(ra.d, rt.d));
+            assert(ra.t_min == r.t_min && ra.t_max == r.t_max);
+
+            Point back = A.getInverse()(A(p));
+            assert(peq(back, p));
+        }
+    }
+
+    inline void test_composition() {
+        std::mt19937 rng(36);
+        std::uniform_real_distribution<float> u(-5.0f, 5.0f);
+        for (int i = 0; i < 200; ++i) {
+            Transform T1 = randomAffine(rng), T2 = randomAffine(rng);
+            AffineTransform A = AffineTransform(T1) * AffineTransform(T2);
+            Transform T = T1 * T2;
+            Point p(u(rng), u(rng), u(rng));
+            assert(peq(A(p), T(p)));
+            assert(peq(A.getInverse()(p), T.getInverse()(p)));
+        }
+    }
+
+    // Arvo's method bounds exactly what the 8 corners bound
+    inline void test_bbox() {
+        std::mt19937 rng(37);
+        std::uniform_real_distribution<float> u(-5.0f, 5.0f);
+        for (int i = 0; i < 500; ++i) {
+            Transform T = randomAffine(rng);
+            Bbox box(Point(u(rng), u(rng), u(rng)), Point(u(rng), u(rng), u(rng)));
+
+            Bbox corners(T(Point(box.p_min.x, box.p_min.y, box.p_min.z)));
+            for (int c = 1; c < 8; ++c)
+                corners = Bbox::Union(corners, T(Point(box[c & 1].x, box[(c >> 1) & 1].y, box[(c >> 2) & 1].z)));
+
+            Bbox arvo = AffineTransform(T)(box);
+            assert(peq(arvo.p_min, corners.p_min) && peq(arvo.p_max, corners.p_max));
+            Bbox general = T(box);
+            assert(peq(general.p_min, corners.p_min) && peq(general.p_max, corners.p_max));
+        }
+
+        // a degenerate box is a point, an empty box stays empty
+        Transform T = randomAffine(rng);
+        Point p(1, 2, 3);
+        Bbox b = AffineTransform(T)(Bbox(p));
+        assert(peq(b.p_min, T(p)) && peq(b.p_max, T(p)));
+        Bbox empty = AffineTransform(T)(Bbox());
+        assert(empty.p_min.x > empty.p_max.x);
+    }
+
+    // the batch transforms give what one at a time gives, for lengths that leave an SSE tail
+    inline void test_batch() {
+        std::mt19937 rng(38);
+        std::uniform_real_distribution<float> u(-5.0f, 5.0f);
+        Mat4 p(1, 0, 0, 0,
+               0, 1, 0, 0,
+               0, 0, 1, 0,
+               0, 0, 1, 0);
+
+        for (size_t n : {0, 1, 3, 4, 7, 33}) {
+            Transform T = randomAffine(rng);
+            AffineTransform A(T);
+            Transform P = Transform(p, p) * T;
+
+            SoA3Buffer inBuffer(n), dirBuffer(n), outBuffer(n), dirOutBuffer(n);
+            SoA3 in = inBuffer.soa(), dir = dirBuffer.soa(), out = outBuffer.soa(), dirOut = dirOutBuffer.soa();
+            for (size_t i = 0; i < n; ++i) {
+                in.set(i, u(rng), u(rng), u(rng));
+                dir.set(i, u(rng), u(rng), u(rng));
+            }
+
+            A.transformPoints(in, out, n);
+            for (size_t i = 0; i < n; ++i) assert(peq(out.point(i), A(in.point(i))));
+            T.transformPoints(in, out, n);
+            for (size_t i = 0; i < n; ++i) assert(peq(out.point(i), T(in.point(i))));
+            P.transformPoints(in, out, n);
+            for (size_t i = 0; i < n; ++i) {
+                Point q = P(in.point(i));
+                if (std::isfinite(q.x) && std::fabs(q.x) < 1e3f) assert(peq(out.point(i), q));
+            }
+
+            A.transformVectors(dir, out, n);
+            for (size_t i = 0; i < n; ++i) assert(veq(out.vector(i), A(dir.vector(i))));
+            T.transformNormals(dir, out, n);
+            for (size_t i = 0; i < n; ++i) assert(neq(out.normal(i), T(dir.normal(i))));
+            A.transformNormals(dir, out, n);
+            for (size_t i = 0; i < n; ++i) assert(neq(out.normal(i), A(dir.normal(i))));
+
+            A.transformRays(in, dir, out, dirOut, n);
+            for (size_t i = 0; i < n; ++i) {
+                Ray r = A(Ray(in.point(i), dir.vector(i)));
+                assert(peq(out.point(i), r.o) && veq(dirOut.vector(i), r.d));
+            }
+
+            // in place
+            std::vector<Point> before(n);
+            for (size_t i = 0; i < n; ++i) before[i] = in.point(i);
+            A.transformPoints(in, in, n);
+            for (size_t i = 0; i < n; ++i) assert(peq(in.point(i), A(before[i])));
+        }
+    }
+
+    inline void run_all_affine_transform_tests() {
+        test_identity();
+        test_isAffine();
+        test_isTranslateScale();
+        test_matches_transform();
+        test_composition();
+        test_bbox();
+        test_batch();
+        std::cout << "[test_affine_transform] all AffineTransform tests passed\n";
+    }
+}
+
+#endif // TEST_AFFINE_TRANSFORM_H
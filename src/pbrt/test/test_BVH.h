@@ -0,0 +1,321 @@
+#ifndef TEST_BVH_H
+#define TEST_BVH_H
+
+#include "BVH.h"
+#include "Scene.h"
+#include "Sphere.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace test_bvh {
+    static constexpr float EPS = 1e-4f;
+
+    inline bool feq(float a, float b) {
+        return std::fabs(a - b) <= EPS;
+    }
+
+    inline std::vector<std::shared_ptr<Shape>> randomSpheres(int n, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> pos(-5.0f, 5.0f);
+        std::uniform_real_distribution<float> rad(0.05f, 0.5f);
+        std::vector<std::shared_ptr<Shape>> shapes;
+        for (int i = 0; i < n; ++i)
+            shapes.push_back(std::make_shared<Sphere>(Transform::translate(Vector(pos(rng), pos(rng), pos(rng))), false, rad(rng)));
+        return shapes;
+    }
+
+    // closest hit by testing every shape
+    inline bool bruteForce(const std::vector<std::shared_ptr<Shape>>& shapes, const Ray& ray, float* t_hit) {
+        bool hit = false;
+        for (auto& s : shapes) {
+            Hit h;
+            if (s->intersect(ray, &h) && h.t <= ray.t_max) {
+                hit = true;
+                *t_hit = h.t;
+                ray.t_max = h.t;
+            }
+        }
+        return hit;
+    }
+
+    inline void test_empty() {
+        BVH bvh({});
+        Ray r(Point(0, 0, 0), Vector(0, 0, 1));
+        Hit h;
+        assert(!bvh.intersect(r, &h));
+    }
+
+    // a shape placed by a projection is left out of the tree instead of being bounded wrong
+    inline void test_projective_shape() {
+        Mat4 p(1, 0, 0, 0,
+               0, 1, 0, 0,
+               0, 0, 1, 0,
+               0, 0, 1, 0);
+        std::cout << "[test_bvh] the next two lines are expected errors\n";
+        std::shared_ptr<Shape> projected = std::make_shared<Sphere>(Transform(p, p) * Transform::translate(Vector(0, 0, 5)), false, 1.0f);
+        assert(!projected->validPlacement);
+        std::shared_ptr<Shape> placed = std::make_shared<Sphere>(Transform::translate(Vector(0, 0, 5)), false, 1.0f);
+        assert(placed->validPlacement);
+
+        BVH bvh({ projected, placed });
+        assert(bvh.shapes.size() == 1 && bvh.shapes[0] == placed);
+        Ray r(Point(0, 0, 0), Vector(0, 0, 1));
+        Hit h;
+        assert(bvh.intersect(r, &h) && h.shape == placed.get());
+    }
+
+    inline void test_matches_brute_force() {
+        auto shapes = randomSpheres(500, 7);
+        BVH bvh(shapes);
+        assert(bvh.shapes.size() == shapes.size());
+
+        // the root bounds every shape
+        Bbox root = bvh.worldBound();
+        for (auto& s : shapes) {
+            Bbox b = s->worldBound();
+            assert(root.containsPoint(b.p_min) && root.containsPoint(b.p_max));
+        }
+
+        std::mt19937 rng(99);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        int hits = 0;
+        for (int i = 0; i < 2000; ++i) {
+            Point o(u(rng) * 8, u(rng) * 8, -10);
+            Vector d = normalize(Vector(u(rng) * 0.5f, u(rng) * 0.5f, 1));
+            Ray r1(o, d), r2(o, d);
+            float t2 = -1;
+            Hit hit;
+            bool h1 = bvh.intersect(r1, &hit);
+            bool h2 = bruteForce(shapes, r2, &t2);
+            assert(h1 == h2);
+            if (h1) {
+                ++hits;
+                assert(feq(hit.t, t2));
+                assert(feq(r1.t_max, hit.t));
+                assert(hit.shape != nullptr);
+
+                // the closest hit's geometry, on the shape that was hit
+                DifferentialGeometry dg;
+                hit.shape->getDifferentialGeometry(r1, hit, &dg);
+                assert(dg.shape == hit.shape && hit.shape->worldBound().containsPoint(dg.p));
+            }
+        }
+        assert(hits > 0);
+    }
+
+    // the most nodes on any path from the root to a leaf
+    inline int treeDepth(const BVH& bvh) {
+        std::vector<int> depth(bvh.nodes.size(), 1);
+        int deepest = 0;
+        for (size_t i = 0; i < bvh.nodes.size(); ++i) {
+            deepest = std::max(deepest, depth[i]);
+            if (bvh.nodes[i].nPrimitives == 0)
+                depth[i + 1] = depth[bvh.nodes[i].secondChildOffset] = depth[i] + 1;
+        }
+        return deepest;
+    }
+
+    // spheres 16x apart in size along each axis make the SAH peel one off per level, a chain as deep as there are
+    // spheres, the build has to keep it within MAX_DEPTH or traversal's stack overflows
+    // (2^60 is as large as they get, so their quadratics don't overflow)
+    inline void test_depth_cap() {
+        std::vector<std::shared_ptr<Shape>> shapes;
+        for (int i = -30; i <= 15; ++i) {
+            float x = std::ldexp(1.0f, 4 * i);
+            shapes.push_back(std::make_shared<Sphere>(Transform::translate(Vector(x, 0, 0)), false, 0.25f * x));
+            shapes.push_back(std::make_shared<Sphere>(Transform::translate(Vector(0, 0.7f * x, 0)), false, 0.175f * x));
+            shapes.push_back(std::make_shared<Sphere>(Transform::translate(Vector(0, 0, 0.5f * x)), false, 0.125f * x));
+        }
+        BVH bvh(shapes);
+        assert(bvh.shapes.size() == shapes.size());
+        assert(treeDepth(bvh) <= BVH::MAX_DEPTH);
+
+        // a ray along y at each sphere on the x axis hits what brute force hits, at the same t
+        int hits = 0;
+        for (int i = -30; i <= 15; ++i) {
+            float x = std::ldexp(1.0f, 4 * i);
+            Ray r1(Point(x, -x, 0), Vector(0, 1, 0)), r2 = r1, r3 = r1;
+            Hit hit;
+            float t = -1;
+            bool h1 = bvh.intersect(r1, &hit);
+            bool h2 = bruteForce(shapes, r2, &t);
+            assert(h1 == h2 && bvh.intersectP(r3) == h1);
+            if (h1) {
+                ++hits;
+                assert(hit.t == t);
+            }
+        }
+        assert(hits > 0);
+    }
+
+    inline void test_traversal_cost() {
+        auto shapes = randomSpheres(500, 7);
+        BVH bvh(shapes);
+
+        // a ray that misses the root box visits just the root, and tests no shapes
+        Ray miss(Point(100, 100, 100), Vector(0, 0, 1));
+        Hit t;
+        TraversalCost cost;
+        assert(!bvh.intersect(miss, &t, &cost));
+        assert(cost.nodesVisited == 1 && cost.shapeTests == 0);
+
+        // a hit has to reach a leaf, and costs accumulate over calls
+        Bbox b = shapes[0]->worldBound();
+        Point c = b.p_min + (b.p_max - b.p_min) * 0.5f;
+        Ray aim(Point(c.x, c.y, -10), Vector(0, 0, 1));
+        TraversalCost before = cost;
+        assert(bvh.intersect(aim, &t, &cost));
+        assert(cost.nodesVisited > before.nodesVisited + 1);
+        assert(cost.shapeTests > before.shapeTests);
+    }
+
+    // a sphere that only has the scalar intersect(), so packets go through Shape's one-lane-at-a-time fallback
+    class ScalarSphere : public Shape {
+    public:
+        Sphere sphere;
+        ScalarSphere(const Transform& object_to_world, float radius) :
+            Shape(object_to_world), sphere(object_to_world, false, radius) {}
+        Bbox objectBound() const override { return sphere.objectBound(); }
+        bool intersect(const Ray& ray, Hit* hit) const override { return sphere.intersect(ray, hit); }
+        bool doesIntersect(const Ray& ray) const override { return sphere.doesIntersect(ray); }
+        void getDifferentialGeometry(const Ray& ray, const Hit& hit, DifferentialGeometry* dg) const override { sphere.getDifferentialGeometry(ray, hit, dg); }
+    };
+
+    // full spheres, spheres cut off in z or phi (their clipped lanes finish on the scalar path) and ScalarSpheres
+    inline std::vector<std::shared_ptr<Shape>> mixedShapes(int n, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> pos(-5.0f, 5.0f);
+        std::uniform_real_distribution<float> rad(0.1f, 0.8f);
+        std::vector<std::shared_ptr<Shape>> shapes;
+        for (int i = 0; i < n; ++i) {
+            Transform place = Transform::translate(Vector(pos(rng), pos(rng), pos(rng)));
+            float r = rad(rng);
+            switch (i % 4) {
+                case 0: shapes.push_back(std::make_shared<Sphere>(place, false, r)); break;
+                case 1: shapes.push_back(std::make_shared<Sphere>(place, false, r, -0.5f * r, 0.7f * r)); break;
+                case 2: shapes.push_back(std::make_shared<Sphere>(place, false, r, -r, r, 4.0f)); break;
+                default: shapes.push_back(std::make_shared<ScalarSphere>(place, r)); break;
+            }
+        }
+        return shapes;
+    }
+
+    // every active lane has to come out exactly as the single ray path does (same hit, bit-identical t_max),
+    // and inactive lanes are left alone
+    template<int N>
+    inline void check_packet(const BVH& bvh, const Ray rays[N], uint32_t activeBits, int* hits) {
+        RayPacket<N> packet;
+        for (int i = 0; i < N; ++i) packet.set(i, rays[i]);
+        Maskx<N> active = Maskx<N>::fromBits(activeBits);
+        Maskx<N> hit = bvh.intersect(packet, active);
+        assert((hit.bits() & ~active.bits()) == 0);
+
+        for (int i = 0; i < N; ++i) {
+            Ray r = rays[i];
+            if (!active[i]) {
+                assert(packet.t_max[i] == r.t_max);
+                continue;
+            }
+            Hit t;
+            bool h = bvh.intersect(r, &t);
+            assert(hit[i] == h);
+            assert(packet.t_max[i] == r.t_max);
+            if (h) ++*hits;
+        }
+    }
+
+    template<int N>
+    inline void test_packets_match_single_rays() {
+        auto shapes = mixedShapes(400, 11);
+        BVH bvh(shapes);
+        std::mt19937 rng(41);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::uniform_int_distribution<uint32_t> bits(1, Maskx<N>::ALL);
+        int hits = 0;
+
+        for (int packet = 0; packet < 300; ++packet) {
+            Ray rays[N];
+            // coherent: parallel rays from a small patch, like an orthographic camera's
+            float x0 = u(rng) * 6, y0 = u(rng) * 6;
+            for (int i = 0; i < N; ++i)
+                rays[i] = Ray(Point(x0 + 0.05f * (i % 4), y0 + 0.05f * (i / 4), -10), Vector(0, 0, 1));
+            check_packet<N>(bvh, rays, Maskx<N>::ALL, &hits);
+            check_packet<N>(bvh, rays, bits(rng), &hits);
+
+            // incoherent: any origin and direction, some of them with zero components
+            for (int i = 0; i < N; ++i) {
+                Vector d(u(rng), u(rng), u(rng));
+                if (i % 3 == 1) d.x = 0;
+                if (i % 5 == 2) d.y = 0;
+                rays[i] = Ray(Point(u(rng) * 8, u(rng) * 8, u(rng) * 8), normalize(d));
+            }
+            check_packet<N>(bvh, rays, bits(rng), &hits);
+        }
+        assert(hits > 0);
+    }
+
+    // intersectP() agrees with intersect() on every ray, leaves t_max alone, and by stopping at the first hit does
+    // less work overall
+    template<int N>
+    inline void test_occlusion() {
+        auto shapes = mixedShapes(400, 12);
+        Scene scene(shapes);
+        const BVH& bvh = scene.aggregate;
+        assert(!BVH({}).intersectP(Ray(Point(0, 0, 0), Vector(0, 0, 1))));
+
+        std::mt19937 rng(46);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::uniform_int_distribution<uint32_t> bits(1, Maskx<N>::ALL);
+        TraversalCost closestCost, anyCost;
+        int hits = 0, misses = 0;
+        for (int packet = 0; packet < 200; ++packet) {
+            // shadow rays from random points toward one light, some of them stopping short of it
+            Point light(u(rng) * 10, 10, u(rng) * 10);
+            Ray rays[N];
+            for (int i = 0; i < N; ++i) {
+                Point o(u(rng) * 6, u(rng) * 6, u(rng) * 6);
+                rays[i] = Ray(o, light - o, rt::RAY_EPSILON, i % 3 == 0 ? 0.5f : 1.0f);
+            }
+
+            RayPacket<N> rp;
+            for (int i = 0; i < N; ++i) rp.set(i, rays[i]);
+            Maskx<N> active = Maskx<N>::fromBits(bits(rng));
+            Maskx<N> occluded = scene.intersectP(rp, active);
+            uint8_t batch[N];
+            scene.intersectP(rays, N, batch);
+
+            for (int i = 0; i < N; ++i) {
+                Ray r = rays[i];
+                Hit t;
+                bool closest = bvh.intersect(r, &t, &closestCost);
+                bool any = scene.intersectP(rays[i], &anyCost);
+                assert(any == closest && rays[i].t_max == rp.t_max[i]);
+                assert(occluded[i] == (active[i] && closest));
+                assert(batch[i] == closest);
+                closest ? ++hits : ++misses;
+            }
+        }
+        assert(hits > 0 && misses > 0);
+        assert(anyCost.nodesVisited < closestCost.nodesVisited && anyCost.shapeTests < closestCost.shapeTests);
+    }
+
+    inline void run_all_bvh_tests() {
+        test_empty();
+        test_projective_shape();
+        test_matches_brute_force();
+        test_depth_cap();
+        test_traversal_cost();
+        test_packets_match_single_rays<4>();
+        test_packets_match_single_rays<8>();
+        test_packets_match_single_rays<16>();
+        test_occlusion<4>();
+        test_occlusion<8>();
+        test_occlusion<16>();
+        std::cout << "[test_bvh] all BVH tests passed\n";
+    }
+}
+
+#endif // TEST_BVH_H
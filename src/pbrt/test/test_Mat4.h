@@ -88,12 +88,38 @@ namespace test_mat4 {
                 assert(feq(prod->m[i][j], (i==j)?1.0f:0.0f));
     }
 
+    // everything here is checked by the compiler, the function only exists to group it
+    inline void test_constexpr() {
+        constexpr Mat4 I;
+        static_assert(I.m[0][0] == 1 && I.m[0][1] == 0 && I.m[3][3] == 1, "default is the identity");
+
+        constexpr float flat[16] = { 1,2,3,4, 5,6,7,8, 9,10,11,12, 13,14,15,16 };
+        constexpr Mat4 A(flat);
+        static_assert(A.m[1][2] == 7 && A.m[3][0] == 13, "row major");
+
+        constexpr Mat4 At = A.getTranspose();
+        static_assert(At.m[2][1] == 7 && At.m[0][3] == 13, "transpose");
+
+        constexpr Mat4 AI = Mat4::multiply(A, I);
+        static_assert(AI.m[2][3] == 12 && AI.m[3][3] == 16, "A * I = A");
+        constexpr Mat4 AA = Mat4::multiply(A, A);
+        static_assert(AA.m[0][0] == 90 && AA.m[3][3] == 600, "A * A");
+
+        // the runtime (SSE) path agrees
+        Mat4 a(flat);
+        Mat4 aa = Mat4::multiply(a, a);
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                assert(aa.m[i][j] == AA.m[i][j]);
+    }
+
     inline void run_all_mat4_tests() {
         test_default_constructor();
         test_array_constructor();
         test_transpose();
         test_multiply_identity();
         test_inverse_diagonal();
+        test_constexpr();
         std::cout << "[mat4] all tests passed\n";
     }
 }
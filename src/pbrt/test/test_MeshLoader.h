@@ -0,0 +1,265 @@
+#ifndef TEST_MESH_LOADER_H
+#define TEST_MESH_LOADER_H
+
+#include "MeshLoader.h"
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+
+/*
+    meshes are written out as OBJ and PLY files (ascii, binary either endian, triangles or quads), loaded back,
+    and have to be exactly the mesh built from the same numbers in memory
+*/
+
+namespace test_mesh_loader {
+    // an n x n grid of vertices (a jittered heightfield), with normals and uvs, in quads and in triangles
+    struct Grid {
+        int n;
+        std::vector<Point> P;
+        std::vector<Normal> N;
+        std::vector<float> uv;
+        std::vector<uint32_t> triangles; // each quad as two triangles, split the way a fan of it is
+
+        Grid(int n, uint32_t seed) : n(n) {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+            for (int y = 0; y < n; ++y)
+                for (int x = 0; x < n; ++x) {
+                    P.push_back(Point(x + 0.3f * u(rng), y + 0.3f * u(rng), 0.5f * u(rng)));
+                    N.push_back(normalize(Normal(0.2f * u(rng), 0.2f * u(rng), 1.0f)));
+                    uv.push_back(0.5f * (u(rng) + 1.0f));
+                    uv.push_back(0.5f * (u(rng) + 1.0f));
+                }
+            for (int q = 0; q < (n - 1) * (n - 1); ++q) {
+                uint32_t* c = quad(q);
+                for (int i : { 0, 1, 2, 0, 2, 3 }) triangles.push_back(c[i]);
+            }
+        }
+
+        // the corners of quad q, counterclockwise
+        uint32_t* quad(int q) const {
+            static thread_local uint32_t c[4];
+            int x = q % (n - 1), y = q / (n - 1);
+            uint32_t a = y * n + x;
+            c[0] = a; c[1] = a + 1; c[2] = a + n + 1; c[3] = a + n;
+            return c;
+        }
+        int quads() const { return (n - 1) * (n - 1); }
+    };
+
+    inline std::string tempPath(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    // %.9g prints every float so it reads back exactly
+    inline std::string writeObj(const Grid& g, const char* name) {
+        std::string path = tempPath(name);
+        FILE* f = fopen(path.c_str(), "wb");
+        fprintf(f, "# a grid\no grid\n");
+        for (size_t i = 0; i < g.P.size(); ++i) fprintf(f, "v %.9g %.9g %.9g\n", g.P[i].x, g.P[i].y, g.P[i].z);
+        for (size_t i = 0; i < g.P.size(); ++i) fprintf(f, "vt %.9g %.9g\n", g.uv[2 * i], g.uv[2 * i + 1]);
+        for (size_t i = 0; i < g.N.size(); ++i) fprintf(f, "vn %.9g %.9g %.9g\n", g.N[i].x, g.N[i].y, g.N[i].z);
+        fprintf(f, "s off\n");
+        for (int q = 0; q < g.quads(); ++q) {
+            uint32_t* c = g.quad(q);
+            fprintf(f, "f");
+            for (int i = 0; i < 4; ++i) fprintf(f, " %u/%u/%u", c[i] + 1, c[i] + 1, c[i] + 1);
+            fprintf(f, "\n");
+        }
+        fclose(f);
+        return path;
+    }
+
+    template<typename T>
+    inline void put(FILE* f, T x, bool bigEndian) {
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &x, sizeof(T));
+        if (bigEndian) std::reverse(bytes, bytes + sizeof(T));
+        fwrite(bytes, 1, sizeof(T), f);
+    }
+
+    // format is "ascii", "binary_little_endian" or "binary_big_endian", with quads or split into triangles
+    inline std::string writePly(const Grid& g, const char* name, const char* format, bool quads) {
+        std::string path = tempPath(name);
+        FILE* f = fopen(path.c_str(), "wb");
+        int faces = quads ? g.quads() : (int)g.triangles.size() / 3;
+        fprintf(f, "ply\nformat %s 1.0\ncomment a grid\n", format);
+        fprintf(f, "element vertex %zu\nproperty float x\nproperty float y\nproperty float z\n", g.P.size());
+        fprintf(f, "property uchar red\nproperty float nx\nproperty float ny\nproperty float nz\nproperty float u\nproperty float v\n");
+        fprintf(f, "element face %d\nproperty list uchar int vertex_indices\nend_header\n", faces);
+
+        bool ascii = std::strcmp(format, "ascii") == 0, big = std::strcmp(format, "binary_big_endian") == 0;
+        for (size_t i = 0; i < g.P.size(); ++i) {
+            float values[] = { g.P[i].x, g.P[i].y, g.P[i].z, g.N[i].x, g.N[i].y, g.N[i].z, g.uv[2 * i], g.uv[2 * i + 1] };
+            if (ascii) {
+                fprintf(f, "%.9g %.9g %.9g 255", values[0], values[1], values[2]);
+                for (int k = 3; k < 8; ++k) fprintf(f, " %.9g", values[k]);
+                fprintf(f, "\n");
+            } else {
+                for (int k = 0; k < 8; ++k) {
+                    if (k == 3) put<uint8_t>(f, 255, big);
+                    put<float>(f, values[k], big);
+                }
+            }
+        }
+        for (int i = 0; i < faces; ++i) {
+            const uint32_t* c = quads ? g.quad(i) : &g.triangles[3 * i];
+            int k = quads ? 4 : 3;
+            if (ascii) {
+                fprintf(f, "%d", k);
+                for (int j = 0; j < k; ++j) fprintf(f, " %u", c[j]);
+                fprintf(f, "\n");
+            } else {
+                put<uint8_t>(f, (uint8_t)k, big);
+                for (int j = 0; j < k; ++j) put<int32_t>(f, (int32_t)c[j], big);
+            }
+        }
+        fclose(f);
+        return path;
+    }
+
+    // the loaded mesh is the in-memory one, buffer for buffer
+    inline void check_same(TriangleMesh& loaded, TriangleMesh& reference) {
+        assert(loaded.nTriangles == reference.nTriangles && loaded.nVertices == reference.nVertices);
+        assert(loaded.indices == reference.indices);
+        assert(loaded.us == reference.us && loaded.vs == reference.vs);
+        assert(loaded.normals.size() == reference.normals.size());
+        SoA3 a = loaded.normals.soa(), b = reference.normals.soa();
+        for (int i = 0; i < loaded.nVertices; ++i) {
+            Point p = loaded.position(i), q = reference.position(i);
+            assert(p.x == q.x && p.y == q.y && p.z == q.z);
+            if (loaded.normals.size() > 0) assert(a.x[i] == b.x[i] && a.y[i] == b.y[i] && a.z[i] == b.z[i]);
+        }
+        Bbox l = loaded.worldBound(), r = reference.worldBound();
+        assert(l.p_min.x == r.p_min.x && l.p_max.z == r.p_max.z);
+    }
+
+    // both find the same hits along rays over the grid
+    inline void check_same_hits(const TriangleMesh& loaded, const TriangleMesh& reference, int n) {
+        std::mt19937 rng(52);
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        int hits = 0;
+        for (int i = 0; i < 500; ++i) {
+            Point o(n * u(rng), n * u(rng), 3.0f);
+            Ray ray(o, Point(n * u(rng), n * u(rng), -1.0f) - o);
+            Ray copy = ray; // intersect() shortens t_max
+            Hit a, b;
+            bool ha = loaded.intersect(ray, &a), hb = reference.intersect(copy, &b);
+            assert(ha == hb && a.t == b.t);
+            hits += ha;
+        }
+        assert(hits > 100);
+    }
+
+    inline void test_obj() {
+        Grid g(12, 53);
+        TriangleMesh reference(Transform(), false, g.triangles, g.P, g.N, g.uv);
+        std::string path = writeObj(g, "rt_test_mesh.obj");
+        MeshLoadInfo info;
+        std::shared_ptr<TriangleMesh> mesh = loadMesh(path.c_str(), Transform(), false, TriangleMesh::Watertight, 3, &info);
+        assert(mesh);
+        check_same(*mesh, reference);
+        assert(info.bytes == std::filesystem::file_size(path) && info.threads == 3);
+        std::remove(path.c_str());
+    }
+
+    // corners whose uvs and normals aren't their positions' become vertices of their own, relative indices too
+    inline void test_obj_unshared_corners() {
+        std::string path = tempPath("rt_test_corners.obj");
+        FILE* f = fopen(path.c_str(), "wb");
+        fprintf(f, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 1\nvn 0 0 1\n");
+        fprintf(f, "f 1/1/1 2/2/1 3/1/1 4/2/1\n");
+        fprintf(f, "v 0 0 1\nv 1 0 1\nv 0 1 1\nf -3/-2/-1 -2/-1/-1 -1/-2/-1 # the first three again\n");
+        fclose(f);
+
+        std::shared_ptr<TriangleMesh> mesh = loadMesh(path.c_str(), Transform::translate(Vector(0, 0, 5)));
+        assert(mesh && mesh->nTriangles == 3 && mesh->nVertices == 7);
+        assert(mesh->us.size() == 7 && mesh->normals.size() == 7);
+
+        // the quad is a fan around its first corner, and the last face's corners count back from where it is
+        Hit hit;
+        assert(mesh->intersect(Ray(Point(0.8f, 0.6f, 10), Vector(0, 0, -1)), &hit) && hit.t == 5.0f);
+        assert(mesh->intersect(Ray(Point(0.2f, 0.9f, 10), Vector(0, 0, -1)), &hit) && hit.t == 5.0f);
+        assert(mesh->intersect(Ray(Point(0.25f, 0.25f, 10), Vector(0, 0, -1)), &hit) && hit.t == 4.0f);
+        std::remove(path.c_str());
+    }
+
+    inline void test_ply() {
+        Grid g(12, 54);
+        TriangleMesh reference(Transform(), false, g.triangles, g.P, g.N, g.uv);
+        for (const char* format : { "ascii", "binary_little_endian", "binary_big_endian" })
+            for (bool quads : { false, true }) {
+                std::string path = writePly(g, "rt_test_mesh.ply", format, quads);
+                std::shared_ptr<TriangleMesh> mesh = loadMesh(path.c_str(), Transform(), false, TriangleMesh::Watertight, 4);
+                assert(mesh);
+                check_same(*mesh, reference);
+                std::remove(path.c_str());
+            }
+    }
+
+    // files big enough to be cut into many chunks come out the same however many threads read them
+    inline void test_threads() {
+        Grid g(300, 55);
+        TriangleMesh reference(Transform(), false, g.triangles, g.P, g.N, g.uv);
+        std::string obj = writeObj(g, "rt_test_big.obj"), ply = writePly(g, "rt_test_big.ply", "ascii", true);
+        for (const std::string& path : { obj, ply }) {
+            assert(std::filesystem::file_size(path) > (4u << 20));
+            for (int threads : { 1, 7 }) {
+                std::shared_ptr<TriangleMesh> mesh = loadMesh(path.c_str(), Transform(), false, TriangleMesh::Watertight, threads);
+                assert(mesh);
+                check_same(*mesh, reference);
+                check_same_hits(*mesh, reference, g.n);
+            }
+            std::remove(path.c_str());
+        }
+    }
+
+    inline void test_errors() {
+        std::cout << "[test_mesh_loader] the next few lines are expected errors\n";
+        assert(!loadMesh(tempPath("rt_test_missing.obj").c_str(), Transform()));
+
+        std::string path = tempPath("rt_test_bad.obj");
+        FILE* f = fopen(path.c_str(), "wb");
+        fprintf(f, "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 4\n");
+        fclose(f);
+        assert(!loadMesh(path.c_str(), Transform()));
+
+        // corners whose vt and vn are their v, with fewer vt or vn lines than the faces use
+        const char* fewer[] = { "vt 0 0\nvt 1 0\nvt 1 1\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\n",
+                                "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvt 0 1\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\n",
+                                "vt 0 0\nvt 1 0\nvt 1 1\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\n" };
+        for (const char* attributes : fewer) {
+            f = fopen(path.c_str(), "wb");
+            fprintf(f, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 2 0\n%sf 1/1/1 2/2/2 3/3/3\nf 3/3/3 4/4/4 5/5/5\n", attributes);
+            fclose(f);
+            assert(!loadMesh(path.c_str(), Transform()));
+        }
+
+        std::string ply = tempPath("rt_test_short.ply");
+        f = fopen(ply.c_str(), "wb");
+        fprintf(f, "ply\nformat binary_little_endian 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\n"
+                   "element face 1\nproperty list uchar int vertex_indices\nend_header\n");
+        fwrite("\0\0\0\0", 1, 4, f);
+        fclose(f);
+        assert(!loadMesh(ply.c_str(), Transform()));
+
+        std::remove(path.c_str());
+        std::remove(ply.c_str());
+    }
+
+    inline void run_all_mesh_loader_tests() {
+        test_obj();
+        test_obj_unshared_corners();
+        test_ply();
+        test_threads();
+        test_errors();
+        std::cout << "[test_mesh_loader] all MeshLoader tests passed\n";
+    }
+}
+
+#endif // TEST_MESH_LOADER_H
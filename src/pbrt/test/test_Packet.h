@@ -0,0 +1,213 @@
+#ifndef TEST_PACKET_H
+#define TEST_PACKET_H
+
+#include "Packet.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/*
+    every test is a template over the packet width and runs for 1, 4, 8 and 16 lanes: each lane of a packet
+    result is checked against the scalar Vector/Point/float function on that lane's inputs, so Floatx<1> (plain
+    float code), the SSE/AVX2/AVX-512 widths and the generic fallbacks of the widths the target lacks all
+    have to agree with Vector.h
+*/
+
+namespace test_packet {
+    static constexpr float EPS = 1e-5f;
+
+    // relative, the packet code may fuse or reorder where the scalar code doesn't
+    inline bool feq(float a, float b) {
+        return std::fabs(a - b) <= EPS * std::fmax(1.0f, std::fmax(std::fabs(a), std::fabs(b)));
+    }
+    inline bool veq(const Vector& a, const Vector& b) {
+        return feq(a.x, b.x) && feq(a.y, b.y) && feq(a.z, b.z);
+    }
+
+    template<int N>
+    inline Floatx<N> randomFloats(std::mt19937& rng, float lo = -10.0f, float hi = 10.0f) {
+        std::uniform_real_distribution<float> u(lo, hi);
+        Floatx<N> f;
+        for (int i = 0; i < N; ++i) f[i] = u(rng);
+        return f;
+    }
+
+    template<int N>
+    inline Vec3x<N> randomVectors(std::mt19937& rng) {
+        return Vec3x<N>(randomFloats<N>(rng), randomFloats<N>(rng), randomFloats<N>(rng));
+    }
+
+    template<int N>
+    inline void test_float_lanes(std::mt19937& rng) {
+        for (int trial = 0; trial < 50; ++trial) {
+            Floatx<N> a = randomFloats<N>(rng), b = randomFloats<N>(rng), c = randomFloats<N>(rng);
+            // a few equal lanes so == and <= see both outcomes
+            b[0] = a[0];
+
+            Floatx<N> sum = a + b, diff = a - b, prod = a * b, quot = a / b, neg = -a;
+            Floatx<N> lo = min(a, b), hi = max(a, b), ab = abs(a), root = sqrt(abs(a)), f = fma(a, b, c);
+            Maskx<N> lt = a < b, le = a <= b, gt = a > b, ge = a >= b, eq = a == b, ne = a != b;
+            Floatx<N> sel = select(lt, a, b);
+
+            for (int i = 0; i < N; ++i) {
+                float x = a[i], y = b[i];
+                assert(sum[i] == x + y && diff[i] == x - y && prod[i] == x * y && quot[i] == x / y);
+                assert(neg[i] == -x && ab[i] == std::fabs(x) && feq(root[i], std::sqrt(std::fabs(x))));
+                assert(lo[i] == std::fmin(x, y) && hi[i] == std::fmax(x, y));
+                assert(feq(f[i], x * y + c[i]));
+                assert(lt[i] == (x < y) && le[i] == (x <= y) && gt[i] == (x > y));
+                assert(ge[i] == (x >= y) && eq[i] == (x == y) && ne[i] == (x != y));
+                assert(sel[i] == (x < y ? x : y));
+            }
+
+            float mn = a[0], mx = a[0], total = 0.0f;
+            for (int i = 0; i < N; ++i) {
+                mn = std::fmin(mn, a[i]);
+                mx = std::fmax(mx, a[i]);
+                total += a[i];
+            }
+            assert(hmin(a) == mn && hmax(a) == mx);
+            assert(std::fabs(hsum(a) - total) <= 1e-4f * N * 10.0f);
+        }
+
+        // broadcasts, and the float operand forms
+        Floatx<N> two(2.0f);
+        Floatx<N> v = (two + 1.0f) * 2.0f - 1.0f;
+        v /= two;
+        v += Floatx<N>(0.5f);
+        for (int i = 0; i < N; ++i) assert(v[i] == 3.0f && (3.0f * two)[i] == 6.0f && (two / 4.0f)[i] == 0.5f);
+
+        // NaN lanes: ordered compares are false, != is true, min/max take the second argument
+        Floatx<N> nan(NAN), one(1.0f);
+        assert(none(nan < one) && none(nan == nan) && all(nan != nan));
+        for (int i = 0; i < N; ++i) {
+            assert(min(nan, one)[i] == 1.0f && std::isnan(min(one, nan)[i]));
+            assert(max(nan, one)[i] == 1.0f && std::isnan(max(one, nan)[i]));
+        }
+        // -0 stays signed through negation and abs clears it
+        Floatx<N> zero(0.0f);
+        assert(std::signbit((-zero)[0]) && !std::signbit(abs(-zero)[0]));
+    }
+
+    template<int N>
+    inline void test_masks() {
+        const uint32_t ALL = Maskx<N>::ALL;
+        assert(ALL == (N == 32 ? 0xffffffffu : (1u << N) - 1));
+        assert(none(Maskx<N>()) && all(Maskx<N>(true)) && Maskx<N>(true).bits() == ALL);
+
+        uint32_t pattern = 0x5a5au & ALL; // alternating lanes, lane 0 clear
+        Maskx<N> m = Maskx<N>::fromBits(pattern);
+        assert(m.bits() == pattern);
+        for (int i = 0; i < N; ++i) assert(m[i] == (bool)((pattern >> i) & 1));
+        assert((m & ~m).bits() == 0 && (m | ~m).bits() == ALL && (m ^ m).bits() == 0);
+        assert(Maskx<N>::fromBits(0xffffffffu).bits() == ALL);
+        if (N > 1) assert(any(m) && !all(m));
+
+        Maskx<N> acc(true);
+        acc &= m;
+        acc |= Maskx<N>::fromBits(1);
+        assert(acc.bits() == (pattern | 1u));
+    }
+
+    template<int N>
+    inline void test_vec3_lanes(std::mt19937& rng) {
+        for (int trial = 0; trial < 50; ++trial) {
+            Vec3x<N> a = randomVectors<N>(rng), b = randomVectors<N>(rng);
+            Floatx<N> s = randomFloats<N>(rng, 0.5f, 2.0f);
+
+            Floatx<N> d = dot(a, b), len = length(a), len2 = lengthSquared(a);
+            Vec3x<N> c = cross(a, b), n = normalize(a), sum = a + b, diff = a - b, scaled = a * s, divided = a / s;
+            Vec3x<N> neg = -a, lo = min(a, b), hi = max(a, b), ab = abs(a);
+            Vec3x<N> sel = select(d > Floatx<N>(0.0f), a, b);
+
+            for (int i = 0; i < N; ++i) {
+                Vector va = a.vector(i), vb = b.vector(i);
+                assert(feq(d[i], dot(va, vb)) && feq(len[i], va.length()) && feq(len2[i], va.lengthSquared()));
+                assert(veq(c.vector(i), cross(va, vb)) && veq(n.vector(i), normalize(va)));
+                assert(veq(sum.vector(i), va + vb) && veq(diff.vector(i), va - vb) && veq(neg.vector(i), -va));
+                assert(veq(scaled.vector(i), va * s[i]) && veq(divided.vector(i), va / s[i]));
+                assert(veq(lo.vector(i), min(va, vb)) && veq(hi.vector(i), max(va, vb)) && veq(ab.vector(i), abs(va)));
+                assert(veq(sel.vector(i), dot(va, vb) > 0 ? va : vb));
+            }
+
+            Vec3x<N> acc = a;
+            acc += b;
+            acc -= b;
+            acc *= s;
+            acc /= s;
+            for (int i = 0; i < N; ++i) assert(veq(acc.vector(i), a.vector(i)));
+        }
+    }
+
+    template<int N>
+    inline void test_conversions() {
+        // broadcasts
+        Vec3x<N> v(Vector(1, 2, 3)), p(Point(4, 5, 6));
+        for (int i = 0; i < N; ++i) {
+            assert(v.vector(i).x == 1 && v.vector(i).y == 2 && v.vector(i).z == 3);
+            assert(p.point(i).x == 4 && p.point(i).y == 5 && p.point(i).z == 6);
+        }
+
+        // arrays of Vectors and Points, in and back out
+        Vector vs[N], vsOut[N];
+        Point ps[N], psOut[N];
+        for (int i = 0; i < N; ++i) {
+            vs[i] = Vector((float)i, (float)(2 * i), (float)(-i));
+            ps[i] = Point((float)(i + 1), 0.5f, (float)(i * i));
+        }
+        Vec3x<N> lv = Vec3x<N>::load(vs), lp = Vec3x<N>::load(ps);
+        lv.store(vsOut);
+        lp.store(psOut);
+        for (int i = 0; i < N; ++i) {
+            assert(lv.x[i] == (float)i && lv.y[i] == (float)(2 * i) && lv.z[i] == (float)(-i));
+            assert(vsOut[i].x == vs[i].x && vsOut[i].y == vs[i].y && vsOut[i].z == vs[i].z);
+            assert(psOut[i].x == ps[i].x && psOut[i].y == ps[i].y && psOut[i].z == ps[i].z);
+        }
+
+        // single lanes
+        lv.set(0, Point(-1, -2, -3));
+        assert(lv.point(0).z == -3);
+        lv.set(N - 1, Vector(7, 8, 9));
+        assert(lv.vector(N - 1).y == 8);
+
+        // a SoA3, from an offset that isn't a multiple of the width (so unaligned)
+        SoA3Buffer buffer(N + 1), bufferOut(N + 1);
+        SoA3 soa = buffer.soa(), soaOut = bufferOut.soa();
+        for (int i = 0; i <= N; ++i) soa.set(i, (float)i, (float)(i + 100), (float)(i + 200));
+        Vec3x<N> ls = Vec3x<N>::load(soa, 1);
+        ls.store(soaOut, 1);
+        for (int i = 0; i < N; ++i) {
+            assert(ls.x[i] == (float)(i + 1) && ls.z[i] == (float)(i + 201));
+            assert(soaOut.vector(i + 1).y == (float)(i + 101));
+        }
+
+        // aligned float arrays
+        alignas(64) float in[N], out[N];
+        for (int i = 0; i < N; ++i) in[i] = (float)(i * 3);
+        Floatx<N>::load(in).store(out);
+        for (int i = 0; i < N; ++i) assert(out[i] == in[i]);
+    }
+
+    template<int N>
+    inline void test_width(std::mt19937& rng) {
+        static_assert(sizeof(Floatx<N>) == N * sizeof(float), "no padding between lanes");
+        static_assert(alignof(Floatx<N>) == N * sizeof(float), "aligned to the packet size");
+        test_float_lanes<N>(rng);
+        test_masks<N>();
+        test_vec3_lanes<N>(rng);
+        test_conversions<N>();
+    }
+
+    inline void run_all_packet_tests() {
+        std::mt19937 rng(40);
+        test_width<1>(rng);
+        test_width<4>(rng);
+        test_width<8>(rng);
+        test_width<16>(rng);
+        static_assert(PACKET_WIDTH == 4 || PACKET_WIDTH == 8 || PACKET_WIDTH == 16, "native width");
+        std::cout << "[test_packet] all packet tests passed (native width " << PACKET_WIDTH << ")\n";
+    }
+}
+
+#endif // TEST_PACKET_H
@@ -92,8 +92,15 @@ namespace test_point {
         assert(feq(p[1], 8.8f));
         assert(feq(p[2], 7.7f));
 
-        float oob = p[99];
-        assert(std::isnan(oob)); // out‐of‐range returns NAN
+        p[2] = 1.0f;
+        assert(p.z == 1.0f && &p[0] == &p.x);
+    }
+
+    inline void test_min_max() {
+        Point a(1, 5, -3), b(2, -1, -3);
+        Point lo = min(a, b), hi = max(a, b);
+        assert(lo.x == 1 && lo.y == -1 && lo.z == -3);
+        assert(hi.x == 2 && hi.y == 5 && hi.z == -3);
     }
 
     inline void run_all_point_tests() {
@@ -104,6 +111,7 @@ namespace test_point {
         test_compound_add();
         test_point_minus_point();
         test_index_operator();
+        test_min_max();
         std::cout << "[test_point] all Point tests passed\n";
     }
 }
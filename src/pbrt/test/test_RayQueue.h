@@ -0,0 +1,141 @@
+#ifndef TEST_RAY_QUEUE_H
+#define TEST_RAY_QUEUE_H
+
+#include "RayQueue.h"
+#include "test_Renderer.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+
+namespace test_ray_queue {
+    // n rays from in front of the scene, most of them aimed at one of its shapes and the rest anywhere
+    inline void fill(RayQueue& queue, const Scene& scene, int n, std::mt19937& rng) {
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::uniform_int_distribution<size_t> pick(0, scene.aggregate.shapes.size() - 1);
+        queue.clear();
+        for (int i = 0; i < n; ++i) {
+            int slot = queue.push(Sample((float)i, 0.0f, 0.0f, 0.0f, 0.0f));
+            Point o(1.5f * u(rng), 1.5f * u(rng), 2 * u(rng));
+            Bbox b = scene.aggregate.shapes[pick(rng)]->worldBound();
+            Point target = b.p_min + (b.p_max - b.p_min) * (0.5f + 0.4f * u(rng));
+            queue.rays[slot] = Ray(o, i % 4 == 0 ? Vector(u(rng), u(rng), u(rng)) : target - o);
+        }
+    }
+
+    // every slot's Hit is the one Scene::intersect() finds, whether the queue is traced in packets or not
+    inline void test_extend_hits() {
+        Scene scene(test_renderer::shapes());
+        std::mt19937 rng(43);
+        RayQueue queue(1000);
+        int hits = 0;
+        for (int packetSize : { 1, 4, 8, 16 }) {
+            // 997 leaves a part filled last packet
+            fill(queue, scene, 997, rng);
+            std::vector<Ray> rays(queue.rays.begin(), queue.rays.begin() + queue.size);
+            queue.extend(scene, packetSize);
+
+            for (int i = 0; i < queue.size; ++i) {
+                Hit expected;
+                bool hit = scene.intersect(rays[i], &expected);
+                const Hit& h = queue.hits[i];
+                assert((h.shape != nullptr) == hit);
+                if (!hit) continue;
+                ++hits;
+                assert(h.shape == expected.shape && h.primitive == expected.primitive);
+                assert(h.t == expected.t && h.u == expected.u && h.v == expected.v);
+                assert(queue.rays[i].t_max == h.t);
+            }
+        }
+        assert(hits > 1000);
+    }
+
+    // the octant of a direction, as sort() numbers them
+    inline int octant(const Vector& d) {
+        return (d.x < 0.0f) | (d.y < 0.0f) << 1 | (d.z < 0.0f) << 2;
+    }
+
+    // octants come first, all eight of them in order (4 to 7 differ from 0 to 3 only in the top bit of the key),
+    // then the origins' Morton codes, which grow along the diagonal
+    inline void test_sort_order() {
+        const float positions[4] = { 0.9f, 0.6f, 0.3f, 0.05f };
+        RayQueue queue(64);
+        for (int o = 7; o >= 0; --o)
+            for (float p : positions) {
+                int slot = queue.push(Sample(0.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+                Vector d(o & 1 ? -1.0f : 1.0f, o & 2 ? -1.0f : 1.0f, o & 4 ? -1.0f : 1.0f);
+                queue.rays[slot] = Ray(Point(p, p, p), d);
+            }
+
+        queue.sort(Bbox(Point(0, 0, 0), Point(1, 1, 1)));
+        for (int i = 0; i < queue.size; ++i) {
+            const Ray& ray = queue.rays[queue.order[i]];
+            assert(octant(ray.d) == i / 4);
+            assert(ray.o.x == positions[3 - i % 4]);
+        }
+    }
+
+    // rays whose keys are equal are traced in queue order
+    inline void test_sort_ties() {
+        RayQueue queue(64);
+        for (int i = 0; i < 48; ++i) {
+            int slot = queue.push(Sample(0.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+            // three groups, one of them also holding origins clamped onto the same corner cell
+            Point o = i % 3 == 0 ? Point(0.5f, 0.5f, 0.5f) : i % 3 == 1 ? Point(-1.0f, -2.0f, -3.0f) : Point(0.0f, 0.0f, 0.0f);
+            queue.rays[slot] = Ray(o, Vector(0.0f, 0.0f, i % 3 == 0 ? -1.0f : 1.0f));
+        }
+
+        queue.sort(Bbox(Point(0, 0, 0), Point(1, 1, 1)));
+        // the two groups in the corner cell come first, interleaved as they were pushed, then the other octant
+        for (int i = 0; i < 32; ++i) assert(queue.order[i] == 3 * (i / 2) + 1 + i % 2);
+        for (int i = 32; i < 48; ++i) assert(queue.order[i] == 3 * (i - 32));
+    }
+
+    // sorting changes the order rays are traced in but not what any slot ends up with, and compact() still
+    // splits the slots in queue order
+    inline void test_sort_extend_compact() {
+        Scene scene(test_renderer::shapes());
+        std::mt19937 rng(44);
+        RayQueue queue(1000), sorted(1000);
+        for (int packetSize : { 1, 4, 8, 16 }) {
+            fill(queue, scene, 997, rng);
+            sorted.clear();
+            for (int i = 0; i < queue.size; ++i)
+                sorted.rays[sorted.push(Sample((float)i, 0.0f, 0.0f, 0.0f, 0.0f))] = queue.rays[i];
+
+            sorted.sort(scene.worldBound());
+            std::vector<int> order(sorted.order.begin(), sorted.order.begin() + sorted.size);
+            std::sort(order.begin(), order.end());
+            for (int i = 0; i < sorted.size; ++i) assert(order[i] == i);
+
+            queue.extend(scene, packetSize);
+            sorted.extend(scene, packetSize);
+            queue.compact();
+            sorted.compact();
+            for (int i = 0; i < queue.size; ++i) {
+                const Hit& a = queue.hits[i];
+                const Hit& b = sorted.hits[i];
+                assert(a.shape == b.shape && a.primitive == b.primitive && a.t == b.t && a.u == b.u && a.v == b.v);
+                assert(queue.rays[i].t_max == sorted.rays[i].t_max);
+            }
+
+            assert(sorted.hitSlots == queue.hitSlots && sorted.missSlots == queue.missSlots);
+            assert(!sorted.hitSlots.empty() && !sorted.missSlots.empty());
+            assert(sorted.hitSlots.size() + sorted.missSlots.size() == (size_t)sorted.size);
+            assert(std::is_sorted(sorted.hitSlots.begin(), sorted.hitSlots.end()));
+            assert(std::is_sorted(sorted.missSlots.begin(), sorted.missSlots.end()));
+            for (int slot : sorted.hitSlots) assert(sorted.hits[slot].shape);
+            for (int slot : sorted.missSlots) assert(!sorted.hits[slot].shape);
+        }
+    }
+
+    inline void run_all_ray_queue_tests() {
+        test_extend_hits();
+        test_sort_order();
+        test_sort_ties();
+        test_sort_extend_compact();
+        std::cout << "[test_ray_queue] all RayQueue tests passed\n";
+    }
+}
+
+#endif // TEST_RAY_QUEUE_H
@@ -0,0 +1,94 @@
+#ifndef TEST_RENDERER_H
+#define TEST_RENDERER_H
+
+#include "Renderer.h"
+#include "Sphere.h"
+#include "SphereSoup.h"
+#include "TriangleMesh.h"
+#include "test_TriangleMesh.h"
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+    every way Renderer can trace a frame (one ray at a time, in packets, and wavefront through RayQueues,
+    sorted or not) has to give the same image, pixel for pixel, as tracing one ray at a time
+*/
+
+namespace test_renderer {
+    constexpr int WIDTH = 64, HEIGHT = 48;
+
+    // spheres, a soup and a mesh in front of the camera, with sky showing between them
+    inline std::vector<std::shared_ptr<Shape>> shapes() {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::vector<std::shared_ptr<Shape>> list;
+
+        for (int i = 0; i < 12; ++i)
+            list.push_back(std::make_shared<Sphere>(Transform::translate(Vector(1.2f * u(rng), u(rng), 8 + 2 * u(rng))),
+                i % 3 == 0, 0.1f + 0.1f * (u(rng) + 1.0f)));
+
+        std::vector<Point> centers;
+        std::vector<float> radii;
+        for (int i = 0; i < 100; ++i) {
+            centers.push_back(Point(1.3f * u(rng), u(rng), 10 + u(rng)));
+            radii.push_back(0.04f);
+        }
+        list.push_back(std::make_shared<SphereSoup>(centers, radii));
+
+        std::vector<uint32_t> idx;
+        std::vector<Point> P;
+        std::vector<Normal> N;
+        std::vector<float> uv;
+        test_triangle_mesh::grid(6, rng, &idx, &P, &N, &uv);
+        list.push_back(std::make_shared<TriangleMesh>(Transform::translate(Vector(-0.6f, -0.5f, 9)) * Transform::scale(0.3f, 0.3f, 0.3f),
+            false, idx, P, N, uv, TriangleMesh::Watertight));
+
+        return list;
+    }
+
+    inline std::vector<uint32_t> render(const Scene& scene, int packetSize, int streamSize, bool sortRays, int threads) {
+        Film film(WIDTH, HEIGHT);
+        float aspect = (float)WIDTH / (float)HEIGHT;
+        const float screen[4] = { -aspect, aspect, -1, 1 };
+        OrthographicCamera camera(Transform::translate(Vector(0, 0, 1)), screen, 0.0f, 10.0f, 0.0f, 0.0f, 1.0f, 1.0f, &film);
+
+        Renderer renderer(scene, camera, film, 2, 2, true, 7, threads);
+        renderer.packetSize = packetSize;
+        renderer.streamSize = streamSize;
+        renderer.sortRays = sortRays;
+        assert(renderer.render() == (uint64_t)(WIDTH * HEIGHT * 4));
+
+        std::vector<uint32_t> pixels(WIDTH * HEIGHT);
+        film.resolve(pixels.data(), WIDTH * sizeof(uint32_t));
+        return pixels;
+    }
+
+    inline void test_same_image() {
+        Scene scene(shapes());
+        std::vector<uint32_t> scalar = render(scene, 1, 0, false, 1);
+
+        // some of the scene and some of the sky both show
+        std::vector<uint32_t> sky = render(Scene({}), 1, 0, false, 1);
+        int covered = 0;
+        for (int i = 0; i < WIDTH * HEIGHT; ++i) covered += scalar[i] != sky[i];
+        assert(covered > 100 && covered < WIDTH * HEIGHT - 100);
+
+        for (int packetSize : { 1, 4, 8, 16 }) {
+            assert(render(scene, packetSize, 0, false, 2) == scalar);
+            // queues smaller than a tile, and a last queue that's only partly full
+            for (int streamSize : { 100, 4096 }) {
+                assert(render(scene, packetSize, streamSize, false, 2) == scalar);
+                assert(render(scene, packetSize, streamSize, true, 2) == scalar);
+            }
+        }
+    }
+
+    inline void run_all_renderer_tests() {
+        test_same_image();
+        std::cout << "[test_renderer] all renderer tests passed\n";
+    }
+}
+
+#endif // TEST_RENDERER_H
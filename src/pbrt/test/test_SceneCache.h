@@ -0,0 +1,304 @@
+#ifndef TEST_SCENE_CACHE_H
+#define TEST_SCENE_CACHE_H
+
+#include "SceneCache.h"
+#include "Sphere.h"
+#include "SphereSoup.h"
+#include "TriangleMesh.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+    a scene of every shape the cache knows is written out and loaded back, and has to answer every ray exactly
+    like the scene it was written from, with its nodes and buffers borrowed from the file instead of built
+*/
+
+namespace test_scene_cache {
+    inline std::string tempPath(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    // partial, transformed and reversed spheres, a soup, and a mesh with each intersector
+    inline std::vector<std::shared_ptr<Shape>> shapes() {
+        std::mt19937 rng(51);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::vector<std::shared_ptr<Shape>> list;
+
+        for (int i = 0; i < 40; ++i) {
+            Transform t = Transform::translate(Vector(4 * u(rng), 4 * u(rng), 4 * u(rng)));
+            if (i % 3 == 0) t = t * Transform::rotateY(3 * u(rng)) * Transform::scale(1.0f, 0.5f, 1.5f);
+            float r = 0.3f + 0.2f * u(rng);
+            if (i % 4 == 0) list.push_back(std::make_shared<Sphere>(t, i % 8 == 0, r, -0.5f * r, 0.8f * r, 4.0f));
+            else list.push_back(std::make_shared<Sphere>(t, i % 5 == 0, r));
+        }
+
+        std::vector<Point> centers;
+        std::vector<float> radii;
+        for (int i = 0; i < 203; ++i) {
+            centers.push_back(Point(4 * u(rng), 4 * u(rng), 4 * u(rng)));
+            radii.push_back(0.1f + 0.05f * u(rng));
+        }
+        list.push_back(std::make_shared<SphereSoup>(centers, radii));
+
+        std::vector<uint32_t> idx;
+        std::vector<Point> P;
+        std::vector<Normal> N;
+        std::vector<float> uv;
+        test_triangle_mesh::grid(12, rng, &idx, &P, &N, &uv);
+        list.push_back(std::make_shared<TriangleMesh>(Transform::translate(Vector(0, 0, -2)) * Transform::rotateX(0.4f),
+            false, idx, P, N, uv, TriangleMesh::Watertight));
+        test_triangle_mesh::closed_sphere(2, &idx, &P);
+        list.push_back(std::make_shared<TriangleMesh>(Transform::translate(Vector(1, 2, 0)) * Transform::scale(1.5f, -1.5f, 1.5f),
+            true, idx, P, std::vector<Normal>{}, std::vector<float>{}, TriangleMesh::PrecomputedEdges));
+
+        return list;
+    }
+
+    inline int shapeIndex(const Scene& scene, const Shape* shape) {
+        for (size_t i = 0; i < scene.aggregate.shapes.size(); ++i)
+            if (scene.aggregate.shapes[i].get() == shape) return (int)i;
+        return -1;
+    }
+
+    inline bool same(const Point& a, const Point& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+    // every ray, one at a time and in packets, hits the same shape at the same place in both scenes
+    inline void check_same_hits(const Scene& built, const Scene& loaded) {
+        std::mt19937 rng(52);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        int hits = 0;
+        for (int trial = 0; trial < 500; ++trial) {
+            RayPacket<8> packets[2];
+            Ray rays[8];
+            Point o(6 * u(rng), 6 * u(rng), 6 * u(rng));
+            for (int i = 0; i < 8; ++i) {
+                rays[i] = Ray(o, Point(3 * u(rng), 3 * u(rng), 3 * u(rng)) - o);
+                packets[0].set(i, rays[i]);
+                packets[1].set(i, rays[i]);
+
+                Ray a = rays[i], b = rays[i];
+                Hit ha, hb;
+                bool hit = built.intersect(a, &ha);
+                assert(loaded.intersect(b, &hb) == hit);
+                Ray pa = rays[i], pb = rays[i];
+                assert(built.intersectP(pa) == loaded.intersectP(pb));
+                if (!hit) continue;
+                ++hits;
+                assert(ha.t == hb.t && ha.u == hb.u && ha.v == hb.v && ha.primitive == hb.primitive);
+                assert(shapeIndex(built, ha.shape) == shapeIndex(loaded, hb.shape));
+
+                DifferentialGeometry da, db;
+                ha.shape->getDifferentialGeometry(a, ha, &da);
+                hb.shape->getDifferentialGeometry(b, hb, &db);
+                assert(same(da.p, db.p) && same(Point(da.nn.x, da.nn.y, da.nn.z), Point(db.nn.x, db.nn.y, db.nn.z)));
+                assert(da.u == db.u && da.v == db.v);
+            }
+
+            Maskx<8> active = Maskx<8>::fromBits(0xff);
+            Maskx<8> ha = built.intersect(packets[0], active), hb = loaded.intersect(packets[1], active);
+            for (int i = 0; i < 8; ++i)
+                assert(ha[i] == hb[i] && packets[0].t_max[i] == packets[1].t_max[i]);
+        }
+        assert(hits > 1000);
+    }
+
+    inline void test_round_trip() {
+        std::string path = tempPath("rt_test_scene.rtscene");
+        Scene built(shapes());
+        assert(writeSceneCache(path.c_str(), built, 1234));
+        assert(!std::filesystem::exists(path + ".tmp"));
+
+        SceneCacheInfo info;
+        std::unique_ptr<Scene> loaded = loadSceneCache(path.c_str(), 1234, &info);
+        assert(loaded && info.hit && info.bytes == std::filesystem::file_size(path));
+        assert(loaded->aggregate.shapes.size() == built.aggregate.shapes.size());
+        const Array<BVH::LinearNode>& nodes = loaded->aggregate.nodes;
+        assert(nodes.borrowed() && nodes.size() == built.aggregate.nodes.size());
+        assert(memcmp(nodes.data(), built.aggregate.nodes.data(), nodes.size() * sizeof(BVH::LinearNode)) == 0);
+        assert(same(loaded->worldBound().p_min, built.worldBound().p_min) && same(loaded->worldBound().p_max, built.worldBound().p_max));
+
+        // the soup's and meshes' arrays are the file's, not copies
+        int borrowed = 0;
+        for (const std::shared_ptr<Shape>& shape : loaded->aggregate.shapes) {
+            if (const SphereSoup* soup = dynamic_cast<const SphereSoup*>(shape.get())) {
+                assert(soup->nodes.borrowed() && soup->blocks.borrowed() && soup->size() == 203);
+                ++borrowed;
+            }
+            if (const TriangleMesh* mesh = dynamic_cast<const TriangleMesh*>(shape.get())) {
+                assert(mesh->indices.borrowed() && mesh->nodes.borrowed());
+                assert(mesh->edgeTriangles.empty() == (mesh->intersector == TriangleMesh::Watertight));
+                ++borrowed;
+            }
+        }
+        assert(borrowed == 3);
+
+        // the mapping outlives the file's name
+        std::filesystem::remove(path);
+        check_same_hits(built, *loaded);
+    }
+
+    // any other source, a damaged file, or a shape it doesn't know about means there's no cache to use
+    inline void test_invalidation() {
+        std::string path = tempPath("rt_test_scene_stale.rtscene");
+        std::filesystem::remove(path);
+        assert(!loadSceneCache(path.c_str(), 1)); // no file isn't worth a message
+
+        int builds = 0;
+        auto build = [&builds] { ++builds; return shapes(); };
+        SceneCacheInfo info;
+        std::unique_ptr<Scene> scene = loadOrBuildScene(path.c_str(), 1, build, &info);
+        assert(scene && builds == 1 && !info.hit && info.bytes > 0);
+        scene = loadOrBuildScene(path.c_str(), 1, build, &info);
+        assert(scene && builds == 1 && info.hit);
+
+        std::cout << "[test_scene_cache] the next few lines are expected errors\n";
+        assert(!loadSceneCache(path.c_str(), 2));
+        scene = loadOrBuildScene(path.c_str(), 2, build, &info);
+        assert(scene && builds == 2 && !info.hit);
+        assert(loadSceneCache(path.c_str(), 2) && !loadSceneCache(path.c_str(), 1));
+
+        // cut short, and not a cache at all
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 64);
+        assert(!loadSceneCache(path.c_str(), 2));
+        FILE* f = fopen(path.c_str(), "wb");
+        fputs("v 0 0 0\n", f);
+        fclose(f);
+        assert(!loadSceneCache(path.c_str(), 2));
+
+        // a subclass is another shape, whatever it inherits
+        struct OtherSphere : Sphere {
+            OtherSphere() : Sphere(Transform(), false, 1.0f) {}
+        };
+        std::vector<std::shared_ptr<Shape>> other = shapes();
+        other.push_back(std::make_shared<OtherSphere>());
+        std::filesystem::remove(path);
+        assert(!writeSceneCache(path.c_str(), Scene(other), 3));
+        assert(!std::filesystem::exists(path) && !std::filesystem::exists(path + ".tmp"));
+    }
+
+    // where bytes first appear in file, which has to have them
+    inline size_t find(const std::vector<char>& file, const void* bytes, size_t n) {
+        const char* p = (const char*)bytes;
+        std::vector<char>::const_iterator at = std::search(file.begin(), file.end(), p, p + n);
+        assert(at != file.end());
+        return at - file.begin();
+    }
+
+    inline std::vector<char> readFile(const std::string& path) {
+        std::vector<char> bytes(std::filesystem::file_size(path));
+        FILE* f = fopen(path.c_str(), "rb");
+        assert(fread(bytes.data(), 1, bytes.size(), f) == bytes.size());
+        fclose(f);
+        return bytes;
+    }
+
+    inline void writeFile(const std::string& path, const std::vector<char>& bytes) {
+        FILE* f = fopen(path.c_str(), "wb");
+        assert(fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size());
+        fclose(f);
+    }
+
+    // the cache at path with one value changed has to be turned down
+    template<typename T>
+    inline void check_rejected(const std::string& path, std::vector<char> bytes, size_t offset, T value) {
+        memcpy(&bytes[offset], &value, sizeof(T));
+        writeFile(path, bytes);
+        assert(!loadSceneCache(path.c_str(), 5));
+    }
+
+    // a file that's the right size and hash but whose trees, indices or counts point past its arrays is
+    // turned down when it's loaded, instead of being read out of bounds while rays are traced
+    inline void test_corrupt() {
+        std::string path = tempPath("rt_test_scene_corrupt.rtscene");
+        Scene built(shapes());
+        assert(writeSceneCache(path.c_str(), built, 5));
+        const std::vector<char> good = readFile(path);
+        assert(loadSceneCache(path.c_str(), 5));
+
+        const SphereSoup* soup = nullptr;
+        const TriangleMesh* mesh = nullptr;
+        for (const std::shared_ptr<Shape>& shape : built.aggregate.shapes) {
+            if (!soup) soup = dynamic_cast<const SphereSoup*>(shape.get());
+            if (!mesh) mesh = dynamic_cast<const TriangleMesh*>(shape.get());
+        }
+        assert(soup && mesh);
+
+        // every node is unique by its bounds, so each tree is where its bytes are
+        auto nodeAt = [&good](const Array<BVH::LinearNode>& nodes, size_t i) {
+            return find(good, nodes.data(), nodes.size() * sizeof(BVH::LinearNode)) + i * sizeof(BVH::LinearNode);
+        };
+        auto firstLeaf = [](const Array<BVH::LinearNode>& nodes) {
+            size_t i = 0;
+            while (nodes[i].nPrimitives == 0) ++i;
+            return i;
+        };
+        const size_t childOffset = offsetof(BVH::LinearNode, secondChildOffset);
+        const size_t countOffset = offsetof(BVH::LinearNode, nPrimitives);
+
+        std::cout << "[test_scene_cache] the next few lines are expected errors\n";
+        // the top-level tree: a leaf past the shapes, a child past the nodes and one before its parent
+        const Array<BVH::LinearNode>& top = built.aggregate.nodes;
+        check_rejected(path, good, nodeAt(top, firstLeaf(top)) + childOffset, (int32_t)built.aggregate.shapes.size());
+        check_rejected(path, good, nodeAt(top, 0) + childOffset, (int32_t)top.size());
+        check_rejected(path, good, nodeAt(top, 0) + childOffset, (int32_t)0);
+        check_rejected(path, good, nodeAt(top, 0) + countOffset + 2, (uint8_t)3); // the axis
+
+        // the soup's: a leaf past the blocks, one with more spheres than a block has, and a count its leaves don't add up to
+        check_rejected(path, good, nodeAt(soup->nodes, firstLeaf(soup->nodes)) + childOffset, (int32_t)soup->blocks.size());
+        check_rejected(path, good, nodeAt(soup->nodes, firstLeaf(soup->nodes)) + countOffset, (uint16_t)(SphereSoup::LEAF_WIDTH + 1));
+        check_rejected(path, good, nodeAt(soup->nodes, 0) + childOffset, (int32_t)-1);
+        // the record keeps the soup's count right before the range of its nodes
+        uint64_t range[3] = { soup->size(), (uint64_t)nodeAt(soup->nodes, 0), soup->nodes.size() };
+        check_rejected(path, good, find(good, range, sizeof(range)), (uint64_t)(soup->size() + 1));
+
+        // the mesh's: a leaf past the triangles, and a triangle using a vertex that isn't there
+        size_t triangles = mesh->indices.size() / 3;
+        check_rejected(path, good, nodeAt(mesh->nodes, firstLeaf(mesh->nodes)) + childOffset, (int32_t)triangles);
+        size_t indices = find(good, mesh->indices.data(), mesh->indices.size() * sizeof(uint32_t));
+        check_rejected(path, good, indices + 7 * sizeof(uint32_t), (uint32_t)mesh->positions.size());
+
+        // and the file as it was written still loads
+        writeFile(path, good);
+        assert(loadSceneCache(path.c_str(), 5));
+        std::filesystem::remove(path);
+    }
+
+    // reference values from the xxHash library
+    inline void test_hash() {
+        assert(hashBytes("", 0) == 0xef46db3751d8e999ull);
+        assert(hashBytes("a", 1) == 0xd24ec4f1a98c6e5bull);
+        assert(hashBytes("abc", 3, 7) == 0x9e755206156676d7ull);
+        const char* fox = "The quick brown fox jumps over the lazy dog";
+        assert(hashBytes(fox, strlen(fox)) == 0x0b242d361fda71bcull);
+        unsigned char bytes[100];
+        for (int i = 0; i < 100; ++i) bytes[i] = (unsigned char)i;
+        assert(hashBytes(bytes, 100, 7) == 0x80653e7e9b887cddull);
+
+        std::string path = tempPath("rt_test_hash.bin");
+        FILE* f = fopen(path.c_str(), "wb");
+        fwrite(bytes, 1, 100, f);
+        fclose(f);
+        uint64_t hash = 0;
+        assert(hashFile(path.c_str(), &hash) && hash == hashBytes(bytes, 100));
+        std::filesystem::remove(path);
+    }
+
+    inline void run_all_scene_cache_tests() {
+        test_hash();
+        test_round_trip();
+        test_invalidation();
+        test_corrupt();
+        std::cout << "[test_scene_cache] all scene cache tests passed\n";
+    }
+}
+
+#endif // TEST_SCENE_CACHE_H
@@ -0,0 +1,154 @@
+#ifndef TEST_SPHERE_H
+#define TEST_SPHERE_H
+
+#include "Sphere.h"
+#include "RayPacket.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/*
+    a full sphere placed by a translation and a uniform scale takes the world space path, the same sphere
+    spun about its z axis first takes the general object space path, and both have to find the same hits
+
+    the geometry at a hit is checked against what it has to be on a sphere, on either path
+*/
+
+namespace test_sphere {
+    static constexpr float EPS = 1e-4f;
+
+    inline bool feq(float a, float b) {
+        return std::fabs(a - b) <= EPS * std::fmax(1.0f, std::fmax(std::fabs(a), std::fabs(b)));
+    }
+
+    // true if the ray barely hits or barely misses, or its hit lies right at t_min or t_max
+    inline bool grazing(const Point& c, float r, const Ray& ray) {
+        double dx = ray.d.x, dy = ray.d.y, dz = ray.d.z;
+        double ox = ray.o.x - c.x, oy = ray.o.y - c.y, oz = ray.o.z - c.z;
+        double a = dx * dx + dy * dy + dz * dz;
+        double b = ox * dx + oy * dy + oz * dz;
+        double disc = b * b - a * (ox * ox + oy * oy + oz * oz - (double)r * r);
+        if (std::fabs(disc) < 1e-3 * a * r * r) return true;
+        if (disc < 0) return false;
+        double s = std::sqrt(disc);
+        for (double t : { (-b - s) / a, (-b + s) / a })
+            if (std::fabs(t - ray.t_min) < 1e-3 || std::fabs(t - ray.t_max) < 1e-3) return true;
+        return false;
+    }
+
+    inline void test_world_space_matches_general() {
+        std::mt19937 rng(45);
+        std::uniform_real_distribution<float> pos(-50.0f, 50.0f), scale(0.1f, 4.0f), u(-1.0f, 1.0f);
+        int hits = 0;
+        for (int i = 0; i < 200; ++i) {
+            Point c(pos(rng), pos(rng), pos(rng));
+            float s = (i % 3 == 0 ? -1.0f : 1.0f) * scale(rng), r = 0.5f + 0.5f * (u(rng) + 1.0f);
+            Transform place = Transform::translate(Vector(c.x, c.y, c.z)) * Transform::scale(s, s, s);
+            Sphere world(place, false, r), general(place * Transform::rotateZ(1.0f), false, r);
+            float R = r * std::fabs(s);
+
+            for (int j = 0; j < 50; ++j) {
+                // aimed somewhere around the sphere, from near or far, sometimes starting inside it
+                Point o = c + Vector(u(rng), u(rng), u(rng)) * (j % 5 == 0 ? 0.5f * R : 20.0f * R);
+                Point target = c + Vector(u(rng), u(rng), u(rng)) * 1.5f * R;
+                Ray ray(o, (target - o) * (0.5f + u(rng) + 1.0f));
+                if (j % 7 == 0) ray.t_max = 0.5f * (u(rng) + 1.0f);
+                if (grazing(c, R, ray)) continue;
+
+                Hit hw, hg;
+                bool w = world.intersect(ray, &hw), g = general.intersect(ray, &hg);
+                assert(w == g);
+                if (w) {
+                    assert(feq(hw.t, hg.t));
+                    ++hits;
+                }
+            }
+        }
+        assert(hits > 1000);
+    }
+
+    // the packet kernel gives every lane exactly what intersect() gives
+    template<int N>
+    inline void test_world_space_packets() {
+        std::mt19937 rng(46);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        Sphere sphere(Transform::translate(Vector(1, 2, 3)) * Transform::scale(1.5f, 1.5f, 1.5f), false, 1.0f);
+        for (int trial = 0; trial < 200; ++trial) {
+            RayPacket<N> packet;
+            Ray rays[N];
+            for (int i = 0; i < N; ++i) {
+                rays[i] = Ray(Point(1 + 4 * u(rng), 2 + 4 * u(rng), 3 + 4 * u(rng)), Vector(u(rng), u(rng), u(rng)));
+                packet.set(i, rays[i]);
+            }
+            Maskx<N> active = Maskx<N>::fromBits((uint32_t)rng());
+            Floatx<N> t(-1.0f);
+            Maskx<N> hit = sphere.intersectPacket(packet, active, &t);
+            for (int i = 0; i < N; ++i) {
+                Hit hs;
+                bool h = active[i] && sphere.intersect(rays[i], &hs);
+                assert(hit[i] == h);
+                assert(t[i] == (h ? hs.t : -1.0f));
+            }
+        }
+    }
+
+    inline bool veq(const Vector& a, const Vector& b, float scale) {
+        return (a - b).length() <= 1e-3f * std::fmax(scale, 1.0f);
+    }
+
+    // the geometry of a sphere of world radius R around c: the normal is (p - c) / R (pointing in when reversed),
+    // dpdu and dpdv are tangent to it, and the normal changes like the point does, over R
+    inline void check_geometry(const Sphere& sphere, const Point& c, float R, bool reversed, std::mt19937& rng) {
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        int hits = 0;
+        for (int j = 0; j < 500; ++j) {
+            Point o = c + Vector(u(rng), u(rng), u(rng)) * 4.0f * R;
+            Ray ray(o, c + Vector(u(rng), u(rng), u(rng)) * R - o);
+            Hit hit;
+            if (!sphere.intersect(ray, &hit)) continue;
+            assert(hit.shape == &sphere);
+            ++hits;
+
+            DifferentialGeometry dg;
+            sphere.getDifferentialGeometry(ray, hit, &dg);
+            Vector out = (dg.p - c) / R;
+            assert(dg.shape == &sphere && veq(Vector(dg.p - ray(hit.t)), Vector(0, 0, 0), R));
+            assert(std::fabs(out.length() - 1.0f) < 1e-3f);
+            assert(dot(Vector(dg.nn), out) > (reversed ? -1.001f : 0.999f) && dot(Vector(dg.nn), out) < (reversed ? -0.999f : 1.001f));
+            assert(dg.u > -1e-4f && dg.u < 1.0f + 1e-4f && dg.v > -1e-4f && dg.v < 1.0f + 1e-4f);
+
+            float scale = dg.dpdu.length() + dg.dpdv.length();
+            assert(std::fabs(dot(dg.dpdu, out)) < 1e-3f * scale && std::fabs(dot(dg.dpdv, out)) < 1e-3f * scale);
+            assert(veq(dg.dndu, dg.dpdu / R, scale / R) && veq(dg.dndv, dg.dpdv / R, scale / R));
+        }
+        assert(hits > 50);
+    }
+
+    inline void test_differential_geometry() {
+        std::mt19937 rng(47);
+        Point c(3, -2, 5);
+        Transform place = Transform::translate(Vector(c.x, c.y, c.z));
+        Transform spin = Transform::rotateX(0.7f) * Transform::rotateZ(1.0f);
+        for (float s : { 1.5f, -0.8f }) {
+            Transform scaled = place * Transform::scale(s, s, s);
+            float R = 2.0f * std::fabs(s);
+            // the world space path, the general one, a clipped sphere and a reversed one
+            check_geometry(Sphere(scaled, false, 2.0f), c, R, false, rng);
+            check_geometry(Sphere(scaled * spin, false, 2.0f), c, R, false, rng);
+            check_geometry(Sphere(scaled * spin, false, 2.0f, -1.0f, 1.6f, 4.0f), c, R, false, rng);
+            check_geometry(Sphere(scaled, true, 2.0f), c, R, true, rng);
+        }
+    }
+
+    inline void run_all_sphere_tests() {
+        test_world_space_matches_general();
+        test_world_space_packets<4>();
+        test_world_space_packets<8>();
+        test_world_space_packets<16>();
+        test_differential_geometry();
+        std::cout << "[test_sphere] all Sphere tests passed\n";
+    }
+}
+
+#endif // TEST_SPHERE_H
@@ -0,0 +1,200 @@
+#ifndef TEST_SPHERE_SOUP_H
+#define TEST_SPHERE_SOUP_H
+
+#include "SphereSoup.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace test_sphere_soup {
+    struct Reference {
+        bool hit = false;
+        bool grazing = false; // some sphere is barely hit or barely missed, float answers may differ
+        double t = INFINITY;
+    };
+
+    // closest hit over every sphere, in double precision
+    inline Reference closest(const std::vector<Point>& c, const std::vector<float>& r, const Ray& ray) {
+        Reference ref;
+        double dx = ray.d.x, dy = ray.d.y, dz = ray.d.z;
+        double a = dx * dx + dy * dy + dz * dz;
+        for (size_t i = 0; i < c.size(); ++i) {
+            double ox = ray.o.x - c[i].x, oy = ray.o.y - c[i].y, oz = ray.o.z - c[i].z;
+            double b = ox * dx + oy * dy + oz * dz;
+            double cc = ox * ox + oy * oy + oz * oz - (double)r[i] * r[i];
+            double disc = b * b - a * cc;
+            if (std::fabs(disc) < 1e-3 * r[i] * r[i]) ref.grazing = true;
+            if (disc < 0) continue;
+            double s = std::sqrt(disc);
+            double t0 = (-b - s) / a, t1 = (-b + s) / a;
+            double t = t0 > ray.t_min ? t0 : t1;
+            if (std::fabs(t - ray.t_min) < 1e-3 || std::fabs(t - ray.t_max) < 1e-3) ref.grazing = true;
+            if (t > ray.t_min && t < ray.t_max && t < ref.t) {
+                ref.hit = true;
+                ref.t = t;
+            }
+        }
+        return ref;
+    }
+
+    inline void test_matches_reference() {
+        std::mt19937 rng(44);
+        std::uniform_real_distribution<float> pos(-5.0f, 5.0f), rad(0.05f, 0.6f), u(-1.0f, 1.0f);
+        // enough spheres for a few levels, and a count that leaves some leaves partly empty
+        std::vector<Point> centers;
+        std::vector<float> radii;
+        for (int i = 0; i < 301; ++i) {
+            centers.push_back(Point(pos(rng), pos(rng), pos(rng)));
+            radii.push_back(rad(rng));
+        }
+        SphereSoup soup(centers, radii);
+        assert(soup.size() == centers.size());
+        assert(soup.bytes() < centers.size() * 64);
+
+        // the root bounds every sphere
+        Bbox root = soup.worldBound();
+        for (size_t i = 0; i < centers.size(); ++i)
+            assert(root.containsPoint(centers[i] + Vector(radii[i], radii[i], radii[i])));
+
+        int hits = 0, checked = 0;
+        for (int i = 0; i < 3000; ++i) {
+            Point o(u(rng) * 8, u(rng) * 8, u(rng) * 8);
+            Ray ray(o, normalize(Vector(u(rng), u(rng), u(rng))));
+            Reference ref = closest(centers, radii, ray);
+            if (ref.grazing) continue;
+            ++checked;
+
+            Hit h;
+            bool hit = soup.intersect(ray, &h);
+            assert(hit == ref.hit);
+            assert(soup.doesIntersect(Ray(o, ray.d)) == ref.hit);
+            if (hit) {
+                ++hits;
+                float t = h.t;
+                assert(std::fabs(t - ref.t) < 1e-3 * std::fmax(1.0, ref.t));
+                assert(ray.t_max == t && h.shape == &soup);
+
+                // the geometry is on the sphere that was hit, with the normal pointing out of it
+                DifferentialGeometry dg;
+                soup.getDifferentialGeometry(ray, h, &dg);
+                const SphereSoup::Block& b = soup.blocks[h.primitive / SphereSoup::LEAF_WIDTH];
+                int lane = h.primitive % SphereSoup::LEAF_WIDTH;
+                Vector out = (dg.p - Point(b.x[lane], b.y[lane], b.z[lane])) / b.r[lane];
+                assert(dg.shape == &soup && std::fabs(dg.nn.length() - 1.0f) < 1e-3f);
+                assert(std::fabs(out.length() - 1.0f) < 1e-3f && dot(Vector(dg.nn), out) > 0.999f);
+                assert(dg.u >= 0.0f && dg.u <= 1.0f && dg.v >= 0.0f && dg.v <= 1.0f);
+            }
+        }
+        assert(checked > 2000 && hits > 0);
+    }
+
+    // the small spheres of particle scenes, far from the origin
+    inline void test_small_and_far() {
+        std::vector<Point> centers = { Point(1000.0f, 0.0f, 0.0f) };
+        std::vector<float> radii = { 0.001f };
+        SphereSoup soup(centers, radii);
+        Hit h;
+        assert(soup.intersect(Ray(Point(0, 0.0005f, 0), Vector(1, 0, 0)), &h));
+        assert(std::fabs(h.t - (1000.0f - std::sqrt(0.001f * 0.001f - 0.0005f * 0.0005f))) < 0.01f);
+        assert(!soup.intersect(Ray(Point(0, 0.0015f, 0), Vector(1, 0, 0)), &h));
+    }
+
+    inline void test_empty() {
+        SphereSoup soup({}, {});
+        Hit h;
+        assert(!soup.intersect(Ray(Point(0, 0, 0), Vector(0, 0, 1)), &h));
+        assert(!soup.doesIntersect(Ray(Point(0, 0, 0), Vector(0, 0, 1))));
+    }
+
+    // a soup missing some radii is built empty instead of reading past them
+    inline void test_mismatched_radii() {
+        std::cout << "[test_sphere_soup] the next line is an expected error\n";
+        SphereSoup soup({ Point(0, 0, 5), Point(0, 0, 8) }, { 1.0f });
+        assert(soup.size() == 0 && soup.nodes.size() == 0 && soup.blocks.size() == 0);
+        assert(!soup.doesIntersect(Ray(Point(0, 0, 0), Vector(0, 0, 1))));
+    }
+
+    // doesIntersect() only asks whether there's a hit, the ray it's given keeps its t_max however many
+    // spheres are along it, while intersect() shortens it to the closest
+    inline void test_does_intersect_keeps_t_max() {
+        std::vector<Point> centers;
+        std::vector<float> radii;
+        for (int i = 0; i < 64; ++i) {
+            centers.push_back(Point(0.0f, 0.0f, 2.0f + i));
+            radii.push_back(0.25f);
+        }
+        SphereSoup soup(centers, radii);
+
+        for (float t_max : { INFINITY, 40.0f, 2.0f }) {
+            Ray ray(Point(0, 0, 0), Vector(0, 0, 1));
+            ray.t_max = t_max;
+            assert(soup.doesIntersect(ray));
+            assert(ray.t_max == t_max);
+
+            Hit h;
+            assert(soup.intersect(ray, &h));
+            assert(std::fabs(h.t - 1.75f) < 1e-5f && ray.t_max == h.t);
+        }
+
+        Ray ray(Point(0, 0, 0), Vector(0, 0, 1));
+        ray.t_max = 1.5f;
+        assert(!soup.doesIntersect(ray) && ray.t_max == 1.5f);
+    }
+
+    // every active lane of a packet gets exactly what its ray gets on its own
+    template<int N>
+    inline void test_packets() {
+        std::mt19937 rng(45);
+        std::uniform_real_distribution<float> pos(-5.0f, 5.0f), rad(0.05f, 0.6f), u(-1.0f, 1.0f);
+        std::vector<Point> centers;
+        std::vector<float> radii;
+        for (int i = 0; i < 200; ++i) {
+            centers.push_back(Point(pos(rng), pos(rng), pos(rng)));
+            radii.push_back(rad(rng));
+        }
+        SphereSoup soup(centers, radii);
+
+        int hits = 0;
+        for (int packet = 0; packet < 200; ++packet) {
+            RayPacket<N> rays;
+            Ray single[N];
+            for (int i = 0; i < N; ++i) {
+                single[i] = Ray(Point(u(rng) * 8, u(rng) * 8, -10), normalize(Vector(u(rng) * 0.3f, u(rng) * 0.3f, 1)));
+                rays.set(i, single[i]);
+            }
+            Maskx<N> active = Maskx<N>::fromBits(packet % 2 ? Maskx<N>::ALL : 0x5555u);
+            Floatx<N> t(-1.0f);
+            Maskx<N> hit = soup.intersectPacket(rays, active, &t);
+            for (int i = 0; i < N; ++i) {
+                assert(rays.t_max[i] == INFINITY); // the caller's packet is left alone
+                if (!active[i]) {
+                    assert(!hit[i] && t[i] == -1.0f);
+                    continue;
+                }
+                Hit hs;
+                bool h = soup.intersect(single[i], &hs);
+                assert(hit[i] == h);
+                if (h) {
+                    ++hits;
+                    assert(t[i] == hs.t);
+                }
+            }
+        }
+        assert(hits > 0);
+    }
+
+    inline void run_all_sphere_soup_tests() {
+        test_matches_reference();
+        test_packets<4>();
+        test_packets<8>();
+        test_packets<16>();
+        test_small_and_far();
+        test_empty();
+        test_mismatched_radii();
+        test_does_intersect_keeps_t_max();
+        std::cout << "[test_sphere_soup] all SphereSoup tests passed\n";
+    }
+}
+
+#endif // TEST_SPHERE_SOUP_H
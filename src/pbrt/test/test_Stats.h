@@ -0,0 +1,89 @@
+#ifndef TEST_STATS_H
+#define TEST_STATS_H
+
+#include "Stats.h"
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+    built with -DRT_STATS, every thread's counters have to add up to the right totals once they're reported
+    built without it, the macros have to be nothing at all: no statistic exists and no argument is evaluated
+*/
+
+namespace test_stats {
+    STAT_COUNTER("Test/Values counted", nTestValues);
+    STAT_RATIO("Test/Even values", nTestEvens, nTestTotal);
+    STAT_INT_DISTRIBUTION("Test/Values", testValues);
+
+    constexpr int THREADS = 4;
+    constexpr int VALUES = 1000;
+
+    // each thread counts 0 to VALUES - 1 in its own copies, then folds them in
+    inline void count() {
+        for (int i = 0; i < VALUES; ++i) {
+            STAT_INC(nTestValues);
+            STAT_ADD(nTestTotal, 1);
+            if (i % 2 == 0) STAT_INC(nTestEvens);
+            STAT_REPORT_VALUE(testValues, i);
+        }
+        stats::reportThread();
+    }
+
+#ifdef RT_STATS
+    inline void test_merge() {
+        assert(stats::enabled());
+        stats::clear();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) threads.emplace_back(count);
+        for (std::thread& t : threads) t.join();
+        // this thread never counted anything, and reporting twice adds nothing more
+        stats::reportThread();
+        stats::reportThread();
+
+        stats::Accumulator totals = stats::totals();
+        assert(totals.counters["Test/Values counted"] == THREADS * VALUES);
+        const std::pair<int64_t, int64_t>& evens = totals.ratios["Test/Even values"];
+        assert(evens.first == THREADS * VALUES / 2 && evens.second == THREADS * VALUES);
+
+        const stats::Accumulator::Distribution& d = totals.distributions["Test/Values"];
+        assert(d.count == THREADS * VALUES && d.sum == (int64_t)THREADS * VALUES * (VALUES - 1) / 2);
+        assert(d.min == 0 && d.max == VALUES - 1);
+        // buckets are [0], [1], [2, 3], ..., and the last one of 0..999 ([512, 1023]) holds 488 of them
+        assert(d.buckets[0] == THREADS && d.buckets[1] == THREADS && d.buckets[2] == 2 * THREADS);
+        assert(d.buckets[10] == (VALUES - 512) * THREADS && d.buckets[11] == 0);
+
+        stats::clear();
+        assert(stats::totals().counters.empty());
+    }
+#else
+    inline void test_compiled_out() {
+        static_assert(!stats::enabled(), "statistics are compiled in without RT_STATS");
+
+        int evaluated = 0;
+        // none of these names even exist
+        STAT_INC(nTestValues);
+        STAT_ADD(nTestTotal, ++evaluated);
+        STAT_REPORT_VALUE(testValues, ++evaluated);
+        assert(evaluated == 0);
+
+        count();
+        stats::Accumulator totals = stats::totals();
+        assert(totals.counters.empty() && totals.ratios.empty() && totals.distributions.empty());
+    }
+#endif
+
+    inline void run_all_stats_tests() {
+#ifdef RT_STATS
+        test_merge();
+#else
+        test_compiled_out();
+#endif
+        std::cout << "[test_stats] all stats tests passed\n";
+    }
+}
+
+#endif // TEST_STATS_H
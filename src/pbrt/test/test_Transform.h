@@ -139,6 +139,49 @@ namespace test_transform {
         assert(feq(bt.p_max.x, 6) && feq(bt.p_max.y, 2) && feq(bt.p_max.z, 3));
     }
 
+    inline void test_value_storage() {
+        // both matrices live inside the Transform
+        static_assert(sizeof(Transform) == 128, "Transform should be exactly two inline Mat4s");
+        static_assert(alignof(Transform) >= 16, "Transform should be 16 byte aligned");
+
+        // copies are independent
+        Transform A = Transform::translate(Vector(1,2,3));
+        Transform B = A;
+        B.m.m[0][3] = 7;
+        assert(feq(A.m.m[0][3], 1));
+
+        // the shared_ptr constructors still work, and copy the matrices in
+        auto M = std::make_shared<Mat4>(2,0,0,0, 0,2,0,0, 0,0,2,0, 0,0,0,1);
+        Transform S(M);
+        M->m[0][0] = 5;
+        Point p = S(Point(1,1,1));
+        assert(feq(p.x, 2) && feq(p.y, 2) && feq(p.z, 2));
+        Point q = S.getInverse()(p);
+        assert(feq(q.x, 1) && feq(q.y, 1) && feq(q.z, 1));
+    }
+
+    // the affine builders fold to constants, like rtiow's camera_to_world
+    inline void test_constexpr() {
+        constexpr Transform T = Transform::translate(Vector(1, 2, 3)) * Transform::scale(2, 4, 8);
+        constexpr Point p = T(Point(1, 1, 1));
+        static_assert(p.x == 3 && p.y == 6 && p.z == 11, "scale, then translate");
+        constexpr Point back = T.getInverse()(p);
+        static_assert(back.x == 1 && back.y == 1 && back.z == 1, "inverse");
+        constexpr Vector v = T(Vector(1, 1, 1));
+        static_assert(v.x == 2 && v.y == 4 && v.z == 8, "vectors aren't translated");
+        static_assert(T.isAffine(), "translate and scale are affine");
+
+        constexpr Transform O = Transform::orthographic(0.0f, 10.0f);
+        constexpr Point q = O(Point(0, 0, 10));
+        static_assert(q.z == 1, "far plane maps to z = 1");
+
+        // same values as at runtime
+        Transform R = Transform::translate(Vector(1, 2, 3)) * Transform::scale(2, 4, 8);
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                assert(R.m.m[i][j] == T.m.m[i][j] && R.m_inv.m[i][j] == T.m_inv.m[i][j]);
+    }
+
     inline void run_all_transform_tests() {
         test_identity();
         test_translate();
@@ -148,6 +191,8 @@ namespace test_transform {
         test_lookAt();
         test_orthographic();
         test_ray_and_bbox();
+        test_value_storage();
+        test_constexpr();
         std::cout << "[test_transform] all Transform tests passed\n";
     }
 }
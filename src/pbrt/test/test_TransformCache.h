@@ -0,0 +1,164 @@
+#ifndef TEST_TRANSFORM_CACHE_H
+#define TEST_TRANSFORM_CACHE_H
+
+#include "TransformCache.h"
+#include "Sphere.h"
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace test_transform_cache {
+    inline AffineTransform translation(float x) {
+        return AffineTransform(Transform::translate(Vector(x, 0, 0)));
+    }
+
+    inline void test_interning() {
+        TransformCache cache;
+        std::shared_ptr<const AffineTransform> a = cache.lookup(translation(1));
+        std::shared_ptr<const AffineTransform> b = cache.lookup(translation(1));
+        std::shared_ptr<const AffineTransform> c = cache.lookup(translation(2));
+        assert(a == b && a != c);
+        assert(a->m[0][3] == 1 && c->m[0][3] == 2);
+        // an inverse is a different transform, though it's kept with the one it's the inverse of
+        std::shared_ptr<const AffineTransform> inverse;
+        assert(cache.lookup(translation(1), &inverse) == a && inverse->m[0][3] == -1 && inverse->m_inv[0][3] == 1);
+        assert(cache.lookup(translation(1).getInverse()) != inverse);
+        // which nothing held on to, so it's gone already
+        assert(cache.size() == 2 && cache.lookups() == 5);
+        assert(cache.bytes() > 0);
+    }
+
+    // copies stay put and unique while the table grows, and leave it as they're dropped
+    inline void test_release() {
+        TransformCache cache;
+        std::vector<std::shared_ptr<const AffineTransform>> first;
+        for (int i = 0; i < 10000; ++i)
+            first.push_back(cache.lookup(translation((float)i)));
+        for (int i = 0; i < 10000; ++i) {
+            assert(first[i]->m[0][3] == (float)i);
+            assert(cache.lookup(translation((float)i)) == first[i]);
+        }
+        assert(cache.size() == 10000);
+
+        // dropping every other one leaves the rest findable (the table closes the gaps behind them)
+        for (int i = 0; i < 10000; i += 2) first[i].reset();
+        assert(cache.size() == 5000);
+        for (int i = 1; i < 10000; i += 2) assert(cache.lookup(translation((float)i)) == first[i]);
+        // a dropped one is made again when it's looked up, and dropped again right after
+        assert(cache.lookup(translation(0))->m[0][3] == 0);
+        assert(cache.size() == 5000);
+
+        size_t held = cache.bytes();
+        first.clear();
+        assert(cache.size() == 0 && cache.bytes() < held && cache.bytes() == 0);
+        assert(cache.lookup(translation(3))->m[0][3] == 3);
+    }
+
+    // a copy outlives the cache it came from
+    inline void test_outlives_cache() {
+        std::shared_ptr<const AffineTransform> kept;
+        {
+            TransformCache cache;
+            kept = cache.lookup(translation(5));
+        }
+        assert(kept->m[0][3] == 5);
+        kept.reset();
+    }
+
+    // *inverse may hold the only reference to another entry, which then leaves the table as it's replaced
+    inline void test_replaced_inverse() {
+        TransformCache cache;
+        std::shared_ptr<const AffineTransform> inverse;
+        cache.lookup(translation(1), &inverse);
+        assert(cache.size() == 1);
+        assert(cache.lookup(translation(2), &inverse)->m[0][3] == 2);
+        // the first entry is gone, the second is kept by its inverse
+        assert(inverse->m[0][3] == -2 && cache.size() == 1);
+        // and over one that's the same entry
+        std::shared_ptr<const AffineTransform> t = cache.lookup(translation(2), &inverse);
+        assert(inverse->m[0][3] == -2 && cache.size() == 1);
+    }
+
+    // a dropped copy's block in the pool goes to the next copy made
+    inline void test_block_reuse() {
+        TransformCache cache;
+        std::shared_ptr<const AffineTransform> a = cache.lookup(translation(1)), b = cache.lookup(translation(2));
+        size_t held = cache.bytes();
+        const AffineTransform* freed = b.get();
+        b.reset();
+        b = cache.lookup(translation(3));
+        assert(b.get() == freed && b->m[0][3] == 3 && cache.bytes() == held);
+    }
+
+    // lookups and releases from many threads at once agree on one copy per transform
+    inline void test_threads() {
+        TransformCache cache;
+        std::vector<std::shared_ptr<const AffineTransform>> kept(64);
+        for (int i = 0; i < 64; ++i) kept[i] = cache.lookup(translation((float)i));
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+            threads.emplace_back([&cache, &kept, t] {
+                for (int round = 0; round < 2000; ++round) {
+                    int i = (round * 7 + t) % 128;
+                    std::shared_ptr<const AffineTransform> a = cache.lookup(translation((float)i));
+                    assert(a->m[0][3] == (float)i);
+                    if (i < 64) assert(a == kept[i]);
+                }
+            });
+        for (std::thread& t : threads) t.join();
+        assert(cache.size() == 64);
+    }
+
+    // shapes built from equal Transforms share the global cache's copies, which go with the last of them
+    inline void test_shapes_share() {
+        size_t before = TransformCache::global().size();
+        {
+            Sphere s(Transform::translate(Vector(0.125f, 0.5f, 7)), false, 1.0f);
+            assert(TransformCache::global().size() == before + 1);
+        }
+        assert(TransformCache::global().size() == before);
+
+        Transform placement = Transform::translate(Vector(0.25f, 0.5f, 8));
+        Sphere s1(placement, false, 1.0f), s2(placement, false, 2.0f);
+        Sphere s3(Transform::translate(Vector(0.25f, 0.5f, 9)), false, 1.0f);
+        assert(s1.object_to_world == s2.object_to_world && s1.world_to_object == s2.world_to_object);
+        assert(s1.object_to_world != s3.object_to_world);
+
+        Point p(1, 2, 3);
+        Point q = (*s1.world_to_object)((*s1.object_to_world)(p));
+        assert(std::fabs(q.x - p.x) < 1e-5f && std::fabs(q.y - p.y) < 1e-5f && std::fabs(q.z - p.z) < 1e-5f);
+    }
+
+    // a scene whose shapes repeat a few placements holds one copy of each, in less than a copy per shape would take
+    inline void test_repeated_placements() {
+        TransformCache& cache = TransformCache::global();
+        size_t before = cache.size(), bytesBefore = cache.bytes();
+        {
+            std::vector<std::shared_ptr<Shape>> shapes;
+            for (int shell = 1; shell <= 100; ++shell)
+                for (int i = 0; i < 10; ++i)
+                    shapes.push_back(std::make_shared<Sphere>(Transform::translate(Vector((float)i, 0, 20)), false, 0.004f * shell));
+            assert(cache.size() == before + 10);
+            assert(cache.bytes() - bytesBefore < shapes.size() * 2 * sizeof(AffineTransform));
+            for (int i = 0; i < 10; ++i)
+                assert(shapes[i]->object_to_world == shapes[990 + i]->object_to_world);
+        }
+        assert(cache.size() == before);
+    }
+
+    inline void run_all_transform_cache_tests() {
+        test_interning();
+        test_release();
+        test_outlives_cache();
+        test_replaced_inverse();
+        test_block_reuse();
+        test_threads();
+        test_shapes_share();
+        test_repeated_placements();
+        std::cout << "[test_transform_cache] all TransformCache tests passed\n";
+    }
+}
+
+#endif // TEST_TRANSFORM_CACHE_H
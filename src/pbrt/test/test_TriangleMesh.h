@@ -0,0 +1,312 @@
+#ifndef TEST_TRIANGLE_MESH_H
+#define TEST_TRIANGLE_MESH_H
+
+#include "TriangleMesh.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/*
+    both intersectors have to find the closest triangle a brute force test in double precision finds,
+    and Watertight can't let a ray out of a closed mesh, not even through a vertex or an edge
+*/
+
+namespace test_triangle_mesh {
+    struct Reference {
+        bool hit = false;
+        bool grazing = false; // some triangle is barely hit or barely missed, float answers may differ
+        double t = INFINITY;
+    };
+
+    // closest hit over every triangle, in double precision
+    inline Reference closest(const std::vector<uint32_t>& idx, const std::vector<Point>& P, const Ray& ray) {
+        Reference ref;
+        const double o[3] = { ray.o.x, ray.o.y, ray.o.z }, d[3] = { ray.d.x, ray.d.y, ray.d.z };
+        for (size_t i = 0; i < idx.size(); i += 3) {
+            const Point &p0 = P[idx[i]], &p1 = P[idx[i + 1]], &p2 = P[idx[i + 2]];
+            double e1[3] = { (double)p1.x - p0.x, (double)p1.y - p0.y, (double)p1.z - p0.z };
+            double e2[3] = { (double)p2.x - p0.x, (double)p2.y - p0.y, (double)p2.z - p0.z };
+            double s[3] = { o[0] - p0.x, o[1] - p0.y, o[2] - p0.z };
+            double pv[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+            double det = e1[0] * pv[0] + e1[1] * pv[1] + e1[2] * pv[2];
+            if (det == 0.0) continue;
+            double b1 = (s[0] * pv[0] + s[1] * pv[1] + s[2] * pv[2]) / det;
+            double qv[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+            double b2 = (d[0] * qv[0] + d[1] * qv[1] + d[2] * qv[2]) / det;
+            double t = (e2[0] * qv[0] + e2[1] * qv[1] + e2[2] * qv[2]) / det;
+            double edge = std::fmin(std::fmin(b1, b2), 1.0 - b1 - b2);
+            if (std::fabs(edge) < 1e-4) ref.grazing = true;
+            if (edge < 0) continue;
+            if (std::fabs(t - ray.t_min) < 1e-3 || std::fabs(t - ray.t_max) < 1e-3) ref.grazing = true;
+            if (t > ray.t_min && t < ray.t_max && t < ref.t) {
+                ref.hit = true;
+                ref.t = t;
+            }
+        }
+        return ref;
+    }
+
+    // a jittered heightfield of (n - 1)^2 quads over [-1, 1]^2, with per-vertex normals and uvs
+    inline void grid(int n, std::mt19937& rng, std::vector<uint32_t>* idx, std::vector<Point>* P,
+                     std::vector<Normal>* N, std::vector<float>* uv) {
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        for (int y = 0; y < n; ++y)
+            for (int x = 0; x < n; ++x) {
+                float px = -1.0f + 2.0f * x / (n - 1), py = -1.0f + 2.0f * y / (n - 1);
+                P->push_back(Point(px, py, 0.3f * std::sin(3.0f * px) * std::cos(2.0f * py) + 0.05f * u(rng)));
+                N->push_back(normalize(Normal(u(rng) * 0.3f, u(rng) * 0.3f, 1.0f)));
+                uv->push_back((float)x / (n - 1));
+                uv->push_back((float)y / (n - 1));
+            }
+        for (int y = 0; y + 1 < n; ++y)
+            for (int x = 0; x + 1 < n; ++x) {
+                uint32_t a = y * n + x, b = a + 1, c = a + n, d = c + 1;
+                for (uint32_t v : { a, b, d, a, d, c }) idx->push_back(v);
+            }
+    }
+
+    inline void test_matches_reference() {
+        std::mt19937 rng(48);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::vector<uint32_t> idx;
+        std::vector<Point> P;
+        std::vector<Normal> N;
+        std::vector<float> uv;
+        grid(13, rng, &idx, &P, &N, &uv);
+
+        // the reference works on the world space vertices, which are exactly what the identity leaves them
+        for (TriangleMesh::Intersector which : { TriangleMesh::Watertight, TriangleMesh::PrecomputedEdges }) {
+            TriangleMesh mesh(Transform(), false, idx, P, N, uv, which);
+            assert(mesh.nTriangles == 12 * 12 * 2 && mesh.nVertices == 13 * 13);
+            for (const Point& p : P) assert(mesh.worldBound().containsPoint(p));
+
+            int hits = 0, checked = 0;
+            for (int i = 0; i < 3000; ++i) {
+                Point o(2 * u(rng), 2 * u(rng), 2 * u(rng));
+                Ray ray(o, Point(u(rng), u(rng), 0.3f * u(rng)) - o);
+                if (i % 5 == 0) ray.t_max = 0.5f + 0.5f * u(rng);
+                Reference ref = closest(idx, P, ray);
+                if (ref.grazing) continue;
+                ++checked;
+
+                Hit hit;
+                Ray r = ray;
+                bool h = mesh.intersect(r, &hit);
+                assert(h == ref.hit);
+                assert(mesh.doesIntersect(ray) == ref.hit);
+                if (h) {
+                    ++hits;
+                    assert(std::fabs(hit.t - ref.t) <= 1e-4 * std::fmax(1.0, ref.t));
+                    assert(hit.shape == &mesh && hit.primitive < (uint32_t)mesh.nTriangles);
+                    assert(r.t_max == hit.t);
+                }
+            }
+            assert(checked > 2000 && hits > 1000);
+        }
+    }
+
+    // an octahedron subdivided level times and pushed out onto the unit sphere, closed, with shared vertices
+    inline void closed_sphere(int level, std::vector<uint32_t>* idx, std::vector<Point>* P) {
+        *P = { Point(1, 0, 0), Point(-1, 0, 0), Point(0, 1, 0), Point(0, -1, 0), Point(0, 0, 1), Point(0, 0, -1) };
+        *idx = { 0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4, 2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5 };
+        for (int l = 0; l < level; ++l) {
+            std::vector<uint32_t> next;
+            std::vector<std::pair<uint64_t, uint32_t>> mids;
+            auto midpoint = [&](uint32_t a, uint32_t b) {
+                uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+                for (auto& m : mids) if (m.first == key) return m.second;
+                Vector v = normalize((P->at(a) - Point(0, 0, 0)) + (P->at(b) - Point(0, 0, 0)));
+                P->push_back(Point(v.x, v.y, v.z));
+                mids.push_back({ key, (uint32_t)P->size() - 1 });
+                return (uint32_t)P->size() - 1;
+            };
+            for (size_t i = 0; i < idx->size(); i += 3) {
+                uint32_t a = (*idx)[i], b = (*idx)[i + 1], c = (*idx)[i + 2];
+                uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+                for (uint32_t v : { a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca }) next.push_back(v);
+            }
+            *idx = next;
+        }
+    }
+
+    // rays from inside through the vertices and edges the triangles share can't slip between them
+    inline void test_watertight() {
+        std::vector<uint32_t> idx;
+        std::vector<Point> P;
+        closed_sphere(3, &idx, &P);
+        Transform place = Transform::translate(Vector(0.3f, -0.2f, 4.0f)) * Transform::rotateX(0.4f) * Transform::scale(2.0f, 2.0f, 2.0f);
+        TriangleMesh mesh(place, false, idx, P);
+
+        std::mt19937 rng(49);
+        std::uniform_real_distribution<float> u(-0.5f, 0.5f);
+        int rays = 0;
+        for (size_t i = 0; i < idx.size(); i += 3)
+            for (int k = 0; k < 3; ++k) {
+                Point a = mesh.position(mesh.indices[i + k]), b = mesh.position(mesh.indices[i + (k + 1) % 3]);
+                Point edge = a + (b - a) * 0.5f;
+                for (int j = 0; j < 4; ++j) {
+                    Point o = place(Point(u(rng), u(rng), u(rng)));
+                    Hit hit;
+                    assert(mesh.intersect(Ray(o, a - o), &hit));
+                    assert(mesh.intersect(Ray(o, edge - o), &hit));
+                    assert(mesh.doesIntersect(Ray(o, edge - o)));
+                    rays += 3;
+                }
+            }
+        assert(rays > 1000);
+    }
+
+    // doesIntersect() only asks whether there's a hit, the ray it's given keeps its t_max however many
+    // triangles are along it, while intersect() shortens it to the closest
+    inline void test_does_intersect_keeps_t_max() {
+        std::vector<uint32_t> idx;
+        std::vector<Point> P;
+        closed_sphere(3, &idx, &P);
+        for (TriangleMesh::Intersector which : { TriangleMesh::Watertight, TriangleMesh::PrecomputedEdges }) {
+            TriangleMesh mesh(Transform::translate(Vector(0.0f, 0.0f, 4.0f)), false, idx, P, {}, {}, which);
+
+            for (float t_max : { INFINITY, 10.0f, 4.0f }) {
+                Ray ray(Point(0.01f, 0.02f, 0.0f), Vector(0, 0, 1));
+                ray.t_max = t_max;
+                assert(mesh.doesIntersect(ray));
+                assert(ray.t_max == t_max);
+
+                Hit h;
+                assert(mesh.intersect(ray, &h));
+                assert(h.t > 2.9f && h.t < 3.1f && ray.t_max == h.t);
+            }
+
+            Ray ray(Point(0.01f, 0.02f, 0.0f), Vector(0, 0, 1));
+            ray.t_max = 2.5f;
+            assert(!mesh.doesIntersect(ray) && ray.t_max == 2.5f);
+        }
+    }
+
+    // arrays that don't fit together leave the mesh empty, instead of being read past their ends
+    inline void test_mismatched_arrays() {
+        const std::vector<Point> P = { Point(-1, -1, 5), Point(1, -1, 5), Point(0, 1, 5) };
+        const std::vector<uint32_t> idx = { 0, 1, 2 };
+        const std::vector<Normal> N(3, Normal(0, 0, -1));
+        const std::vector<float> uv = { 0, 0, 1, 0, 0, 1 };
+        Ray ray(Point(0, 0, 0), Vector(0, 0, 1));
+        assert(TriangleMesh(Transform(), false, idx, P, N, uv).doesIntersect(ray));
+
+        std::cout << "[test_triangle_mesh] the next four lines are expected errors\n";
+        TriangleMesh outOfRange(Transform(), false, { 0, 1, 3 }, P);
+        TriangleMesh shortTriangle(Transform(), false, { 0, 1, 2, 0 }, P);
+        TriangleMesh fewerNormals(Transform(), false, idx, P, { Normal(0, 0, -1) });
+        TriangleMesh fewerUVs(Transform(), false, idx, P, N, { 0, 0, 1, 0 });
+        for (const TriangleMesh* mesh : { &outOfRange, &shortTriangle, &fewerNormals, &fewerUVs }) {
+            assert(mesh->nTriangles == 0 && mesh->nVertices == 0 && mesh->nodes.empty());
+            assert(mesh->normals.size() == 0 && mesh->us.empty());
+            Hit h;
+            assert(!mesh->doesIntersect(ray) && !mesh->intersect(ray, &h));
+        }
+    }
+
+    // the packet kernel gives every lane exactly what intersect() gives
+    template<int N>
+    inline void test_packets() {
+        std::mt19937 rng(50);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::vector<uint32_t> idx;
+        std::vector<Point> P;
+        std::vector<Normal> Nr;
+        std::vector<float> uv;
+        grid(9, rng, &idx, &P, &Nr, &uv);
+        for (TriangleMesh::Intersector which : { TriangleMesh::Watertight, TriangleMesh::PrecomputedEdges }) {
+            TriangleMesh mesh(Transform::rotateY(0.3f), false, idx, P, Nr, uv, which);
+            for (int trial = 0; trial < 200; ++trial) {
+                RayPacket<N> packet;
+                Ray rays[N];
+                Point o(2 * u(rng), 2 * u(rng), 2 + u(rng));
+                for (int i = 0; i < N; ++i) {
+                    rays[i] = Ray(o, Point(1.2f * u(rng), 1.2f * u(rng), 0) - o);
+                    if (i % 3 == 0) rays[i].t_max = 0.5f + 0.5f * u(rng);
+                    packet.set(i, rays[i]);
+                }
+                Maskx<N> active = Maskx<N>::fromBits((uint32_t)rng());
+                Floatx<N> t(-1.0f);
+                Maskx<N> hit = mesh.intersectPacket(packet, active, &t);
+                for (int i = 0; i < N; ++i) {
+                    Hit hs;
+                    bool h = active[i] && mesh.intersect(rays[i], &hs);
+                    assert(hit[i] == h);
+                    assert(t[i] == (h ? hs.t : -1.0f));
+                }
+            }
+        }
+    }
+
+    inline bool veq(const Vector& a, const Vector& b, float scale) {
+        return (a - b).length() <= 1e-3f * std::fmax(scale, 1.0f);
+    }
+
+    inline void test_differential_geometry() {
+        std::mt19937 rng(51);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::vector<uint32_t> idx;
+        std::vector<Point> P;
+        std::vector<Normal> Nr;
+        std::vector<float> uv;
+        grid(7, rng, &idx, &P, &Nr, &uv);
+        Transform place = Transform::translate(Vector(1, 2, 3)) * Transform::rotateZ(0.8f) * Transform::scale(1.5f, -1.5f, 1.5f);
+        for (bool withNormals : { true, false })
+            for (bool reversed : { false, true }) {
+                TriangleMesh mesh(place, reversed, idx, P, withNormals ? Nr : std::vector<Normal>(), uv);
+                int hits = 0;
+                for (int j = 0; j < 300; ++j) {
+                    Point o = place(Point(u(rng), u(rng), 2.0f));
+                    Ray ray(o, place(Point(u(rng), u(rng), 0.0f)) - o);
+                    Hit hit;
+                    if (!mesh.intersect(ray, &hit)) continue;
+                    ++hits;
+
+                    DifferentialGeometry dg;
+                    mesh.getDifferentialGeometry(ray, hit, &dg);
+                    assert(dg.shape == &mesh && veq(dg.p - ray(hit.t), Vector(0, 0, 0), 1.0f));
+
+                    // the geometric normal is perpendicular to the triangle, and the uvs are interpolated
+                    const uint32_t* v = &mesh.indices[3 * hit.primitive];
+                    Point p0 = mesh.position(v[0]), p1 = mesh.position(v[1]), p2 = mesh.position(v[2]);
+                    Vector nn(dg.nn);
+                    assert(std::fabs(nn.length() - 1.0f) < 1e-3f);
+                    assert(std::fabs(dot(nn, normalize(p1 - p0))) < 1e-3f && std::fabs(dot(nn, normalize(p2 - p0))) < 1e-3f);
+                    assert(std::fabs(dot(dg.dpdu, nn)) < 1e-3f * dg.dpdu.length() && std::fabs(dot(dg.dpdv, nn)) < 1e-3f * dg.dpdv.length());
+                    assert(dg.u > -1e-4f && dg.u < 1.0001f && dg.v > -1e-4f && dg.v < 1.0001f);
+
+                    // the point moves with uv as dpdu and dpdv say: p0 - p2 = dpdu (u0 - u2) + dpdv (v0 - v2)
+                    Vector along = dg.dpdu * (uv[2 * v[0]] - uv[2 * v[2]]) + dg.dpdv * (uv[2 * v[0] + 1] - uv[2 * v[2] + 1]);
+                    assert(veq(along, p0 - p2, (p0 - p2).length()));
+                    float b1 = hit.u, b2 = hit.v, b0 = 1.0f - b1 - b2;
+                    assert(std::fabs(dg.u - (b0 * uv[2 * v[0]] + b1 * uv[2 * v[1]] + b2 * uv[2 * v[2]])) < 1e-4f);
+
+                    // the normal faces the interpolated normals, or the way the uvs, the transform and
+                    // reverseOrientation say (the grid's uvs run with its winding, and the scale's -1 swaps handedness)
+                    if (withNormals) {
+                        SoA3 n = mesh.normals.soa();
+                        Vector ns = Vector(n.normal(v[0])) * b0 + Vector(n.normal(v[1])) * b1 + Vector(n.normal(v[2])) * b2;
+                        assert(dot(nn, ns) > 0);
+                    } else {
+                        assert((dot(nn, cross(p1 - p0, p2 - p0)) > 0) == reversed);
+                    }
+                }
+                assert(hits > 100);
+            }
+    }
+
+    inline void run_all_triangle_mesh_tests() {
+        test_matches_reference();
+        test_watertight();
+        test_does_intersect_keeps_t_max();
+        test_mismatched_arrays();
+        test_packets<4>();
+        test_packets<8>();
+        test_packets<16>();
+        test_differential_geometry();
+        std::cout << "[test_triangle_mesh] all TriangleMesh tests passed\n";
+    }
+}
+
+#endif // TEST_TRIANGLE_MESH_H
@@ -107,8 +107,34 @@ namespace test_vector {
         assert(feq(v[0], 7.7f));
         assert(feq(v[1], 8.8f));
         assert(feq(v[2], 9.9f));
-        float oob = v[42];
-        assert(std::isnan(oob));
+
+        // the index aliases the named member
+        v[1] = 1.5f;
+        assert(v.y == 1.5f && &v[2] == &v.z);
+        Normal n(1, 2, 3);
+        n[0] = 4;
+        assert(n.x == 4 && n[2] == 3);
+    }
+
+    inline void test_min_max_abs_fma() {
+        Vector a(1, -5, 3), b(-2, 4, 3);
+        Vector lo = min(a, b), hi = max(a, b);
+        assert(lo.x == -2 && lo.y == -5 && lo.z == 3);
+        assert(hi.x == 1 && hi.y == 4 && hi.z == 3);
+        Vector ab = abs(a);
+        assert(ab.x == 1 && ab.y == 5 && ab.z == 3);
+        Normal an = abs(Normal(-1, 0, 2));
+        assert(an.x == 1 && an.y == 0 && an.z == 2);
+        Vector f = fma(a, b, Vector(1, 1, 1));
+        assert(f.x == -1 && f.y == -19 && f.z == 10);
+
+        assert(minComponent(a) == -5 && maxComponent(a) == 3);
+        assert(maxDimension(Vector(3, 2, 1)) == 0);
+        assert(maxDimension(Vector(1, 3, 2)) == 1);
+        assert(maxDimension(Vector(1, 2, 3)) == 2);
+        // ties go to the later axis, like Bbox::maximumExtent always did
+        assert(maxDimension(Vector(2, 2, 1)) == 1);
+        assert(maxDimension(Vector(2, 2, 2)) == 2);
     }
 
     inline void test_dot_cross_normalize() {
@@ -135,6 +161,19 @@ namespace test_vector {
         assert(feq(nv.x, 4) && feq(nv.y, 5) && feq(nv.z, 6));
     }
 
+    inline void test_constexpr() {
+        constexpr Vector a(1, 2, 3), b(4, 5, 6);
+        static_assert(dot(a, b) == 32, "dot");
+        constexpr Vector c = cross(a, b);
+        static_assert(c.x == -3 && c.y == 6 && c.z == -3, "cross");
+        constexpr Vector d = (a + b) * 2.0f - -a / 1.0f;
+        static_assert(d.x == 11 && d.y == 16 && d.z == 21, "arithmetic");
+        static_assert(a.lengthSquared() == 14, "lengthSquared");
+        constexpr Normal n = Normal(a) * 2.0f;
+        static_assert(Vector(n).y == 4 && dot(n, n) == 56, "Normal");
+        static_assert(maxDimension(abs(-b)) == 2 && maxComponent(min(a, b)) == 3, "min/max/abs");
+    }
+
     inline void run_all_vector_tests() {
         test_default_constructor();
         test_parameter_constructor();
@@ -143,8 +182,10 @@ namespace test_vector {
         test_scalar_mul_div();
         test_unary_neg();
         test_index_operator();
+        test_min_max_abs_fma();
         test_dot_cross_normalize();
         test_conversion();
+        test_constexpr();
         std::cout << "[test_vector] all Vector/Normal tests passed\n";
     }
 }
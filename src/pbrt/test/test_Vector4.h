@@ -0,0 +1,74 @@
+#ifndef TEST_VECTOR4_H
+#define TEST_VECTOR4_H
+
+#include "Vector4.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+namespace test_vector4 {
+    inline bool same(const Vector4& v, float x, float y, float z, float w) {
+        return v.x == x && v.y == y && v.z == z && v.w == w;
+    }
+
+    inline void test_layout() {
+        static_assert(sizeof(Vector4) == 16 && alignof(Vector4) == 16, "one SSE register");
+        Vector4 v(1, 2, 3, 4);
+        for (int i = 0; i < 4; ++i) assert(v[i] == (float)(i + 1));
+        v[3] = 9;
+        assert(v.w == 9 && &v[0] == &v.x);
+
+        // Vectors are directions, Points are positions
+        assert(same(Vector4(Vector(1, 2, 3)), 1, 2, 3, 0));
+        assert(same(Vector4(Point(1, 2, 3)), 1, 2, 3, 1));
+        Vector4 p(Point(4, 5, 6));
+        assert(p.point().y == 5 && p.xyz().z == 6);
+    }
+
+    inline void test_arithmetic() {
+        Vector4 a(1, -2, 3, -4), b(2, 4, -6, 8);
+        assert(same(a + b, 3, 2, -3, 4));
+        assert(same(a - b, -1, -6, 9, -12));
+        assert(same(a * b, 2, -8, -18, -32));
+        assert(same(b / Vector4(2, 4, -6, 8), 1, 1, 1, 1));
+        assert(same(a * 2.0f, 2, -4, 6, -8));
+        assert(same(b / 2.0f, 1, 2, -3, 4));
+        assert(same(-a, -1, 2, -3, 4));
+
+        Vector4 c = a;
+        c += b; c -= a; c *= Vector4(2); c /= Vector4(2);
+        assert(same(c, 2, 4, -6, 8));
+    }
+
+    inline void test_min_max_abs_fma() {
+        Vector4 a(1, -2, 3, -4), b(2, -4, -6, 8);
+        assert(same(min(a, b), 1, -4, -6, -4));
+        assert(same(max(a, b), 2, -2, 3, 8));
+        assert(same(abs(a), 1, 2, 3, 4));
+        assert(same(abs(Vector4(-0.0f)), 0, 0, 0, 0) && !std::signbit(abs(Vector4(-0.0f)).x));
+        assert(same(fma(a, b, Vector4(1)), 3, 9, -17, -31));
+
+        // a NaN in either argument yields the second one, with and without SSE
+        Vector4 n(NAN, 0, 0, 0);
+        assert(min(n, a).x == 1 && std::isnan(min(a, n).x));
+        assert(max(n, a).x == 1 && std::isnan(max(a, n).x));
+    }
+
+    inline void test_horizontal() {
+        Vector4 a(1, -2, 3, -4);
+        assert(hmin(a) == -4 && hmax(a) == 3 && hsum(a) == -2);
+        assert(hmin(Vector4(5, 6, 7, 0)) == 0 && hmax(Vector4(9, 6, 7, 0)) == 9);
+        assert(dot(a, Vector4(1, 1, 1, 1)) == -2);
+        assert(dot(Vector4(Vector(1, 2, 3)), Vector4(Point(4, 5, 6))) == 32); // w = 0 drops out
+    }
+
+    inline void run_all_vector4_tests() {
+        test_layout();
+        test_arithmetic();
+        test_min_max_abs_fma();
+        test_horizontal();
+        std::cout << "[test_vector4] all Vector4 tests passed\n";
+    }
+}
+
+#endif // TEST_VECTOR4_H